@@ -34,15 +34,42 @@
 #include "common/common.h"
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/atomic.hpp>
 
 namespace srslte {
 
+struct buffer_pool_metrics_t
+{
+  uint64_t cache_hits;      // allocations served by the thread cache
+  uint64_t depot_refills;   // batches taken from the depots
+  uint64_t depot_drains;    // batches returned to the depots
+  uint64_t grow_failures;   // allocations refused by the memory limit
+  uint64_t memory_bytes;    // memory currently held by the pool
+  uint32_t nof_buffers[BUFFER_CLASS_N_ITEMS];     // buffers created per class
+  uint32_t in_use[BUFFER_CLASS_N_ITEMS];          // buffers outside the depot (in use or cached)
+  uint32_t high_water_mark[BUFFER_CLASS_N_ITEMS]; // max value of in_use
+};
+
 /******************************************************************************
  * Buffer pool
  *
- * Preallocates a large number of srsue_byte_buffer_t and provides allocate and
- * deallocate functions. Provides quick object creation and deletion as well
- * as object reuse. Uses a linked list to keep track of available buffers.
+ * Provides allocate and deallocate functions for byte buffers of three size
+ * classes (small, MTU and max TBS). allocate(nof_bytes) returns a buffer of
+ * the smallest class that fits, falling back to larger classes when needed.
+ * The pool grows in chunks of CHUNK_SIZE buffers up to a memory limit.
+ *
+ * Each thread keeps a small cache of free buffers per class. Caches are
+ * refilled from and drained to a shared depot in batches of CACHE_BATCH
+ * buffers. The depot is a lock-free stack of batches, so allocate() and
+ * deallocate() only take a lock when the pool needs to grow. Buffers not
+ * owned by the pool are reset but not recycled.
+ *
+ * allocate_ref() returns a segment referencing bytes of another buffer
+ * without copying them. Segments come from a class of descriptors with no
+ * payload of their own. The referenced buffer is recycled once its owner
+ * and all referencing segments have been deallocated. deallocate() frees
+ * a whole segment chain and flatten() turns one into a contiguous buffer.
  * Singleton class - only one exists for the UE.
  *****************************************************************************/
 class buffer_pool{
@@ -54,20 +81,85 @@ public:
   static void           cleanup(void);
 
   byte_buffer_t*        allocate();
+  byte_buffer_t*        allocate(uint32_t nof_bytes);
   void                  deallocate(byte_buffer_t *b);
 
+  // Segment covering nof_bytes of b starting offset bytes after b->msg
+  byte_buffer_t*        allocate_ref(byte_buffer_t *b, uint32_t offset, uint32_t nof_bytes);
+  // Returns the chain starting at b as a single buffer, or NULL leaving b valid
+  byte_buffer_t*        flatten(byte_buffer_t *b);
+
+  // Returns a buffer able to hold nof_bytes from msg, moving the contents if b is too small
+  byte_buffer_t*        resize(byte_buffer_t *b, uint32_t nof_bytes);
+
+  void                  set_max_memory(uint64_t max_bytes);
+  void                  get_metrics(buffer_pool_metrics_t &m);
+
 private:
   buffer_pool();
-  ~buffer_pool(){ delete [] pool; }
+  ~buffer_pool();
   buffer_pool(buffer_pool const&);    // Disabled
   void operator=(buffer_pool const&); // Disabled
 
-  static const int      POOL_SIZE = 2048;
-  byte_buffer_t        *pool;
-  byte_buffer_t        *first_available;
-  boost::mutex          mutex;
+  static const int      CACHE_BATCH    = 16;
+  static const int      CACHE_SIZE     = 2*CACHE_BATCH;
+  static const uint32_t CHUNK_SIZE     = 256;
+  static const uint32_t MAX_CHUNKS     = 1024;
+  static const uint32_t NIL            = 0xFFFFFFFF;
+  static const uint64_t DEFAULT_MAX_MEMORY = 64*1024*1024;
+
+  typedef struct {
+    byte_buffer_t           *buffers;
+    uint8_t                 *storage;
+    // Depot links, indexed by the position of the first buffer of a batch
+    boost::atomic<uint32_t> *batch_next;
+    uint32_t                *batch_len;
+  } chunk_t;
+
+  typedef struct {
+    uint32_t                 buffer_len;
+    uint32_t                 header_offset;
+    uint32_t                 tail_offset;
+    chunk_t                  chunks[MAX_CHUNKS];
+    boost::atomic<uint32_t>  nof_chunks;
+    // Tagged head: ABA counter << 32 | pool index of the first buffer of the top batch
+    boost::atomic<uint64_t>  depot_head;
+    boost::atomic<int32_t>   in_use;
+    boost::atomic<int32_t>   high_water_mark;
+  } class_t;
+
+  typedef struct {
+    uint32_t        generation;
+    uint32_t        count[BUFFER_CLASS_N_ITEMS];
+    byte_buffer_t  *buffers[BUFFER_CLASS_N_ITEMS][CACHE_SIZE];
+    uint64_t        hits;
+  } cache_t;
+
+  byte_buffer_t*        allocate_class(uint32_t c);
+  void                  release(byte_buffer_t *b);
+  void                  recycle(byte_buffer_t *b);
+  byte_buffer_t*        get_buffer(class_t *cl, uint32_t idx);
+  cache_t*              get_cache();
+  bool                  grow(uint32_t c);
+  bool                  depot_pop(uint32_t c, cache_t *cache);
+  void                  depot_push(uint32_t c, byte_buffer_t **buffers, uint32_t n);
+  void                  flush_hits(cache_t *c);
+  static void           release_cache(cache_t *c);
+
+  class_t               classes[BUFFER_CLASS_N_ITEMS];
+  boost::mutex          grow_mutex;
+  uint64_t              max_memory;
+  boost::atomic<uint64_t> memory_bytes;
+
+  uint32_t              generation;
+  static boost::atomic<uint32_t>            next_generation;
+  static boost::thread_specific_ptr<cache_t> cache;
   static boost::mutex   instance_mutex;
-  int                   allocated;
+
+  boost::atomic<uint64_t> cache_hits;
+  boost::atomic<uint64_t> depot_refills;
+  boost::atomic<uint64_t> depot_drains;
+  boost::atomic<uint64_t> grow_failures;
 };
 
 
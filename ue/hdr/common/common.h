@@ -33,7 +33,9 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/atomic.hpp>
 
 /*******************************************************************************
                               DEFINES
@@ -51,6 +53,13 @@
 #define SRSUE_MAX_BUFFER_SIZE_BYTES 12756
 #define SRSUE_BUFFER_HEADER_OFFSET  1024
 
+// Buffer size classes used by the buffer pool. Sizes exclude the headroom
+// and the tailroom reserved for trailers such as the PDCP MAC-I.
+#define SRSUE_SMALL_BUFFER_SIZE_BYTES     256
+#define SRSUE_MTU_BUFFER_SIZE_BYTES       2048
+#define SRSUE_SMALL_BUFFER_HEADER_OFFSET  64
+#define SRSUE_SMALL_BUFFER_TAIL_OFFSET    16
+
 namespace bpt = boost::posix_time;
 
 /*******************************************************************************
@@ -59,6 +68,14 @@ namespace bpt = boost::posix_time;
 
 namespace srslte {
 
+// Monotonic time in ns used to timestamp packets, 0 means not set
+static inline uint64_t get_time_ns()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t) t.tv_sec*1000000000 + t.tv_nsec;
+}
+
 typedef enum{
   ERROR_NONE = 0,
   ERROR_INVALID_PARAMS,
@@ -107,66 +124,188 @@ static const char rb_id_text[RB_ID_N_ITEMS][20] = { "SRB0",
  * Generic buffers with headroom to accommodate packet headers and custom
  * copy constructors & assignment operators for quick copying. Byte buffer
  * holds a next pointer to support linked lists.
+ *
+ * A default-constructed byte buffer owns SRSUE_MAX_BUFFER_SIZE_BYTES of
+ * storage. Buffers from the buffer pool wrap smaller, pool-owned storage
+ * of one of the size classes below.
+ *
+ * A packet may be held as a chain of segments linked through next, each
+ * segment covering N_bytes from its msg. The head segment carries the
+ * timestamp and opt fields of the packet. A segment may reference the
+ * storage of another buffer (see buffer_pool::allocate_ref), in which case
+ * it has no headroom or tailroom of its own.
  *****************************************************************************/
+typedef enum{
+  BUFFER_CLASS_SMALL = 0,
+  BUFFER_CLASS_MTU,
+  BUFFER_CLASS_MAX,
+  BUFFER_CLASS_REF,                         // Segment descriptors, no payload
+  BUFFER_CLASS_N_ITEMS,
+  BUFFER_CLASS_NONE = BUFFER_CLASS_N_ITEMS, // Not owned by the pool
+}buffer_class_t;
+static const char buffer_class_text[BUFFER_CLASS_N_ITEMS][20] = { "Small",
+                                                                   "MTU",
+                                                                   "Max",
+                                                                   "Ref"};
+
 class byte_buffer_t{
 public:
     uint32_t    N_bytes;
-    uint8_t     buffer[SRSUE_MAX_BUFFER_SIZE_BYTES];
+    uint8_t    *buffer;
     uint8_t    *msg;
-    bpt::ptime  timestamp;
+    uint64_t    timestamp;
     uint32_t     opt, opt2; 
 
     byte_buffer_t():N_bytes(0)
     {
-      msg  = &buffer[SRSUE_BUFFER_HEADER_OFFSET];
+      buffer        = new uint8_t[SRSUE_MAX_BUFFER_SIZE_BYTES];
+      buffer_len    = SRSUE_MAX_BUFFER_SIZE_BYTES;
+      header_offset = SRSUE_BUFFER_HEADER_OFFSET;
+      owns_buffer   = true;
+      size_class    = BUFFER_CLASS_NONE;
+      pool_idx      = 0;
+      parent        = NULL;
+      nof_users.store(1, boost::memory_order_relaxed);
+      msg  = &buffer[header_offset];
+      next = NULL; 
+      opt  = 0; 
+      opt2 = 0; 
+      timestamp = 0;
+    }
+    // Wraps external storage of len bytes, which is not freed by the buffer
+    byte_buffer_t(uint8_t *storage, uint32_t len, uint32_t headroom):N_bytes(0)
+    {
+      buffer        = storage;
+      buffer_len    = len;
+      header_offset = headroom;
+      owns_buffer   = false;
+      size_class    = BUFFER_CLASS_NONE;
+      pool_idx      = 0;
+      parent        = NULL;
+      nof_users.store(1, boost::memory_order_relaxed);
+      msg  = &buffer[header_offset];
       next = NULL; 
       opt  = 0; 
       opt2 = 0; 
+      timestamp = 0;
     }
     byte_buffer_t(const byte_buffer_t& buf)
     {
-      N_bytes = buf.N_bytes;
+      buffer        = new uint8_t[SRSUE_MAX_BUFFER_SIZE_BYTES];
+      buffer_len    = SRSUE_MAX_BUFFER_SIZE_BYTES;
+      header_offset = SRSUE_BUFFER_HEADER_OFFSET;
+      owns_buffer   = true;
+      size_class    = BUFFER_CLASS_NONE;
+      pool_idx      = 0;
+      parent        = NULL;
+      nof_users.store(1, boost::memory_order_relaxed);
+      msg       = &buffer[header_offset];
+      next      = NULL;
+      opt       = buf.opt;
+      opt2      = buf.opt2;
+      timestamp = buf.timestamp;
+      N_bytes   = buf.N_bytes;
       memcpy(msg, buf.msg, N_bytes);
     }
-    byte_buffer_t & operator= (const byte_buffer_t & buf)
+    ~byte_buffer_t()
     {
+      if(owns_buffer)
+        delete [] buffer;
+    }
+    // Copies the contents of buf. Pool buffers may belong to a smaller size
+    // class than buf: returns false without copying if buf does not fit.
+    bool copy_from(const byte_buffer_t &buf)
+    {
+      if(this == &buf)
+        return true;
+      uint32_t capacity = parent ? 0 : buffer_len - (msg-buffer);
+      if(buf.N_bytes > capacity)
+        return false;
       N_bytes = buf.N_bytes;
       memcpy(msg, buf.msg, N_bytes);
+      return true;
     }
     void reset()
     {
-      msg       = &buffer[SRSUE_BUFFER_HEADER_OFFSET];
+      msg       = &buffer[header_offset];
       N_bytes   = 0;
-      timestamp = bpt::not_a_date_time;
+      timestamp = 0;
     }
     uint32_t get_headroom()
     {
+      if(parent)
+        return 0;
       return msg-buffer;
     }
+    // Bytes that can still be appended after msg[N_bytes-1]
+    uint32_t get_tailroom()
+    {
+      if(parent)
+        return 0;
+      return buffer_len - (msg-buffer) - N_bytes;
+    }
+    buffer_class_t get_size_class() { return size_class; }
+    bool is_ref() { return parent != NULL; }
+    void set_timestamp()
+    {
+      timestamp = get_time_ns();
+    }
     long get_latency_us()
     {
-      if(timestamp.is_not_a_date_time())
+      if(!timestamp)
         return 0;
-      bpt::time_duration td = bpt::microsec_clock::local_time() - timestamp;
-      return td.total_microseconds();
+      return (get_time_ns() - timestamp)/1000;
     }
 
     // Linked list support
     byte_buffer_t*  get_next() { return next; }
     void set_next(byte_buffer_t *b) { next = b; }
+
+    // Segment chain support
+    void append_segment(byte_buffer_t *b)
+    {
+      byte_buffer_t *tail = this;
+      while(tail->next)
+        tail = tail->next;
+      tail->next = b;
+    }
+    uint32_t get_chain_bytes()
+    {
+      uint32_t n = 0;
+      for(byte_buffer_t *b = this; b; b = b->next)
+        n += b->N_bytes;
+      return n;
+    }
+    uint32_t get_nof_segments()
+    {
+      uint32_t n = 0;
+      for(byte_buffer_t *b = this; b; b = b->next)
+        n++;
+      return n;
+    }
 private:
-    byte_buffer_t *next;
+    friend class buffer_pool;
+    byte_buffer_t & operator= (const byte_buffer_t & buf); // Disabled, use copy_from()
+    byte_buffer_t  *next;
+    byte_buffer_t  *parent;     // Buffer whose storage msg points into, if any
+    boost::atomic<uint32_t> nof_users; // Owner plus segments referencing the storage
+    uint32_t        buffer_len;
+    uint32_t        header_offset;
+    bool            owns_buffer;
+    buffer_class_t  size_class;
+    uint32_t        pool_idx;
 };
 
 struct bit_buffer_t{
     uint32_t    N_bits;
     uint8_t     buffer[SRSUE_MAX_BUFFER_SIZE_BITS];
     uint8_t    *msg;
-    bpt::ptime  timestamp;
+    uint64_t    timestamp;
 
     bit_buffer_t():N_bits(0)
     {
-      msg = &buffer[SRSUE_BUFFER_HEADER_OFFSET];
+      msg       = &buffer[SRSUE_BUFFER_HEADER_OFFSET];
+      timestamp = 0;
     }
     bit_buffer_t(const bit_buffer_t& buf){
       N_bits = buf.N_bits;
@@ -180,18 +319,21 @@ struct bit_buffer_t{
     {
       msg       = &buffer[SRSUE_BUFFER_HEADER_OFFSET];
       N_bits    = 0;
-      timestamp = bpt::not_a_date_time;
+      timestamp = 0;
     }
     uint32_t get_headroom()
     {
       return msg-buffer;
     }
+    void set_timestamp()
+    {
+      timestamp = get_time_ns();
+    }
     long get_latency_us()
     {
-      if(timestamp.is_not_a_date_time())
+      if(!timestamp)
         return 0;
-      bpt::time_duration td = bpt::microsec_clock::local_time() - timestamp;
-      return td.total_microseconds();
+      return (get_time_ns() - timestamp)/1000;
     }
 };
 
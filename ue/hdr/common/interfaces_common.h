@@ -10,10 +10,12 @@ class mac_interface_timers
 {
 public: 
   /* Timer services with ms resolution. 
-   * timer_id must be lower than MAC_NOF_UPPER_TIMERS
+   * timer_id must be obtained with get_unique_id() and given back with
+   * release_id() once it is no longer used
    */
   virtual timers::timer* get(uint32_t timer_id) = 0;
   virtual uint32_t               get_unique_id() = 0;
+  virtual void                   release_id(uint32_t timer_id) = 0;
 };
 
 class read_pdu_interface
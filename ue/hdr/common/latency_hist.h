@@ -0,0 +1,81 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/******************************************************************************
+ *  File:         latency_hist.h
+ *  Description:  Lock-free latency histogram with logarithmic buckets.
+ *                Each power of two is split into
+ *                2^LATENCY_HIST_SUB_BITS linear sub-buckets, so the
+ *                reported percentiles are within 12.5% of the true value
+ *                across the whole uint32 microsecond range. add() may be
+ *                called from any thread; get_metrics() takes a snapshot
+ *                and restarts the measurement period.
+ *  Reference:    HdrHistogram
+ *****************************************************************************/
+
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdint.h>
+#include <boost/atomic.hpp>
+
+#define LATENCY_HIST_SUB_BITS     3
+#define LATENCY_HIST_NOF_BUCKETS  ((32-LATENCY_HIST_SUB_BITS+1)<<LATENCY_HIST_SUB_BITS)
+
+namespace srslte {
+
+typedef struct {
+  uint32_t count;
+  float    mean_us;
+  float    p50_us;
+  float    p90_us;
+  float    p99_us;
+  float    max_us;
+} latency_metrics_t;
+
+class latency_hist
+{
+public:
+  latency_hist();
+  void add(uint32_t latency_us);
+  void get_metrics(latency_metrics_t &m);
+  void reset();
+
+  static uint32_t bucket_idx(uint32_t latency_us);
+  static uint32_t bucket_low(uint32_t idx);
+  static uint32_t bucket_width(uint32_t idx);
+
+private:
+  float percentile(uint32_t *counts, uint32_t total, float p);
+
+  boost::atomic<uint32_t> buckets[LATENCY_HIST_NOF_BUCKETS];
+  boost::atomic<uint64_t> sum_us;
+  boost::atomic<uint32_t> max_us;
+};
+
+} // namespace srslte
+
+#endif // LATENCY_HIST_H
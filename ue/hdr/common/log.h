@@ -54,6 +54,39 @@ static const char log_level_text[LOG_LEVEL_N_ITEMS][16] = {"None   ",
                                                            "Info   ",
                                                            "Debug  "};
 
+/* Compile-time maximum log level of each layer. Log statements written
+ * with SRSLTE_LOG above it are removed by the compiler, e.g. build with
+ * -DSRSLTE_LOG_MAX_LEVEL_PHY=srslte::LOG_LEVEL_INFO to strip PHY debug.
+ */
+#ifndef SRSLTE_LOG_MAX_LEVEL
+#define SRSLTE_LOG_MAX_LEVEL      srslte::LOG_LEVEL_DEBUG
+#endif
+#ifndef SRSLTE_LOG_MAX_LEVEL_PHY
+#define SRSLTE_LOG_MAX_LEVEL_PHY  SRSLTE_LOG_MAX_LEVEL
+#endif
+#ifndef SRSLTE_LOG_MAX_LEVEL_MAC
+#define SRSLTE_LOG_MAX_LEVEL_MAC  SRSLTE_LOG_MAX_LEVEL
+#endif
+#ifndef SRSLTE_LOG_MAX_LEVEL_RLC
+#define SRSLTE_LOG_MAX_LEVEL_RLC  SRSLTE_LOG_MAX_LEVEL
+#endif
+#ifndef SRSLTE_LOG_MAX_LEVEL_PDCP
+#define SRSLTE_LOG_MAX_LEVEL_PDCP SRSLTE_LOG_MAX_LEVEL
+#endif
+#ifndef SRSLTE_LOG_MAX_LEVEL_GW
+#define SRSLTE_LOG_MAX_LEVEL_GW   SRSLTE_LOG_MAX_LEVEL
+#endif
+
+/* Checks the compile-time and run-time level before the arguments are
+ * evaluated, so a disabled log statement costs a single branch.
+ * E.g. SRSLTE_LOG(log_h, MAC, INFO, info_line, __FILE__, __LINE__, fmt, ...)
+ */
+#define SRSLTE_LOG_ENABLED(h, layer, lvl) \
+  (srslte::LOG_LEVEL_##lvl <= SRSLTE_LOG_MAX_LEVEL_##layer && (h)->get_level() >= srslte::LOG_LEVEL_##lvl)
+
+#define SRSLTE_LOG(h, layer, lvl, fn, ...) \
+  do { if (SRSLTE_LOG_ENABLED(h, layer, lvl)) (h)->fn(__VA_ARGS__); } while(0)
+
 class log
 {
 public:
@@ -95,23 +128,23 @@ public:
   }
 
   // Pure virtual methods for logging
-  virtual void console(std::string message, ...) = 0;
-  virtual void error(std::string message, ...)   = 0;
-  virtual void warning(std::string message, ...) = 0;
-  virtual void info(std::string message, ...)    = 0;
-  virtual void debug(std::string message, ...)   = 0;
+  virtual void console(const char *message, ...) = 0;
+  virtual void error(const char *message, ...)   = 0;
+  virtual void warning(const char *message, ...) = 0;
+  virtual void info(const char *message, ...)    = 0;
+  virtual void debug(const char *message, ...)   = 0;
 
   // Same with hex dump
-  virtual void error_hex(uint8_t *hex, int size, std::string message, ...){error("error_hex not implemented.\n");}
-  virtual void warning_hex(uint8_t *hex, int size, std::string message, ...){error("warning_hex not implemented.\n");}
-  virtual void info_hex(uint8_t *hex, int size, std::string message, ...){error("info_hex not implemented.\n");}
-  virtual void debug_hex(uint8_t *hex, int size, std::string message, ...){error("debug_hex not implemented.\n");}
+  virtual void error_hex(uint8_t *hex, int size, const char *message, ...){error("error_hex not implemented.\n");}
+  virtual void warning_hex(uint8_t *hex, int size, const char *message, ...){error("warning_hex not implemented.\n");}
+  virtual void info_hex(uint8_t *hex, int size, const char *message, ...){error("info_hex not implemented.\n");}
+  virtual void debug_hex(uint8_t *hex, int size, const char *message, ...){error("debug_hex not implemented.\n");}
 
   // Same with line and file info
-  virtual void error_line(std::string file, int line, std::string message, ...){error("error_line not implemented.\n");}
-  virtual void warning_line(std::string file, int line, std::string message, ...){error("warning_line not implemented.\n");}
-  virtual void info_line(std::string file, int line, std::string message, ...){error("info_line not implemented.\n");}
-  virtual void debug_line(std::string file, int line, std::string message, ...){error("debug_line not implemented.\n");}
+  virtual void error_line(const char *file, int line, const char *message, ...){error("error_line not implemented.\n");}
+  virtual void warning_line(const char *file, int line, const char *message, ...){error("warning_line not implemented.\n");}
+  virtual void info_line(const char *file, int line, const char *message, ...){error("info_line not implemented.\n");}
+  virtual void debug_line(const char *file, int line, const char *message, ...){error("debug_line not implemented.\n");}
 
 protected:
   std::string get_service_name() { return service_name; }
@@ -51,21 +51,21 @@ public:
 
   void init(std::string layer, logger *logger_, bool tti=false);
 
-  void console(std::string message, ...);
-  void error(std::string message, ...);
-  void warning(std::string message, ...);
-  void info(std::string message, ...);
-  void debug(std::string message, ...);
+  void console(const char *message, ...);
+  void error(const char *message, ...);
+  void warning(const char *message, ...);
+  void info(const char *message, ...);
+  void debug(const char *message, ...);
 
-  void error_hex(uint8_t *hex, int size, std::string message, ...);
-  void warning_hex(uint8_t *hex, int size, std::string message, ...);
-  void info_hex(uint8_t *hex, int size, std::string message, ...);
-  void debug_hex(uint8_t *hex, int size, std::string message, ...);
+  void error_hex(uint8_t *hex, int size, const char *message, ...);
+  void warning_hex(uint8_t *hex, int size, const char *message, ...);
+  void info_hex(uint8_t *hex, int size, const char *message, ...);
+  void debug_hex(uint8_t *hex, int size, const char *message, ...);
 
-  void error_line(std::string file, int line, std::string message, ...);
-  void warning_line(std::string file, int line, std::string message, ...);
-  void info_line(std::string file, int line, std::string message, ...);
-  void debug_line(std::string file, int line, std::string message, ...);
+  void error_line(const char *file, int line, const char *message, ...);
+  void warning_line(const char *file, int line, const char *message, ...);
+  void info_line(const char *file, int line, const char *message, ...);
+  void debug_line(const char *file, int line, const char *message, ...);
 
 private:
   logger *logger_h;
@@ -73,7 +73,9 @@ private:
 
   void all_log(srslte::LOG_LEVEL_ENUM level, uint32_t tti, char *msg);
   void all_log(srslte::LOG_LEVEL_ENUM level, uint32_t tti, char *msg, uint8_t *hex, int size);
-  void all_log_line(srslte::LOG_LEVEL_ENUM level, uint32_t tti, std::string file, int line, char *msg);
+  void all_log_line(srslte::LOG_LEVEL_ENUM level, uint32_t tti, const char *file, int line, char *msg);
+  void log_va(srslte::LOG_LEVEL_ENUM level, const char *file, int line,
+              uint8_t *hex, int size, const char *message, va_list args);
   std::string now_time();
   std::string hex_string(uint8_t *hex, int size);
 };
@@ -47,31 +47,31 @@ public:
 
   log_stdout(std::string service_name_) : log(service_name_) { }
   
-  void console(std::string message, ...);
-  void error(std::string message, ...);
-  void warning(std::string message, ...);
-  void info(std::string message, ...);
-  void debug(std::string message, ...);
+  void console(const char *message, ...);
+  void error(const char *message, ...);
+  void warning(const char *message, ...);
+  void info(const char *message, ...);
+  void debug(const char *message, ...);
 
   // Same with hex dump
-  void error_hex(uint8_t *hex, int size, std::string message, ...);
-  void warning_hex(uint8_t *hex, int size, std::string message, ...);
-  void info_hex(uint8_t *hex, int size, std::string message, ...);
-  void debug_hex(uint8_t *hex, int size, std::string message, ...);
+  void error_hex(uint8_t *hex, int size, const char *message, ...);
+  void warning_hex(uint8_t *hex, int size, const char *message, ...);
+  void info_hex(uint8_t *hex, int size, const char *message, ...);
+  void debug_hex(uint8_t *hex, int size, const char *message, ...);
 
   // Same with line and file info
-  void error_line(std::string file, int line, std::string message, ...);
-  void warning_line(std::string file, int line, std::string message, ...);
-  void info_line(std::string file, int line, std::string message, ...);
-  void debug_line(std::string file, int line, std::string message, ...);
+  void error_line(const char *file, int line, const char *message, ...);
+  void warning_line(const char *file, int line, const char *message, ...);
+  void info_line(const char *file, int line, const char *message, ...);
+  void debug_line(const char *file, int line, const char *message, ...);
 
 private:
-  void printlog(srslte::LOG_LEVEL_ENUM level, uint32_t tti, std::string file, int line, std::string message, va_list args);
-  void printlog(srslte::LOG_LEVEL_ENUM level, uint32_t tti, std::string message, va_list args);
+  void printlog(srslte::LOG_LEVEL_ENUM level, uint32_t tti, const char *file, int line, const char *message, va_list args);
+  void printlog(srslte::LOG_LEVEL_ENUM level, uint32_t tti, const char *message, va_list args);
 
   void all_log(srslte::LOG_LEVEL_ENUM level, uint32_t tti, char *msg);
   void all_log(srslte::LOG_LEVEL_ENUM level, uint32_t tti, char *msg, uint8_t *hex, int size);
-  void all_log_line(srslte::LOG_LEVEL_ENUM level, uint32_t tti, std::string file, int line, char *msg);
+  void all_log_line(srslte::LOG_LEVEL_ENUM level, uint32_t tti, const char *file, int line, char *msg);
   std::string now_time();
   std::string hex_string(uint8_t *hex, int size);
 };
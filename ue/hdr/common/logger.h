@@ -28,48 +28,188 @@
  * File:        logger.h
  * Description: Common log object. Maintains a queue of log messages
  *              and runs a thread to read messages and write to file.
- *              Multiple producers, single consumer. If full, producers
- *              increase queue size. If empty, consumer blocks.
+ *              Multiple producers, single consumer. If empty, consumer
+ *              blocks. The consumer takes the whole queue at once and
+ *              copies it into a page-aligned write buffer, so the file
+ *              sees a few large writes instead of one per message.
+ *
+ *              Queued messages are limited to max_queue_bytes. Beyond
+ *              that, messages are dropped according to the drop policy
+ *              and counted, and a notice is written to the log. With
+ *              rotation enabled, the file is renamed to file.1 (file.1
+ *              to file.2 and so on) when it reaches max_file_bytes.
+ *
+ *              In binary mode, log_binary() writes a compact record
+ *              (timestamp, level, layer, TTI, format string pointer and
+ *              raw arguments) into a lock-free ring owned by the calling
+ *              thread and formatting happens on the logger thread.
+ *              Format strings must outlive the logger. If a ring is full
+ *              the record is dropped and counted. %s arguments longer
+ *              than LOG_MAX_STR_LEN are cut and marked as truncated.
+ *              Rings are found through a thread-specific key and freed
+ *              once drained after their thread exits. The logger thread
+ *              sleeps on a futex eventcount when there is nothing to
+ *              write and producers only wake it when it is parked.
  *****************************************************************************/
 
 #ifndef LOGGER_H
 #define LOGGER_H
 
 #include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
 #include <string>
+#include <vector>
 #include <boost/shared_ptr.hpp>
+#include <boost/atomic.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition.hpp>
 #include <boost/circular_buffer.hpp>
+#include "common/log.h"
 
 namespace srslte {
 
 typedef boost::shared_ptr<std::string> str_ptr;
 
+typedef enum {
+  LOGGER_DROP_NEWEST = 0,   // Discard the message being logged
+  LOGGER_DROP_OLDEST,       // Discard queued messages to make room
+} logger_drop_policy_t;
+
+typedef struct {
+  uint64_t dropped_msgs;      // Text messages dropped by the queue limit
+  uint64_t dropped_records;   // Binary records dropped by full rings
+  uint64_t bytes_written;
+  uint32_t nof_rotations;
+  uint32_t queue_bytes;
+  uint32_t queue_bytes_max;   // High water mark
+}logger_metrics_t;
+
 class logger
 {
 public:
   logger();
   logger(std::string file);
   ~logger();
-  void init(std::string file);
+  void init(std::string file, bool binary_=false);
+
+  // max_file_bytes=0 disables rotation. Rotation changes made after init()
+  // are applied by the logger thread with the next batch.
+  void set_max_queue_bytes(uint32_t bytes, logger_drop_policy_t policy=LOGGER_DROP_NEWEST);
+  void set_rotation(uint64_t max_file_bytes, uint32_t nof_files);
+  void get_metrics(logger_metrics_t &m);
+
   void log(const char *msg);
   void log(str_ptr msg);
 
+  // Returns false if the message can't be encoded and must be logged as text
+  bool log_binary(LOG_LEVEL_ENUM level, const char *layer, bool do_tti, uint32_t tti,
+                  uint8_t *hex, int hex_len, const char *fmt, va_list args);
+  bool is_binary() { return binary; }
+
+  static const uint32_t LAYER_LEN = 16;
+
 private:
+  typedef struct {
+    uint32_t        size;       // Bytes including arguments, 0 pads to the end of the ring
+    uint8_t         level;
+    uint8_t         do_tti;
+    uint16_t        nof_args;
+    uint32_t        tti;
+    uint32_t        hex_len;
+    struct timespec time;
+    const char     *fmt;
+    char            layer[LAYER_LEN];
+  } record_t;
+
+  typedef struct {
+    uint16_t type;
+    uint16_t truncated;
+    uint32_t len;
+    union {
+      int         i;
+      long        l;
+      long long   ll;
+      double      d;
+      const void *p;
+    } v;
+  } record_arg_t;
+
+  // Byte ring written by a single thread and read by the logger thread
+  class ring
+  {
+  public:
+    ring();
+    uint8_t*  reserve(uint32_t size);
+    void      commit(uint32_t size);
+    record_t* front();
+    void      pop();
+    bool      empty();
+
+    boost::atomic<uint32_t>  dropped;
+    boost::atomic<bool>      released; // Set when the owner thread exits
+  private:
+    std::vector<uint8_t>     buf;
+    boost::atomic<uint32_t>  head;     // Read position, written by the logger thread
+    boost::atomic<uint32_t>  tail;     // Write position, written by the owner thread
+    uint32_t                 pad;      // Padding to skip on next commit
+  };
+
   static void* start(void *input);
   void reader_loop();
-  void flush();
+  ring* get_ring();
+  static void release_ring(void *r);
+  bool has_pending();
+  void wait_pending();
+  void wake_reader();
+  void push(str_ptr msg);
+  bool read_messages();
+  bool read_records();
+  void write_record(record_t *rec);
+  void append(const char *s, uint32_t len);
+  void write_buffer();
+  void write_file(const char *s, uint32_t len);
+  void rotate();
 
-  FILE*                               logfile;
+  int                                 fd;
   bool                                inited;
-  bool                                not_done;
+  boost::atomic<bool>                 not_done;
+  bool                                binary;
+  uint32_t                            id;
   std::string                         filename;
   boost::condition                    not_empty;
-  boost::condition                    not_full;
   boost::mutex                        mutex;
   pthread_t                           thread;
   boost::circular_buffer<str_ptr>     buffer;
+  boost::circular_buffer<str_ptr>     batch;
+
+  // Queue limit, protected by mutex. Bytes of the batch being written
+  // still count until the batch is released.
+  uint32_t                            queue_bytes;
+  uint32_t                            queue_bytes_max;
+  uint32_t                            max_queue_bytes;
+  logger_drop_policy_t                drop_policy;
+  uint64_t                            dropped_msgs;
+  uint64_t                            dropped_msgs_reported;
+  uint64_t                            new_max_file_bytes;
+  uint32_t                            new_nof_files;
+  bool                                rotation_changed;
+
+  // Write buffer and rotation, used by the logger thread only
+  char                               *wbuf;
+  uint32_t                            wbuf_len;
+  uint64_t                            file_bytes;
+  uint64_t                            max_file_bytes;
+  uint32_t                            nof_files;
+  boost::atomic<uint64_t>             bytes_written;
+  boost::atomic<uint32_t>             nof_rotations;
+  boost::atomic<uint64_t>             dropped_records;
+  boost::mutex                        rings_mutex;
+  std::vector<ring*>                  rings;
+  pthread_key_t                       ring_key;
+  boost::atomic<uint32_t>             events;          // Futex word, bumped to wake the logger thread
+  boost::atomic<uint32_t>             reader_waiting;
 };
 
 } // namespace srsue
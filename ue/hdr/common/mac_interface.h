@@ -69,6 +69,7 @@ public:
     bool                    decode_enabled;
     int                     rv;
     uint16_t                rnti; 
+    uint32_t                current_tx_nb; 
     bool                    generate_ack; 
     bool                    default_ack; 
     // If non-null, called after tb_decoded_ok to determine if ack needs to be sent
@@ -112,6 +113,14 @@ public:
   /* Indicate successfull decoding of PCH TB through PDSCH */
   virtual void pch_decoded_ok(uint32_t len) = 0;  
   
+  /* Returns false if the UE is in DRX sleep and the PDCCH for the C-RNTI needs not be 
+   * monitored in this TTI (Active Time, Section 5.7 of 36.321). A TTI for which it 
+   * returns true keeps the next ones active until pdcch_done() is called for it */
+  virtual bool is_active_time(uint32_t tti) = 0;
+  
+  /* Called once the grants, PHICH and PDSCH result of a TTI have been passed to MAC */
+  virtual void pdcch_done(uint32_t tti) = 0;
+  
   /* Function called every start of a subframe (TTI). Warning, this function is called 
    * from a high priority thread and should terminate asap 
    */
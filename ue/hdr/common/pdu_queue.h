@@ -43,7 +43,7 @@ public:
   class process_callback
   {
     public: 
-      virtual void process_pdu(uint8_t *buff, uint32_t len) = 0;
+      virtual void process_pdu(uint8_t *buff, uint32_t len, uint32_t tti) = 0;
   };
 
   pdu_queue();
@@ -52,14 +52,20 @@ public:
   bool     process_pdus();
   uint8_t* request_buffer(uint32_t pid, uint32_t len);
   
-  void     push_pdu(uint32_t pid, uint32_t nof_bytes);
+  /* tti is the subframe in which the PDU was received */
+  void     push_pdu(uint32_t pid, uint32_t nof_bytes, uint32_t tti);
     
 private:
   const static int NOF_HARQ_PID    = 8; 
   const static int MAX_PDU_LEN     = 150*1024/8; // ~ 150 Mbps  
   const static int NOF_BUFFER_PDUS = 64; // Number of PDU buffers per HARQ pid
         
-  std::vector<qbuff> pdu_q;
+  qbuff             pdu_q[NOF_HARQ_PID];
+  
+  // Reception TTI of each queued PDU, in the same order as pdu_q
+  uint32_t          pdu_tti[NOF_HARQ_PID][NOF_BUFFER_PDUS];
+  uint32_t          tti_wp[NOF_HARQ_PID];  // Writer only
+  uint32_t          tti_rp[NOF_HARQ_PID];  // Reader only
   process_callback *callback; 
   
   log       *log_h;
@@ -46,6 +46,10 @@ typedef struct {
   bool ul_pwr_ctrl_en; 
   float prach_gain;
   int pdsch_max_its;
+  bool pdsch_its_adaptive; 
+  int pdsch_min_its; 
+  int pdsch_boost_its; 
+  int pdsch_last_tx; 
   bool attach_enable_64qam; 
   int nof_phy_threads;  
   std::string equalizer_mode; 
@@ -59,6 +63,16 @@ typedef struct {
   bool sfo_correct_disable; 
   std::string sss_algorithm; 
   float estimator_fil_w;   
+  bool atomic_handoff; 
+  int handoff_spin_us; 
+  std::string worker_cpus; 
+  int sync_cpu; 
+  bool pipelined; 
+  int pipeline_ack_deadline_us; 
+  int pdsch_dec_helpers; 
+  bool offline; 
+  int offline_rnti; 
+  std::string tti_metrics_filename; 
 } phy_args_t; 
   
 /* Interface MAC -> PHY */
@@ -42,12 +42,19 @@
  *   - Call to release() to release the message buffer
  *  or
  *   - use recv()
+ *
+ * The writer owns the write index and the reader the read index. Occupancy
+ * is tracked by atomic message and byte counters, which publish the message
+ * contents from push() to pop() and the freed slot from release() to
+ * request(). pending_msgs() and pending_data() are O(1) and may be called
+ * from any thread. flush() must only be called while both sides are idle.
  *****************************************************************************/
 
 #ifndef QBUFF_H
 #define QBUFF_H
 
 #include <stdint.h>
+#include <boost/atomic.hpp>
 
 namespace srslte {
 
@@ -73,15 +80,21 @@ namespace srslte {
     uint32_t pending_msgs(); 
     uint32_t max_msgs(); 
   private:
+    qbuff(qbuff const&);           // Disabled
+    void operator=(qbuff const&);  // Disabled
+
     typedef struct {
-      bool valid; 
       uint32_t len; 
       void *ptr; 
     } pkt_t; 
     
     uint32_t nof_messages; 
     uint32_t max_msg_size; 
-    uint32_t rp, wp; 
+    uint32_t rp;                   // Reader only
+    uint32_t wp;                   // Writer only
+
+    boost::atomic<uint32_t> nof_pending;
+    boost::atomic<uint32_t> pending_bytes;
 
     pkt_t   *packets; 
     uint8_t *buffer; 
@@ -0,0 +1,174 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/******************************************************************************
+ *  File:         sdu_queue.h
+ *  Description:  Lock-free bounded single-producer/single-consumer queue of
+ *                byte_buffer_t pointers with byte accounting.
+ *  Reference:
+ *****************************************************************************/
+
+#ifndef SDU_QUEUE_H
+#define SDU_QUEUE_H
+
+#include "common/common.h"
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+#include <sched.h>
+
+namespace srslte {
+
+/******************************************************************************
+ * SDU queue
+ *
+ * One thread writes and one thread reads; callers must serialize each side.
+ * Reads and size queries never lock. A writer that finds the queue full
+ * blocks on a condition variable until the reader frees a slot.
+ * size() and size_bytes() are updated separately and may briefly disagree
+ * while a write or read is in progress.
+ *****************************************************************************/
+class sdu_queue
+{
+public:
+  sdu_queue(uint32_t capacity_ = 128)
+    :head(0)
+    ,tail(0)
+    ,unread_bytes(0)
+    ,writer_waiting(false)
+  {
+    capacity = 1;
+    while(capacity < capacity_)
+      capacity <<= 1;
+    buf = new byte_buffer_t*[capacity];
+  }
+
+  ~sdu_queue()
+  {
+    delete [] buf;
+  }
+
+  // Producer side
+  bool try_write(byte_buffer_t *msg)
+  {
+    uint32_t h = head.load(boost::memory_order_relaxed);
+    if(h - tail.load(boost::memory_order_acquire) == capacity)
+      return false;
+    buf[h & (capacity-1)] = msg;
+    unread_bytes.fetch_add(msg->N_bytes, boost::memory_order_relaxed);
+    head.store(h+1, boost::memory_order_release);
+    return true;
+  }
+
+  void write(byte_buffer_t *msg)
+  {
+    while(!try_write(msg))
+    {
+      boost::mutex::scoped_lock lock(mutex);
+      writer_waiting.store(true);
+      if(is_full())
+        not_full.wait(lock);
+      writer_waiting.store(false);
+    }
+  }
+
+  // Consumer side
+  bool try_read(byte_buffer_t **msg)
+  {
+    return read_batch(msg, 1) == 1;
+  }
+
+  void read(byte_buffer_t **msg)
+  {
+    while(!try_read(msg))
+      sched_yield();
+  }
+
+  // Reads up to max_msgs messages in one go, returns the number read
+  uint32_t read_batch(byte_buffer_t **msgs, uint32_t max_msgs)
+  {
+    uint32_t t = tail.load(boost::memory_order_relaxed);
+    uint32_t n = head.load(boost::memory_order_acquire) - t;
+    if(n > max_msgs)
+      n = max_msgs;
+    if(n == 0)
+      return 0;
+    uint32_t nof_bytes = 0;
+    for(uint32_t i=0;i<n;i++)
+    {
+      msgs[i]    = buf[(t+i) & (capacity-1)];
+      nof_bytes += msgs[i]->N_bytes;
+    }
+    unread_bytes.fetch_sub(nof_bytes, boost::memory_order_relaxed);
+    tail.store(t+n);
+    if(writer_waiting.load())
+    {
+      boost::mutex::scoped_lock lock(mutex);
+      not_full.notify_one();
+    }
+    return n;
+  }
+
+  // Bytes of the message at the front of the queue, 0 if empty
+  uint32_t size_tail_bytes()
+  {
+    uint32_t t = tail.load(boost::memory_order_relaxed);
+    if(head.load(boost::memory_order_acquire) == t)
+      return 0;
+    return buf[t & (capacity-1)]->N_bytes;
+  }
+
+  // Safe from any thread
+  uint32_t size()
+  {
+    return head.load(boost::memory_order_acquire) - tail.load(boost::memory_order_acquire);
+  }
+
+  uint32_t size_bytes()
+  {
+    return unread_bytes.load(boost::memory_order_relaxed);
+  }
+
+private:
+  // Sequentially consistent with the reader's tail update and waiting check
+  bool     is_full() { return head.load(boost::memory_order_relaxed) - tail.load() == capacity; }
+
+  byte_buffer_t         **buf;
+  uint32_t                capacity;
+  boost::atomic<uint32_t> head;   // Written by the producer only
+  boost::atomic<uint32_t> tail;   // Written by the consumer only
+  boost::atomic<uint32_t> unread_bytes;
+
+  // Only used to block a writer on a full queue
+  boost::atomic<bool>     writer_waiting;
+  boost::condition        not_full;
+  boost::mutex            mutex;
+};
+
+} // namespace srsue
+
+
+#endif // SDU_QUEUE_H
@@ -28,6 +28,13 @@
  *  File:         thread_pool.h
  *  Description:  Implements a pool of threads. Pending tasks to execute are 
  *                identified by a pointer. 
+ *
+ *                By default workers are handed over with a mutex and a
+ *                condition variable per state change. With
+ *                set_atomic_handoff(), worker states are atomics and the
+ *                waiting side spins for spin_us before blocking, so the
+ *                signalling side only takes a mutex when the other
+ *                side is asleep.
  *  Reference:
  *****************************************************************************/
 
@@ -38,8 +45,11 @@
 #include <string>
 #include <vector>
 #include <stack>
+#include <sys/time.h>
+#include <boost/atomic.hpp>
 
 #include "common/threads.h"
+#include "common/trace.h"
 
 namespace srslte {
 
@@ -50,7 +60,7 @@ public:
   class worker : public thread
   {
   public:
-    void setup(uint32_t id, thread_pool *parent, uint32_t prio=0);
+    void setup(uint32_t id, thread_pool *parent, uint32_t prio=0, int cpu=-1);
     void stop();
     uint32_t get_id();
     void release();
@@ -59,7 +69,7 @@ public:
   private: 
     uint32_t my_id; 
     thread_pool *my_parent;
-    bool running; 
+    boost::atomic<bool> running; 
     void run_thread();  
     void wait_to_start();
     void finished();    
@@ -67,7 +77,9 @@ public:
     
   
   thread_pool(uint32_t nof_workers);  
-  void    init_worker(uint32_t id, worker*, uint32_t prio = 0);              
+  ~thread_pool();
+  void    set_atomic_handoff(uint32_t spin_us);
+  void    init_worker(uint32_t id, worker*, uint32_t prio = 0, int cpu = -1);              
   void    stop();
   worker* wait_worker();              
   worker* wait_worker(uint32_t tti);              
@@ -75,11 +87,19 @@ public:
   void    start_worker(uint32_t id);              
   worker* get_worker(uint32_t id);
   uint32_t get_nof_workers();
-  
+
+  // Records the time from start_worker() until the worker runs, in us
+  void    start_trace();
+  void    write_trace(std::string filename);
 
 private:
 
   bool find_finished_worker(uint32_t tti, uint32_t *id);
+  worker* wait_worker_atomic(uint32_t tti);
+  void    wait_to_start_atomic(uint32_t id, boost::atomic<bool> *worker_running);
+  void    finished_atomic(uint32_t id);
+  void    wake(uint32_t id);
+  void    trace_wakeup(uint32_t id);
   
   typedef enum {
     IDLE, 
@@ -91,7 +111,22 @@ private:
   std::vector<worker*> workers; 
   uint32_t nof_workers;
   uint32_t max_workers; 
-  bool running;
+  boost::atomic<bool> running;
+
+  // Atomic hand-off. *_sleeping is set while the waiting side is
+  // blocked on the condition variable.
+  bool                     atomic_handoff;
+  uint32_t                 spin_us;
+  boost::atomic<uint32_t> *astatus;
+  boost::atomic<uint32_t> *worker_sleeping;
+  boost::atomic<uint32_t>  queue_sleeping;
+
+  // Wake-up latency trace
+  bool                     trace_enabled;
+  std::vector<uint32_t>    start_tti;
+  std::vector<struct timeval> start_time;
+  std::vector<srslte::trace<uint32_t>*> tr_wakeup;
+
   pthread_cond_t cvar_queue;
   pthread_mutex_t mutex_queue;
   std::vector<worker_status> status;
@@ -34,6 +34,15 @@
   bool threads_new_rt(pthread_t *thread, void *(*start_routine) (void*), void *arg);
   bool threads_new_rt_prio(pthread_t *thread, void *(*start_routine) (void*), void *arg, int prio_offset);
   bool threads_new_rt_cpu(pthread_t *thread, void *(*start_routine) (void*), void *arg, int cpu, int prio_offset);
+  bool threads_new_rt_named(pthread_t *thread, void *(*start_routine) (void*), void *arg, int cpu, int prio_offset, const char *name);
+
+  /* Overrides CPU set, policy (other, fifo, rr, batch, idle) and priority of
+   * threads created with the given name. Empty strings and -1 keep the
+   * built-in settings. Must be called before the threads are created.
+   */
+  bool threads_set_config(const char *name, const char *cpus, const char *policy, int prio);
+  /* Named threads print their settings the first time a thread of that name starts */
+  void threads_print(const char *name, pthread_t thread);
   void threads_print_self();
 
 #ifdef __cplusplus
@@ -45,11 +54,15 @@
 class thread
 {
 public: 
+  thread() : _name(NULL) {}
+  void set_name(const char *name) {
+    _name = name;
+  }
   bool start(int prio = -1) {
-    return threads_new_rt_prio(&_thread, thread_function_entry, this, prio);    
+    return threads_new_rt_named(&_thread, thread_function_entry, this, -1, prio, _name);    
   }
   bool start_cpu(int prio, int cpu) {
-    return threads_new_rt_cpu(&_thread, thread_function_entry, this, cpu, prio);    
+    return threads_new_rt_named(&_thread, thread_function_entry, this, cpu, prio, _name);    
   }
   void print_priority() {
     threads_print_self();
@@ -65,6 +78,7 @@ protected:
 private:
   static void *thread_function_entry(void *_this)  { ((thread*) _this)->run_thread(); return NULL; }
   pthread_t _thread;
+  const char *_name;
 };
   
 
@@ -39,111 +39,452 @@
 #include <stdint.h>
 #include <vector>
 #include <time.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/atomic.hpp>
 
 namespace srslte {
-  
-class timer_callback 
+
+class timer_callback
 {
-  public: 
-    virtual void timer_expired(uint32_t timer_id) = 0; 
-}; 
-  
+  public:
+    virtual void timer_expired(uint32_t timer_id) = 0;
+};
+
+/******************************************************************************
+ * Timers
+ *
+ * Each call to step_all() advances all timers by one tick (one TTI).
+ * Running timers are kept in a hierarchical timing wheel, so starting and
+ * stopping a timer is O(1) and a step only touches the timers that expire or
+ * move down a wheel level. Callbacks run from step_all() and may restart any
+ * timer. step_all() must always be called from the same thread.
+ *
+ * The state of each timer is a single atomic word, so get(), is_running()
+ * and is_expired() take no lock. set(), run(), stop() and reset() only lock
+ * the timer itself and hand newly started timers to step_all() through a
+ * lock-free list. The wheel is only touched by step_all(). The timers lock
+ * is only taken to create and release timer ids.
+ *
+ * Ids below the number of timers given to the constructor always exist.
+ * Further ids are allocated by get_unique_id() and returned with
+ * release_id(), which stops the timer.
+ *
+ * A timer not created by a timers object is stepped manually with step().
+ *****************************************************************************/
 class timers
 {
+private:
+  struct wheel_node_t {
+    wheel_node_t *prev;
+    wheel_node_t *next;
+  };
+
 public:
-  class timer
+  class timer : private wheel_node_t
   {
   public:
-    timer(uint32_t id_=0) {id = id_; counter = 0; timeout = 0; running = false; callback = NULL; }
+    timer(uint32_t id_=0) {
+      id = id_; counter = 0; timeout = 0; running = false; callback = NULL;
+      owner = NULL; prev = NULL; next = NULL;
+      state = STOPPED; queued = false; pending_next = NULL;
+    }
+    // Only timers not owned by a timers object can be copied
+    timer(const timer &t) : wheel_node_t() {
+      owner = NULL; prev = NULL; next = NULL;
+      state = STOPPED; queued = false; pending_next = NULL;
+      copy(t);
+    }
+    timer& operator=(const timer &t) {
+      if (this != &t) {
+        copy(t);
+      }
+      return *this;
+    }
     void set(timer_callback *callback_, uint32_t timeout_) {
-      callback = callback_; 
-      timeout = timeout_; 
-      reset();
+      lock_t lock(this);
+      callback = callback_;
+      timeout = timeout_;
+      update(OP_RESET);
     }
     bool is_running() {
-      return (counter < timeout) && running; 
+      if (!owner) {
+        return (counter < timeout) && running;
+      }
+      uint64_t s = state.load(boost::memory_order_acquire);
+      return is_started(s) && owner->now.load(boost::memory_order_acquire) < deadline(s);
     }
     bool is_expired() {
-      return counter == timeout || !running; 
+      if (!owner) {
+        return counter == timeout || !running;
+      }
+      uint64_t s   = state.load(boost::memory_order_acquire);
+      uint64_t now = owner->now.load(boost::memory_order_acquire);
+      switch (s & KIND_MASK) {
+        case ARMED:   return now >= deadline(s);
+        case RUNNING: return now == deadline(s);
+        default:      return true;
+      }
     }
     uint32_t get_timeout() {
-      return timeout; 
+      return timeout;
     }
     void reset() {
-      counter = 0; 
+      lock_t lock(this);
+      update(OP_RESET);
     }
+    // Only for timers not owned by a timers object
     void step() {
-      if (running) {
-        counter++; 
+      if (running && !owner) {
+        counter++;
         if (is_expired()) {
-          running = false; 
-          callback->timer_expired(id); 
-        }        
+          running = false;
+          callback.load()->timer_expired(id);
+        }
       }
     }
     void stop() {
-      running = false; 
+      lock_t lock(this);
+      update(OP_STOP);
     }
     void run() {
-      running = true; 
-    }
-    uint32_t id; 
-  private: 
-    timer_callback *callback; 
-    uint32_t timeout; 
-    uint32_t counter; 
-    bool running; 
+      lock_t lock(this);
+      update(OP_RUN);
+    }
+    uint32_t id;
+  private:
+    friend class timers;
+
+    // The state word holds the kind in the top two bits and, while started,
+    // the tick at which the elapsed time reaches the timeout
+    static const uint64_t STOPPED   = 0;
+    static const uint64_t RUNNING   = (uint64_t) 1 << 62;  // Started with no time left, never fires
+    static const uint64_t ARMED     = (uint64_t) 2 << 62;  // Fires when step_all() reaches the deadline
+    static const uint64_t EXPIRED   = (uint64_t) 3 << 62;  // Fired, the elapsed time equals the timeout
+    static const uint64_t KIND_MASK = (uint64_t) 3 << 62;
+
+    typedef enum {
+      OP_RUN = 0,
+      OP_STOP,
+      OP_RESET,
+    } op_t;
+
+    class lock_t {
+    public:
+      lock_t(timer *t) : m(t->owner ? &t->mutex : NULL) { if (m) m->lock(); }
+      ~lock_t() { if (m) m->unlock(); }
+    private:
+      boost::mutex *m;
+    };
+
+    static bool     is_started(uint64_t s) { return (s & KIND_MASK) == RUNNING || (s & KIND_MASK) == ARMED; }
+    static uint64_t deadline(uint64_t s)   { return s & ~KIND_MASK; }
+
+    void copy(const timer &t) {
+      id       = t.id;
+      counter  = t.counter;
+      timeout  = t.timeout.load();
+      running  = t.running;
+      callback = t.callback.load();
+    }
+
+    // Applies op to an owned timer. The state is swapped with a CAS so that
+    // an expiry processed concurrently by step_all() is never overwritten.
+    void update(op_t op) {
+      if (!owner) {
+        switch (op) {
+          case OP_RUN:   running = true;  break;
+          case OP_STOP:  running = false; break;
+          case OP_RESET: counter = 0;     break;
+        }
+        return;
+      }
+      uint64_t s = state.load(boost::memory_order_acquire);
+      while (1) {
+        uint64_t now     = owner->now.load(boost::memory_order_acquire);
+        uint32_t elapsed = (s & KIND_MASK) == EXPIRED ? (uint32_t) timeout : counter;
+        uint64_t ns      = s;
+        switch (op) {
+          case OP_RUN:
+            if (!is_started(s)) {
+              ns = start(now - elapsed, now);
+            }
+            break;
+          case OP_STOP:
+            if (is_started(s)) {
+              uint64_t e = now - (deadline(s) - timeout);
+              elapsed = e < 0xFFFFFFFF ? (uint32_t) e : 0xFFFFFFFF;
+            }
+            ns = STOPPED;
+            break;
+          case OP_RESET:
+            elapsed = 0;
+            ns = is_started(s) ? start(now, now) : STOPPED;
+            break;
+        }
+        if (state.compare_exchange_weak(s, ns, boost::memory_order_acq_rel, boost::memory_order_acquire)) {
+          counter = elapsed;
+          if ((ns & KIND_MASK) == ARMED) {
+            owner->enqueue(this);
+          }
+          return;
+        }
+      }
+    }
+    uint64_t start(uint64_t base, uint64_t now) {
+      uint64_t d = base + timeout;
+      return (d > now ? ARMED : RUNNING) | d;
+    }
+
+    timers                          *owner;
+    boost::atomic<timer_callback*>   callback;
+    boost::atomic<uint32_t>          timeout;
+    uint32_t                         counter;      // Elapsed ticks while stopped or stepped manually
+    bool                             running;      // Manually stepped timers only
+    boost::atomic<uint64_t>          state;        // Owned timers only
+    boost::mutex                     mutex;        // Serializes set/run/stop/reset of an owned timer
+    boost::atomic<bool>              queued;       // In the list of timers to be scheduled
+    timer                           *pending_next;
   };
-  
-  timers(uint32_t nof_timers_) : timer_list(nof_timers_) {
-    nof_timers = nof_timers_; 
-    next_timer = 0;
-    for (uint32_t i=0;i<nof_timers;i++) {
-      timer_list[i].id = i; 
+
+  timers(uint32_t nof_timers_ = 0) {
+    now = 0;
+    nof_timers = 0;
+    pending = NULL;
+    for (uint32_t l=0;l<NOF_LEVELS;l++) {
+      for (uint32_t i=0;i<level_size(l);i++) {
+        wheel_node_t *slot = &slots[l][i];
+        slot->prev = slot;
+        slot->next = slot;
+      }
+    }
+    for (uint32_t i=0;i<nof_timers_;i++) {
+      new_timer();
     }
   }
-  
+  ~timers() {
+    uint32_t n = nof_timers;
+    for (uint32_t i=0;i<n;i++) {
+      delete table[i/TABLE_CHUNK][i%TABLE_CHUNK];
+    }
+    for (uint32_t i=0;i<n;i+=TABLE_CHUNK) {
+      delete [] table[i/TABLE_CHUNK];
+    }
+  }
+
   void step_all() {
-    for (int i=0;i<nof_timers;i++) {
-      get(i)->step();
+    uint64_t tick = now + 1;
+    uint32_t idx  = tick & (level_size(0)-1);
+
+    schedule_pending();
+
+    // Move timers due within the next wheel turn down one level
+    if (idx == 0) {
+      for (uint32_t l=1;l<NOF_LEVELS && cascade(l, tick) == 0;l++);
+    }
+    now.store(tick, boost::memory_order_release);
+
+    // Detach the slot so that restarted timers go to the next turn
+    wheel_node_t expired;
+    splice(&slots[0][idx], &expired);
+    while (expired.next != &expired) {
+      timer *t = static_cast<timer*>(expired.next);
+      unlink(t);
+      uint64_t s = t->state.load(boost::memory_order_acquire);
+      if ((s & timer::KIND_MASK) != timer::ARMED) {
+        continue;
+      }
+      if (timer::deadline(s) > tick) {
+        schedule(t, timer::deadline(s));
+      } else if (t->state.compare_exchange_strong(s, timer::EXPIRED, boost::memory_order_acq_rel)) {
+        timer_callback *callback = t->callback;
+        if (callback) {
+          callback->timer_expired(t->id);
+        }
+      }
     }
   }
   void stop_all() {
-    for (int i=0;i<nof_timers;i++) {
-      get(i)->stop();
+    uint32_t n = nof_timers.load(boost::memory_order_acquire);
+    for (uint32_t i=0;i<n;i++) {
+      get_timer(i)->stop();
     }
   }
   void run_all() {
-    for (int i=0;i<nof_timers;i++) {
-      get(i)->run();
+    uint32_t n = nof_timers.load(boost::memory_order_acquire);
+    for (uint32_t i=0;i<n;i++) {
+      get_timer(i)->run();
     }
   }
   void reset_all() {
-    for (int i=0;i<nof_timers;i++) {
-      get(i)->reset();
+    uint32_t n = nof_timers.load(boost::memory_order_acquire);
+    for (uint32_t i=0;i<n;i++) {
+      get_timer(i)->reset();
     }
   }
   timer *get(uint32_t i) {
-    if (i < nof_timers) {
-      return &timer_list[i];       
+    uint32_t n = nof_timers.load(boost::memory_order_acquire);
+    if (i < n) {
+      return get_timer(i);
     } else {
-      printf("Error accessing invalid timer %d (Only %d timers available)\n", i, nof_timers);
-      return NULL; 
+      printf("Error accessing invalid timer %d (Only %d timers available)\n", i, n);
+      return NULL;
     }
   }
   uint32_t get_unique_id() {
-    if (next_timer == nof_timers){
-      printf("No more unique timer ids (Only %d timers available)\n", nof_timers);
-      next_timer = 0;
+    boost::mutex::scoped_lock lock(mutex);
+    if (free_ids.size() > 0) {
+      uint32_t id = free_ids.back();
+      free_ids.pop_back();
+      return id;
+    }
+    timer *t = new_timer();
+    return t ? t->id : MAX_TIMERS;
+  }
+  void release_id(uint32_t i) {
+    boost::mutex::scoped_lock lock(mutex);
+    if (i < nof_timers) {
+      timer *t = get_timer(i);
+      timer::lock_t tlock(t);
+      t->update(timer::OP_STOP);
+      t->callback = NULL;
+      t->timeout  = 0;
+      t->counter  = 0;
+      free_ids.push_back(i);
+    } else {
+      printf("Error releasing invalid timer %d\n", i);
     }
-    return next_timer++;
   }
+  uint32_t nof_running() {
+    uint32_t n = nof_timers.load(boost::memory_order_acquire);
+    uint32_t r = 0;
+    for (uint32_t i=0;i<n;i++) {
+      r += get_timer(i)->is_running() ? 1 : 0;
+    }
+    return r;
+  }
+
 private:
-  uint32_t nof_timers; 
-  uint32_t next_timer;
-  std::vector<timer>   timer_list;   
+  // Level 0 has 256 slots of one tick, levels 1-3 have 64 slots each
+  // covering 2^8, 2^14 and 2^20 ticks per slot
+  static const uint32_t NOF_LEVELS = 4;
+  static uint32_t level_size(uint32_t l)  { return l == 0 ? 256 : 64; }
+  static uint32_t level_shift(uint32_t l) { return l == 0 ? 0 : 2 + 6*l; }
+
+  // Timers are never moved once created, so get() reads the table without a lock
+  static const uint32_t TABLE_CHUNK = 64;
+  static const uint32_t MAX_TIMERS  = 256*TABLE_CHUNK;
+
+  timer* get_timer(uint32_t i) {
+    return table[i/TABLE_CHUNK][i%TABLE_CHUNK];
+  }
+
+  timer* new_timer() {
+    uint32_t n = nof_timers.load(boost::memory_order_relaxed);
+    if (n == MAX_TIMERS) {
+      printf("Error creating timer (Only %d timers supported)\n", MAX_TIMERS);
+      return NULL;
+    }
+    if (n%TABLE_CHUNK == 0) {
+      table[n/TABLE_CHUNK] = new timer*[TABLE_CHUNK];
+    }
+    timer *t = new timer(n);
+    t->owner = this;
+    table[n/TABLE_CHUNK][n%TABLE_CHUNK] = t;
+    nof_timers.store(n+1, boost::memory_order_release);
+    return t;
+  }
+
+  // Called by started timers, scheduled in the wheel by the next step_all()
+  void enqueue(timer *t) {
+    if (t->queued.exchange(true, boost::memory_order_acq_rel)) {
+      return;
+    }
+    timer *head = pending.load(boost::memory_order_relaxed);
+    do {
+      t->pending_next = head;
+    } while (!pending.compare_exchange_weak(head, t, boost::memory_order_release, boost::memory_order_relaxed));
+  }
+  void schedule_pending() {
+    timer *t = pending.exchange(NULL, boost::memory_order_acquire);
+    while (t) {
+      timer *next = t->pending_next;
+      // Clear the flag first so that a later start is queued again
+      t->queued.store(false, boost::memory_order_seq_cst);
+      uint64_t s = t->state.load(boost::memory_order_seq_cst);
+      unlink(t);
+      if ((s & timer::KIND_MASK) == timer::ARMED) {
+        schedule(t, timer::deadline(s));
+      }
+      t = next;
+    }
+  }
+
+  void schedule(timer *t, uint64_t deadline) {
+    // Timers are placed relative to the next tick to be processed
+    uint64_t ref     = now + 1;
+    uint64_t expires = deadline > ref ? deadline : ref;
+    uint64_t delta   = expires - ref;
+    uint32_t l       = 0;
+    while (l < NOF_LEVELS-1 && delta >= ((uint64_t) level_size(l) << level_shift(l))) {
+      l++;
+    }
+    // Beyond the wheel range, park in the last slot and reschedule on cascade
+    uint64_t range = (uint64_t) level_size(l) << level_shift(l);
+    if (delta >= range) {
+      expires = ref + range - 1;
+    }
+    wheel_node_t *slot = &slots[l][(expires >> level_shift(l)) & (level_size(l)-1)];
+    t->prev = slot->prev;
+    t->next = slot;
+    slot->prev->next = t;
+    slot->prev = t;
+  }
+  void unlink(timer *t) {
+    if (t->prev) {
+      t->prev->next = t->next;
+      t->next->prev = t->prev;
+      t->prev = NULL;
+      t->next = NULL;
+    }
+  }
+  void splice(wheel_node_t *from, wheel_node_t *to) {
+    if (from->next == from) {
+      to->prev = to;
+      to->next = to;
+    } else {
+      to->next = from->next;
+      to->prev = from->prev;
+      to->next->prev = to;
+      to->prev->next = to;
+      from->prev = from;
+      from->next = from;
+    }
+  }
+  uint32_t cascade(uint32_t l, uint64_t tick) {
+    uint32_t idx = (tick >> level_shift(l)) & (level_size(l)-1);
+    wheel_node_t list;
+    splice(&slots[l][idx], &list);
+    while (list.next != &list) {
+      timer *t = static_cast<timer*>(list.next);
+      unlink(t);
+      // Stopped timers are dropped, restarted ones go to their new slot
+      uint64_t s = t->state.load(boost::memory_order_acquire);
+      if ((s & timer::KIND_MASK) == timer::ARMED) {
+        schedule(t, timer::deadline(s));
+      }
+    }
+    return idx;
+  }
+
+  boost::mutex            mutex;        // Protects timer creation and free_ids
+  boost::atomic<uint64_t> now;          // Ticks processed so far
+  wheel_node_t            slots[NOF_LEVELS][256];
+  timer                 **table[MAX_TIMERS/TABLE_CHUNK];
+  boost::atomic<uint32_t> nof_timers;
+  boost::atomic<timer*>   pending;      // Timers started since the last step
+  std::vector<uint32_t>   free_ids;
 };
 
 } // namespace srslte
-  
+
 #endif // TIMERS_H
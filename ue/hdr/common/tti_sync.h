@@ -53,7 +53,7 @@ class tti_sync
     virtual void     resync() = 0;
     virtual uint32_t wait() = 0; 
     virtual void     set_producer_cntr(uint32_t) = 0; 
-    uint32_t         get_producer_cntr() { return producer_cntr; }
+    virtual uint32_t get_producer_cntr() { return producer_cntr; }
     uint32_t         get_consumer_cntr() { return consumer_cntr; }
     void             set_increment(uint32_t increment_) {
       increment = increment_; 
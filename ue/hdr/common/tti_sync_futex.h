@@ -0,0 +1,66 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/******************************************************************************
+ *  File:         tti_sync_futex.h
+ *  Description:  Implements tti_sync interface with an eventcount on a
+ *                futex. The producer counter is the futex word, so
+ *                increase() is one atomic update plus a wake-up syscall
+ *                only when the consumer is parked. The consumer spins
+ *                for spin_us before parking.
+ *  Reference:
+ *****************************************************************************/
+
+#ifndef TTISYNC_FUTEX_H
+#define TTISYNC_FUTEX_H
+
+#include <boost/atomic.hpp>
+#include "common/tti_sync.h"
+
+namespace srslte {
+  
+class tti_sync_futex : public tti_sync
+{
+  public: 
+             tti_sync_futex(uint32_t modulus = 10240, uint32_t spin_us = 0);
+    void     increase();
+    uint32_t wait();      
+    void     resync();
+    void     set_producer_cntr(uint32_t producer_cntr);
+    uint32_t get_producer_cntr();
+    void     set_spin_us(uint32_t spin_us);
+    
+  private: 
+    void     wake();
+    
+    boost::atomic<uint32_t> prod;       // Producer counter and futex word, replaces producer_cntr
+    boost::atomic<uint32_t> waiters; 
+    uint32_t                spin_us; 
+}; 
+
+} // namespace srsue
+
+#endif // TTISYNC_FUTEX_H
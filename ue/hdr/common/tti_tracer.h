@@ -0,0 +1,130 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/******************************************************************************
+ *  File:         tti_tracer.h
+ *  Description:  Timeline tracing of the TTI processing stages. Named spans
+ *                with CLOCK_MONOTONIC nanosecond timestamps are written to
+ *                a ring owned by the calling thread, keeping the last
+ *                TTI_TRACER_RING_SIZE spans per thread. write_json()
+ *                exports all rings in Chrome trace event format, which
+ *                chrome://tracing and ui.perfetto.dev open directly.
+ *                Span names must be string literals.
+ *  Reference:    Chromium Trace Event Format
+ *****************************************************************************/
+
+#ifndef TTI_TRACER_H
+#define TTI_TRACER_H
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+
+#define TTI_TRACER_RING_SIZE (1024*64)
+
+namespace srslte {
+
+class tti_tracer
+{
+public:
+  static tti_tracer* get_instance(void);
+  // Frees the tracer and its rings. Spans recorded afterwards are dropped
+  static void        cleanup(void);
+
+  void start();
+  void stop();
+  bool write_json(std::string filename);
+  // Durations in ns of the recorded spans, by span name
+  void get_durations(std::map<std::string, std::vector<uint64_t> > &durations);
+
+  static bool is_enabled() {
+    return enabled.load(boost::memory_order_relaxed);
+  }
+  static uint64_t now_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec*1000000000 + t.tv_nsec;
+  }
+  static void record(const char *name, uint32_t tti, uint64_t start_ns, uint64_t end_ns);
+
+private:
+  tti_tracer();
+  ~tti_tracer();
+
+  typedef struct {
+    const char *name;
+    uint32_t    tti;
+    uint64_t    start_ns;
+    uint64_t    end_ns;
+  } span_t;
+
+  typedef struct {
+    int                      tid;
+    char                     thread_name[16];
+    std::vector<span_t>      spans;
+    boost::atomic<uint32_t>  count;
+  } ring_t;
+
+  ring_t* new_ring();
+
+  static tti_tracer              *instance;
+  static boost::mutex             instance_mutex;
+  static boost::atomic<bool>      enabled;
+  static boost::atomic<uint32_t>  current_generation;
+  static boost::atomic<uint32_t>  nof_writers;
+
+  uint32_t              generation;
+  uint64_t              start_ns;
+  boost::mutex          rings_mutex;
+  std::vector<ring_t*>  rings;
+};
+
+/* Records a span from construction to destruction if tracing is enabled */
+class tti_span
+{
+public:
+  tti_span(const char *name_, uint32_t tti_) : name(name_), tti(tti_) {
+    start_ns = tti_tracer::is_enabled() ? tti_tracer::now_ns() : 0;
+  }
+  ~tti_span() {
+    if (start_ns) {
+      tti_tracer::record(name, tti, start_ns, tti_tracer::now_ns());
+    }
+  }
+private:
+  const char *name;
+  uint32_t    tti;
+  uint64_t    start_ns;
+};
+
+} // namespace srsue
+
+#endif // TTI_TRACER_H
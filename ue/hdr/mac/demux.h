@@ -34,6 +34,7 @@
 #include "common/qbuff.h"
 #include "common/timers.h"
 #include "common/pdu.h"
+#include "mac/proc_drx.h"
 
 /* Logical Channel Demultiplexing and MAC CE dissassemble */   
 
@@ -44,18 +45,18 @@ class demux : public srslte::pdu_queue::process_callback
 {
 public:
   demux();
-  void init(phy_interface_mac* phy_h_, rlc_interface_mac *rlc, srslte::log* log_h_, srslte::timers* timers_db_);
+  void init(phy_interface_mac* phy_h_, rlc_interface_mac *rlc, srslte::log* log_h_, srslte::timers* timers_db_, drx_proc *drx_procedure_);
 
   bool     process_pdus();
   uint8_t* request_buffer(uint32_t pid, uint32_t len);
   
-  void     push_pdu(uint32_t pid, uint8_t *buff, uint32_t nof_bytes);
-  void     push_pdu_temp_crnti(uint32_t pid, uint8_t *buff, uint32_t nof_bytes);
+  void     push_pdu(uint32_t pid, uint8_t *buff, uint32_t nof_bytes, uint32_t tti);
+  void     push_pdu_temp_crnti(uint32_t pid, uint8_t *buff, uint32_t nof_bytes, uint32_t tti);
 
   void     set_uecrid_callback(bool (*callback)(void*, uint64_t), void *arg);
   bool     get_uecrid_successful();
   
-  void     process_pdu(uint8_t *pdu, uint32_t nof_bytes);
+  void     process_pdu(uint8_t *pdu, uint32_t nof_bytes, uint32_t tti);
   
 private:
   const static int NOF_HARQ_PID    = 8; 
@@ -69,8 +70,8 @@ private:
   srslte::sch_pdu mac_msg;
   srslte::sch_pdu pending_mac_msg;
   
-  void process_sch_pdu(srslte::sch_pdu *pdu);
-  bool process_ce(srslte::sch_subh *subheader);
+  void process_sch_pdu(srslte::sch_pdu *pdu, uint32_t tti);
+  bool process_ce(srslte::sch_subh *subheader, uint32_t tti);
   
   bool       is_uecrid_successful; 
     
@@ -78,6 +79,7 @@ private:
   srslte::log       *log_h;
   srslte::timers    *timers_db;
   rlc_interface_mac *rlc;
+  drx_proc          *drx_procedure;
   
   // Buffer of PDUs
   srslte::pdu_queue pdus; 
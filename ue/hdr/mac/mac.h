@@ -37,11 +37,12 @@
 #include "mac/proc_sr.h"
 #include "mac/proc_bsr.h"
 #include "mac/proc_phr.h"
+#include "mac/proc_drx.h"
 #include "mac/mux.h"
 #include "mac/demux.h"
 #include "common/mac_pcap.h"
 #include "common/mac_interface.h"
-#include "common/tti_sync_cv.h"
+#include "common/tti_sync_futex.h"
 #include "common/threads.h"
 
 namespace srsue {
@@ -69,6 +70,8 @@ public:
   void tb_decoded(bool ack, srslte_rnti_type_t rnti_type, uint32_t harq_pid);
   void bch_decoded_ok(uint8_t *payload, uint32_t len);
   void pch_decoded_ok(uint32_t len);    
+  bool is_active_time(uint32_t tti);
+  void pdcch_done(uint32_t tti);
   void tti_clock(uint32_t tti);
 
   
@@ -95,8 +98,13 @@ public:
   void timer_expired(uint32_t timer_id); 
   void start_pcap(srslte::mac_pcap* pcap);
   
+  /* Offline decoding: the random access procedure is never started and the 
+   * C-RNTI grants, which are all for the offline RNTI, only go to the DL HARQ */
+  void set_offline(bool enable);
+  
   srslte::timers::timer*   get(uint32_t timer_id);
   u_int32_t                get_unique_id();
+  void                     release_id(uint32_t timer_id);
   
   uint32_t get_current_tti();
       
@@ -111,8 +119,6 @@ public:
     NOF_MAC_TIMERS
   } mac_timers_t; 
   
-  static const int MAC_NOF_UPPER_TIMERS = 20; 
-  
 private:  
   void run_thread(); 
   
@@ -120,7 +126,7 @@ private:
   static const int MAC_PDU_THREAD_PRIO  = 6;
 
   // Interaction with PHY 
-  srslte::tti_sync_cv   ttisync; 
+  srslte::tti_sync_futex ttisync; 
   phy_interface_mac    *phy_h; 
   rlc_interface_mac    *rlc_h; 
   rrc_interface_mac    *rrc_h; 
@@ -135,6 +141,7 @@ private:
   uint32_t      tti; 
   bool          started; 
   bool          is_synchronized; 
+  bool          offline; 
   uint16_t      last_temporal_crnti;
   uint16_t      phy_rnti;
   
@@ -152,6 +159,9 @@ private:
   bsr_proc      bsr_procedure; 
   phr_proc      phr_procedure; 
   
+  /* Discontinuous Reception */
+  drx_proc      drx_procedure; 
+  
   /* Buffers for PCH reception (not included in DL HARQ) */
   const static uint32_t  pch_payload_buffer_sz = 8*1024;
   srslte_softbuffer_rx_t pch_softbuffer;
@@ -174,16 +184,17 @@ private:
   /* Class to run upper-layer timers with normal priority */
   class upper_timers : public thread {
   public: 
-    upper_timers() : timers_db(MAC_NOF_UPPER_TIMERS),ttisync(10240) {start();}
+    upper_timers() : ttisync(10240) {set_name("mac_timers"); start();}
     void tti_clock();
     void stop();
     void reset();
     srslte::timers::timer* get(uint32_t timer_id);
     uint32_t get_unique_id();
+    void release_id(uint32_t timer_id);
   private:
     void run_thread();
     srslte::timers  timers_db;
-    srslte::tti_sync_cv     ttisync;
+    srslte::tti_sync_futex  ttisync;
     bool running; 
   };
   upper_timers   upper_timers_thread; 
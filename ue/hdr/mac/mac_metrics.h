@@ -39,6 +39,7 @@ struct mac_metrics_t
   int rx_errors;
   int rx_brate;
   int ul_buffer;
+  int drx_sleep;
 };
 
 } // namespace srsue
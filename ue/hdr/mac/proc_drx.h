@@ -0,0 +1,121 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#ifndef PROCDRX_H
+#define PROCDRX_H
+
+#include <stdint.h>
+#include <boost/atomic.hpp>
+#include "common/log.h"
+#include "common/mac_interface.h"
+
+/* Discontinuous Reception in RRC_CONNECTED as defined in 5.7 of 36.321 (FDD).
+ *
+ * The DRX timers are not stepped: the procedure keeps the TTIs of the events
+ * that start them (last new PDCCH, DRX Command, HARQ NACK) and is_active_time()
+ * derives the timer states for any TTI from them. This lets the PHY workers,
+ * which run several TTIs in parallel, ask for the TTI they are processing.
+ */
+
+namespace srsue {
+
+class drx_proc
+{
+public:
+  drx_proc();
+  void init(srslte::log *log_h, mac_interface_rrc::mac_cfg_t *mac_cfg);
+  void reset();
+
+  /* Reads the DRX configuration from the MAC main configuration */
+  void reconfigure();
+
+  /* Called every TTI from the MAC thread. force_active keeps the UE awake,
+   * eg. while an SR is pending or a RA procedure is ongoing. Counts the TTIs
+   * that are not Active Time */
+  void step(uint32_t tti, bool force_active);
+
+  /* Events. May be called from the PHY workers and the PDU thread */
+  void new_grant_dl(uint32_t tti, uint32_t pid, bool is_new_tx);
+  void new_grant_ul(uint32_t tti, bool is_new_tx, bool expect_ack);
+  void tb_decoded(uint32_t pid, bool ack);
+  void drx_command(uint32_t tti);
+
+  /* True if the PDCCH for the C-RNTI has to be monitored in this TTI. Has no
+   * side effects, workers may call it for the same TTI more than once */
+  bool is_active_time(uint32_t tti);
+
+  /* Called by a PHY worker when it starts a TTI. Also true while an earlier 
+   * TTI that was monitored is still being processed, since its grants may 
+   * extend the Active Time. A monitored TTI stays pending until pdcch_done() */
+  bool monitor_pdcch(uint32_t tti);
+  void pdcch_done(uint32_t tti);
+
+  /* Number of TTIs stepped while not in Active Time since the last call */
+  uint32_t get_sleep_count();
+  bool     is_enabled();
+
+private:
+  static const uint32_t NOF_HARQ_PROC = 8;
+  static const uint32_t HARQ_RTT      = 8;
+
+  /* TTIs that a PHY worker may lag behind the MAC thread */
+  static const uint32_t MAX_WORKER_LAG = 16;
+
+  int32_t  age(uint32_t tti, int32_t ref);
+  void     set_latest(boost::atomic<int32_t> *ref, uint32_t tti);
+  void     expire(boost::atomic<int32_t> *ref, uint32_t tti, uint32_t duration);
+
+  srslte::log                  *log_h;
+  mac_interface_rrc::mac_cfg_t *mac_cfg;
+
+  // Configuration, in subframes
+  boost::atomic<bool> enabled;
+  uint32_t on_duration_timer;
+  uint32_t inactivity_timer;
+  uint32_t retx_timer;
+  uint32_t long_cycle;
+  uint32_t start_offset;
+  uint32_t short_cycle_len;
+  uint32_t short_cycle_timer;
+  bool     short_cycle_enabled;
+
+  // TTI of the last event or -1
+  boost::atomic<int32_t> last_new_pdcch;
+  boost::atomic<int32_t> last_drx_cmd;
+  boost::atomic<int32_t> dl_grant_tti[NOF_HARQ_PROC];
+  boost::atomic<int32_t> dl_retx_start[NOF_HARQ_PROC];
+  boost::atomic<int32_t> ul_retx_tti[NOF_HARQ_PROC];
+
+  // Monitored TTIs whose grants have not all been passed to MAC yet or -1
+  boost::atomic<int32_t> pending_tti[MAX_WORKER_LAG];
+
+  boost::atomic<bool>     force_active;
+  boost::atomic<uint32_t> sleep_count;
+};
+
+} // namespace srsue
+
+#endif // PROCDRX_H
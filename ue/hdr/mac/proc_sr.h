@@ -45,6 +45,7 @@ public:
   void reset();
   void start();
   bool need_random_access(); 
+  bool is_pending();
   
 private:
   bool need_tx(uint32_t tti); 
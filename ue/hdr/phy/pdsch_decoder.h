@@ -0,0 +1,141 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/******************************************************************************
+ *  File:         pdsch_decoder.h
+ *  Description:  PDSCH decoder that spreads the code blocks of a transport
+ *                block over a group of helper threads. The calling worker
+ *                demodulates the PDSCH and decodes code blocks alongside
+ *                the helpers. Each code block, and its soft buffer, is
+ *                owned by the thread that claims it. A code block that
+ *                fails its CRC cancels the turbo iterations of the rest.
+ *  Reference:    3GPP TS 36.211 v10.0.0 Sections 6.3, 6.4 and 6.10.1
+ *                3GPP TS 36.212 v10.0.0 Sections 5.1.3 to 5.1.5
+ *****************************************************************************/
+
+#ifndef UEPDSCHDECODER_H
+#define UEPDSCHDECODER_H
+
+#include <pthread.h>
+#include <boost/atomic.hpp>
+#include "srslte/srslte.h"
+#include "common/log.h"
+#include "common/threads.h"
+
+namespace srsue {
+
+class pdsch_decoder
+{
+public:
+  static const uint32_t MAX_HELPERS = 4;
+  static const uint32_t MAX_CB      = 16;
+
+  pdsch_decoder();
+  ~pdsch_decoder();
+  void  init(srslte::log *log_h);
+  bool  init_cell(srslte_cell_t cell);
+  void  free_cell();
+  bool  start_helpers(uint32_t nof_helpers, int prio, int cpu);
+  void  stop_helpers();
+  bool  is_enabled();
+
+  void  set_rnti(uint16_t rnti);
+  void  set_max_noi(uint32_t max_noi);
+
+  /* Returns SRSLTE_SUCCESS if the TB CRC is correct, SRSLTE_ERROR if not and
+   * SRSLTE_ERROR_INVALID_INPUTS if the grant must be decoded by srslte_pdsch
+   * instead (single code block, RNTI other than the C-RNTI, REs of the grant
+   * that do not add up to the PDSCH configuration, ...). The soft buffer is
+   * not touched in that case */
+  int   decode(srslte_pdsch_cfg_t *cfg, srslte_softbuffer_rx_t *softbuffer, cf_t *sf_symbols,
+               cf_t *ce[SRSLTE_MAX_PORTS], float noise_estimate, uint16_t rnti, uint8_t *data);
+  float last_noi();
+  
+  /* Threads that will share the code blocks of the grant, 1 if decode() won't take it */
+  uint32_t get_nof_decoders(srslte_pdsch_cfg_t *cfg, uint16_t rnti);
+
+private:
+  class helper;
+
+  typedef struct {
+    srslte_tdec_t tdec;
+    srslte_crc_t  crc_cb;
+    uint8_t      *cb_in;
+  } cb_decoder_t;
+
+  bool     can_decode(srslte_pdsch_cfg_t *cfg, uint16_t rnti);
+  uint32_t get_re(cf_t *grid, cf_t *re, srslte_ra_dl_grant_t *grant, uint32_t lstart, uint32_t sf_idx);
+  bool     demodulate(srslte_pdsch_cfg_t *cfg, cf_t *sf_symbols, cf_t *ce[SRSLTE_MAX_PORTS], float noise_estimate);
+  void     segment(srslte_pdsch_cfg_t *cfg);
+  void     decode_cbs(uint32_t decoder_idx);
+  bool     decode_cb(cb_decoder_t *dec, uint32_t i);
+
+  srslte::log  *log_h;
+  srslte_cell_t cell;
+  bool          cell_initiated;
+  uint32_t      max_re;
+  uint16_t      rnti;
+  bool          rnti_is_set;
+  uint32_t      max_noi;
+
+  /* Demodulation, done by the calling worker */
+  srslte_sequence_t seq[SRSLTE_NSUBFRAMES_X_FRAME];
+  cf_t         *symbols;
+  cf_t         *ce_re[SRSLTE_MAX_PORTS];
+  cf_t         *x[SRSLTE_MAX_LAYERS];
+  cf_t         *d;
+  int16_t      *e;
+
+  /* Code block decoding. Decoder 0 belongs to the calling worker */
+  helper       *helpers[MAX_HELPERS];
+  uint32_t      nof_helpers;
+  cb_decoder_t  decoders[MAX_HELPERS+1];
+  srslte_crc_t  crc_tb;
+
+  /* Current transport block */
+  srslte_cbsegm_t        *cb_segm;
+  srslte_softbuffer_rx_t *softbuffer;
+  uint8_t                *data;
+  uint32_t                rv;
+  uint32_t                cb_rp[MAX_CB];
+  uint32_t                cb_ne[MAX_CB];
+  uint32_t                cb_wp[MAX_CB];
+  uint8_t                 tb_parity[3];
+  boost::atomic<uint32_t> next_cb;
+  boost::atomic<uint32_t> nof_iterations;
+  boost::atomic<bool>     cancel;
+  float                   avg_noi;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t  cvar;
+  bool            running;
+  uint32_t        tb_id;
+  uint32_t        nof_helpers_done;
+};
+
+} // namespace srsue
+
+#endif // UEPDSCHDECODER_H
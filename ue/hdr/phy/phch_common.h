@@ -28,13 +28,17 @@
 #define UEPHYWORKERCOMMON_H
 
 #include <pthread.h>
+#include <stdio.h>
 #include <string.h>
+#include <string>
 #include <vector>
+#include <boost/atomic.hpp>
 #include "srslte/srslte.h"
 #include "common/mac_interface.h"
 #include "common/phy_interface.h"
 #include "radio/radio.h"
 #include "common/log.h"
+#include "common/latency_hist.h"
 #include "phy/phy_metrics.h"
 
 //#define CONTINUOUS_TX
@@ -49,6 +53,10 @@ namespace srsue {
     /* Common variables used by all phy workers */
     phy_interface_rrc::phy_cfg_t *config; 
     phy_args_t                   *args; 
+    
+    /* Estimator settings parsed from args */
+    srslte_chest_dl_noise_alg_t   noise_alg; 
+    bool                          equalizer_zf; 
     srslte::log       *log_h;
     mac_interface_phy *mac;
     srslte_ue_ul_t     ue_ul; 
@@ -65,6 +73,9 @@ namespace srsue {
     float avg_snr_db; 
     float avg_noise; 
     float avg_rsrp; 
+    
+    /* PDSCH decoding time per transport block, filled by all workers */
+    srslte::latency_hist pdsch_dec_time; 
   
     phch_common(uint32_t max_mutex = 3);
     void init(phy_interface_rrc::phy_cfg_t *config, 
@@ -90,12 +101,27 @@ namespace srsue {
     bool get_pending_ack(uint32_t tti);    
     bool get_pending_ack(uint32_t tti, uint32_t *I_lowest, uint32_t *n_dmrs);
         
-    void worker_end(uint32_t tti, bool tx_enable, cf_t *buffer, uint32_t nof_samples, srslte_timestamp_t tx_time);
+    /* metrics, if given, is written to the per-TTI metrics file in TTI order */
+    void worker_end(uint32_t tti, bool tx_enable, cf_t *buffer, uint32_t nof_samples, srslte_timestamp_t tx_time, 
+                    tti_metrics_t *metrics = NULL);
+    
+    /* Per-TTI metrics of offline decoding, one CSV line per subframe */
+    bool open_tti_metrics(std::string filename);
+    void close_tti_metrics();
     
     void set_nof_mutex(uint32_t nof_mutex);
     
     bool sr_enabled; 
     int  sr_last_tx_tti; 
+    
+    /* Periodic UL transmissions due in a TX TTI, rebuilt on reconfiguration */
+    typedef enum {
+      UL_PLAN_SR  = 0x1, 
+      UL_PLAN_CQI = 0x2, 
+      UL_PLAN_SRS = 0x4, 
+    } ul_plan_t;
+    void     build_ul_plan();
+    uint32_t get_ul_plan(uint32_t tx_tti) { return ul_plan.load(boost::memory_order_acquire)[tx_tti%10240]; }
    
     srslte::radio*    get_radio();
 
@@ -124,6 +150,14 @@ namespace srsue {
     uint16_t           ul_rnti, dl_rnti;  
     srslte_rnti_type_t ul_rnti_type, dl_rnti_type; 
     int                ul_rnti_start, ul_rnti_end, dl_rnti_start, dl_rnti_end; 
+    bool               dl_rnti_skip_sf5; 
+    
+    /* Workers read ul_plan while the inactive buffer is rebuilt. The new
+     * plan is published with a release store. Rebuilds only happen on RRC
+     * reconfiguration, far apart from each other, so a worker never holds
+     * the old pointer while that buffer is rebuilt again. */
+    uint8_t                 ul_plan_buf[2][10240]; 
+    boost::atomic<uint8_t*> ul_plan; 
     
     float              time_adv_sec; 
     
@@ -155,6 +189,9 @@ namespace srsue {
     sync_metrics_t  sync_metrics;
     uint32_t        sync_metrics_count;
     bool            sync_metrics_read;
+    
+    FILE           *tti_metrics_file;
+    uint64_t        tti_metrics_cnt;
   };
   
 } // namespace srsue
@@ -47,7 +47,7 @@ public:
   phch_recv();
   void init(srslte::radio* radio_handler, mac_interface_phy *mac,rrc_interface_phy *rrc,
             prach *prach_buffer, srslte::thread_pool *_workers_pool,
-            phch_common *_worker_com, srslte::log* _log_h, uint32_t prio);
+            phch_common *_worker_com, srslte::log* _log_h, uint32_t prio, int cpu=-1);
   void stop();
   void set_agc_enable(bool enable);
 
@@ -58,6 +58,8 @@ public:
   void    sync_start(); 
   void    sync_stop();
   bool    status_is_sync();
+  /* True once all the samples of a replayed capture have been decoded */
+  bool    status_is_finished();
 
   void    set_time_adv_sec(float time_adv_sec);
   void    get_current_cell(srslte_cell_t *cell);
@@ -69,8 +71,10 @@ private:
   void   set_ue_sync_opts(srslte_ue_sync_t *q); 
   void   run_thread();
   int    sync_sfn();
+  void   end_of_capture();
   
   bool   running; 
+  bool   finished; 
   
   srslte::radio        *radio_h;
   mac_interface_phy    *mac;
@@ -105,6 +109,8 @@ private:
   uint32_t      tx_mutex_cnt;
 
   uint32_t      sync_sfn_cnt;
+  uint64_t      nof_sf;
+  uint64_t      start_ns;
   const static uint32_t SYNC_SFN_TIMEOUT = 5000;
   float ul_dl_factor;
   
@@ -33,6 +33,8 @@
 #include "common/phy_interface.h"
 #include "common/trace.h"
 #include "phy/phch_common.h"
+#include "phy/pdsch_decoder.h"
+#include "phy/turbo_its_policy.h"
 
 #define LOG_EXECTIME
 
@@ -59,6 +61,22 @@ public:
   void  set_crnti(uint16_t rnti);
   void  enable_pregen_signals(bool enabled);
   
+  /* Pipelined mode: the UL stage runs on its own thread and overlaps with the 
+   * PDSCH decoding of the same subframe. It works on its own copy of the 
+   * per-TTI context, so the worker is released once the PDSCH is decoded, 
+   * while the UL signal may still be encoded. The next subframe of the worker 
+   * waits for that UL stage only when it hands over its own context */
+  bool  start_ul_thread(int prio, int cpu);
+  void  stop_ul_thread();
+  void  wait_ul_stage();
+  
+  /* Code blocks of large transport blocks are shared with helper threads */
+  bool  start_dec_helpers(uint32_t nof_helpers, int prio, int cpu);
+  void  stop_dec_helpers();
+  
+  void  get_turbo_its_metrics(turbo_its_metrics_t &m);
+  uint32_t get_nof_late_nacks();
+  
   void start_trace();
   void write_trace(std::string filename);
   
@@ -71,14 +89,24 @@ private:
   void work_imp();
 
   
+  /* Processing stages of a subframe */
+  void dl_control_stage();
+  void dl_data_stage();
+  void ul_stage();
+  
+  class ul_thread; 
+  ul_thread *ul_stage_thread; 
+  
   /* Internal methods */
   bool extract_fft_and_pdcch_llr(); 
+  uint16_t get_dl_rnti();
+  uint16_t get_ul_rnti();
   
   /* ... for DL */
   bool decode_pdcch_ul(mac_interface_phy::mac_grant_t *grant);
   bool decode_pdcch_dl(mac_interface_phy::mac_grant_t *grant);
   bool decode_phich(bool *ack); 
-  bool decode_pdsch(srslte_ra_dl_grant_t *grant, uint8_t *payload, srslte_softbuffer_rx_t* softbuffer, int rv, uint16_t rnti, uint32_t pid);
+  bool decode_pdsch(srslte_ra_dl_grant_t *grant, uint8_t *payload, srslte_softbuffer_rx_t* softbuffer, int rv, uint16_t rnti, uint32_t pid, uint32_t tx_nb);
 
   /* ... for UL */
   void encode_pusch(srslte_ra_ul_grant_t *grant, uint8_t *payload, uint32_t current_tx_nb, srslte_softbuffer_tx_t *softbuffer, 
@@ -91,6 +119,7 @@ private:
   void set_uci_aperiodic_cqi();
   void set_uci_ack(bool ack);
   bool srs_is_ready_to_send();
+  void set_chest_params();
   float set_power(float tx_power);
   void setup_tx_gain();
   
@@ -113,14 +142,52 @@ private:
   bool           pregen_enabled;
   uint32_t       last_dl_pdcch_ncce;
   bool           rnti_is_set; 
+  uint64_t       tti_start_ns; 
+  
+  /* Per-TTI context of the DL stages */
+  mac_interface_phy::mac_grant_t    dl_mac_grant;
+  mac_interface_phy::tb_action_dl_t dl_action; 
+  mac_interface_phy::mac_grant_t    ul_mac_grant;
+  bool                              dl_ack; 
+  bool                              dl_nack_sent; 
+  bool                              ul_ack; 
+  bool                              ul_ack_available; 
+  bool                              ul_grant_available; 
+  bool                              drx_sleep; 
+  
+  /* Copy of the per-TTI context used by the UL stage, which in pipelined mode 
+   * may still run when the worker starts its next subframe */
+  typedef struct {
+    uint32_t                          tti; 
+    uint32_t                          tx_tti; 
+    srslte_timestamp_t                tx_time; 
+    float                             cfo; 
+    uint64_t                          start_ns; 
+    uint32_t                          last_dl_pdcch_ncce; 
+    mac_interface_phy::mac_grant_t    ul_mac_grant;
+    bool                              ul_ack; 
+    bool                              ul_ack_available; 
+    bool                              ul_grant_available; 
+    bool                              generate_ack; 
+    bool                              dl_ack; 
+    bool                              drx_sleep; 
+  } ul_ctx_t; 
+  
+  void  get_ul_ctx(ul_ctx_t *ctx);
+  
+  ul_ctx_t                          ul_ctx; 
+  mac_interface_phy::tb_action_ul_t ul_action; 
   
   /* Objects for DL */
   srslte_ue_dl_t ue_dl; 
+  pdsch_decoder  pdsch_dec; 
+  turbo_its_policy its_policy; 
   uint32_t       cfi; 
   uint16_t       dl_rnti;
   
   /* Objects for UL */
   srslte_ue_ul_t     ue_ul; 
+  cf_t              *tx_buffer; 
   srslte_timestamp_t tx_time; 
   srslte_uci_data_t  uci_data; 
   uint16_t           ul_rnti;
@@ -141,6 +208,9 @@ private:
   // Metrics
   dl_metrics_t dl_metrics;
   ul_metrics_t ul_metrics;
+  float        last_turbo_iters;
+  uint32_t     nof_late_nacks;   // PDSCH NACKed because the pipelined UL stage could not wait
+  tti_metrics_t tti_metrics;
   
 #ifdef LOG_EXECTIME
   struct timeval logtime_start[3]; 
@@ -77,6 +77,7 @@ public:
   /********** RRC INTERFACE ********************/
   void    reset();
   bool    status_is_sync();
+  bool    status_is_finished();
   void    configure_ul_params(bool pregen_disabled = false);
   void    resync_sfn(); 
   
@@ -131,7 +132,7 @@ private:
     
   uint32_t nof_workers; 
   
-  const static int MAX_WORKERS         = 4;
+  const static int MAX_WORKERS         = 16;
   const static int DEFAULT_WORKERS     = 2;
   
   const static int SF_RECV_THREAD_PRIO = 1;
@@ -155,6 +156,7 @@ private:
   uint32_t     n_ta;
     
   bool init_(srslte::radio *radio_handler, mac_interface_phy *mac, srslte::log *log_h, bool do_agc, uint32_t nof_workers);
+  void stop_workers();
   void set_default_args(phy_args_t *args);
   bool check_args(phy_args_t *args); 
 
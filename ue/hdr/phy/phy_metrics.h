@@ -27,6 +27,7 @@
 #ifndef UE_PHY_METRICS_H
 #define UE_PHY_METRICS_H
 
+#include "common/latency_hist.h"
 
 namespace srsue {
 
@@ -36,6 +37,15 @@ struct sync_metrics_t
   float sfo;
 };
 
+struct turbo_its_metrics_t
+{
+  uint32_t cap_hits;          // TBs that failed the CRC after spending their iteration cap
+  uint32_t cap_hits_reduced;  // ... of those, with a cap below pdsch_max_its
+  uint32_t reduced;           // TBs decoded with a cap below pdsch_max_its
+  uint32_t raised;            // TBs decoded with a cap above pdsch_max_its
+  uint32_t deadline_limited;  // TBs whose cap was lowered to meet the decoding deadline
+};
+
 struct dl_metrics_t
 {
   float n;
@@ -47,6 +57,8 @@ struct dl_metrics_t
   float mcs;
   float pathloss;
   float mabr_mbps;
+  srslte::latency_metrics_t pdsch_dec_time;  // Per TB, from the start of PDSCH decoding to the CRC check
+  turbo_its_metrics_t       turbo_its;
 };
 
 struct ul_metrics_t
@@ -56,6 +68,21 @@ struct ul_metrics_t
   float mabr_mbps;
 };
 
+/* One subframe of offline decoding */
+struct tti_metrics_t
+{
+  uint32_t tti;
+  float    rsrp;
+  float    rsrq;
+  float    snr;
+  uint16_t rnti;         // RNTI of the DL grant found or 0
+  uint32_t mcs;
+  uint32_t tbs;
+  bool     crc;
+  float    turbo_iters;
+  uint32_t proc_us;      // Worker processing time
+};
+
 struct phy_metrics_t
 {
   sync_metrics_t sync;
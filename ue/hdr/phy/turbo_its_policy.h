@@ -0,0 +1,92 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/******************************************************************************
+ *  File:         turbo_its_policy.h
+ *  Description:  Chooses the turbo decoder iteration cap of each PDSCH
+ *                transport block. The cap is lowered far above and far
+ *                below the decoding threshold, where extra iterations
+ *                rarely change the CRC result, raised just around it and
+ *                on the last HARQ transmission, and bounded by the time
+ *                left before the HARQ-ACK deadline in pipelined mode. One
+ *                instance per PHY worker; the counters may be read from
+ *                any thread.
+ *  Reference:
+ *****************************************************************************/
+
+#ifndef UETURBOITSPOLICY_H
+#define UETURBOITSPOLICY_H
+
+#include <stdint.h>
+#include <boost/atomic.hpp>
+#include "phy/phy_metrics.h"
+
+namespace srsue {
+
+class turbo_its_policy
+{
+public:
+  static const int32_t NO_DEADLINE = 0x7fffffff;
+
+  turbo_its_policy();
+  void     init(bool adaptive, uint32_t max_its, uint32_t min_its, uint32_t boost_its, uint32_t last_tx);
+
+  /* tx_nb counts from 0 for the first transmission of the TB. budget_us is
+   * the time left to decode it, or NO_DEADLINE, and nof_decoders the number
+   * of threads that share its code blocks */
+  uint32_t get_max_its(float snr_db, uint32_t tbs, uint32_t nof_re, uint32_t tx_nb,
+                       uint32_t nof_cb, uint32_t nof_decoders, int32_t budget_us);
+  void     tb_decoded(bool crc_ok, uint32_t max_its, float avg_its,
+                      uint32_t nof_cb, uint32_t nof_decoders, uint32_t dec_time_us);
+
+  /* Adds the counters to m and restarts them */
+  void     get_metrics(turbo_its_metrics_t &m);
+
+  static float required_snr_db(uint32_t tbs, uint32_t nof_re);
+
+private:
+  static const float HIGH_MARGIN_DB;
+  static const float NEAR_MARGIN_DB;
+  static const float LOW_MARGIN_DB;
+  static const float TIME_EMA_COEFF;
+
+  bool     adaptive;
+  uint32_t max_its;
+  uint32_t min_its;
+  uint32_t boost_its;
+  uint32_t last_tx;
+  float    us_per_it;
+
+  boost::atomic<uint32_t> cap_hits;
+  boost::atomic<uint32_t> cap_hits_reduced;
+  boost::atomic<uint32_t> reduced;
+  boost::atomic<uint32_t> raised;
+  boost::atomic<uint32_t> deadline_limited;
+};
+
+} // namespace srsue
+
+#endif // UETURBOITSPOLICY_H
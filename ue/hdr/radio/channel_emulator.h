@@ -0,0 +1,148 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/******************************************************************************
+ *  File:         channel_emulator.h
+ *  Description:  Impairments applied to the received samples before they
+ *                reach the PHY, in this order: multipath fading, carrier
+ *                frequency offset, sampling with a drifting clock, burst
+ *                drops and AWGN.
+ *                Fading follows the EPA, EVA and ETU delay profiles with a
+ *                sum of sinusoids Rayleigh process per path. Path delays
+ *                are rounded to the sampling grid.
+ *                The drifting clock resamples the stream with cubic
+ *                interpolation, so that the emulator reads from the radio
+ *                more or less samples than it delivers. Burst drops skip
+ *                samples of the stream, as a device overflow does, with
+ *                exponentially distributed intervals.
+ *                The SNR is relative to the average received power, noise
+ *                in the received signal included.
+ *                All random processes are derived from a seed so that the
+ *                same input gives the same output.
+ *  Reference:    3GPP TS 36.101 Annex B.2
+ *****************************************************************************/
+
+#ifndef CHANNEL_EMULATOR_H
+#define CHANNEL_EMULATOR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+#include "srslte/srslte.h"
+
+typedef struct {
+  bool          enable;
+  uint32_t      seed;
+  bool          awgn_enable;
+  float         snr_db;
+  float         cfo_hz;
+  float         drift_ppm;
+  std::string   fading_model;    // none, epa, eva or etu
+  float         doppler_hz;
+  float         drop_rate;       // Bursts per second
+  float         drop_len_us;
+}channel_emulator_args_t;
+
+namespace srslte {
+
+class channel_emulator
+{
+public:
+  channel_emulator();
+
+  bool init(channel_emulator_args_t *args);
+  bool is_enabled();
+
+  /* Restarts the emulation at a new sampling rate */
+  void set_srate(double srate);
+
+  /* Reading nof_samples takes get_nof_input() samples from the radio into
+   * get_input_buffer() and then run() */
+  uint32_t get_nof_input(uint32_t nof_samples);
+  cf_t*    get_input_buffer(uint32_t nof_input);
+  void     run(srslte_timestamp_t *in_time, cf_t *out, uint32_t nof_samples, srslte_timestamp_t *out_time);
+
+  uint64_t get_nof_dropped();
+
+  static const uint32_t FADING_NOF_SINUSOIDS = 16;
+  static const uint32_t FADING_UPDATE_LEN    = 32;    // Samples between fading coefficient updates
+
+private:
+  typedef struct {
+    float    delay_ns;
+    uint32_t delay;              // Samples at the current rate
+    float    amplitude;
+    float    theta[FADING_NOF_SINUSOIDS];
+    float    phi_i[FADING_NOF_SINUSOIDS];
+    float    phi_q[FADING_NOF_SINUSOIDS];
+  } path_t;
+
+  double uniform(unsigned short *state);
+  cf_t   fading_coeff(path_t *p, double t);
+  void   multipath(cf_t *x, uint32_t n);
+  void   rotate(cf_t *x, uint32_t n);
+  void   resample(cf_t *out, uint32_t n);
+  void   add_noise(cf_t *x, uint32_t n);
+  uint64_t drop_at(uint32_t i);
+
+  channel_emulator_args_t args;
+  bool                    enabled;
+  double                  srate;
+
+  unsigned short          noise_rand[3];
+  unsigned short          drop_rand[3];
+
+  // Multipath
+  std::vector<path_t>     paths;
+  std::vector<cf_t>       history;          // Last inputs before fading, newest last
+  double                  fading_time;
+
+  // CFO
+  double                  phase;
+
+  // Drifting clock: output sample k is at input position pos+k*step
+  std::vector<cf_t>       fifo;
+  std::vector<cf_t>       in_buffer;
+  srslte_timestamp_t      fifo_time;        // Time of fifo[0]
+  bool                    fifo_started;
+  double                  pos;
+  double                  step;
+
+  // Burst drops at output sample counts
+  std::deque<uint64_t>    drops;            // Scheduled drops, drawn ahead of run()
+  uint64_t                last_drop;
+  uint64_t                out_count;
+  uint32_t                drop_len;
+  uint64_t                nof_dropped;
+
+  double                  avg_power;
+};
+
+} // namespace srslte
+
+#endif // CHANNEL_EMULATOR_H
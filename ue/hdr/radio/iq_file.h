@@ -0,0 +1,179 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/******************************************************************************
+ *  File:         iq_file.h
+ *  Description:  Record and replay of the sample streams seen by the radio.
+ *                A capture starts with an iq_file_header_t followed by
+ *                iq_file_record_t records in the order they happened. RX
+ *                and TX records are followed by nof_samples cf_t samples.
+ *                The other records hold the rate, frequency and gain set
+ *                by the UE, stamped with the time of the next RX sample.
+ *                iq_recorder copies the records to a ring that a low
+ *                priority thread writes to disk, so that the RX thread
+ *                never waits for the disk. If the ring is full the record
+ *                is dropped, which shows up as a time gap when replayed.
+ *                iq_player serves the RX samples of a capture in chunks
+ *                of any size with the timestamps they were received with,
+ *                optionally paced at the recorded sampling rate.
+ *  Reference:
+ *****************************************************************************/
+
+#ifndef IQ_FILE_H
+#define IQ_FILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <string>
+
+#include "srslte/srslte.h"
+#include "common/threads.h"
+
+namespace srslte {
+
+#define IQ_FILE_MAGIC   "srsUE-IQ"
+#define IQ_FILE_VERSION 1
+
+typedef enum {
+  IQ_FILE_RX = 0,   // Samples returned by rx_now()
+  IQ_FILE_TX,       // Samples sent by tx(). value is 1 at the start of a burst
+  IQ_FILE_TX_END,   // End of burst. The timestamp is the end of the last TX
+  IQ_FILE_RX_SRATE,
+  IQ_FILE_TX_SRATE,
+  IQ_FILE_RX_FREQ,
+  IQ_FILE_TX_FREQ,
+  IQ_FILE_RX_GAIN,
+  IQ_FILE_TX_GAIN,
+  IQ_FILE_START_RX,
+  IQ_FILE_STOP_RX,
+  IQ_FILE_NOF_TYPES
+} iq_file_type_t;
+
+static const char iq_file_type_text[IQ_FILE_NOF_TYPES][16] = {"RX", "TX", "TX end",
+                                                              "RX srate", "TX srate",
+                                                              "RX freq", "TX freq",
+                                                              "RX gain", "TX gain",
+                                                              "Start RX", "Stop RX"};
+
+typedef struct {
+  char     magic[8];
+  uint32_t version;
+  uint32_t sizeof_sample;
+} iq_file_header_t;
+
+typedef struct {
+  uint32_t type;
+  uint32_t nof_samples;
+  int64_t  full_secs;
+  double   frac_secs;
+  double   value;
+} iq_file_record_t;
+
+class iq_recorder : public thread
+{
+public:
+  static const uint32_t DEFAULT_RING_SIZE = 128*1024*1024;
+
+  iq_recorder();
+  bool open(std::string filename, uint32_t ring_size = DEFAULT_RING_SIZE);
+  void close();
+  bool is_open();
+
+  void rx(cf_t *buffer, uint32_t nof_samples, srslte_timestamp_t *rx_time);
+  void tx(cf_t *buffer, uint32_t nof_samples, srslte_timestamp_t *tx_time, bool is_start_of_burst);
+  void tx_end(srslte_timestamp_t *end_time);
+  void set(iq_file_type_t type, double value);
+
+  uint32_t get_nof_dropped();
+
+private:
+  void run_thread();
+  void push(iq_file_type_t type, srslte_timestamp_t *t, double value, cf_t *samples, uint32_t nof_samples);
+  void copy_to_ring(uint64_t pos, void *data, uint32_t len);
+
+  FILE              *f;
+  bool               running;
+  uint8_t           *ring;
+  uint32_t           ring_size;
+  uint64_t           wpos;
+  uint64_t           rpos;
+  uint32_t           nof_dropped;
+  double             rx_srate;
+  srslte_timestamp_t next_rx_time;
+  pthread_mutex_t    mutex;
+  pthread_cond_t     cvar;
+};
+
+class iq_player
+{
+public:
+  iq_player();
+  bool open(std::string filename, bool realtime);
+  void close();
+  bool is_open();
+
+  /* Returns false when the end of the capture has been reached */
+  bool rx_now(cf_t *buffer, uint32_t nof_samples, srslte_timestamp_t *rxd_time);
+  bool is_finished();
+  void get_time(srslte_timestamp_t *now);
+
+  /* Value of a setting in the capture at the current position or 0 if the
+   * capture does not hold it yet. Warns once if the UE asks for another one */
+  double get(iq_file_type_t type);
+  void   check(iq_file_type_t type, double value);
+
+  uint64_t get_nof_samples();
+
+private:
+  bool next_rx_record();
+  void time_at(uint32_t offset, srslte_timestamp_t *t);
+  void wait_realtime(srslte_timestamp_t *t);
+
+  std::string        filename;
+  FILE              *f;
+  bool               realtime;
+  bool               finished;
+  double             values[IQ_FILE_NOF_TYPES];
+  bool               mismatch_warned[IQ_FILE_NOF_TYPES];
+
+  // Current RX record
+  srslte_timestamp_t rec_time;
+  double             rec_srate;
+  uint32_t           rec_pos;
+  uint32_t           rec_len;
+
+  uint64_t           nof_samples;
+  uint32_t           nof_tx;
+  bool               started;
+  srslte_timestamp_t start_time;
+  struct timespec    start_wall;
+};
+
+} // namespace srslte
+
+#endif // IQ_FILE_H
@@ -29,6 +29,9 @@
 #include "srslte/srslte.h"
 #include "srslte/rf/rf.h"
 #include "common/trace.h"
+#include "radio/iq_file.h"
+#include "radio/shm_link.h"
+#include "radio/channel_emulator.h"
 
 #ifndef RADIO_H
 #define RADIO_H
@@ -44,6 +47,13 @@ typedef struct {
   float         rx_corr_iq_q; 
 }rf_cal_t; 
 
+typedef enum {
+  RADIO_BACKEND_RF = 0,
+  RADIO_BACKEND_REPLAY,
+  RADIO_BACKEND_SHM,
+  RADIO_BACKEND_NULL
+} radio_backend_t;
+
 
 namespace srslte {
   
@@ -74,10 +84,26 @@ namespace srslte {
         tti                     = 0; 
         agc_enabled             = false; 
         offset                  = 0; 
+        backend                 = RADIO_BACKEND_RF; 
+        bzero(values, sizeof(values));
         
       };
       
       bool init(char *args = NULL, char *devname = NULL);
+      
+      /* Serves the RX samples of an IQ capture instead of opening a device. 
+       * TX samples are discarded unless recording */
+      bool init_replay(std::string filename, bool realtime);
+      
+      /* Exchanges the samples with another process over a shared memory link */
+      bool init_shm(std::string name, double srate, bool lockstep);
+      /* No device: RX reads zeros and TX is discarded, as in benchmarks */
+      void init_null();
+      
+      /* Writes the RX and TX samples and the radio settings to an IQ capture */
+      bool set_channel(channel_emulator_args_t *args);
+      bool start_record(std::string filename);
+      void stop_record();
       bool start_agc(bool tx_gain_same_rx);
       
       void set_burst_preamble(double preamble_us);
@@ -89,8 +115,12 @@ namespace srslte {
       void get_time(srslte_timestamp_t *now);
       bool tx(void *buffer, uint32_t nof_samples, srslte_timestamp_t tx_time);
       void tx_end();
+      /* Nothing is transmitted in this subframe. Lets a lockstep link advance */
+      void tx_idle(srslte_timestamp_t tx_time, uint32_t nof_samples);
       bool rx_now(void *buffer, uint32_t nof_samples, srslte_timestamp_t *rxd_time);
       bool rx_at(void *buffer, uint32_t nof_samples, srslte_timestamp_t rx_time);
+      /* A replayed capture has no more samples */
+      bool is_rx_finished();
 
       void set_tx_gain(float gain);
       void set_rx_gain(float gain);
@@ -130,9 +160,20 @@ namespace srslte {
     private:
       
       void save_trace(uint32_t is_eob, srslte_timestamp_t *usrp_time);
+      const char* device_name();
+      void init_backend(radio_backend_t backend_);
+      void set_value(iq_file_type_t type, double value);
+      bool rx_backend(cf_t *buffer, uint32_t nof_samples, srslte_timestamp_t *rxd_time);
       
       srslte_rf_t rf_device; 
       
+      radio_backend_t backend; 
+      iq_recorder     recorder;
+      iq_player       player;
+      shm_link        link;
+      channel_emulator channel;
+      double          values[IQ_FILE_NOF_TYPES];   // Settings when there is no RF device
+      
       
       const static uint32_t burst_preamble_max_samples = 30720000;  // 30.72 MHz is maximum frequency
       double burst_preamble_sec;// Start of burst preamble time (off->on RF transition time)      
@@ -0,0 +1,155 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/******************************************************************************
+ *  File:         shm_link.h
+ *  Description:  Baseband link between two processes on the same host over
+ *                a POSIX shared memory segment. The segment holds a DL ring,
+ *                read by the UE endpoint, and an UL ring, read by the eNB
+ *                endpoint. Rings are indexed by sample time at the link
+ *                sampling rate: a TX burst is copied to the slots of its
+ *                timestamp and the reader zeroes the slots it consumes, so
+ *                that anything not transmitted reads as silence. Samples
+ *                written after the reader went past them are dropped and
+ *                counted as late.
+ *                Free running links follow CLOCK_MONOTONIC from the time
+ *                the segment was created. In lockstep links there is no
+ *                wall clock: the writer of a ring declares with write_time
+ *                the samples that are final, by transmitting them or with
+ *                tx_idle(), and the reader waits for them. An endpoint that
+ *                has not transmitted for LOCKSTEP_IDLE_MS declares silence
+ *                up to LOCKSTEP_LEAD_MS after its RX time, so that a peer
+ *                that only listens or a UE that is not synchronized yet
+ *                does not stall the other side.
+ *                Readers at an integer fraction of the link rate, as in the
+ *                UE cell search, get a low-pass filtered and decimated
+ *                stream. TX must use the link rate.
+ *  Reference:
+ *****************************************************************************/
+
+#ifndef SHM_LINK_H
+#define SHM_LINK_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+#include "srslte/srslte.h"
+
+namespace srslte {
+
+#define SHM_LINK_MAGIC   "srsUEshm"
+#define SHM_LINK_VERSION 1
+
+typedef struct {
+  uint64_t read_time;     // First sample the reader has not consumed
+  uint64_t write_time;    // Lockstep: samples before it are final
+  uint64_t nof_late;      // Samples dropped because they arrived after read_time
+} shm_link_ring_t;
+
+typedef struct {
+  char            magic[8];
+  uint32_t        version;
+  uint32_t        lockstep;
+  double          srate;
+  uint64_t        epoch_ns;      // Free running: CLOCK_MONOTONIC time of sample 0
+  uint32_t        ring_len;      // Samples per ring
+  uint32_t        attached[2];
+  pthread_mutex_t mutex;         // Process shared
+  pthread_cond_t  cvar;          // Process shared, CLOCK_MONOTONIC
+  shm_link_ring_t ring[2];       // Indexed by the endpoint that reads it
+} shm_link_header_t;             // Followed by 2*ring_len cf_t samples
+
+class shm_link
+{
+public:
+  typedef enum {
+    ENDPOINT_UE = 0,
+    ENDPOINT_ENB
+  } endpoint_t;
+
+  static const uint32_t RING_MS           = 100;
+  static const uint32_t LOCKSTEP_IDLE_MS  = 2;
+  static const uint32_t LOCKSTEP_LEAD_MS  = 1;
+  static const uint32_t RX_TIMEOUT_MS     = 1000;
+
+  shm_link();
+  ~shm_link();
+
+  /* Attaches to the link or creates it. srate and lockstep must match the
+   * ones of the endpoint that created it */
+  bool open(std::string name, endpoint_t endpoint, double srate, bool lockstep);
+  void close();
+  bool is_open();
+
+  bool set_rx_srate(double srate);
+  bool set_tx_srate(double srate);
+  void stop_rx();
+
+  bool rx_now(cf_t *buffer, uint32_t nof_samples, srslte_timestamp_t *rxd_time);
+  bool tx(cf_t *buffer, uint32_t nof_samples, srslte_timestamp_t *tx_time);
+  void tx_idle(srslte_timestamp_t *time, uint32_t nof_samples);
+  void get_time(srslte_timestamp_t *now);
+
+  uint64_t get_nof_late();
+  uint32_t get_nof_overflows();
+
+private:
+  uint64_t now_samples();
+  uint64_t to_samples(srslte_timestamp_t *t);
+  void     to_timestamp(uint64_t samples, srslte_timestamp_t *t);
+  bool     wait_rx(uint64_t end);
+  void     declare(shm_link_ring_t *r, uint64_t end);
+  void     decimate(cf_t *in, uint32_t nof_in, cf_t *out);
+
+  std::string        name;
+  endpoint_t         endpoint;
+  int                fd;
+  size_t             size;
+  shm_link_header_t *hdr;
+  cf_t              *rx_samples;
+  cf_t              *tx_samples;
+  shm_link_ring_t   *rx_ring;
+  shm_link_ring_t   *tx_ring;
+
+  bool               streaming;
+  uint64_t           rx_time;
+  uint64_t           last_tx;
+  bool               tx_active;
+  uint32_t           nof_overflows;
+  bool               tx_srate_ok;
+
+  // RX decimation
+  uint32_t           decim;
+  std::vector<float> taps;
+  std::vector<cf_t>  in_buffer;
+  uint32_t           nof_history;
+};
+
+} // namespace srslte
+
+#endif // SHM_LINK_H
@@ -35,6 +35,7 @@
 
 #include <stdarg.h>
 #include <string>
+#include <map>
 #include <pthread.h>
 
 #include "radio/radio.h"
@@ -69,6 +70,12 @@ typedef struct {
   std::string   device_args; 
   std::string   time_adv_nsamples; 
   std::string   burst_preamble; 
+  std::string   record_file; 
+  std::string   replay_file; 
+  bool          replay_realtime; 
+  std::string   shm_name; 
+  float         shm_srate; 
+  bool          shm_lockstep; 
 }rf_args_t;
 
 typedef struct {
@@ -76,10 +83,18 @@ typedef struct {
   std::string   filename;
 }pcap_args_t;
 
+typedef struct {
+  bool          enable;
+  std::string   rnti;
+  int           nof_workers;
+  std::string   metrics_file;
+}offline_args_t;
+
 typedef struct {
   bool          enable;
   std::string   phy_filename;
   std::string   radio_filename;
+  std::string   timeline_filename;
 }trace_args_t;
 
 typedef struct {
@@ -102,21 +117,36 @@ typedef struct {
   int           usim_hex_limit;
   int           all_hex_limit;
   std::string   filename;
+  bool          binary;
+  int           max_queue_mb;
+  std::string   drop_policy;
+  int           max_file_mb;
+  int           nof_files;
 }log_args_t;
 
 typedef struct {
   bool          enable;
 }gui_args_t;
 
+typedef struct {
+  std::string   cpus;
+  std::string   policy;
+  int           prio;
+}thread_args_t;
+
 typedef struct {
   phy_args_t phy; 
   float      metrics_period_secs;
   bool pregenerate_signals;
+  int        buffer_pool_max_mb;
+  std::map<std::string, thread_args_t> threads;
 }expert_args_t;
 
 typedef struct {
   rf_args_t     rf;
   rf_cal_t      rf_cal; 
+  channel_emulator_args_t channel; 
+  offline_args_t offline;
   pcap_args_t   pcap;
   trace_args_t  trace;
   log_args_t    log;
@@ -140,6 +170,8 @@ public:
   bool init(all_args_t *args_);
   void stop();
   bool is_attached();
+  /* Offline decoding reached the end of the capture */
+  bool is_finished();
   void start_plot();
   
   static void rf_msg(srslte_rf_error_t error);
@@ -60,6 +60,7 @@ public:
 private:
   
   static const int GW_THREAD_PRIO = 7; 
+  static const uint32_t GW_MAX_IOV = 32; // Longer segment chains are flattened
   
   srslte::buffer_pool        *pool;
   srslte::log        *gw_log;
@@ -75,6 +76,7 @@ private:
   long                ul_tput_bytes;
   long                dl_tput_bytes;
   bpt::ptime          metrics_time;
+  srslte::latency_hist dl_mac_gw_latency;
 
   void                run_thread();
   srslte::error_t     init_if(char *err_str);
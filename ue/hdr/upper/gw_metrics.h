@@ -28,12 +28,15 @@
 #define UE_GW_METRICS_H
 
 
+#include "common/latency_hist.h"
+
 namespace srsue {
 
 struct gw_metrics_t
 {
   double dl_tput_mbps;
   double ul_tput_mbps;
+  srslte::latency_metrics_t dl_mac_gw_latency;  // RLC reception of the first segment to GW write
 };
 
 } // namespace srsue
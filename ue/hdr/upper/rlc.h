@@ -90,6 +90,8 @@ private:
   long                ul_tput_bytes[SRSUE_N_RADIO_BEARERS];
   long                dl_tput_bytes[SRSUE_N_RADIO_BEARERS];
   bpt::ptime          metrics_time;
+  srslte::latency_hist ul_gw_rlc_latency;
+  srslte::latency_hist ul_rlc_mac_latency;
 
   bool valid_lcid(uint32_t lcid);
 };
@@ -31,8 +31,7 @@
 #include "common/log.h"
 #include "common/common.h"
 #include "common/interfaces.h"
-#include "common/msg_queue.h"
-#include "common/timeout.h"
+#include "common/sdu_queue.h"
 #include "upper/rlc_common.h"
 #include <boost/thread/mutex.hpp>
 #include <map>
@@ -70,7 +69,8 @@ struct rlc_amd_retx_t{
 
 
 class rlc_am
-    :public rlc_common
+    :public srslte::timer_callback
+    ,public rlc_common
 {
 public:
   rlc_am();
@@ -95,6 +95,9 @@ public:
   int      read_pdu(uint8_t *payload, uint32_t nof_bytes);
   void     write_pdu(uint8_t *payload, uint32_t nof_bytes);
 
+  // Timeout callback interface
+  void timer_expired(uint32_t timeout_id);
+
 private:
 
   srslte::buffer_pool        *pool;
@@ -102,9 +105,13 @@ private:
   uint32_t            lcid;
   pdcp_interface_rlc *pdcp;
   rrc_interface_rlc  *rrc;
+  srslte::mac_interface_timers *mac_timers;
 
-  // TX SDU buffers
-  srslte::msg_queue      tx_sdu_queue;
+  // TX SDU buffers. Upper layer threads writing the queue are serialized
+  // by tx_sdu_mutex, reads (read_pdu() and the drain on reset) under mutex.
+  static const uint32_t TX_SDU_BATCH = 16;
+  srslte::sdu_queue      tx_sdu_queue;
+  boost::mutex           tx_sdu_mutex;
   byte_buffer_t *tx_sdu;
 
   // PDU being resegmented
@@ -167,16 +174,24 @@ private:
    * Timers
    * Ref: 3GPP TS 36.322 v10.0.0 Section 7
    ***************************************************************************/
-  timeout poll_retx_timeout;
-  timeout reordering_timeout;
-  timeout status_prohibit_timeout;
-
-  static const int reordering_timeout_id = 1;
+  uint32_t poll_retx_timeout_id;
+  uint32_t reordering_timeout_id;
+  uint32_t status_prohibit_timeout_id;
+  srslte::timers::timer *poll_retx_timer;
+  srslte::timers::timer *reordering_timer;
+  srslte::timers::timer *status_prohibit_timer;
+
+  // Expiries are delivered from the MAC timer thread. Track which timers
+  // are armed so that late callbacks for stopped timers are ignored.
+  bool     poll_retx_running;
+  bool     poll_retx_expired;
+  bool     reordering_running;
 
   // Timer checks
   bool status_prohibited();
   bool poll_retx();
-  void check_reordering_timeout();
+  void start_timer(srslte::timers::timer *t, int32_t duration);
+  void stop_timer(srslte::timers::timer *t);
 
   // Helpers
   bool poll_required();
@@ -186,12 +201,15 @@ private:
   int  build_retx_pdu(uint8_t *payload, uint32_t nof_bytes);
   int  build_segment(uint8_t *payload, uint32_t nof_bytes, rlc_amd_retx_t retx);
   int  build_data_pdu(uint8_t *payload, uint32_t nof_bytes);
+  void drain_tx_sdu_queue();
 
   void handle_data_pdu(uint8_t *payload, uint32_t nof_bytes, rlc_amd_pdu_header_t header);
   void handle_data_pdu_segment(uint8_t *payload, uint32_t nof_bytes, rlc_amd_pdu_header_t header);
   void handle_control_pdu(uint8_t *payload, uint32_t nof_bytes);
 
   void reassemble_rx_sdus();
+  void append_rx_sdu(srslte::byte_buffer_t *pdu, uint32_t nof_bytes);
+  void deliver_rx_sdu();
 
   bool inside_tx_window(uint16_t sn);
   bool inside_rx_window(uint16_t sn);
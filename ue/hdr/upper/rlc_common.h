@@ -27,6 +27,8 @@
 #ifndef RLC_COMMON_H
 #define RLC_COMMON_H
 
+#include "common/latency_hist.h"
+
 namespace srsue {
 
 /****************************************************************************
@@ -157,6 +159,7 @@ struct rlc_status_pdu_t{
 class rlc_common
 {
 public:
+  rlc_common() : tx_latency(NULL) {}
   virtual void init(srslte::log        *rlc_entity_log_,
                     uint32_t            lcid_,
                     pdcp_interface_rlc *pdcp_,
@@ -177,6 +180,12 @@ public:
   virtual uint32_t get_total_buffer_state() = 0;
   virtual int      read_pdu(uint8_t *payload, uint32_t nof_bytes) = 0;
   virtual void     write_pdu(uint8_t *payload, uint32_t nof_bytes) = 0;
+
+  // Time from write_sdu() until the SDU is fully read by MAC, may be NULL
+  void set_tx_latency(srslte::latency_hist *h) { tx_latency = h; }
+
+protected:
+  srslte::latency_hist *tx_latency;
 };
 
 } // namespace srsue
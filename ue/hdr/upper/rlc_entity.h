@@ -52,7 +52,8 @@ public:
             uint32_t              lcid_,
             pdcp_interface_rlc   *pdcp_,
             rrc_interface_rlc    *rrc_,
-            srslte::mac_interface_timers *mac_timers_);
+            srslte::mac_interface_timers *mac_timers_,
+            srslte::latency_hist *tx_latency_ = NULL);
 
   void configure(LIBLTE_RRC_RLC_CONFIG_STRUCT *cnfg);
   void reset();
@@ -28,12 +28,16 @@
 #define UE_RLC_METRICS_H
 
 
+#include "common/latency_hist.h"
+
 namespace srsue {
 
 struct rlc_metrics_t
 {
   float dl_tput_mbps;
   float ul_tput_mbps;
+  srslte::latency_metrics_t ul_gw_rlc_latency;  // DRB SDUs, GW read to RLC write_sdu
+  srslte::latency_metrics_t ul_rlc_mac_latency; // DRB SDUs, RLC write_sdu to fully read by MAC
 };
 
 } // namespace srsue
@@ -31,7 +31,7 @@
 #include "common/log.h"
 #include "common/common.h"
 #include "common/interfaces.h"
-#include "common/msg_queue.h"
+#include "common/sdu_queue.h"
 #include "upper/rlc_common.h"
 #include <boost/thread/mutex.hpp>
 #include <map>
@@ -86,8 +86,11 @@ private:
   rrc_interface_rlc    *rrc;
   srslte::mac_interface_timers *mac_timers; 
 
-  // TX SDU buffers
-  srslte::msg_queue           tx_sdu_queue;
+  // TX SDU buffers. Upper layer threads writing the queue are serialized
+  // by tx_sdu_mutex, reads (read_pdu() and the drain on reset) under mutex.
+  static const uint32_t TX_SDU_BATCH = 16;
+  srslte::sdu_queue           tx_sdu_queue;
+  boost::mutex                tx_sdu_mutex;
   srslte::byte_buffer_t      *tx_sdu;
 
   // Rx window
@@ -130,12 +133,17 @@ private:
    * Ref: 3GPP TS 36.322 v10.0.0 Section 7
    ***************************************************************************/
   uint32_t reordering_timeout_id;
+  srslte::timers::timer *reordering_timer;
 
   bool     pdu_lost;
 
   int  build_data_pdu(uint8_t *payload, uint32_t nof_bytes);
+  void drain_tx_sdu_queue();
   void handle_data_pdu(uint8_t *payload, uint32_t nof_bytes);
   void reassemble_rx_sdus();
+  void append_rx_sdu(srslte::byte_buffer_t *pdu, uint32_t nof_bytes);
+  void deliver_rx_sdu();
+  uint32_t rx_sdu_bytes();
   bool inside_reordering_window(uint16_t sn);
   void debug_state();
 };
@@ -83,6 +83,9 @@ public:
   rrc_state_t get_state();
   
   void enable_capabilities();
+  
+  /* Offline decoding: camp on the cell after SIB2 and never connect, so NAS never attaches */
+  void set_offline(bool enable);
 
   // Timeout callback interface
   void timer_expired(uint32_t timeout_id);
@@ -107,6 +110,7 @@ private:
   rrc_state_t           state;
   uint8_t               transaction_id;
   bool                  drb_up;
+  bool                  offline;
 
   uint8_t               k_rrc_enc[32];
   uint8_t               k_rrc_int[32];
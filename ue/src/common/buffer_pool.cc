@@ -27,11 +27,14 @@
 
 #include "common/buffer_pool.h"
 #include <stdio.h>
+#include <new>
 
 namespace srslte{
 
 buffer_pool* buffer_pool::instance = NULL;
 boost::mutex buffer_pool::instance_mutex;
+boost::atomic<uint32_t> buffer_pool::next_generation(1);
+boost::thread_specific_ptr<buffer_pool::cache_t> buffer_pool::cache(buffer_pool::release_cache);
 
 buffer_pool* buffer_pool::get_instance(void)
 {
@@ -53,45 +56,393 @@ void buffer_pool::cleanup(void)
 
 buffer_pool::buffer_pool()
 {
-  pool = new byte_buffer_t[POOL_SIZE];
-  first_available = &pool[0];
-  for(int i=0;i<POOL_SIZE-1;i++)
+  generation = next_generation.fetch_add(1);
+  max_memory = DEFAULT_MAX_MEMORY;
+  memory_bytes.store(0);
+  cache_hits.store(0);
+  depot_refills.store(0);
+  depot_drains.store(0);
+  grow_failures.store(0);
+
+  classes[BUFFER_CLASS_SMALL].buffer_len    = SRSUE_SMALL_BUFFER_HEADER_OFFSET + SRSUE_SMALL_BUFFER_SIZE_BYTES;
+  classes[BUFFER_CLASS_SMALL].header_offset = SRSUE_SMALL_BUFFER_HEADER_OFFSET;
+  classes[BUFFER_CLASS_SMALL].tail_offset   = SRSUE_SMALL_BUFFER_TAIL_OFFSET;
+  classes[BUFFER_CLASS_MTU].buffer_len      = SRSUE_SMALL_BUFFER_HEADER_OFFSET + SRSUE_MTU_BUFFER_SIZE_BYTES;
+  classes[BUFFER_CLASS_MTU].header_offset   = SRSUE_SMALL_BUFFER_HEADER_OFFSET;
+  classes[BUFFER_CLASS_MTU].tail_offset     = SRSUE_SMALL_BUFFER_TAIL_OFFSET;
+  classes[BUFFER_CLASS_MAX].buffer_len      = SRSUE_MAX_BUFFER_SIZE_BYTES;
+  classes[BUFFER_CLASS_MAX].header_offset   = SRSUE_BUFFER_HEADER_OFFSET;
+  classes[BUFFER_CLASS_MAX].tail_offset     = 0;
+  classes[BUFFER_CLASS_REF].buffer_len      = 0;
+  classes[BUFFER_CLASS_REF].header_offset   = 0;
+  classes[BUFFER_CLASS_REF].tail_offset     = 0;
+
+  for(uint32_t c=0;c<BUFFER_CLASS_N_ITEMS;c++)
+  {
+    classes[c].nof_chunks.store(0);
+    classes[c].depot_head.store(NIL);
+    classes[c].in_use.store(0);
+    classes[c].high_water_mark.store(0);
+    grow(c);
+  }
+}
+
+buffer_pool::~buffer_pool()
+{
+  for(uint32_t c=0;c<BUFFER_CLASS_N_ITEMS;c++)
   {
-    pool[i].set_next(&pool[i+1]);
+    for(uint32_t n=0;n<classes[c].nof_chunks;n++)
+    {
+      chunk_t *chunk = &classes[c].chunks[n];
+      for(uint32_t i=0;i<CHUNK_SIZE;i++)
+        chunk->buffers[i].~byte_buffer_t();
+      operator delete(chunk->buffers);
+      delete [] chunk->storage;
+      delete [] chunk->batch_next;
+      delete [] chunk->batch_len;
+    }
   }
-  pool[POOL_SIZE-1].set_next(NULL);
-  allocated = 0;
 }
 
 byte_buffer_t* buffer_pool::allocate()
 {
-  boost::lock_guard<boost::mutex> lock(mutex);
+  return allocate(SRSUE_MAX_BUFFER_SIZE_BYTES-SRSUE_BUFFER_HEADER_OFFSET);
+}
 
-  if(first_available == NULL)
+byte_buffer_t* buffer_pool::allocate(uint32_t nof_bytes)
+{
+  uint32_t max_bytes = classes[BUFFER_CLASS_MAX].buffer_len - classes[BUFFER_CLASS_MAX].header_offset;
+  if(nof_bytes > max_bytes)
   {
-    printf("Error - buffer pool is empty\n");
+    printf("Error - buffer pool request of %d bytes exceeds the largest buffer (%d bytes)\n",
+           nof_bytes, max_bytes);
     return NULL;
   }
 
-  // Remove from available list
-  byte_buffer_t* b = first_available;
-  first_available = b->get_next();
-  allocated++;
-
-  return b;
+  // Smallest class that fits, then larger ones if it can not grow
+  for(uint32_t c=0;c<BUFFER_CLASS_REF;c++)
+  {
+    if(nof_bytes <= classes[c].buffer_len - classes[c].header_offset)
+    {
+      byte_buffer_t *b = allocate_class(c);
+      if(b)
+        return b;
+    }
+  }
+  printf("Error - buffer pool memory limit reached (%lu bytes)\n", max_memory);
+  return NULL;
 }
 
 void buffer_pool::deallocate(byte_buffer_t *b)
 {
-  boost::lock_guard<boost::mutex> lock(mutex);
+  while(b)
+  {
+    byte_buffer_t *next = b->next;
+    b->next = NULL;
+    release(b);
+    b = next;
+  }
+}
 
-  // Add to front of available list
+byte_buffer_t* buffer_pool::allocate_ref(byte_buffer_t *b, uint32_t offset, uint32_t nof_bytes)
+{
+  // Segments always reference the buffer that owns the storage
+  byte_buffer_t *owner = b->parent ? b->parent : b;
+  byte_buffer_t *r     = allocate_class(BUFFER_CLASS_REF);
+  if(r == NULL)
+  {
+    printf("Error - buffer pool memory limit reached (%lu bytes)\n", max_memory);
+    return NULL;
+  }
+  owner->nof_users.fetch_add(1, boost::memory_order_relaxed);
+  r->parent    = owner;
+  r->msg       = &b->msg[offset];
+  r->N_bytes   = nof_bytes;
+  r->timestamp = b->timestamp;
+  return r;
+}
+
+byte_buffer_t* buffer_pool::flatten(byte_buffer_t *b)
+{
+  if(b->next == NULL)
+    return b;
+
+  uint32_t len      = b->get_chain_bytes();
+  byte_buffer_t *nb = b;
+  if(b->N_bytes + b->get_tailroom() < len)
+  {
+    nb = allocate(len);
+    if(nb == NULL)
+      return NULL;
+    memcpy(nb->msg, b->msg, b->N_bytes);
+    nb->N_bytes   = b->N_bytes;
+    nb->timestamp = b->timestamp;
+    nb->opt       = b->opt;
+    nb->opt2      = b->opt2;
+  }
+  byte_buffer_t *segs = b->next;
+  b->next = NULL;
+  for(byte_buffer_t *seg = segs; seg; seg = seg->next)
+  {
+    memcpy(&nb->msg[nb->N_bytes], seg->msg, seg->N_bytes);
+    nb->N_bytes += seg->N_bytes;
+  }
+  deallocate(segs);
+  if(nb != b)
+    deallocate(b);
+  return nb;
+}
+
+void buffer_pool::release(byte_buffer_t *b)
+{
+  // A sole user can not race with anyone taking a new reference
+  if(b->nof_users.load(boost::memory_order_acquire) != 1 &&
+     b->nof_users.fetch_sub(1, boost::memory_order_acq_rel) != 1)
+    return;
+
+  b->nof_users.store(1, boost::memory_order_relaxed);
+  byte_buffer_t *owner = b->parent;
+  b->parent = NULL;
+  recycle(b);
+  if(owner)
+    release(owner);
+}
+
+void buffer_pool::recycle(byte_buffer_t *b)
+{
   b->reset();
-  b->set_next(first_available);
-  first_available = b;
-  allocated--;
+
+  // Buffers created outside the pool (e.g. on the stack) are not recycled
+  if(b->size_class == BUFFER_CLASS_NONE)
+    return;
+
+  uint32_t c = b->size_class;
+  cache_t *ch = get_cache();
+  if(ch->count[c] == CACHE_SIZE)
+  {
+    depot_push(c, &ch->buffers[c][CACHE_SIZE-CACHE_BATCH], CACHE_BATCH);
+    ch->count[c] -= CACHE_BATCH;
+    classes[c].in_use.fetch_sub(CACHE_BATCH, boost::memory_order_relaxed);
+    depot_drains.fetch_add(1, boost::memory_order_relaxed);
+    flush_hits(ch);
+  }
+  ch->buffers[c][ch->count[c]++] = b;
+}
+
+byte_buffer_t* buffer_pool::resize(byte_buffer_t *b, uint32_t nof_bytes)
+{
+  if(b->N_bytes + b->get_tailroom() >= nof_bytes)
+    return b;
+
+  byte_buffer_t *nb = allocate(nof_bytes);
+  if(nb == NULL)
+    return NULL;
+  memcpy(nb->msg, b->msg, b->N_bytes);
+  nb->N_bytes   = b->N_bytes;
+  nb->timestamp = b->timestamp;
+  nb->opt       = b->opt;
+  nb->opt2      = b->opt2;
+  nb->next      = b->next;
+  b->next       = NULL;
+  deallocate(b);
+  return nb;
+}
+
+void buffer_pool::set_max_memory(uint64_t max_bytes)
+{
+  boost::lock_guard<boost::mutex> lock(grow_mutex);
+  max_memory = max_bytes;
+}
+
+void buffer_pool::get_metrics(buffer_pool_metrics_t &m)
+{
+  m.cache_hits    = cache_hits.load(boost::memory_order_relaxed);
+  m.depot_refills = depot_refills.load(boost::memory_order_relaxed);
+  m.depot_drains  = depot_drains.load(boost::memory_order_relaxed);
+  m.grow_failures = grow_failures.load(boost::memory_order_relaxed);
+  m.memory_bytes  = memory_bytes.load(boost::memory_order_relaxed);
+  for(uint32_t c=0;c<BUFFER_CLASS_N_ITEMS;c++)
+  {
+    m.nof_buffers[c]     = classes[c].nof_chunks.load(boost::memory_order_relaxed)*CHUNK_SIZE;
+    m.in_use[c]          = classes[c].in_use.load(boost::memory_order_relaxed);
+    m.high_water_mark[c] = classes[c].high_water_mark.load(boost::memory_order_relaxed);
+  }
+}
+
+byte_buffer_t* buffer_pool::allocate_class(uint32_t c)
+{
+  cache_t *ch = get_cache();
+
+  if(ch->count[c] == 0)
+  {
+    while(!depot_pop(c, ch))
+    {
+      if(!grow(c))
+        return NULL;
+    }
+  } else {
+    ch->hits++;
+  }
+
+  // Cached buffers may still hold depot links
+  byte_buffer_t *b = ch->buffers[c][--ch->count[c]];
+  b->next = NULL;
+  return b;
 }
 
+byte_buffer_t* buffer_pool::get_buffer(class_t *cl, uint32_t idx)
+{
+  return &cl->chunks[idx/CHUNK_SIZE].buffers[idx%CHUNK_SIZE];
+}
+
+buffer_pool::cache_t* buffer_pool::get_cache()
+{
+  cache_t *ch = cache.get();
+  if(ch == NULL || ch->generation != generation)
+  {
+    // New thread, or the cache belongs to a pool that has been cleaned up
+    if(ch == NULL)
+    {
+      ch = new cache_t;
+      cache.reset(ch);
+    }
+    for(uint32_t c=0;c<BUFFER_CLASS_N_ITEMS;c++)
+      ch->count[c] = 0;
+    ch->hits       = 0;
+    ch->generation = generation;
+  }
+  return ch;
+}
+
+bool buffer_pool::grow(uint32_t c)
+{
+  boost::lock_guard<boost::mutex> lock(grow_mutex);
+  class_t *cl = &classes[c];
+
+  // Another thread may have refilled the depot while we waited
+  if((uint32_t) cl->depot_head.load(boost::memory_order_acquire) != NIL)
+    return true;
+
+  uint32_t n           = cl->nof_chunks.load(boost::memory_order_relaxed);
+  uint32_t len         = cl->buffer_len + cl->tail_offset;
+  uint64_t chunk_bytes = (uint64_t) CHUNK_SIZE*(len + sizeof(byte_buffer_t));
+  if(n == MAX_CHUNKS || memory_bytes.load(boost::memory_order_relaxed) + chunk_bytes > max_memory)
+  {
+    grow_failures.fetch_add(1, boost::memory_order_relaxed);
+    return false;
+  }
+
+  chunk_t *chunk    = &cl->chunks[n];
+  chunk->storage    = new uint8_t[CHUNK_SIZE*len];
+  chunk->buffers    = (byte_buffer_t*) operator new(CHUNK_SIZE*sizeof(byte_buffer_t));
+  chunk->batch_next = new boost::atomic<uint32_t>[CHUNK_SIZE];
+  chunk->batch_len  = new uint32_t[CHUNK_SIZE];
+  for(uint32_t i=0;i<CHUNK_SIZE;i++)
+  {
+    byte_buffer_t *b = new(&chunk->buffers[i]) byte_buffer_t(&chunk->storage[i*len],
+                                                             len, cl->header_offset);
+    b->size_class = (buffer_class_t) c;
+    b->pool_idx   = n*CHUNK_SIZE + i;
+  }
+  cl->nof_chunks.store(n+1, boost::memory_order_release);
+  memory_bytes.fetch_add(chunk_bytes, boost::memory_order_relaxed);
+
+  byte_buffer_t *batch[CACHE_BATCH];
+  for(uint32_t i=0;i<CHUNK_SIZE;i+=CACHE_BATCH)
+  {
+    for(uint32_t j=0;j<CACHE_BATCH;j++)
+      batch[j] = &chunk->buffers[i+j];
+    depot_push(c, batch, CACHE_BATCH);
+  }
+  return true;
+}
 
+bool buffer_pool::depot_pop(uint32_t c, cache_t *ch)
+{
+  class_t *cl = &classes[c];
+  uint64_t head = cl->depot_head.load(boost::memory_order_acquire);
+  uint32_t idx;
+  while(1)
+  {
+    idx = (uint32_t) head;
+    if(idx == NIL)
+      return false;
+    uint64_t tag      = (head >> 32) + 1;
+    uint32_t next     = cl->chunks[idx/CHUNK_SIZE].batch_next[idx%CHUNK_SIZE].load(boost::memory_order_relaxed);
+    if(cl->depot_head.compare_exchange_weak(head, (tag << 32) | next,
+                                            boost::memory_order_acquire,
+                                            boost::memory_order_acquire))
+      break;
+  }
+
+  // The batch is now owned by this thread
+  uint32_t n = cl->chunks[idx/CHUNK_SIZE].batch_len[idx%CHUNK_SIZE];
+  byte_buffer_t *b = get_buffer(cl, idx);
+  for(uint32_t i=0;i<n;i++)
+  {
+    ch->buffers[c][ch->count[c]++] = b;
+    b = b->get_next();
+  }
+
+  int32_t cur = cl->in_use.fetch_add(n, boost::memory_order_relaxed) + n;
+  int32_t hwm = cl->high_water_mark.load(boost::memory_order_relaxed);
+  while(cur > hwm && !cl->high_water_mark.compare_exchange_weak(hwm, cur, boost::memory_order_relaxed));
+  depot_refills.fetch_add(1, boost::memory_order_relaxed);
+  flush_hits(ch);
+  return true;
+}
+
+void buffer_pool::depot_push(uint32_t c, byte_buffer_t **buffers, uint32_t n)
+{
+  class_t *cl = &classes[c];
+  for(uint32_t i=0;i<n-1;i++)
+    buffers[i]->set_next(buffers[i+1]);
+  buffers[n-1]->set_next(NULL);
+
+  uint32_t first  = buffers[0]->pool_idx;
+  chunk_t *chunk  = &cl->chunks[first/CHUNK_SIZE];
+  chunk->batch_len[first%CHUNK_SIZE] = n;
+
+  uint64_t head = cl->depot_head.load(boost::memory_order_relaxed);
+  while(1)
+  {
+    uint64_t tag = (head >> 32) + 1;
+    chunk->batch_next[first%CHUNK_SIZE].store((uint32_t) head, boost::memory_order_relaxed);
+    if(cl->depot_head.compare_exchange_weak(head, (tag << 32) | first,
+                                            boost::memory_order_release,
+                                            boost::memory_order_relaxed))
+      break;
+  }
+}
+
+void buffer_pool::flush_hits(cache_t *ch)
+{
+  // Hits are counted per thread and published on every depot access
+  if(ch->hits)
+  {
+    cache_hits.fetch_add(ch->hits, boost::memory_order_relaxed);
+    ch->hits = 0;
+  }
+}
+
+void buffer_pool::release_cache(cache_t *ch)
+{
+  // Called on thread exit: give cached buffers back to the depots
+  boost::lock_guard<boost::mutex> lock(instance_mutex);
+  if(NULL != instance && ch->generation == instance->generation)
+  {
+    for(uint32_t c=0;c<BUFFER_CLASS_N_ITEMS;c++)
+    {
+      if(ch->count[c] > 0)
+      {
+        instance->depot_push(c, ch->buffers[c], ch->count[c]);
+        instance->classes[c].in_use.fetch_sub(ch->count[c], boost::memory_order_relaxed);
+        instance->depot_drains.fetch_add(1, boost::memory_order_relaxed);
+      }
+    }
+    instance->flush_hits(ch);
+  }
+  delete ch;
+}
 
 } // namespace srsue
@@ -0,0 +1,114 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#include <algorithm>
+#include "common/latency_hist.h"
+
+namespace srslte {
+
+latency_hist::latency_hist()
+{
+  reset();
+}
+
+uint32_t latency_hist::bucket_idx(uint32_t latency_us)
+{
+  if(latency_us < (1<<LATENCY_HIST_SUB_BITS))
+    return latency_us;
+  uint32_t e   = 31 - __builtin_clz(latency_us);
+  uint32_t sub = (latency_us >> (e-LATENCY_HIST_SUB_BITS)) & ((1<<LATENCY_HIST_SUB_BITS)-1);
+  return ((e-LATENCY_HIST_SUB_BITS+1)<<LATENCY_HIST_SUB_BITS) + sub;
+}
+
+uint32_t latency_hist::bucket_low(uint32_t idx)
+{
+  if(idx < (1<<LATENCY_HIST_SUB_BITS))
+    return idx;
+  uint32_t e   = (idx>>LATENCY_HIST_SUB_BITS) + LATENCY_HIST_SUB_BITS - 1;
+  uint32_t sub = idx & ((1<<LATENCY_HIST_SUB_BITS)-1);
+  return ((1<<LATENCY_HIST_SUB_BITS) + sub) << (e-LATENCY_HIST_SUB_BITS);
+}
+
+uint32_t latency_hist::bucket_width(uint32_t idx)
+{
+  if(idx < (1<<LATENCY_HIST_SUB_BITS))
+    return 1;
+  return 1 << ((idx>>LATENCY_HIST_SUB_BITS) - 1);
+}
+
+void latency_hist::add(uint32_t latency_us)
+{
+  buckets[bucket_idx(latency_us)].fetch_add(1, boost::memory_order_relaxed);
+  sum_us.fetch_add(latency_us, boost::memory_order_relaxed);
+  uint32_t m = max_us.load(boost::memory_order_relaxed);
+  while(latency_us > m && !max_us.compare_exchange_weak(m, latency_us, boost::memory_order_relaxed));
+}
+
+void latency_hist::reset()
+{
+  for(uint32_t i=0;i<LATENCY_HIST_NOF_BUCKETS;i++)
+    buckets[i].store(0, boost::memory_order_relaxed);
+  sum_us.store(0, boost::memory_order_relaxed);
+  max_us.store(0, boost::memory_order_relaxed);
+}
+
+// Samples added while taking the snapshot may be counted in either period
+void latency_hist::get_metrics(latency_metrics_t &m)
+{
+  uint32_t counts[LATENCY_HIST_NOF_BUCKETS];
+  uint32_t total = 0;
+  for(uint32_t i=0;i<LATENCY_HIST_NOF_BUCKETS;i++) {
+    counts[i] = buckets[i].exchange(0, boost::memory_order_relaxed);
+    total    += counts[i];
+  }
+  uint64_t sum = sum_us.exchange(0, boost::memory_order_relaxed);
+
+  m.count   = total;
+  m.max_us  = max_us.exchange(0, boost::memory_order_relaxed);
+  m.mean_us = total ? (float) sum/total : 0;
+  m.p50_us  = std::min(percentile(counts, total, 0.50), m.max_us);
+  m.p90_us  = std::min(percentile(counts, total, 0.90), m.max_us);
+  m.p99_us  = std::min(percentile(counts, total, 0.99), m.max_us);
+}
+
+// Midpoint of the bucket holding the p-quantile
+float latency_hist::percentile(uint32_t *counts, uint32_t total, float p)
+{
+  if(!total)
+    return 0;
+  uint32_t target = (uint32_t) (p*total);
+  if(target >= total)
+    target = total-1;
+  uint32_t acc = 0;
+  for(uint32_t i=0;i<LATENCY_HIST_NOF_BUCKETS;i++) {
+    acc += counts[i];
+    if(acc > target)
+      return bucket_low(i) + (bucket_width(i)-1)/2.0;
+  }
+  return 0;
+}
+
+} // namespace srslte
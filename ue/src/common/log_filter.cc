@@ -32,7 +32,8 @@ namespace srslte{
 
 log_filter::log_filter()
 {
-  do_tti = false; 
+  do_tti   = false; 
+  logger_h = NULL;
 }
 
 log_filter::log_filter(std::string layer, logger *logger_, bool tti)
@@ -90,7 +91,7 @@ void log_filter::all_log(srslte::LOG_LEVEL_ENUM level,
 
 void log_filter::all_log_line(srslte::LOG_LEVEL_ENUM level,
                               uint32_t               tti,
-                              std::string            file,
+                              const char            *file,
                               int                    line,
                               char                  *msg)
 {
@@ -109,155 +110,146 @@ void log_filter::all_log_line(srslte::LOG_LEVEL_ENUM level,
   }
 }
 
-void log_filter::console(std::string message, ...) {
+void log_filter::log_va(srslte::LOG_LEVEL_ENUM level, const char *file, int line,
+                        uint8_t *hex, int size, const char *message, va_list args)
+{
+  // Binary records are formatted by the logger thread
+  if(logger_h && logger_h->is_binary()) {
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int hex_len = (hex_limit >= 0 && size > hex_limit) ? hex_limit : size;
+    bool logged = logger_h->log_binary(level, service_name.c_str(), do_tti, tti,
+                                       hex, hex ? hex_len : 0, message, args_copy);
+    va_end(args_copy);
+    if(logged)
+      return;
+  }
+
+  char *args_msg;
+  if(vasprintf(&args_msg, message, args) > 0) {
+    if(hex)
+      all_log(level, tti, args_msg, hex, size);
+    else if(file)
+      all_log_line(level, tti, file, line, args_msg);
+    else
+      all_log(level, tti, args_msg);
+    free(args_msg);
+  }
+}
+
+void log_filter::console(const char *message, ...) {
   char     *args_msg;
   va_list   args;
   va_start(args, message);
-  if(vasprintf(&args_msg, message.c_str(), args) > 0)
+  if(vasprintf(&args_msg, message, args) > 0)
     printf("%s",args_msg); // Print directly to stdout
   va_end(args);
   free(args_msg);
 }
 
-void log_filter::error(std::string message, ...) {
+void log_filter::error(const char *message, ...) {
   if (level >= LOG_LEVEL_ERROR) {
-    char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0)
-      all_log(LOG_LEVEL_ERROR, tti, args_msg);
+    log_va(LOG_LEVEL_ERROR, NULL, 0, NULL, 0, message, args);
     va_end(args);
-    free(args_msg);
   }
 }
-void log_filter::warning(std::string message, ...) {
+void log_filter::warning(const char *message, ...) {
   if (level >= LOG_LEVEL_WARNING) {
-    char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0)
-      all_log(LOG_LEVEL_WARNING, tti, args_msg);
+    log_va(LOG_LEVEL_WARNING, NULL, 0, NULL, 0, message, args);
     va_end(args);
-    free(args_msg);
   }
 }
-void log_filter::info(std::string message, ...) {
+void log_filter::info(const char *message, ...) {
   if (level >= LOG_LEVEL_INFO) {
-    char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0)
-      all_log(LOG_LEVEL_INFO, tti, args_msg);
+    log_va(LOG_LEVEL_INFO, NULL, 0, NULL, 0, message, args);
     va_end(args);
-    free(args_msg);
   }
 }
-void log_filter::debug(std::string message, ...) {
+void log_filter::debug(const char *message, ...) {
   if (level >= LOG_LEVEL_DEBUG) {
-    char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0)
-      all_log(LOG_LEVEL_DEBUG, tti, args_msg);
+    log_va(LOG_LEVEL_DEBUG, NULL, 0, NULL, 0, message, args);
     va_end(args);
-    free(args_msg);
   }
 }
 
-void log_filter::error_hex(uint8_t *hex, int size, std::string message, ...) {
+void log_filter::error_hex(uint8_t *hex, int size, const char *message, ...) {
   if (level >= LOG_LEVEL_ERROR) {
-    char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0)
-      all_log(LOG_LEVEL_ERROR, tti, args_msg, hex, size);
+    log_va(LOG_LEVEL_ERROR, NULL, 0, hex, size, message, args);
     va_end(args);
-    free(args_msg);
   }
 }
-void log_filter::warning_hex(uint8_t *hex, int size, std::string message, ...) {
+void log_filter::warning_hex(uint8_t *hex, int size, const char *message, ...) {
   if (level >= LOG_LEVEL_WARNING) {
-    char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0)
-      all_log(LOG_LEVEL_WARNING, tti, args_msg, hex, size);
+    log_va(LOG_LEVEL_WARNING, NULL, 0, hex, size, message, args);
     va_end(args);
-    free(args_msg);
   }
 }
-void log_filter::info_hex(uint8_t *hex, int size, std::string message, ...) {
+void log_filter::info_hex(uint8_t *hex, int size, const char *message, ...) {
   if (level >= LOG_LEVEL_INFO) {
-    char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0)
-      all_log(LOG_LEVEL_INFO, tti, args_msg, hex, size);
+    log_va(LOG_LEVEL_INFO, NULL, 0, hex, size, message, args);
     va_end(args);
-    free(args_msg);
   }
 }
-void log_filter::debug_hex(uint8_t *hex, int size, std::string message, ...) {
+void log_filter::debug_hex(uint8_t *hex, int size, const char *message, ...) {
   if (level >= LOG_LEVEL_DEBUG) {
-    char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0)
-      all_log(LOG_LEVEL_DEBUG, tti, args_msg, hex, size);
+    log_va(LOG_LEVEL_DEBUG, NULL, 0, hex, size, message, args);
     va_end(args);
-    free(args_msg);
   }
 }
 
-void log_filter::error_line(std::string file, int line, std::string message, ...)
+void log_filter::error_line(const char *file, int line, const char *message, ...)
 {
   if (level >= LOG_LEVEL_ERROR) {
-    char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0)
-      all_log_line(LOG_LEVEL_ERROR, tti, file, line, args_msg);
+    log_va(LOG_LEVEL_ERROR, file, line, NULL, 0, message, args);
     va_end(args);
-    free(args_msg);
   }
 }
 
-void log_filter::warning_line(std::string file, int line, std::string message, ...)
+void log_filter::warning_line(const char *file, int line, const char *message, ...)
 {
   if (level >= LOG_LEVEL_WARNING) {
-    char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0)
-      all_log_line(LOG_LEVEL_WARNING, tti, file, line, args_msg);
+    log_va(LOG_LEVEL_WARNING, file, line, NULL, 0, message, args);
     va_end(args);
-    free(args_msg);
   }
 }
 
-void log_filter::info_line(std::string file, int line, std::string message, ...)
+void log_filter::info_line(const char *file, int line, const char *message, ...)
 {
   if (level >= LOG_LEVEL_INFO) {
-    char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0)
-      all_log_line(LOG_LEVEL_INFO, tti, file, line, args_msg);
+    log_va(LOG_LEVEL_INFO, file, line, NULL, 0, message, args);
     va_end(args);
-    free(args_msg);
   }
 }
 
-void log_filter::debug_line(std::string file, int line, std::string message, ...)
+void log_filter::debug_line(const char *file, int line, const char *message, ...)
 {
   if (level >= LOG_LEVEL_DEBUG) {
-    char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0)
-      all_log_line(LOG_LEVEL_DEBUG, tti, file, line, args_msg);
+    log_va(LOG_LEVEL_DEBUG, file, line, NULL, 0, message, args);
     va_end(args);
-    free(args_msg);
   }
 }
 
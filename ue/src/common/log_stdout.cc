@@ -67,7 +67,7 @@ void log_stdout::all_log(srslte::LOG_LEVEL_ENUM level,
 
 void log_stdout::all_log_line(srslte::LOG_LEVEL_ENUM level,
                               uint32_t               tti,
-                              std::string            file,
+                              const char            *file,
                               int                    line,
                               char                  *msg)
 {
@@ -82,152 +82,152 @@ void log_stdout::all_log_line(srslte::LOG_LEVEL_ENUM level,
   cout << ss.str();
 }
 
-void log_stdout::console(std::string message, ...) {
+void log_stdout::console(const char *message, ...) {
   char     *args_msg;
   va_list   args;
   va_start(args, message);
-  if(vasprintf(&args_msg, message.c_str(), args) > 0);
+  if(vasprintf(&args_msg, message, args) > 0);
     printf("%s",args_msg); // Print directly to stdout
   va_end(args);
   free(args_msg);
 }
 
-void log_stdout::error(std::string message, ...) {
+void log_stdout::error(const char *message, ...) {
   if (level >= LOG_LEVEL_ERROR) {
     char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0);
+    if(vasprintf(&args_msg, message, args) > 0);
       all_log(LOG_LEVEL_ERROR, tti, args_msg);
     va_end(args);
     free(args_msg);
   }
 }
-void log_stdout::warning(std::string message, ...) {
+void log_stdout::warning(const char *message, ...) {
   if (level >= LOG_LEVEL_WARNING) {
     char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0);
+    if(vasprintf(&args_msg, message, args) > 0);
       all_log(LOG_LEVEL_WARNING, tti, args_msg);
     va_end(args);
     free(args_msg);
   }
 }
-void log_stdout::info(std::string message, ...) {
+void log_stdout::info(const char *message, ...) {
   if (level >= LOG_LEVEL_INFO) {
     char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0);
+    if(vasprintf(&args_msg, message, args) > 0);
       all_log(LOG_LEVEL_INFO, tti, args_msg);
     va_end(args);
     free(args_msg);
   }
 }
-void log_stdout::debug(std::string message, ...) {
+void log_stdout::debug(const char *message, ...) {
   if (level >= LOG_LEVEL_DEBUG) {
     char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0);
+    if(vasprintf(&args_msg, message, args) > 0);
       all_log(LOG_LEVEL_DEBUG, tti, args_msg);
     va_end(args);
     free(args_msg);
   }
 }
 
-void log_stdout::error_hex(uint8_t *hex, int size, std::string message, ...) {
+void log_stdout::error_hex(uint8_t *hex, int size, const char *message, ...) {
   if (level >= LOG_LEVEL_ERROR) {
     char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0);
+    if(vasprintf(&args_msg, message, args) > 0);
       all_log(LOG_LEVEL_ERROR, tti, args_msg, hex, size);
     va_end(args);
     free(args_msg);
   }
 }
-void log_stdout::warning_hex(uint8_t *hex, int size, std::string message, ...) {
+void log_stdout::warning_hex(uint8_t *hex, int size, const char *message, ...) {
   if (level >= LOG_LEVEL_WARNING) {
     char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0);
+    if(vasprintf(&args_msg, message, args) > 0);
       all_log(LOG_LEVEL_WARNING, tti, args_msg, hex, size);
     va_end(args);
     free(args_msg);
   }
 }
-void log_stdout::info_hex(uint8_t *hex, int size, std::string message, ...) {
+void log_stdout::info_hex(uint8_t *hex, int size, const char *message, ...) {
   if (level >= LOG_LEVEL_INFO) {
     char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0);
+    if(vasprintf(&args_msg, message, args) > 0);
       all_log(LOG_LEVEL_INFO, tti, args_msg, hex, size);
     va_end(args);
     free(args_msg);
   }
 }
-void log_stdout::debug_hex(uint8_t *hex, int size, std::string message, ...) {
+void log_stdout::debug_hex(uint8_t *hex, int size, const char *message, ...) {
   if (level >= LOG_LEVEL_DEBUG) {
     char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0);
+    if(vasprintf(&args_msg, message, args) > 0);
       all_log(LOG_LEVEL_DEBUG, tti, args_msg, hex, size);
     va_end(args);
     free(args_msg);
   }
 }
 
-void log_stdout::error_line(std::string file, int line, std::string message, ...)
+void log_stdout::error_line(const char *file, int line, const char *message, ...)
 {
   if (level >= LOG_LEVEL_ERROR) {
     char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0);
+    if(vasprintf(&args_msg, message, args) > 0);
       all_log_line(LOG_LEVEL_ERROR, tti, file, line, args_msg);
     va_end(args);
     free(args_msg);
   }
 }
 
-void log_stdout::warning_line(std::string file, int line, std::string message, ...)
+void log_stdout::warning_line(const char *file, int line, const char *message, ...)
 {
   if (level >= LOG_LEVEL_WARNING) {
     char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0);
+    if(vasprintf(&args_msg, message, args) > 0);
       all_log_line(LOG_LEVEL_WARNING, tti, file, line, args_msg);
     va_end(args);
     free(args_msg);
   }
 }
 
-void log_stdout::info_line(std::string file, int line, std::string message, ...)
+void log_stdout::info_line(const char *file, int line, const char *message, ...)
 {
   if (level >= LOG_LEVEL_INFO) {
     char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0);
+    if(vasprintf(&args_msg, message, args) > 0);
       all_log_line(LOG_LEVEL_INFO, tti, file, line, args_msg);
     va_end(args);
     free(args_msg);
   }
 }
 
-void log_stdout::debug_line(std::string file, int line, std::string message, ...)
+void log_stdout::debug_line(const char *file, int line, const char *message, ...)
 {
   if (level >= LOG_LEVEL_DEBUG) {
     char     *args_msg;
     va_list   args;
     va_start(args, message);
-    if(vasprintf(&args_msg, message.c_str(), args) > 0);
+    if(vasprintf(&args_msg, message, args) > 0);
       all_log_line(LOG_LEVEL_DEBUG, tti, file, line, args_msg);
     va_end(args);
     free(args_msg);
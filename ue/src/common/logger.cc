@@ -26,36 +26,220 @@
 
 
 #define LOG_BUFFER_SIZE 1024*32
+#define LOG_WRITE_SIZE  (1024*256)
+#define LOG_MSG_OVERHEAD 64
+#define LOG_MAX_QUEUE_BYTES (1024*1024*64)
+#define LOG_RING_SIZE   (1024*64)
+#define LOG_MAX_RECORD  (1024*8)
+#define LOG_MAX_ARGS    16
+#define LOG_MAX_STR_LEN 256
+#define LOG_MAX_BATCH   1024
+#define LOG_TRUNC_MARK  "...(truncated)"
 
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include "common/logger.h"
+#include "common/threads.h"
 
 using namespace std;
 
 namespace srslte{
 
+typedef enum {
+  ARG_NONE = 0,
+  ARG_INT,
+  ARG_LONG,
+  ARG_LLONG,
+  ARG_DOUBLE,
+  ARG_PTR,
+  ARG_STR,
+  ARG_UNSUPPORTED
+} arg_type_t;
+
+// Finds the next conversion in fmt and the types of the arguments it takes,
+// '*' width and precision first. Returns NULL if there are no more.
+static const char* next_conversion(const char *fmt, const char **end, arg_type_t *types, uint32_t *nof_types)
+{
+  const char *p = strchr(fmt, '%');
+  if(!p)
+    return NULL;
+  const char *q = p+1;
+  uint32_t    n = 0;
+  uint32_t    l = 0;
+  bool long_double = false;
+
+  while(*q && strchr("-+ #0'", *q))
+    q++;
+  if(*q == '*') {
+    types[n++] = ARG_INT;
+    q++;
+  }
+  while(*q >= '0' && *q <= '9')
+    q++;
+  if(*q == '.') {
+    q++;
+    if(*q == '*') {
+      types[n++] = ARG_INT;
+      q++;
+    }
+    while(*q >= '0' && *q <= '9')
+      q++;
+  }
+  while(*q && strchr("hlLqjzt", *q)) {
+    if(*q == 'l')
+      l++;
+    else if(*q == 'z' || *q == 't')
+      l = 1;
+    else if(*q == 'j' || *q == 'q')
+      l = 2;
+    else if(*q == 'L')
+      long_double = true;
+    q++;
+  }
+  switch(*q) {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+      types[n++] = (l == 0) ? ARG_INT : ((l == 1) ? ARG_LONG : ARG_LLONG);
+      break;
+    case 'c':
+      types[n++] = (l == 0) ? ARG_INT : ARG_UNSUPPORTED;
+      break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+      types[n++] = long_double ? ARG_UNSUPPORTED : ARG_DOUBLE;
+      break;
+    case 's':
+      types[n++] = (l == 0) ? ARG_STR : ARG_UNSUPPORTED;
+      break;
+    case 'p':
+      types[n++] = ARG_PTR;
+      break;
+    case '%':
+      break;
+    default:
+      types[n++] = ARG_UNSUPPORTED;
+      break;
+  }
+  *end       = *q ? q+1 : q;
+  *nof_types = n;
+  return p;
+}
+
+template<typename T>
+static int format_arg(char *buf, uint32_t len, const char *spec, uint32_t nof_stars, int *stars, T v)
+{
+  switch(nof_stars) {
+    case 0:  return snprintf(buf, len, spec, v);
+    case 1:  return snprintf(buf, len, spec, stars[0], v);
+    default: return snprintf(buf, len, spec, stars[0], stars[1], v);
+  }
+}
+
+static boost::atomic<uint32_t> logger_ids(0);
+
+// Memory accounted for a queued message
+static uint32_t msg_bytes(const str_ptr &msg)
+{
+  return msg->size() + LOG_MSG_OVERHEAD;
+}
+
 logger::logger()
-  :buffer(LOG_BUFFER_SIZE)
+  :fd(-1)
   ,inited(false)
   ,not_done(true)
-{}
+  ,binary(false)
+  ,buffer(LOG_BUFFER_SIZE)
+  ,batch(LOG_BUFFER_SIZE)
+  ,queue_bytes(0)
+  ,queue_bytes_max(0)
+  ,max_queue_bytes(LOG_MAX_QUEUE_BYTES)
+  ,drop_policy(LOGGER_DROP_NEWEST)
+  ,dropped_msgs(0)
+  ,dropped_msgs_reported(0)
+  ,new_max_file_bytes(0)
+  ,new_nof_files(0)
+  ,rotation_changed(false)
+  ,wbuf(NULL)
+  ,wbuf_len(0)
+  ,file_bytes(0)
+  ,max_file_bytes(0)
+  ,nof_files(0)
+  ,bytes_written(0)
+  ,nof_rotations(0)
+  ,dropped_records(0)
+  ,events(0)
+  ,reader_waiting(0)
+{
+  id = ++logger_ids;
+  pthread_key_create(&ring_key, release_ring);
+}
 
 logger::~logger() {
   not_done = false;
-  log("Closing log");
+  // Bypasses the queue limit, so closing never drops or evicts a message
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    push(str_ptr(new std::string("Closing log")));
+  }
+  not_empty.notify_one();
+  if(binary)
+    wake_reader();
   if(inited) {
     pthread_join(thread, NULL);
-    flush();
-    fclose(logfile);
+    while(read_records());
+    read_messages();
+    write_buffer();
+    if(fd >= 0)
+      close(fd);
   }
+  free(wbuf);
+  // Threads still running keep their pointer but no longer log to us
+  pthread_key_delete(ring_key);
+  for(uint32_t i=0;i<rings.size();i++)
+    delete rings[i];
+}
+
+void logger::set_max_queue_bytes(uint32_t bytes, logger_drop_policy_t policy) {
+  boost::mutex::scoped_lock lock(mutex);
+  max_queue_bytes = bytes;
+  drop_policy     = policy;
 }
 
-void logger::init(std::string file) {
+void logger::set_rotation(uint64_t max_file_bytes_, uint32_t nof_files_) {
+  boost::mutex::scoped_lock lock(mutex);
+  new_max_file_bytes = max_file_bytes_;
+  new_nof_files      = nof_files_;
+  rotation_changed   = true;
+  if(!inited) {
+    max_file_bytes = max_file_bytes_;
+    nof_files      = nof_files_;
+  }
+}
+
+void logger::get_metrics(logger_metrics_t &m) {
+  boost::mutex::scoped_lock lock(mutex);
+  m.dropped_msgs    = dropped_msgs;
+  m.dropped_records = dropped_records;
+  m.bytes_written   = bytes_written;
+  m.nof_rotations   = nof_rotations;
+  m.queue_bytes     = queue_bytes;
+  m.queue_bytes_max = queue_bytes_max;
+}
+
+void logger::init(std::string file, bool binary_) {
   filename = file;
-  logfile = fopen(filename.c_str(), "w");
-  if(logfile==NULL) {
+  binary   = binary_;
+  fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0) {
     printf("Error: could not create log file, no messages will be logged");
   }
-  pthread_create(&thread, NULL, &start, this);
+  if(posix_memalign((void**) &wbuf, 4096, LOG_WRITE_SIZE)) {
+    wbuf = NULL;
+  }
+  threads_new_rt_named(&thread, &start, this, -1, -1, "logger");
   inited = true;
 }
 
@@ -65,15 +249,170 @@ void logger::log(const char *msg) {
 }
 
 void logger::log(str_ptr msg) {
-    boost::mutex::scoped_lock lock(mutex);
-    if(buffer.full()) {
-      buffer.set_capacity(buffer.capacity()*2);
-      if(logfile)
-        fprintf(logfile, "Log queue full, doubling capacity\n");
+  uint32_t len = msg_bytes(msg);
+  boost::mutex::scoped_lock lock(mutex);
+  if(drop_policy == LOGGER_DROP_OLDEST) {
+    while(!buffer.empty() && queue_bytes + len > max_queue_bytes) {
+      queue_bytes -= msg_bytes(buffer.front());
+      buffer.pop_front();
+      dropped_msgs++;
     }
-    buffer.push_back(msg);
+  }
+  if(queue_bytes + len > max_queue_bytes) {
+    dropped_msgs++;
+    return;
+  }
+  push(msg);
+  lock.unlock();
+  not_empty.notify_one();
+  if(binary)
+    wake_reader();
+}
+
+// Queues msg. The caller must hold mutex
+void logger::push(str_ptr msg) {
+  // Capacity is bounded by the byte limit
+  if(buffer.full()) {
+    buffer.set_capacity(buffer.capacity()*2);
+  }
+  buffer.push_back(msg);
+  queue_bytes += msg_bytes(msg);
+  if(queue_bytes > queue_bytes_max) {
+    queue_bytes_max = queue_bytes;
+  }
+}
+
+bool logger::log_binary(LOG_LEVEL_ENUM level, const char *layer, bool do_tti, uint32_t tti,
+                        uint8_t *hex, int hex_len, const char *fmt, va_list args)
+{
+  record_arg_t argv[LOG_MAX_ARGS];
+  arg_type_t   types[3];
+  uint32_t     nof_types;
+  uint32_t     nof_args  = 0;
+  uint32_t     str_bytes = 0;
+  const char  *p = fmt;
+  const char  *end;
+
+  // Capture the raw arguments
+  while((p = next_conversion(p, &end, types, &nof_types)) != NULL) {
+    for(uint32_t i=0;i<nof_types;i++) {
+      if(types[i] == ARG_UNSUPPORTED || nof_args == LOG_MAX_ARGS)
+        return false;
+      record_arg_t *a = &argv[nof_args++];
+      a->type      = types[i];
+      a->len       = 0;
+      a->truncated = 0;
+      switch(types[i]) {
+        case ARG_INT:    a->v.i  = va_arg(args, int);       break;
+        case ARG_LONG:   a->v.l  = va_arg(args, long);      break;
+        case ARG_LLONG:  a->v.ll = va_arg(args, long long); break;
+        case ARG_DOUBLE: a->v.d  = va_arg(args, double);    break;
+        case ARG_PTR:    a->v.p  = va_arg(args, void*);     break;
+        case ARG_STR:
+          a->v.p = va_arg(args, const char*);
+          if(!a->v.p)
+            a->v.p = "(null)";
+          a->len = strnlen((const char*) a->v.p, LOG_MAX_STR_LEN);
+          a->truncated = (a->len == LOG_MAX_STR_LEN && ((const char*) a->v.p)[a->len] != '\0');
+          str_bytes += a->len;
+          break;
+        default:
+          break;
+      }
+    }
+    p = end;
+  }
+  if(hex_len < 0)
+    hex_len = 0;
+
+  uint32_t size = sizeof(record_t) + nof_args*sizeof(record_arg_t) + str_bytes + hex_len;
+  size = (size + 7) & ~7;
+  if(size > LOG_MAX_RECORD)
+    return false;
+
+  ring    *r   = get_ring();
+  uint8_t *ptr = r->reserve(size);
+  if(!ptr) {
+    r->dropped.fetch_add(1, boost::memory_order_relaxed);
+    return true;
+  }
+
+  record_t *rec = (record_t*) ptr;
+  rec->size     = size;
+  rec->level    = level;
+  rec->do_tti   = do_tti;
+  rec->nof_args = nof_args;
+  rec->tti      = tti;
+  rec->hex_len  = hex_len;
+  rec->fmt      = fmt;
+  clock_gettime(CLOCK_REALTIME, &rec->time);
+  strncpy(rec->layer, layer, LAYER_LEN-1);
+  rec->layer[LAYER_LEN-1] = '\0';
+  ptr += sizeof(record_t);
+  memcpy(ptr, argv, nof_args*sizeof(record_arg_t));
+  ptr += nof_args*sizeof(record_arg_t);
+  for(uint32_t i=0;i<nof_args;i++) {
+    if(argv[i].type == ARG_STR) {
+      memcpy(ptr, argv[i].v.p, argv[i].len);
+      ptr += argv[i].len;
+    }
+  }
+  if(hex_len > 0)
+    memcpy(ptr, hex, hex_len);
+  r->commit(size);
+
+  // Pairs with the fence in wait_pending()
+  boost::atomic_thread_fence(boost::memory_order_seq_cst);
+  if(reader_waiting.load(boost::memory_order_relaxed))
+    wake_reader();
+  return true;
+}
+
+logger::ring* logger::get_ring() {
+  ring *r = (ring*) pthread_getspecific(ring_key);
+  if(!r) {
+    r = new ring();
+    boost::mutex::scoped_lock lock(rings_mutex);
+    rings.push_back(r);
     lock.unlock();
-    not_empty.notify_one();
+    pthread_setspecific(ring_key, r);
+  }
+  return r;
+}
+
+// Runs on thread exit. The logger thread frees the ring once drained.
+void logger::release_ring(void *r) {
+  ((ring*) r)->released.store(true, boost::memory_order_release);
+}
+
+// Returns true if there are records or text messages to write
+bool logger::has_pending() {
+  {
+    boost::mutex::scoped_lock lock(rings_mutex);
+    for(uint32_t i=0;i<rings.size();i++) {
+      if(!rings[i]->empty())
+        return true;
+    }
+  }
+  boost::mutex::scoped_lock lock(mutex);
+  return !buffer.empty() || dropped_msgs != dropped_msgs_reported || !not_done;
+}
+
+// Parks the logger thread until a producer wakes it. Producers publish
+// before checking reader_waiting and the reader sets reader_waiting before
+// checking for pending data, so either side sees the other.
+void logger::wait_pending() {
+  uint32_t e = events.load(boost::memory_order_acquire);
+  reader_waiting.store(1, boost::memory_order_relaxed);
+  boost::atomic_thread_fence(boost::memory_order_seq_cst);
+  if(!has_pending())
+    syscall(SYS_futex, &events, FUTEX_WAIT_PRIVATE, e, NULL, NULL, 0);
+  reader_waiting.store(0, boost::memory_order_relaxed);
+}
+
+void logger::wake_reader() {
+  events.fetch_add(1, boost::memory_order_release);
+  syscall(SYS_futex, &events, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
 }
 
 void* logger::start(void *input) {
@@ -84,24 +423,313 @@ void* logger::start(void *input) {
 
 void logger::reader_loop() {
   while(not_done) {
-    boost::mutex::scoped_lock lock(mutex);
-    while(buffer.empty()) not_empty.wait(lock);
-    str_ptr s = buffer.front();
-    buffer.pop_front();
-    lock.unlock();
-    not_full.notify_one();
-    if(logfile)
-      fprintf(logfile, "%s", s.get()->c_str());
+    if(binary) {
+      // Write pending records before text messages to keep the order of
+      // each thread
+      bool busy = read_records();
+      busy |= read_messages();
+      if(!busy) {
+        write_buffer();
+        wait_pending();
+      }
+    } else {
+      boost::mutex::scoped_lock lock(mutex);
+      while(buffer.empty()) not_empty.wait(lock);
+      lock.unlock();
+      read_messages();
+      write_buffer();
+    }
   }
 }
 
-void logger::flush() {
+// Takes all queued messages and copies them to the write buffer.
+// Returns true if any message was written.
+bool logger::read_messages() {
+  boost::mutex::scoped_lock lock(mutex);
+  if(rotation_changed) {
+    max_file_bytes   = new_max_file_bytes;
+    nof_files        = new_nof_files;
+    rotation_changed = false;
+  }
+  if(buffer.empty() && dropped_msgs == dropped_msgs_reported)
+    return false;
+  if(batch.capacity() < buffer.capacity())
+    batch.set_capacity(buffer.capacity());
+  buffer.swap(batch);
+  uint32_t dropped = dropped_msgs - dropped_msgs_reported;
+  dropped_msgs_reported = dropped_msgs;
+  lock.unlock();
+
+  // The report goes first, as the last message may not end its line
+  if(dropped) {
+    char tmp[64];
+    int n = snprintf(tmp, sizeof(tmp), "Log queue full, %d messages dropped\n", dropped);
+    append(tmp, n);
+  }
+  uint32_t len = 0;
   boost::circular_buffer<str_ptr>::iterator it;
-  for(it=buffer.begin();it!=buffer.end();it++)
+  for(it=batch.begin();it!=batch.end();it++) {
+    append((*it)->c_str(), (*it)->size());
+    len += msg_bytes(*it);
+  }
+  batch.clear();
+
+  lock.lock();
+  queue_bytes -= len;
+  return true;
+}
+
+// Writes up to LOG_MAX_BATCH records, oldest first across all rings.
+// Returns true if any record was written.
+bool logger::read_records() {
+  std::vector<ring*> r;
   {
-    if(logfile)
-      fprintf(logfile, "%s", it->get()->c_str());
+    boost::mutex::scoped_lock lock(rings_mutex);
+    r = rings;
+  }
+  uint32_t n = 0;
+  for(;n<LOG_MAX_BATCH;n++) {
+    ring     *oldest = NULL;
+    record_t *rec    = NULL;
+    for(uint32_t i=0;i<r.size();i++) {
+      record_t *f = r[i]->front();
+      if(f && (!rec || f->time.tv_sec < rec->time.tv_sec ||
+              (f->time.tv_sec == rec->time.tv_sec && f->time.tv_nsec < rec->time.tv_nsec))) {
+        oldest = r[i];
+        rec    = f;
+      }
+    }
+    if(!oldest)
+      break;
+    write_record(rec);
+    oldest->pop();
+  }
+  bool released = false;
+  for(uint32_t i=0;i<r.size();i++) {
+    uint32_t dropped = r[i]->dropped.exchange(0);
+    if(dropped) {
+      char tmp[64];
+      int len = snprintf(tmp, sizeof(tmp), "Log ring full, %d messages dropped\n", dropped);
+      append(tmp, len);
+      dropped_records += dropped;
+    }
+    released |= r[i]->released.load(boost::memory_order_acquire);
+  }
+  if(released) {
+    // released is read first, so the last records of the thread are seen
+    boost::mutex::scoped_lock lock(rings_mutex);
+    for(uint32_t i=0;i<rings.size();) {
+      if(rings[i]->released.load(boost::memory_order_acquire) && rings[i]->empty() &&
+         rings[i]->dropped.load() == 0) {
+        delete rings[i];
+        rings.erase(rings.begin()+i);
+      } else {
+        i++;
+      }
+    }
+  }
+  return n > 0;
+}
+
+void logger::write_record(record_t *rec) {
+  if(fd < 0)
+    return;
+
+  record_arg_t *argv = (record_arg_t*) ((uint8_t*) rec + sizeof(record_t));
+  char         *strs = (char*) &argv[rec->nof_args];
+  uint8_t      *hex  = (uint8_t*) strs;
+  for(uint32_t i=0;i<rec->nof_args;i++)
+    hex += argv[i].len;
+
+  // Same layout as log_filter text messages
+  struct tm t;
+  char      tmp[LOG_MAX_STR_LEN*2];
+  localtime_r(&rec->time.tv_sec, &t);
+  std::string s;
+  s.reserve(256);
+  snprintf(tmp, sizeof(tmp), "%02d:%02d:%02d.%03d [%s] %s ", t.tm_hour, t.tm_min, t.tm_sec,
+           (int) (rec->time.tv_nsec/1000000), rec->layer, log_level_text[rec->level]);
+  s += tmp;
+  if(rec->do_tti) {
+    snprintf(tmp, sizeof(tmp), "[%05d] ", rec->tti);
+    s += tmp;
   }
+
+  const char  *p = rec->fmt;
+  const char  *start;
+  const char  *end;
+  arg_type_t   types[3];
+  uint32_t     nof_types;
+  uint32_t     k = 0;
+  while((start = next_conversion(p, &end, types, &nof_types)) != NULL) {
+    s.append(p, start-p);
+    char spec[32];
+    if(end-start >= (int) sizeof(spec) || k+nof_types > rec->nof_args) {
+      s.append(start, end-start);
+      p = end;
+      continue;
+    }
+    memcpy(spec, start, end-start);
+    spec[end-start] = '\0';
+    if(nof_types == 0) {
+      s += "%";
+      p = end;
+      continue;
+    }
+    int stars[2];
+    for(uint32_t i=0;i+1<nof_types;i++)
+      stars[i] = argv[k++].v.i;
+    record_arg_t *a = &argv[k++];
+    char str[LOG_MAX_STR_LEN+sizeof(LOG_TRUNC_MARK)];
+    switch(a->type) {
+      case ARG_INT:    format_arg(tmp, sizeof(tmp), spec, nof_types-1, stars, a->v.i);  break;
+      case ARG_LONG:   format_arg(tmp, sizeof(tmp), spec, nof_types-1, stars, a->v.l);  break;
+      case ARG_LLONG:  format_arg(tmp, sizeof(tmp), spec, nof_types-1, stars, a->v.ll); break;
+      case ARG_DOUBLE: format_arg(tmp, sizeof(tmp), spec, nof_types-1, stars, a->v.d);  break;
+      case ARG_PTR:    format_arg(tmp, sizeof(tmp), spec, nof_types-1, stars, a->v.p);  break;
+      case ARG_STR:
+        memcpy(str, strs, a->len);
+        str[a->len] = '\0';
+        if(a->truncated)
+          strcat(str, LOG_TRUNC_MARK);
+        strs += a->len;
+        format_arg(tmp, sizeof(tmp), spec, nof_types-1, stars, str);
+        break;
+      default:
+        tmp[0] = '\0';
+        break;
+    }
+    s += tmp;
+    p = end;
+  }
+  s += p;
+
+  if(rec->hex_len > 0) {
+    s += "\n";
+    for(uint32_t c=0;c<rec->hex_len;c+=16) {
+      snprintf(tmp, sizeof(tmp), "             %04x: ", c);
+      s += tmp;
+      for(uint32_t i=c;i<rec->hex_len && i<c+16;i++) {
+        snprintf(tmp, sizeof(tmp), "%02x ", hex[i]);
+        s += tmp;
+      }
+      s += "\n";
+    }
+  }
+  append(s.c_str(), s.size());
+}
+
+// Messages are never split across writes, so rotation happens on a
+// message boundary.
+void logger::append(const char *s, uint32_t len) {
+  if(!wbuf) {
+    write_file(s, len);
+    return;
+  }
+  if(wbuf_len + len > LOG_WRITE_SIZE)
+    write_buffer();
+  if(len > LOG_WRITE_SIZE) {
+    write_file(s, len);
+    return;
+  }
+  memcpy(&wbuf[wbuf_len], s, len);
+  wbuf_len += len;
+}
+
+void logger::write_buffer() {
+  if(wbuf_len > 0) {
+    write_file(wbuf, wbuf_len);
+    wbuf_len = 0;
+  }
+}
+
+void logger::write_file(const char *s, uint32_t len) {
+  if(max_file_bytes && file_bytes > 0 && file_bytes + len > max_file_bytes)
+    rotate();
+  if(fd < 0)
+    return;
+  uint32_t n = 0;
+  while(n < len) {
+    ssize_t w = write(fd, &s[n], len-n);
+    if(w < 0) {
+      if(errno == EINTR)
+        continue;
+      break;
+    }
+    n += w;
+  }
+  file_bytes    += n;
+  bytes_written += n;
+}
+
+// Shifts file.N-1 to file.N, ..., file to file.1 and starts a new file
+void logger::rotate() {
+  if(fd >= 0)
+    close(fd);
+  char from[256];
+  char to[256];
+  for(uint32_t i=nof_files;i>0;i--) {
+    if(i > 1)
+      snprintf(from, sizeof(from), "%s.%d", filename.c_str(), i-1);
+    else
+      snprintf(from, sizeof(from), "%s", filename.c_str());
+    snprintf(to, sizeof(to), "%s.%d", filename.c_str(), i);
+    rename(from, to);
+  }
+  fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  file_bytes = 0;
+  nof_rotations++;
+}
+
+logger::ring::ring()
+  :dropped(0)
+  ,released(false)
+  ,buf(LOG_RING_SIZE)
+  ,head(0)
+  ,tail(0)
+  ,pad(0)
+{}
+
+uint8_t* logger::ring::reserve(uint32_t size) {
+  uint32_t t   = tail.load(boost::memory_order_relaxed);
+  uint32_t h   = head.load(boost::memory_order_acquire);
+  uint32_t off = t % LOG_RING_SIZE;
+  uint32_t contiguous = LOG_RING_SIZE - off;
+  pad = (size > contiguous) ? contiguous : 0;
+  if(t - h + pad + size > LOG_RING_SIZE)
+    return NULL;
+  if(pad) {
+    ((record_t*) &buf[off])->size = 0;
+    off = 0;
+  }
+  return &buf[off];
+}
+
+void logger::ring::commit(uint32_t size) {
+  tail.store(tail.load(boost::memory_order_relaxed) + pad + size, boost::memory_order_release);
+}
+
+logger::record_t* logger::ring::front() {
+  uint32_t h = head.load(boost::memory_order_relaxed);
+  if(h == tail.load(boost::memory_order_acquire))
+    return NULL;
+  record_t *rec = (record_t*) &buf[h % LOG_RING_SIZE];
+  if(rec->size == 0) {
+    // Padding is always followed by a record
+    h += LOG_RING_SIZE - h % LOG_RING_SIZE;
+    head.store(h, boost::memory_order_release);
+    rec = (record_t*) &buf[0];
+  }
+  return rec;
+}
+
+bool logger::ring::empty() {
+  return head.load(boost::memory_order_relaxed) == tail.load(boost::memory_order_acquire);
+}
+
+void logger::ring::pop() {
+  uint32_t h = head.load(boost::memory_order_relaxed);
+  head.store(h + ((record_t*) &buf[h % LOG_RING_SIZE])->size, boost::memory_order_release);
 }
 
 } // namespace srsue
@@ -25,19 +25,19 @@
  */
 
 
-#define Error(fmt, ...)   log_h->error_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Warning(fmt, ...) log_h->warning_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Info(fmt, ...)    log_h->info_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Debug(fmt, ...)   log_h->debug_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-
+#define Error(fmt, ...)   SRSLTE_LOG(log_h, MAC, ERROR, error_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...) SRSLTE_LOG(log_h, MAC, WARNING, warning_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)    SRSLTE_LOG(log_h, MAC, INFO, info_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)   SRSLTE_LOG(log_h, MAC, DEBUG, debug_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #include "common/pdu_queue.h"
 
 
 namespace srslte {
     
-pdu_queue::pdu_queue() : pdu_q(NOF_HARQ_PID)
+pdu_queue::pdu_queue()
 {
-  callback = NULL; 
+  callback  = NULL; 
+  initiated = false; 
 }
 
 void pdu_queue::init(process_callback *callback_, log* log_h_)
@@ -46,6 +46,8 @@ void pdu_queue::init(process_callback *callback_, log* log_h_)
   log_h     = log_h_; 
   for (int i=0;i<NOF_HARQ_PID;i++) {
     pdu_q[i].init(NOF_BUFFER_PDUS, MAX_PDU_LEN);
+    tti_wp[i] = 0; 
+    tti_rp[i] = 0; 
   }
   initiated = true; 
 }
@@ -60,9 +62,10 @@ uint8_t* pdu_queue::request_buffer(uint32_t pid, uint32_t len)
 
   if (pid < NOF_HARQ_PID) {
     if (len < MAX_PDU_LEN) {
-      if (pdu_q[pid].pending_msgs() > 0.75*pdu_q[pid].max_msgs()) {
+      uint32_t pending = pdu_q[pid].pending_msgs();
+      if (4*pending > 3*pdu_q[pid].max_msgs()) {
         log_h->console("Warning TX buffer HARQ PID=%d: Occupation is %.1f%% \n", 
-                      pid, (float) 100*pdu_q[pid].pending_msgs()/pdu_q[pid].max_msgs());
+                      pid, (float) 100*pending/pdu_q[pid].max_msgs());
       }
       buff = (uint8_t*) pdu_q[pid].request();
       if (!buff) {
@@ -84,7 +87,7 @@ uint8_t* pdu_queue::request_buffer(uint32_t pid, uint32_t len)
  * This function enqueues the packet and returns quicly because ACK 
  * deadline is important here. 
  */ 
-void pdu_queue::push_pdu(uint32_t pid, uint32_t nof_bytes)
+void pdu_queue::push_pdu(uint32_t pid, uint32_t nof_bytes, uint32_t tti)
 {
   if (!initiated) {
     return; 
@@ -92,8 +95,13 @@ void pdu_queue::push_pdu(uint32_t pid, uint32_t nof_bytes)
   
   if (pid < NOF_HARQ_PID) {    
     if (nof_bytes > 0) {
-      if (!pdu_q[pid].push(nof_bytes)) {
+      // Only the reader frees slots, so a queue that is not full stays so until the push
+      if (pdu_q[pid].isfull()) {
         Warning("Full queue %d when pushing MAC PDU %d bytes\n", pid, nof_bytes);
+      } else {
+        pdu_tti[pid][tti_wp[pid]] = tti; 
+        pdu_q[pid].push(nof_bytes);
+        tti_wp[pid] = (tti_wp[pid] + 1)%NOF_BUFFER_PDUS; 
       }
       //callback->process_pdu((uint8_t*) pdu_q[pid].request(), nof_bytes);
     } else {
@@ -119,9 +127,10 @@ bool pdu_queue::process_pdus()
       buff = (uint8_t*) pdu_q[i].pop(&len);
       if (buff) {
         if (callback) {
-          callback->process_pdu(buff, len);
+          callback->process_pdu(buff, len, pdu_tti[i][tti_rp[i]]);
         }
         pdu_q[i].release();
+        tti_rp[i] = (tti_rp[i] + 1)%NOF_BUFFER_PDUS; 
         cnt++;
         have_data = true;
       }
@@ -41,6 +41,8 @@ qbuff::qbuff()
   max_msg_size=0;
   wp = 0; 
   rp = 0; 
+  nof_pending.store(0);
+  pending_bytes.store(0);
   buffer = NULL;
   packets = NULL; 
 }
@@ -73,20 +75,21 @@ void qbuff::flush()
   wp = 0; 
   rp = 0; 
   for (int i=0;i<nof_messages;i++) {
-    packets[i].valid = false; 
     packets[i].ptr   = &buffer[i*max_msg_size];
     packets[i].len   = 0; 
   }  
+  pending_bytes.store(0);
+  nof_pending.store(0);
 }
 
 bool qbuff::isempty()
 {
-  return !packets[rp].valid;
+  return nof_pending.load(boost::memory_order_acquire) == 0;
 }
 
 bool qbuff::isfull()
 {
-  return packets[wp].valid; 
+  return nof_pending.load(boost::memory_order_acquire) == nof_messages; 
 }
 
 
@@ -101,9 +104,13 @@ void* qbuff::request()
 
 bool qbuff::push(uint32_t len)
 {
+  if (isfull()) {
+    return false; 
+  }
   packets[wp].len = len; 
-  packets[wp].valid = true; 
   wp += (wp+1 >= nof_messages)?(1-nof_messages):1; 
+  pending_bytes.fetch_add(len, boost::memory_order_relaxed);
+  nof_pending.fetch_add(1, boost::memory_order_release);
   return true; 
 }
 
@@ -129,13 +136,8 @@ void* qbuff::pop(uint32_t* len, uint32_t idx)
   if (idx == 0) {
     return pop(len);
   } else {
-    uint32_t rpp = rp; 
-    uint32_t i   = 0; 
-    while(i<idx && packets[rpp].valid) {
-      rpp += (rpp+1 >= nof_messages)?(1-nof_messages):1; 
-      i++;
-    }
-    if (packets[rpp].valid) {
+    if (idx < nof_pending.load(boost::memory_order_acquire)) {
+      uint32_t rpp = (rp + idx)%nof_messages; 
       if (len) {
         *len = packets[rpp].len;
       }
@@ -148,9 +150,12 @@ void* qbuff::pop(uint32_t* len, uint32_t idx)
 
 void qbuff::release()
 {
-  packets[rp].valid = false; 
-  packets[rp].len = 0; 
+  if (isempty()) {
+    return; 
+  }
+  pending_bytes.fetch_sub(packets[rp].len, boost::memory_order_relaxed);
   rp += (rp+1 >= nof_messages)?(1-nof_messages):1; 
+  nof_pending.fetch_sub(1, boost::memory_order_release);
 }
 
 bool qbuff::send(void* buffer, uint32_t msg_size)
@@ -171,20 +176,12 @@ bool qbuff::send(void* buffer, uint32_t msg_size)
 
 uint32_t qbuff::pending_data()
 {
-  uint32_t total_len = 0; 
-  for (int i=0;i<nof_messages;i++) {
-    total_len += packets[i].len;
-  }
-  return total_len; 
+  return pending_bytes.load(boost::memory_order_relaxed); 
 }
 
 uint32_t qbuff::pending_msgs()
 {
-  uint32_t nof_msg = 0; 
-  for (int i=0;i<nof_messages;i++) {
-    nof_msg += packets[i].valid?1:0;
-  }
-  return nof_msg;
+  return nof_pending.load(boost::memory_order_relaxed);
 }
 
 uint32_t qbuff::max_msgs()
@@ -27,6 +27,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <time.h>
 #include "common/thread_pool.h"
 
 #define DEBUG 0
@@ -34,19 +35,38 @@
 
 #define USE_QUEUE
 
+#define TRACE_WAKEUP_LEN 10000
+
 namespace srslte {
  
+static inline void cpu_relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#endif
+}
+
+static uint64_t now_us()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t) t.tv_sec*1000000 + t.tv_nsec/1000;
+}
   
-void thread_pool::worker::setup(uint32_t id, thread_pool *parent, uint32_t prio)
+void thread_pool::worker::setup(uint32_t id, thread_pool *parent, uint32_t prio, int cpu)
 {
   my_id = id; 
   my_parent = parent;   
-  start(prio);
+  running = true;   
+  if (cpu < 0) {
+    start(prio);
+  } else {
+    start_cpu(prio, cpu);
+  }
 }
 
 void thread_pool::worker::run_thread()
 {
-  running = true;   
   while(running)  {
     wait_to_start();
     if (running) {
@@ -64,21 +84,37 @@ uint32_t thread_pool::worker::get_id()
 void thread_pool::worker::stop()
 {
   running = false; 
-  pthread_cond_signal(&my_parent->cvar[my_id]);
+  if (my_parent->atomic_handoff) {
+    my_parent->wake(my_id);
+  } else {
+    pthread_cond_signal(&my_parent->cvar[my_id]);
+  }
   wait_thread_finish();
 }
 
 thread_pool::thread_pool(uint32_t max_workers_)  : 
                                   workers(max_workers_),
+                                  atomic_handoff(false),
+                                  spin_us(0),
+                                  queue_sleeping(0),
+                                  trace_enabled(false),
+                                  start_tti(max_workers_),
+                                  start_time(max_workers_),
+                                  tr_wakeup(max_workers_),
                                   status(max_workers_),
                                   cvar(max_workers_),
                                   mutex(max_workers_)
                                   
 {
   max_workers = max_workers_;
+  astatus         = new boost::atomic<uint32_t>[max_workers];
+  worker_sleeping = new boost::atomic<uint32_t>[max_workers];
   for (int i=0;i<max_workers;i++) {
     workers[i] = NULL;
     status[i] = IDLE; 
+    astatus[i] = IDLE;
+    worker_sleeping[i] = 0;
+    tr_wakeup[i] = NULL;
     pthread_mutex_init(&mutex[i], NULL);
     pthread_cond_init(&cvar[i], NULL);
   }
@@ -88,7 +124,25 @@ thread_pool::thread_pool(uint32_t max_workers_)  :
   nof_workers = 0; 
 }
 
-void thread_pool::init_worker(uint32_t id, worker *obj, uint32_t prio)
+thread_pool::~thread_pool()
+{
+  for (uint32_t i=0;i<max_workers;i++) {
+    if (tr_wakeup[i]) {
+      delete tr_wakeup[i];
+    }
+  }
+  delete [] astatus;
+  delete [] worker_sleeping;
+}
+
+/* Must be called before any worker is added */
+void thread_pool::set_atomic_handoff(uint32_t spin_us_)
+{
+  atomic_handoff = true;
+  spin_us        = spin_us_;
+}
+
+void thread_pool::init_worker(uint32_t id, worker *obj, uint32_t prio, int cpu)
 {
   if (id < max_workers) {
     if (id >= nof_workers) {
@@ -97,7 +151,7 @@ void thread_pool::init_worker(uint32_t id, worker *obj, uint32_t prio)
     pthread_mutex_lock(&mutex_queue);   
     workers[id] = obj; 
     available_workers.push(obj);    
-    obj->setup(id, this, prio);
+    obj->setup(id, this, prio, cpu);
     pthread_cond_signal(&cvar_queue);
     pthread_mutex_unlock(&mutex_queue);    
   }
@@ -107,6 +161,9 @@ void thread_pool::stop()
 {
   /* Stop any thread waiting for available worker */
   running = false; 
+  pthread_mutex_lock(&mutex_queue);
+  pthread_cond_broadcast(&cvar_queue);
+  pthread_mutex_unlock(&mutex_queue);
   
   /* Now stop all workers */
   for (uint32_t i=0;i<nof_workers;i++) {
@@ -131,6 +188,10 @@ void thread_pool::worker::release()
 
 void thread_pool::worker::wait_to_start()
 {
+  if (my_parent->atomic_handoff) {
+    my_parent->wait_to_start_atomic(my_id, &running);
+    return;
+  }
   
   debug_thread("wait_to_start() id=%d, status=%d, enter\n", my_id, my_parent->status[my_id]);
 
@@ -140,12 +201,19 @@ void thread_pool::worker::wait_to_start()
   }
   my_parent->status[my_id] = WORKING; 
   pthread_mutex_unlock(&my_parent->mutex[my_id]);
+  if (running) {
+    my_parent->trace_wakeup(my_id);
+  }
 
   debug_thread("wait_to_start() id=%d, status=%d, exit\n", my_id, my_parent->status[my_id]);
 }
 
 void thread_pool::worker::finished()
 {
+  if (my_parent->atomic_handoff) {
+    my_parent->finished_atomic(my_id);
+    return;
+  }
 #ifdef USE_QUEUE
   pthread_mutex_lock(&my_parent->mutex[my_id]); 
   my_parent->status[my_id] = IDLE; 
@@ -170,7 +238,7 @@ thread_pool::worker* thread_pool::wait_worker()
 
 bool thread_pool::find_finished_worker(uint32_t tti, uint32_t *id) {
   for(int i=0;i<nof_workers;i++) {
-    if (status[i] == IDLE) {
+    if ((atomic_handoff ? astatus[i].load() : status[i]) == IDLE) {
       *id = i; 
       return true; 
     }
@@ -181,6 +249,10 @@ bool thread_pool::find_finished_worker(uint32_t tti, uint32_t *id) {
 thread_pool::worker* thread_pool::wait_worker(uint32_t tti)
 {
   thread_pool::worker *x; 
+
+  if (atomic_handoff) {
+    return wait_worker_atomic(tti);
+  }
   
 #ifdef USE_QUEUE
   debug_thread("wait_worker() - enter - tti=%d, state0=%d, state1=%d\n", tti, status[0], status[1]);
@@ -192,6 +264,7 @@ thread_pool::worker* thread_pool::wait_worker(uint32_t tti)
   pthread_mutex_unlock(&mutex_queue);
   if (running) {
     x = workers[id];
+    start_tti[id] = tti;
     pthread_mutex_lock(&mutex[id]); 
     status[id] = WORKER_READY;
     pthread_mutex_unlock(&mutex[id]); 
@@ -208,6 +281,7 @@ thread_pool::worker* thread_pool::wait_worker(uint32_t tti)
   }
   if (running) {
     x = (worker*) workers[id];
+    start_tti[id] = tti;
     status[id] = WORKER_READY;
   } else {
     x = NULL; 
@@ -220,6 +294,16 @@ thread_pool::worker* thread_pool::wait_worker(uint32_t tti)
 
 void thread_pool::start_worker(uint32_t id) {
   if (id < nof_workers) {
+    if (trace_enabled) {
+      gettimeofday(&start_time[id], NULL);
+    }
+    if (atomic_handoff) {
+      astatus[id].store(START_WORK);
+      if (worker_sleeping[id].load()) {
+        wake(id);
+      }
+      return;
+    }
     pthread_mutex_lock(&mutex[id]); 
     status[id] = START_WORK;
     pthread_cond_signal(&cvar[id]);
@@ -252,6 +336,115 @@ uint32_t thread_pool::get_nof_workers()
   return nof_workers;
 }
 
+
+/********** Atomic hand-off ************/
+
+/* A waiter sets its sleeping flag and then checks the state, a signaller
+ * stores the state and then checks the flag. Both are sequentially
+ * consistent so at least one of them sees the other, and the signaller
+ * only takes the mutex if the waiter may be blocked.
+ */
+thread_pool::worker* thread_pool::wait_worker_atomic(uint32_t tti)
+{
+  uint32_t id = 0;
+  uint64_t deadline = now_us() + spin_us;
+  uint32_t n = 0;
+  while(!find_finished_worker(tti, &id) && running) {
+    if ((++n%64) == 0 && now_us() >= deadline) {
+      pthread_mutex_lock(&mutex_queue);
+      queue_sleeping.store(1);
+      while(!find_finished_worker(tti, &id) && running) {
+        pthread_cond_wait(&cvar_queue, &mutex_queue);
+      }
+      queue_sleeping.store(0);
+      pthread_mutex_unlock(&mutex_queue);
+      break;
+    }
+    cpu_relax();
+  }
+  if (!running) {
+    return NULL;
+  }
+  start_tti[id] = tti;
+  astatus[id].store(WORKER_READY);
+  debug_thread("wait_worker_atomic() - exit - id=%d\n", id);
+  return workers[id];
+}
+
+void thread_pool::wait_to_start_atomic(uint32_t id, boost::atomic<bool> *worker_running)
+{
+  uint64_t deadline = now_us() + spin_us;
+  uint32_t n = 0;
+  while(astatus[id].load() != START_WORK && *worker_running) {
+    if ((++n%64) == 0 && now_us() >= deadline) {
+      pthread_mutex_lock(&mutex[id]);
+      worker_sleeping[id].store(1);
+      while(astatus[id].load() != START_WORK && *worker_running) {
+        pthread_cond_wait(&cvar[id], &mutex[id]);
+      }
+      worker_sleeping[id].store(0);
+      pthread_mutex_unlock(&mutex[id]);
+      break;
+    }
+    cpu_relax();
+  }
+  astatus[id].store(WORKING);
+  if (*worker_running) {
+    trace_wakeup(id);
+  }
+}
+
+void thread_pool::finished_atomic(uint32_t id)
+{
+  astatus[id].store(IDLE);
+  if (queue_sleeping.load()) {
+    pthread_mutex_lock(&mutex_queue);
+    pthread_cond_signal(&cvar_queue);
+    pthread_mutex_unlock(&mutex_queue);
+  }
+}
+
+void thread_pool::wake(uint32_t id)
+{
+  pthread_mutex_lock(&mutex[id]);
+  pthread_cond_signal(&cvar[id]);
+  pthread_mutex_unlock(&mutex[id]);
+}
+
+
+/********** Wake-up latency trace ************/
+
+void thread_pool::start_trace()
+{
+  for (uint32_t i=0;i<max_workers;i++) {
+    if (!tr_wakeup[i]) {
+      tr_wakeup[i] = new srslte::trace<uint32_t>(TRACE_WAKEUP_LEN);
+    }
+  }
+  trace_enabled = true;
+}
+
+void thread_pool::write_trace(std::string filename)
+{
+  char name[256];
+  for (uint32_t i=0;i<nof_workers;i++) {
+    if (tr_wakeup[i]) {
+      snprintf(name, sizeof(name), "%s_%d.wakeup", filename.c_str(), i);
+      tr_wakeup[i]->writeToBinary(name);
+    }
+  }
+}
+
+void thread_pool::trace_wakeup(uint32_t id)
+{
+  if (trace_enabled) {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    uint32_t us = (t.tv_sec-start_time[id].tv_sec)*1000000 + t.tv_usec-start_time[id].tv_usec;
+    tr_wakeup[id]->push(start_tti[id], us);
+  }
+}
+
 }
 
 
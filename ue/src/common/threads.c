@@ -28,11 +28,156 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <sched.h>
 #include <sys/types.h>
 
 #include "common/threads.h"
 
+#define THREADS_MAX_CONFIG 32
+
+typedef struct {
+  char      name[16];
+  bool      has_cpus;
+  cpu_set_t cpus;
+  int       policy;   // -1 keeps the built-in policy
+  int       prio;     // -1 keeps the built-in priority
+} threads_config_t;
+
+static threads_config_t config[THREADS_MAX_CONFIG];
+static int              nof_config = 0;
+
+// Names of the threads whose settings have been printed
+static char             printed[THREADS_MAX_CONFIG][16];
+static int              nof_printed = 0;
+static pthread_mutex_t  printed_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static threads_config_t* find_config(const char *name) {
+  int i;
+  if (name) {
+    for (i=0;i<nof_config;i++) {
+      if (!strcmp(config[i].name, name)) {
+        return &config[i];
+      }
+    }
+  }
+  return NULL;
+}
+
+// Parses a list of CPUs such as "1,3-5"
+static bool parse_cpus(const char *str, cpu_set_t *cpus) {
+  const char *p = str;
+  char *end;
+  CPU_ZERO(cpus);
+  while (*p) {
+    long first = strtol(p, &end, 10);
+    long last  = first;
+    if (end == p || first < 0 || first >= CPU_SETSIZE) {
+      return false;
+    }
+    p = end;
+    if (*p == '-') {
+      p++;
+      last = strtol(p, &end, 10);
+      if (end == p || last < first || last >= CPU_SETSIZE) {
+        return false;
+      }
+      p = end;
+    }
+    for (;first<=last;first++) {
+      CPU_SET(first, cpus);
+    }
+    if (*p == ',') {
+      p++;
+    } else if (*p) {
+      return false;
+    }
+  }
+  return CPU_COUNT(cpus) > 0;
+}
+
+static const char* policy_text(int policy) {
+  switch(policy) {
+  case SCHED_OTHER: return "SCHED_OTHER";
+  case SCHED_FIFO:  return "SCHED_FIFO";
+  case SCHED_RR:    return "SCHED_RR";
+  case SCHED_BATCH: return "SCHED_BATCH";
+  case SCHED_IDLE:  return "SCHED_IDLE";
+  default:          return "Other";
+  }
+}
+
+bool threads_set_config(const char *name, const char *cpus, const char *policy, int prio) {
+  threads_config_t *c = find_config(name);
+  if (!c) {
+    if (nof_config == THREADS_MAX_CONFIG || strlen(name) >= sizeof(c->name)) {
+      fprintf(stderr, "Error configuring thread %s\n", name);
+      return false;
+    }
+    c = &config[nof_config++];
+    strcpy(c->name, name);
+  }
+  c->has_cpus = false;
+  c->policy   = -1;
+  c->prio     = prio;
+  if (cpus && strlen(cpus) > 0) {
+    if (!parse_cpus(cpus, &c->cpus)) {
+      fprintf(stderr, "Error in thread %s: invalid CPU list \"%s\"\n", name, cpus);
+      return false;
+    }
+    c->has_cpus = true;
+  }
+  if (policy && strlen(policy) > 0 && strcasecmp(policy, "default")) {
+    if (!strcasecmp(policy, "other")) {
+      c->policy = SCHED_OTHER;
+    } else if (!strcasecmp(policy, "fifo")) {
+      c->policy = SCHED_FIFO;
+    } else if (!strcasecmp(policy, "rr")) {
+      c->policy = SCHED_RR;
+    } else if (!strcasecmp(policy, "batch")) {
+      c->policy = SCHED_BATCH;
+    } else if (!strcasecmp(policy, "idle")) {
+      c->policy = SCHED_IDLE;
+    } else {
+      fprintf(stderr, "Error in thread %s: invalid policy \"%s\"\n", name, policy);
+      return false;
+    }
+  }
+  if (prio != -1) {
+    int p = c->policy != -1 ? c->policy : SCHED_FIFO;
+    if (prio < sched_get_priority_min(p) || prio > sched_get_priority_max(p)) {
+      fprintf(stderr, "Error in thread %s: priority %d out of range for %s\n", name, prio, policy_text(p));
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true the first time it is called for name
+static bool first_start(const char *name) {
+  bool first = true;
+  int i;
+  pthread_mutex_lock(&printed_mutex);
+  for (i=0;i<nof_printed && first;i++) {
+    if (!strncmp(printed[i], name, sizeof(printed[i])-1)) {
+      first = false;
+    }
+  }
+  if (first) {
+    if (nof_printed < THREADS_MAX_CONFIG) {
+      strncpy(printed[nof_printed], name, sizeof(printed[nof_printed])-1);
+      printed[nof_printed][sizeof(printed[nof_printed])-1] = '\0';
+      nof_printed++;
+    } else {
+      first = false;
+    }
+  }
+  pthread_mutex_unlock(&printed_mutex);
+  return first;
+}
+
 bool threads_new_rt(pthread_t *thread, void *(*start_routine) (void*), void *arg) {
   return threads_new_rt_prio(thread, start_routine, arg, -1);
 }
@@ -42,18 +187,69 @@ bool threads_new_rt_prio(pthread_t *thread, void *(*start_routine) (void*), void
 }
 
 bool threads_new_rt_cpu(pthread_t *thread, void *(*start_routine) (void*), void *arg, int cpu, int prio_offset) {
+  return threads_new_rt_named(thread, start_routine, arg, cpu, prio_offset, NULL);
+}
+
+bool threads_new_rt_named(pthread_t *thread, void *(*start_routine) (void*), void *arg, int cpu, int prio_offset, const char *name) {
   bool ret = false; 
   
   pthread_attr_t attr;
   struct sched_param param;
+  int policy = -1;
+  int prio   = 0;
+  cpu_set_t cpuset; 
+  bool has_cpus = false;
 
   if (prio_offset >= 0) {
-    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - prio_offset;  
+    policy = SCHED_FIFO;
+    prio   = sched_get_priority_max(SCHED_FIFO) - prio_offset;
+  }
+  if (cpu != -1) {
+    CPU_ZERO(&cpuset);
+    CPU_SET((size_t) cpu, &cpuset);
+    printf("Setting CPU affinity to cpu_id=%d\n", cpu);
+    has_cpus = true;
+  } 
+  
+  // Configured settings override the built-in ones
+  threads_config_t *c = find_config(name);
+  if (c) {
+    if (c->policy != -1) {
+      if (c->policy != policy) {
+        prio = sched_get_priority_min(c->policy);
+      }
+      policy = c->policy;
+    }
+    if (c->prio != -1) {
+      if (policy == -1) {
+        policy = SCHED_FIFO;
+      }
+      prio = c->prio;
+    }
+    if (c->has_cpus) {
+      memcpy(&cpuset, &c->cpus, sizeof(cpu_set_t));
+      has_cpus = true;
+    }
+  }
+  
+  // Thread attributes only support the RT policies and SCHED_OTHER
+  int post_policy = -1;
+  if (policy == SCHED_BATCH || policy == SCHED_IDLE) {
+    post_policy = policy;
+    policy      = -1;
+  }
+  
+  bool use_attr = policy != -1 || has_cpus;
+
+  if (use_attr) {
     pthread_attr_init(&attr);
+  }
+  if (policy != -1) {
+    param.sched_priority = prio;  
     if (pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED)) {
       perror("pthread_attr_setinheritsched");
     }
-    if (pthread_attr_setschedpolicy(&attr, SCHED_FIFO)) {
+    if (pthread_attr_setschedpolicy(&attr, policy)) {
       perror("pthread_attr_setschedpolicy");
     }
     if (pthread_attr_setschedparam(&attr, &param)) {
@@ -61,20 +257,18 @@ bool threads_new_rt_cpu(pthread_t *thread, void *(*start_routine) (void*), void
       fprintf(stderr, "Error not enough privileges to set Scheduling priority\n");
     }
   }
-  if (cpu != -1) {
-    cpu_set_t cpuset; 
-    CPU_ZERO(&cpuset);
-    CPU_SET((size_t) cpu, &cpuset);
-    printf("Setting CPU affinity to cpu_id=%d\n", cpu);
+  if (has_cpus) {
     if (pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset)) {
       perror("pthread_attr_setaffinity_np");
     }
   } 
-  int err = pthread_create(thread, prio_offset >= 0 ? &attr : NULL, start_routine, arg);
+  int err = pthread_create(thread, use_attr ? &attr : NULL, start_routine, arg);
   if (err) {
     if (EPERM == err) {
       perror("Warning: Failed to create thread with real-time priority. Creating it with normal priority");
-      err = pthread_create(thread, NULL, start_routine, arg);
+      // Keep the CPU affinity, if any
+      pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+      err = pthread_create(thread, &attr, start_routine, arg);
       if (err) {
 	perror("pthread_create");
       } else {
@@ -86,12 +280,52 @@ bool threads_new_rt_cpu(pthread_t *thread, void *(*start_routine) (void*), void
   } else {
     ret = true; 
   }
-  if (prio_offset >= 0) {
+  if (use_attr) {
     pthread_attr_destroy(&attr);
   }
+  if (ret && post_policy != -1) {
+    param.sched_priority = 0;
+    if (pthread_setschedparam(*thread, post_policy, &param)) {
+      fprintf(stderr, "Error setting scheduling policy %s\n", policy_text(post_policy));
+    }
+  }
+  if (ret && name) {
+    pthread_setname_np(*thread, name);
+    if (first_start(name)) {
+      threads_print(name, *thread);
+    }
+  }
   return ret; 
 }
 
+void threads_print(const char *name, pthread_t thread) {
+  cpu_set_t cpuset;
+  struct sched_param param;
+  int policy;
+  char cpus[256];
+  int n = 0;
+  int j, k;
+
+  if (pthread_getaffinity_np(thread, sizeof(cpu_set_t), &cpuset) ||
+      pthread_getschedparam(thread, &policy, &param)) {
+    printf("Thread %s: could not read scheduling settings\n", name);
+    return;
+  }
+  cpus[0] = '\0';
+  for (j=0;j<CPU_SETSIZE && n < (int) sizeof(cpus)-16;j++) {
+    if (CPU_ISSET(j, &cpuset)) {
+      for (k=j;k+1<CPU_SETSIZE && CPU_ISSET(k+1, &cpuset);k++);
+      if (k > j) {
+        n += sprintf(&cpus[n], "%s%d-%d", n?",":"", j, k);
+      } else {
+        n += sprintf(&cpus[n], "%s%d", n?",":"", j);
+      }
+      j = k;
+    }
+  }
+  printf("Thread %-10s policy=%s priority=%d cpus=%s\n", name, policy_text(policy), param.sched_priority, cpus);
+}
+
 void threads_print_self() {
   pthread_t thread;
   cpu_set_t cpuset;
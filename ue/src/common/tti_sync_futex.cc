@@ -0,0 +1,126 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#include <time.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "common/tti_sync_futex.h"
+
+
+namespace srslte {
+
+  static inline void cpu_relax()
+  {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+  }
+
+  static uint64_t now_us()
+  {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec*1000000 + t.tv_nsec/1000;
+  }
+
+  tti_sync_futex::tti_sync_futex(uint32_t modulus, uint32_t spin_us_): tti_sync(modulus)
+  {
+    prod    = producer_cntr;
+    waiters = 0;
+    spin_us = spin_us_;
+  }
+
+  void tti_sync_futex::set_spin_us(uint32_t spin_us_)
+  {
+    spin_us = spin_us_;
+  }
+
+  /* The consumer announces itself in waiters before the kernel checks the
+   * futex word, and the producer updates the word before reading waiters.
+   * Both are sequentially consistent, so either the consumer sees the new
+   * counter or the producer sees the waiter and wakes it up.
+   */
+  uint32_t tti_sync_futex::wait()
+  {
+    uint64_t deadline = 0;
+    uint32_t n        = 0;
+    while(prod.load() == consumer_cntr) {
+      if (spin_us) {
+        if (!deadline) {
+          deadline = now_us() + spin_us;
+        }
+        if ((++n%64) != 0 || now_us() < deadline) {
+          cpu_relax();
+          continue;
+        }
+      }
+      waiters.fetch_add(1);
+      syscall(SYS_futex, &prod, FUTEX_WAIT_PRIVATE, consumer_cntr, NULL, NULL, 0);
+      waiters.fetch_sub(1);
+    }
+    uint32_t x = consumer_cntr;
+    increase_consumer();
+    return x;
+  }
+
+  void tti_sync_futex::resync()
+  {
+    consumer_cntr = prod.load();
+  }
+
+  void tti_sync_futex::set_producer_cntr(uint32_t producer_cntr)
+  {
+    consumer_cntr = producer_cntr;
+    prod.store(producer_cntr);
+    wake();
+  }
+
+  void tti_sync_futex::increase()
+  {
+    // stop() may race with the clock, so update with a CAS
+    uint32_t p = prod.load(boost::memory_order_relaxed);
+    uint32_t next;
+    do {
+      next = (p + increment)%modulus;
+    } while(!prod.compare_exchange_weak(p, next));
+    wake();
+  }
+
+  uint32_t tti_sync_futex::get_producer_cntr()
+  {
+    return prod.load();
+  }
+
+  void tti_sync_futex::wake()
+  {
+    if (waiters.load()) {
+      syscall(SYS_futex, &prod, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+  }
+}
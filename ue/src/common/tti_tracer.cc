@@ -0,0 +1,184 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include "common/tti_tracer.h"
+
+namespace srslte {
+
+tti_tracer*              tti_tracer::instance = NULL;
+boost::mutex             tti_tracer::instance_mutex;
+boost::atomic<bool>      tti_tracer::enabled(false);
+boost::atomic<uint32_t>  tti_tracer::current_generation(0);
+boost::atomic<uint32_t>  tti_tracer::nof_writers(0);
+
+// Ring of the calling thread for the tracer with generation local_generation
+static __thread uint32_t  local_generation = 0;
+static __thread void     *local_ring       = NULL;
+
+tti_tracer* tti_tracer::get_instance(void)
+{
+  boost::lock_guard<boost::mutex> lock(instance_mutex);
+  if(NULL == instance)
+    instance = new tti_tracer();
+  return instance;
+}
+
+void tti_tracer::cleanup(void)
+{
+  tti_tracer *t;
+  {
+    boost::lock_guard<boost::mutex> lock(instance_mutex);
+    t        = instance;
+    instance = NULL;
+    enabled  = false;
+    // Rings cached by the threads belong to the previous generation from now on
+    current_generation++;
+  }
+  // Threads that read the old generation are still writing to its rings
+  while(nof_writers.load() > 0)
+    usleep(100);
+  delete t;
+}
+
+tti_tracer::tti_tracer()
+{
+  generation = ++current_generation;
+  start_ns   = now_ns();
+}
+
+tti_tracer::~tti_tracer()
+{
+  for(uint32_t i=0;i<rings.size();i++)
+    delete rings[i];
+}
+
+void tti_tracer::start()
+{
+  enabled = true;
+}
+
+void tti_tracer::stop()
+{
+  enabled = false;
+}
+
+void tti_tracer::record(const char *name, uint32_t tti, uint64_t start_ns, uint64_t end_ns)
+{
+  // Counted before the generation is read, so that cleanup() waits for this span
+  nof_writers++;
+  ring_t *r = (ring_t*) local_ring;
+  if(!r || local_generation != current_generation.load()) {
+    r = NULL;
+    boost::lock_guard<boost::mutex> lock(instance_mutex);
+    // Nothing is recorded, and no tracer created, after cleanup()
+    if(NULL != instance) {
+      r = instance->new_ring();
+      local_generation = instance->generation;
+      local_ring       = r;
+    }
+  }
+  if(r) {
+    uint32_t n = r->count.load(boost::memory_order_relaxed);
+    span_t  *s = &r->spans[n%TTI_TRACER_RING_SIZE];
+    s->name     = name;
+    s->tti      = tti;
+    s->start_ns = start_ns;
+    s->end_ns   = end_ns;
+    r->count.store(n+1, boost::memory_order_release);
+  }
+  nof_writers--;
+}
+
+tti_tracer::ring_t* tti_tracer::new_ring()
+{
+  ring_t *r = new ring_t;
+  r->tid = syscall(SYS_gettid);
+  if(pthread_getname_np(pthread_self(), r->thread_name, sizeof(r->thread_name)))
+    r->thread_name[0] = '\0';
+  r->spans.resize(TTI_TRACER_RING_SIZE);
+  r->count = 0;
+  boost::lock_guard<boost::mutex> lock(rings_mutex);
+  rings.push_back(r);
+  return r;
+}
+
+// Spans recorded while writing may be missing or, for the oldest ones
+// of a full ring, torn. Call stop() first for a consistent trace.
+bool tti_tracer::write_json(std::string filename)
+{
+  FILE *f = fopen(filename.c_str(), "w");
+  if(!f) {
+    perror("fopen");
+    return false;
+  }
+  int pid = getpid();
+  boost::lock_guard<boost::mutex> lock(rings_mutex);
+  fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"srsUE\"}}", pid);
+  for(uint32_t i=0;i<rings.size();i++) {
+    ring_t *r = rings[i];
+    fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            pid, r->tid, r->thread_name[0] ? r->thread_name : "unnamed");
+    uint32_t n     = r->count.load(boost::memory_order_acquire);
+    uint32_t first = n > TTI_TRACER_RING_SIZE ? n - TTI_TRACER_RING_SIZE : 0;
+    for(uint32_t k=first;k<n;k++) {
+      span_t *s = &r->spans[k%TTI_TRACER_RING_SIZE];
+      if(s->start_ns < start_ns || s->end_ns < s->start_ns)
+        continue;
+      fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"tti\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                 "\"pid\":%d,\"tid\":%d,\"args\":{\"tti\":%u}}",
+              s->name, (s->start_ns - start_ns)/1000.0, (s->end_ns - s->start_ns)/1000.0,
+              pid, r->tid, s->tti);
+    }
+  }
+  fprintf(f, "\n]}\n");
+  fclose(f);
+  return true;
+}
+
+void tti_tracer::get_durations(std::map<std::string, std::vector<uint64_t> > &durations)
+{
+  boost::lock_guard<boost::mutex> lock(rings_mutex);
+  for(uint32_t i=0;i<rings.size();i++) {
+    ring_t  *r     = rings[i];
+    uint32_t n     = r->count.load(boost::memory_order_acquire);
+    uint32_t first = n > TTI_TRACER_RING_SIZE ? n - TTI_TRACER_RING_SIZE : 0;
+    for(uint32_t k=first;k<n;k++) {
+      span_t *s = &r->spans[k%TTI_TRACER_RING_SIZE];
+      if(s->start_ns < start_ns || s->end_ns < s->start_ns)
+        continue;
+      durations[s->name].push_back(s->end_ns - s->start_ns);
+    }
+  }
+}
+
+} // namespace srsue
@@ -25,11 +25,10 @@
  */
 
 
-#define Error(fmt, ...)   log_h->error_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Warning(fmt, ...) log_h->warning_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Info(fmt, ...)    log_h->info_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Debug(fmt, ...)   log_h->debug_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-
+#define Error(fmt, ...)   SRSLTE_LOG(log_h, MAC, ERROR, error_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...) SRSLTE_LOG(log_h, MAC, WARNING, warning_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)    SRSLTE_LOG(log_h, MAC, INFO, info_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)   SRSLTE_LOG(log_h, MAC, DEBUG, debug_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #include "mac/mac.h"
 #include "mac/demux.h"
 
@@ -40,12 +39,13 @@ demux::demux() : mac_msg(20), pending_mac_msg(20)
 {
 }
 
-void demux::init(phy_interface_mac* phy_h_, rlc_interface_mac *rlc_, srslte::log* log_h_, srslte::timers* timers_db_)
+void demux::init(phy_interface_mac* phy_h_, rlc_interface_mac *rlc_, srslte::log* log_h_, srslte::timers* timers_db_, drx_proc *drx_procedure_)
 {
   phy_h     = phy_h_; 
   log_h     = log_h_; 
   rlc       = rlc_;  
   timers_db = timers_db_;
+  drx_procedure = drx_procedure_;
   pdus.init(this, log_h);
 }
 
@@ -80,7 +80,7 @@ uint8_t* demux::request_buffer(uint32_t pid, uint32_t len)
  * Warning: this function does some processing here assuming ACK deadline is not an 
  * issue here because Temp C-RNTI messages have small payloads
  */
-void demux::push_pdu_temp_crnti(uint32_t pid, uint8_t *buff, uint32_t nof_bytes) 
+void demux::push_pdu_temp_crnti(uint32_t pid, uint8_t *buff, uint32_t nof_bytes, uint32_t tti) 
 {
   if (pid < NOF_HARQ_PID) {
     if (nof_bytes > 0) {
@@ -101,7 +101,7 @@ void demux::push_pdu_temp_crnti(uint32_t pid, uint8_t *buff, uint32_t nof_bytes)
       
       Debug("Saved MAC PDU with Temporal C-RNTI in buffer\n");
       
-      pdus.push_pdu(pid, nof_bytes);
+      pdus.push_pdu(pid, nof_bytes, tti);
     } else {
       Warning("Trying to push PDU with payload size zero\n");
     }
@@ -114,10 +114,10 @@ void demux::push_pdu_temp_crnti(uint32_t pid, uint8_t *buff, uint32_t nof_bytes)
  * This function enqueues the packet and returns quicly because ACK 
  * deadline is important here. 
  */ 
-void demux::push_pdu(uint32_t pid, uint8_t *buff, uint32_t nof_bytes)
+void demux::push_pdu(uint32_t pid, uint8_t *buff, uint32_t nof_bytes, uint32_t tti)
 {
   if (pid < NOF_HARQ_PID) {    
-    return pdus.push_pdu(pid, nof_bytes);
+    return pdus.push_pdu(pid, nof_bytes, tti);
   } else if (pid == NOF_HARQ_PID) {
     /* Demultiplexing of MAC PDU associated with SI-RNTI. The PDU passes through 
     * the MAC in transparent mode. 
@@ -136,18 +136,18 @@ bool demux::process_pdus()
   return pdus.process_pdus();
 }
 
-void demux::process_pdu(uint8_t *mac_pdu, uint32_t nof_bytes)
+void demux::process_pdu(uint8_t *mac_pdu, uint32_t nof_bytes, uint32_t tti)
 {
   // Unpack DLSCH MAC PDU 
   mac_msg.init_rx(nof_bytes);
   mac_msg.parse_packet(mac_pdu);
 
-  process_sch_pdu(&mac_msg);
+  process_sch_pdu(&mac_msg, tti);
   //srslte_vec_fprint_byte(stdout, mac_pdu, nof_bytes);
   Debug("MAC PDU processed\n");
 }
 
-void demux::process_sch_pdu(srslte::sch_pdu *pdu_msg)
+void demux::process_sch_pdu(srslte::sch_pdu *pdu_msg, uint32_t tti)
 {  
   while(pdu_msg->next()) {
     if (pdu_msg->get()->is_sdu()) {
@@ -156,14 +156,14 @@ void demux::process_sch_pdu(srslte::sch_pdu *pdu_msg)
       rlc->write_pdu(pdu_msg->get()->get_sdu_lcid(), pdu_msg->get()->get_sdu_ptr(), pdu_msg->get()->get_payload_size());      
     } else {
       // Process MAC Control Element
-      if (!process_ce(pdu_msg->get())) {
+      if (!process_ce(pdu_msg->get(), tti)) {
         Warning("Received Subheader with invalid or unkonwn LCID\n");
       }
     }
   }      
 }
 
-bool demux::process_ce(srslte::sch_subh *subh) {
+bool demux::process_ce(srslte::sch_subh *subh, uint32_t tti) {
   switch(subh->ce_type()) {
     case srslte::sch_subh::CON_RES_ID:
       // Do nothing
@@ -176,6 +176,10 @@ bool demux::process_ce(srslte::sch_subh *subh) {
       timers_db->get(mac::TIME_ALIGNMENT)->reset();
       timers_db->get(mac::TIME_ALIGNMENT)->run();      
       break;
+    case srslte::sch_subh::DRX_CMD:
+      // The DRX Command applies from the subframe the PDU was received in
+      drx_procedure->drx_command(tti);
+      break;
     case srslte::sch_subh::PADDING:
       break;
     default:
@@ -24,11 +24,10 @@
  *
  */
 
-#define Error(fmt, ...)   log_h->error_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Warning(fmt, ...) log_h->warning_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Info(fmt, ...)    log_h->info_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Debug(fmt, ...)   log_h->debug_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-
+#define Error(fmt, ...)   SRSLTE_LOG(log_h, MAC, ERROR, error_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...) SRSLTE_LOG(log_h, MAC, WARNING, warning_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)    SRSLTE_LOG(log_h, MAC, INFO, info_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)   SRSLTE_LOG(log_h, MAC, DEBUG, debug_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #include "phy/phy.h"
 #include "mac/mac.h"
 #include "mac/dl_harq.h"
@@ -263,6 +262,7 @@ void dl_harq_entity::dl_harq_process::new_grant_dl(mac_interface_phy::mac_grant_
     action->decode_enabled = true;     
     action->rv = cur_grant.rv; 
     action->rnti = cur_grant.rnti; 
+    action->current_tx_nb = n_retx; 
     action->softbuffer = &softbuffer;     
     memcpy(&action->phy_grant, &cur_grant.phy_grant, sizeof(srslte_phy_grant_t));
     n_retx++; 
@@ -301,7 +301,7 @@ void dl_harq_entity::dl_harq_process::tb_decoded(bool ack_)
         harq_entity->pcap->write_dl_sirnti(payload_buffer_ptr, cur_grant.n_bytes, ack, cur_grant.tti);
       }
       Debug("Delivering PDU=%d bytes to Dissassemble and Demux unit (BCCH)\n", cur_grant.n_bytes);
-      harq_entity->demux_unit->push_pdu(pid, payload_buffer_ptr, cur_grant.n_bytes);
+      harq_entity->demux_unit->push_pdu(pid, payload_buffer_ptr, cur_grant.n_bytes, cur_grant.tti);
     } else {      
       if (harq_entity->pcap) {
         harq_entity->pcap->write_dl_crnti(payload_buffer_ptr, cur_grant.n_bytes, cur_grant.rnti, ack, cur_grant.tti);            
@@ -309,10 +309,10 @@ void dl_harq_entity::dl_harq_process::tb_decoded(bool ack_)
       if (ack) {
         if (cur_grant.rnti_type == SRSLTE_RNTI_TEMP) {
           Debug("Delivering PDU=%d bytes to Dissassemble and Demux unit (Temporal C-RNTI)\n", cur_grant.n_bytes);
-          harq_entity->demux_unit->push_pdu_temp_crnti(pid, payload_buffer_ptr, cur_grant.n_bytes);
+          harq_entity->demux_unit->push_pdu_temp_crnti(pid, payload_buffer_ptr, cur_grant.n_bytes, cur_grant.tti);
         } else {
           Debug("Delivering PDU=%d bytes to Dissassemble and Demux unit\n", cur_grant.n_bytes);
-          harq_entity->demux_unit->push_pdu(pid, payload_buffer_ptr, cur_grant.n_bytes);
+          harq_entity->demux_unit->push_pdu(pid, payload_buffer_ptr, cur_grant.n_bytes, cur_grant.tti);
 	  	  
 	  // Compute average number of retransmissions per packet 
 	  harq_entity->average_retx = SRSLTE_VEC_CMA((float) n_retx, harq_entity->average_retx, harq_entity->nof_pkts++); 
@@ -24,11 +24,10 @@
  *
  */
 
-#define Error(fmt, ...)   log_h->error_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Warning(fmt, ...) log_h->warning_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Info(fmt, ...)    log_h->info_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Debug(fmt, ...)   log_h->debug_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-
+#define Error(fmt, ...)   SRSLTE_LOG(log_h, MAC, ERROR, error_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...) SRSLTE_LOG(log_h, MAC, WARNING, warning_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)    SRSLTE_LOG(log_h, MAC, INFO, info_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)   SRSLTE_LOG(log_h, MAC, DEBUG, debug_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #include <string.h>
 #include <strings.h>
 #include <pthread.h>
@@ -47,6 +46,7 @@ mac::mac() : ttisync(10240),
 {
   started = false;  
   pcap    = NULL;   
+  offline = false; 
   signals_pregenerated = false; 
 }
   
@@ -67,15 +67,17 @@ bool mac::init(phy_interface_mac *phy, rlc_interface_mac *rlc, rrc_interface_mac
   bsr_procedure.init(       rlc_h, log_h,          &config, &timers_db);
   phr_procedure.init(phy_h,        log_h,          &config, &timers_db);
   mux_unit.init     (       rlc_h, log_h,                               &bsr_procedure, &phr_procedure);
-  demux_unit.init   (phy_h, rlc_h, log_h,                   &timers_db);
+  demux_unit.init   (phy_h, rlc_h, log_h,                   &timers_db, &drx_procedure);
   ra_procedure.init (phy_h, rrc,   log_h, &uernti, &config, &timers_db, &mux_unit, &demux_unit);
   sr_procedure.init (phy_h, rrc,   log_h,          &config);
   ul_harq.init      (              log_h, &uernti, &config, &timers_db, &mux_unit);
   dl_harq.init      (              log_h,          &config, &timers_db, &demux_unit);
+  drx_procedure.init(              log_h,          &config);
 
   reset();
   
   started = true; 
+  set_name("mac_main");
   start(MAC_MAIN_THREAD_PRIO);
   
   
@@ -99,6 +101,11 @@ void mac::start_pcap(srslte::mac_pcap* pcap_)
   ra_procedure.start_pcap(pcap);
 }
 
+void mac::set_offline(bool enable)
+{
+  offline = enable; 
+}
+
 // Implement Section 5.8
 void mac::reconfiguration()
 {
@@ -124,6 +131,7 @@ void mac::reset()
   sr_procedure.reset();
   bsr_procedure.reset();
   phr_procedure.reset();
+  drx_procedure.reset();
   
   dl_harq.reset();
   phy_h->pdcch_dl_search_reset();
@@ -172,11 +180,14 @@ void mac::run_thread() {
       sr_procedure.step(tti);
 
       // Check SR if we need to start RA 
-      if (sr_procedure.need_random_access()) {
+      if (sr_procedure.need_random_access() && !offline) {
         ra_procedure.start_mac_order();
       }
       ra_procedure.step(tti);
       
+      // Stay awake while waiting for an UL grant or the RA to complete
+      drx_procedure.step(tti, sr_procedure.is_pending() || ra_procedure.in_progress());
+      
       if (ra_procedure.is_successful() && !signals_pregenerated) {
 
         // Configure PHY to look for UL C-RNTI grants
@@ -261,6 +272,9 @@ void mac::tb_decoded(bool ack, srslte_rnti_type_t rnti_type, uint32_t harq_pid)
     }
   } else {
     dl_harq.tb_decoded(ack, rnti_type, harq_pid);
+    if (rnti_type == SRSLTE_RNTI_USER && !offline) {
+      drx_procedure.tb_decoded(harq_pid, ack);
+    }
     if (ack) {
       pdu_process_thread.notify();
       metrics.rx_brate += dl_harq.get_current_tbs(harq_pid);
@@ -289,15 +303,31 @@ void mac::new_grant_dl(mac_interface_phy::mac_grant_t grant, mac_interface_phy::
       Error("Received grant for PCH (%d bytes) exceeds buffer (%d bytes)\n", grant.n_bytes, pch_payload_buffer_sz);
       action->decode_enabled = false; 
     }
+  } else if (offline && grant.rnti_type == SRSLTE_RNTI_USER) {
+    // Offline grants are only decoded, they take no part in RA or DRX
+    dl_harq.new_grant_dl(grant, action);
   } else {
     // If PDCCH for C-RNTI and RA procedure in Contention Resolution, notify it
     if (grant.rnti_type == SRSLTE_RNTI_USER && ra_procedure.is_contention_resolution()) {
       ra_procedure.pdcch_to_crnti(false);      
     }
     dl_harq.new_grant_dl(grant, action);
+    if (grant.rnti_type == SRSLTE_RNTI_USER) {
+      drx_procedure.new_grant_dl(grant.tti, grant.pid, action->current_tx_nb == 0);
+    }
   }
 }
 
+bool mac::is_active_time(uint32_t tti)
+{
+  return drx_procedure.monitor_pdcch(tti);
+}
+
+void mac::pdcch_done(uint32_t tti)
+{
+  drx_procedure.pdcch_done(tti);
+}
+
 uint32_t mac::get_current_tti()
 {
   return phy_h->get_current_tti();
@@ -314,6 +344,9 @@ void mac::new_grant_ul(mac_interface_phy::mac_grant_t grant, mac_interface_phy::
     ra_procedure.pdcch_to_crnti(true);    
   }
   ul_harq.new_grant_ul(grant, action);
+  if (grant.rnti_type == SRSLTE_RNTI_USER) {
+    drx_procedure.new_grant_ul(grant.tti, action->tx_enabled && action->current_tx_nb == 0, action->expect_ack);
+  }
   metrics.tx_pkts++;
 }
 
@@ -321,6 +354,9 @@ void mac::new_grant_ul_ack(mac_interface_phy::mac_grant_t grant, bool ack, mac_i
 {
   int tbs = ul_harq.get_current_tbs(tti);
   ul_harq.new_grant_ul_ack(grant, ack, action);
+  if (grant.rnti_type == SRSLTE_RNTI_USER) {
+    drx_procedure.new_grant_ul(grant.tti, action->tx_enabled && action->current_tx_nb == 0, action->expect_ack);
+  }
   if (!ack) {
     metrics.tx_errors++;
   } else {
@@ -339,6 +375,7 @@ void mac::harq_recv(uint32_t tti, bool ack, mac_interface_phy::tb_action_ul_t* a
 {
   int tbs = ul_harq.get_current_tbs(tti);
   ul_harq.harq_recv(tti, ack, action);
+  drx_procedure.new_grant_ul(tti, false, action->tx_enabled && action->expect_ack);
   if (!ack) {
     metrics.tx_errors++;
     metrics.tx_pkts++;
@@ -397,12 +434,14 @@ void mac::set_config(mac_cfg_t* mac_cfg)
 {
   memcpy(&config, mac_cfg, sizeof(mac_cfg_t));
   setup_timers();
+  drx_procedure.reconfigure();
 }
 
 void mac::set_config_main(LIBLTE_RRC_MAC_MAIN_CONFIG_STRUCT* main_cfg)
 {
   memcpy(&config.main, main_cfg, sizeof(LIBLTE_RRC_MAC_MAIN_CONFIG_STRUCT));
   setup_timers();
+  drx_procedure.reconfigure();
 }
 
 void mac::set_config_rach(LIBLTE_RRC_RACH_CONFIG_COMMON_STRUCT* rach_cfg, uint32_t prach_config_index)
@@ -430,6 +469,11 @@ uint32_t mac::get_unique_id()
   return upper_timers_thread.get_unique_id();
 }
 
+void mac::release_id(uint32_t timer_id)
+{
+  upper_timers_thread.release_id(timer_id);
+}
+
 /* Front-end to upper-layer timers */
 srslte::timers::timer* mac::get(uint32_t timer_id)
 {
@@ -446,6 +490,10 @@ void mac::get_metrics(mac_metrics_t &m)
        dl_harq.get_average_retx());
   
   metrics.ul_buffer = (int) bsr_procedure.get_buffer_state();
+  metrics.drx_sleep = (int) drx_procedure.get_sleep_count();
+  if (drx_procedure.is_enabled()) {
+    Info("DRX: %d subframes without PDCCH monitoring\n", metrics.drx_sleep);
+  }
   m = metrics;  
   bzero(&metrics, sizeof(mac_metrics_t));  
 }
@@ -468,7 +516,7 @@ void mac::upper_timers::run_thread()
 }
 srslte::timers::timer* mac::upper_timers::get(uint32_t timer_id)
 {
-  return timers_db.get(timer_id%MAC_NOF_UPPER_TIMERS);
+  return timers_db.get(timer_id);
 }
 
 uint32_t mac::upper_timers::get_unique_id()
@@ -476,6 +524,11 @@ uint32_t mac::upper_timers::get_unique_id()
   return timers_db.get_unique_id();
 }
 
+void mac::upper_timers::release_id(uint32_t timer_id)
+{
+  timers_db.release_id(timer_id);
+}
+
 void mac::upper_timers::stop()
 {
   running=false;
@@ -507,6 +560,7 @@ mac::pdu_process::pdu_process(demux *demux_unit_)
   pthread_mutex_init(&mutex, NULL);
   pthread_cond_init(&cvar, NULL);
   have_data = false; 
+  set_name("mac_pdu");
   start(MAC_PDU_THREAD_PRIO);  
 }
 
@@ -24,13 +24,13 @@
  *
  */
 
-#define Error(fmt, ...)   log_h->error_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Warning(fmt, ...) log_h->warning_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Info(fmt, ...)    log_h->info_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Debug(fmt, ...)   log_h->debug_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-
+#define Error(fmt, ...)   SRSLTE_LOG(log_h, MAC, ERROR, error_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...) SRSLTE_LOG(log_h, MAC, WARNING, warning_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)    SRSLTE_LOG(log_h, MAC, INFO, info_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)   SRSLTE_LOG(log_h, MAC, DEBUG, debug_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #include "mac/mux.h"
 #include "mac/mac.h"
+#include "common/tti_tracer.h"
 
 
 namespace srsue {
@@ -140,6 +140,7 @@ void mux::pusch_retx(uint32_t tx_tti, uint32_t pid)
 // Multiplexing and logical channel priorization as defined in Section 5.4.3
 uint8_t* mux::pdu_get(uint8_t *payload, uint32_t pdu_sz, uint32_t tx_tti, uint32_t pid)
 {
+  srslte::tti_span trace("mux", tx_tti);
   
   pthread_mutex_lock(&mutex);
     
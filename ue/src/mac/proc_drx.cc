@@ -0,0 +1,288 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#define Error(fmt, ...)   SRSLTE_LOG(log_h, MAC, ERROR, error_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...) SRSLTE_LOG(log_h, MAC, WARNING, warning_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)    SRSLTE_LOG(log_h, MAC, INFO, info_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)   SRSLTE_LOG(log_h, MAC, DEBUG, debug_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#include "mac/proc_drx.h"
+
+
+namespace srsue {
+
+drx_proc::drx_proc() : enabled(false), last_new_pdcch(-1), last_drx_cmd(-1), force_active(false), sleep_count(0)
+{
+  log_h   = NULL;
+  mac_cfg = NULL;
+  for (uint32_t i=0;i<NOF_HARQ_PROC;i++) {
+    dl_grant_tti[i]  = -1;
+    dl_retx_start[i] = -1;
+    ul_retx_tti[i]   = -1;
+  }
+  for (uint32_t i=0;i<MAX_WORKER_LAG;i++) {
+    pending_tti[i] = -1;
+  }
+}
+
+void drx_proc::init(srslte::log* log_h_, mac_interface_rrc::mac_cfg_t *mac_cfg_)
+{
+  log_h   = log_h_;
+  mac_cfg = mac_cfg_;
+  reset();
+}
+
+void drx_proc::reset()
+{
+  last_new_pdcch = -1;
+  last_drx_cmd   = -1;
+  for (uint32_t i=0;i<NOF_HARQ_PROC;i++) {
+    dl_grant_tti[i]  = -1;
+    dl_retx_start[i] = -1;
+    ul_retx_tti[i]   = -1;
+  }
+  for (uint32_t i=0;i<MAX_WORKER_LAG;i++) {
+    pending_tti[i] = -1;
+  }
+  force_active = false;
+}
+
+void drx_proc::reconfigure()
+{
+  LIBLTE_RRC_DRX_CONFIG_STRUCT *cfg = &mac_cfg->main.drx_cnfg;
+
+  // Stay awake while the parameters change
+  enabled = false;
+  reset();
+  if (!cfg->setup_present) {
+    Info("DRX:   Disabled\n");
+    return;
+  }
+
+  int inactivity = liblte_rrc_drx_inactivity_timer_num[cfg->drx_inactivity_timer];
+  if (inactivity < 0) {
+    Error("DRX:   Invalid drx-InactivityTimer %d. DRX disabled\n", cfg->drx_inactivity_timer);
+    return;
+  }
+  on_duration_timer   = liblte_rrc_on_duration_timer_num[cfg->on_duration_timer];
+  inactivity_timer    = inactivity;
+  retx_timer          = liblte_rrc_drx_retransmission_timer_num[cfg->drx_retx_timer];
+  long_cycle          = liblte_rrc_long_drx_cycle_num[cfg->long_drx_cycle_start_offset_choice];
+  start_offset        = cfg->long_drx_cycle_start_offset%long_cycle;
+  short_cycle_enabled = cfg->short_drx_present;
+  short_cycle_len     = liblte_rrc_short_drx_cycle_num[cfg->short_drx_cycle];
+  short_cycle_timer   = short_cycle_enabled?cfg->short_drx_cycle_timer*short_cycle_len:0;
+
+  // Events must be forgotten before the TTI counter wraps around
+  uint32_t max_short_timer = 10240 - 4*MAX_WORKER_LAG - inactivity_timer - 1;
+  if (short_cycle_timer > max_short_timer) {
+    Warning("DRX:   drxShortCycleTimer of %d subframes limited to %d\n", short_cycle_timer, max_short_timer);
+    short_cycle_timer = max_short_timer;
+  }
+
+  Info("DRX:   onDuration=%d, inactivity=%d, retx=%d, longCycle=%d, offset=%d, shortCycle=%d, shortCycleTimer=%d\n",
+       on_duration_timer, inactivity_timer, retx_timer, long_cycle, start_offset,
+       short_cycle_enabled?short_cycle_len:0, short_cycle_timer);
+  enabled = true;
+}
+
+bool drx_proc::is_enabled()
+{
+  return enabled;
+}
+
+/* Subframes elapsed from ref to tti or -1 if there is no event or it is
+ * newer than tti, as happens when workers are behind the one that saw it */
+int32_t drx_proc::age(uint32_t tti, int32_t ref)
+{
+  if (ref < 0) {
+    return -1;
+  }
+  uint32_t elapsed = srslte_tti_interval(tti, ref);
+  return (elapsed < 10240 - MAX_WORKER_LAG) ? (int32_t) elapsed : -1;
+}
+
+void drx_proc::set_latest(boost::atomic<int32_t> *ref, uint32_t tti)
+{
+  int32_t cur = ref->load();
+  while (cur < 0 || age(tti, cur) > 0) {
+    if (ref->compare_exchange_weak(cur, tti)) {
+      break;
+    }
+  }
+}
+
+void drx_proc::expire(boost::atomic<int32_t> *ref, uint32_t tti, uint32_t duration)
+{
+  int32_t cur     = ref->load();
+  int32_t elapsed = age(tti, cur);
+  if (elapsed > (int32_t) (duration + MAX_WORKER_LAG)) {
+    ref->compare_exchange_strong(cur, -1);
+  }
+}
+
+void drx_proc::step(uint32_t tti, bool force_active_)
+{
+  force_active = force_active_;
+  if (!enabled) {
+    return;
+  }
+  expire(&last_new_pdcch, tti, inactivity_timer + 1 + short_cycle_timer);
+  expire(&last_drx_cmd,   tti, short_cycle_timer > long_cycle ? short_cycle_timer : long_cycle);
+  for (uint32_t i=0;i<NOF_HARQ_PROC;i++) {
+    expire(&dl_retx_start[i], tti, retx_timer);
+    expire(&ul_retx_tti[i],   tti, 1);
+  }
+  // A worker that never called pdcch_done() holds the TTIs after it only up to the maximum lag
+  for (uint32_t i=0;i<MAX_WORKER_LAG;i++) {
+    expire(&pending_tti[i], tti, MAX_WORKER_LAG);
+  }
+  if (!is_active_time(tti)) {
+    sleep_count++;
+  }
+}
+
+void drx_proc::new_grant_dl(uint32_t tti, uint32_t pid, bool is_new_tx)
+{
+  if (!enabled) {
+    return;
+  }
+  // A retransmission stops the drx-RetransmissionTimer of the process
+  dl_grant_tti[pid%NOF_HARQ_PROC]  = tti;
+  dl_retx_start[pid%NOF_HARQ_PROC] = -1;
+  if (is_new_tx) {
+    set_latest(&last_new_pdcch, tti);
+  }
+}
+
+void drx_proc::new_grant_ul(uint32_t tti, bool is_new_tx, bool expect_ack)
+{
+  if (!enabled) {
+    return;
+  }
+  // An adaptive retransmission may be granted when the PHICH is received
+  if (expect_ack) {
+    ul_retx_tti[tti%NOF_HARQ_PROC] = (tti + HARQ_RTT)%10240;
+  }
+  if (is_new_tx) {
+    set_latest(&last_new_pdcch, tti);
+  }
+}
+
+void drx_proc::tb_decoded(uint32_t pid, bool ack)
+{
+  if (!enabled) {
+    return;
+  }
+  int32_t grant_tti = dl_grant_tti[pid%NOF_HARQ_PROC];
+  if (ack || grant_tti < 0) {
+    dl_retx_start[pid%NOF_HARQ_PROC] = -1;
+  } else {
+    // drx-RetransmissionTimer starts when the HARQ RTT Timer expires
+    dl_retx_start[pid%NOF_HARQ_PROC] = (grant_tti + HARQ_RTT)%10240;
+  }
+}
+
+void drx_proc::drx_command(uint32_t tti)
+{
+  if (!enabled) {
+    Warning("DRX:   Received DRX Command but DRX is not configured\n");
+    return;
+  }
+  Info("DRX:   Received DRX Command at tti=%d\n", tti);
+  set_latest(&last_drx_cmd, tti);
+}
+
+bool drx_proc::is_active_time(uint32_t tti)
+{
+  if (!enabled || force_active) {
+    return true;
+  }
+
+  int32_t pdcch = age(tti, last_new_pdcch);
+  int32_t cmd   = age(tti, last_drx_cmd);
+
+  // A DRX Command stops the onDurationTimer and drx-InactivityTimer started before it
+  bool stopped_by_cmd = cmd >= 0 && (pdcch < 0 || cmd <= pdcch);
+
+  if (pdcch >= 0 && pdcch <= (int32_t) inactivity_timer && !stopped_by_cmd) {
+    return true;
+  }
+
+  for (uint32_t i=0;i<NOF_HARQ_PROC;i++) {
+    int32_t retx = age(tti, dl_retx_start[i]);
+    if (retx >= 0 && retx < (int32_t) retx_timer) {
+      return true;
+    }
+  }
+  if (age(tti, ul_retx_tti[tti%NOF_HARQ_PROC]) == 0) {
+    return true;
+  }
+
+  // drxShortCycleTimer starts with the DRX Command or when drx-InactivityTimer expires
+  uint32_t cycle = long_cycle;
+  if (short_cycle_enabled) {
+    int32_t short_start = stopped_by_cmd ? cmd : (pdcch >= 0 ? pdcch - (int32_t) inactivity_timer - 1 : -1);
+    if (short_start >= 0 && short_start < (int32_t) short_cycle_timer) {
+      cycle = short_cycle_len;
+    }
+  }
+  uint32_t pos = (tti + 10240 - start_offset%cycle)%cycle;
+  if (pos < on_duration_timer && !(cmd >= 0 && cmd <= (int32_t) pos)) {
+    return true;
+  }
+  return false;
+}
+
+bool drx_proc::monitor_pdcch(uint32_t tti)
+{
+  if (!enabled) {
+    return true;
+  }
+  bool active = is_active_time(tti);
+  for (uint32_t i=0;i<MAX_WORKER_LAG && !active;i++) {
+    int32_t elapsed = age(tti, pending_tti[i]);
+    if (elapsed > 0 && elapsed < (int32_t) MAX_WORKER_LAG) {
+      active = true;
+    }
+  }
+  if (active) {
+    pending_tti[tti%MAX_WORKER_LAG] = tti;
+  }
+  return active;
+}
+
+void drx_proc::pdcch_done(uint32_t tti)
+{
+  int32_t cur = tti;
+  pending_tti[tti%MAX_WORKER_LAG].compare_exchange_strong(cur, -1);
+}
+
+uint32_t drx_proc::get_sleep_count()
+{
+  return sleep_count.exchange(0);
+}
+
+}
@@ -39,6 +39,7 @@
 #include "version.h"
 #include "ue.h"
 #include "metrics_stdout.h"
+#include "common/threads.h"
 
 using namespace std;
 using namespace srsue;
@@ -49,6 +50,11 @@ namespace bpo = boost::program_options;
  ***********************************************************************/
 string config_file;
 
+// Threads that can be configured in the [expert.threads] section
+static const char *thread_names[] = {"phy_sync", "phy_worker", "phy_ul", "phy_dec", "mac_main", "mac_pdu", "mac_timers",
+                                     "gw", "rrc_sib", "logger", "metrics"};
+static const int   nof_thread_names = sizeof(thread_names)/sizeof(thread_names[0]);
+
 void parse_args(all_args_t *args, int argc, char* argv[]) {
 
     // Command line only options
@@ -70,6 +76,28 @@ void parse_args(all_args_t *args, int argc, char* argv[]) {
         ("rf.device_args",       bpo::value<string>(&args->rf.device_args)->default_value("auto"),    "Front-end device arguments")
         ("rf.time_adv_nsamples", bpo::value<string>(&args->rf.time_adv_nsamples)->default_value("auto"),    "Transmission time advance")
         ("rf.burst_preamble_us", bpo::value<string>(&args->rf.burst_preamble)->default_value("auto"), "Transmission time advance")
+        ("rf.record_file",       bpo::value<string>(&args->rf.record_file)->default_value(""),        "Record the RX and TX samples to this IQ capture file")
+        ("rf.replay_file",       bpo::value<string>(&args->rf.replay_file)->default_value(""),        "Replay this IQ capture file instead of using an RF device")
+        ("rf.replay_realtime",   bpo::value<bool>(&args->rf.replay_realtime)->default_value(true),    "Replay the IQ capture at its sampling rate instead of as fast as possible")
+        ("rf.shm_name",          bpo::value<string>(&args->rf.shm_name)->default_value(""),           "Connect to an eNB over this shared memory link instead of using an RF device")
+        ("rf.shm_srate",         bpo::value<float>(&args->rf.shm_srate)->default_value(5.76e6),       "Sampling rate of the shared memory link. Must be the one of the cell")
+        ("rf.shm_lockstep",      bpo::value<bool>(&args->rf.shm_lockstep)->default_value(false),      "Advance the shared memory link in lockstep with the eNB instead of in real time")
+
+        ("channel.enable",       bpo::value<bool>(&args->channel.enable)->default_value(false),       "Apply channel impairments to the received samples")
+        ("channel.seed",         bpo::value<uint32_t>(&args->channel.seed)->default_value(0),         "Seed of the channel impairments")
+        ("channel.awgn_enable",  bpo::value<bool>(&args->channel.awgn_enable)->default_value(false),  "Add white gaussian noise")
+        ("channel.snr_db",       bpo::value<float>(&args->channel.snr_db)->default_value(30),         "SNR of the added noise relative to the received power")
+        ("channel.cfo_hz",       bpo::value<float>(&args->channel.cfo_hz)->default_value(0),          "Carrier frequency offset")
+        ("channel.drift_ppm",    bpo::value<float>(&args->channel.drift_ppm)->default_value(0),       "Sampling clock error of the UE")
+        ("channel.fading_model", bpo::value<string>(&args->channel.fading_model)->default_value("none"), "Multipath fading model: none, epa, eva or etu")
+        ("channel.doppler_hz",   bpo::value<float>(&args->channel.doppler_hz)->default_value(5),      "Maximum Doppler frequency of the fading")
+        ("channel.drop_rate",    bpo::value<float>(&args->channel.drop_rate)->default_value(0),       "Average number of sample drops per second")
+        ("channel.drop_len_us",  bpo::value<float>(&args->channel.drop_len_us)->default_value(100),   "Length of each sample drop")
+
+        ("offline.enable",       bpo::value<bool>(&args->offline.enable)->default_value(false),       "Decode rf.replay_file as fast as possible without transmitting and exit at its end")
+        ("offline.rnti",         bpo::value<string>(&args->offline.rnti)->default_value("0"),         "C-RNTI whose PDSCH is decoded offline")
+        ("offline.nof_workers",  bpo::value<int>(&args->offline.nof_workers)->default_value(0),       "PHY workers decoding subframes in parallel, 0 for one per CPU")
+        ("offline.metrics_file", bpo::value<string>(&args->offline.metrics_file)->default_value(""),  "Per-TTI metrics CSV file of offline decoding")
 
         ("pcap.enable",       bpo::value<bool>(&args->pcap.enable)->default_value(false),           "Enable MAC packet captures for wireshark")
         ("pcap.filename",     bpo::value<string>(&args->pcap.filename)->default_value("ue.pcap"),   "MAC layer capture filename")
@@ -77,6 +105,7 @@ void parse_args(all_args_t *args, int argc, char* argv[]) {
         ("trace.enable",      bpo::value<bool>(&args->trace.enable)->default_value(false),                  "Enable PHY and radio timing traces")
         ("trace.phy_filename",bpo::value<string>(&args->trace.phy_filename)->default_value("ue.phy_trace"), "PHY timing traces filename")
         ("trace.radio_filename",bpo::value<string>(&args->trace.radio_filename)->default_value("ue.radio_trace"), "Radio timing traces filename")
+        ("trace.timeline_filename",bpo::value<string>(&args->trace.timeline_filename)->default_value("ue.timeline.json"), "Per-stage TTI timeline filename (Chrome trace format)")
 
         ("gui.enable",        bpo::value<bool>(&args->gui.enable)->default_value(false),                  "Enable GUI plots")
         
@@ -101,6 +130,11 @@ void parse_args(all_args_t *args, int argc, char* argv[]) {
         ("log.all_hex_limit", bpo::value<int>(&args->log.all_hex_limit)->default_value(32),  "ALL log hex dump limit")
 
         ("log.filename",      bpo::value<string>(&args->log.filename)->default_value("/tmp/ue.log"),"Log filename")
+        ("log.binary",        bpo::value<bool>(&args->log.binary)->default_value(false), "Defer log message formatting to the logger thread")
+        ("log.max_queue_mb",  bpo::value<int>(&args->log.max_queue_mb)->default_value(64), "Maximum memory used by queued log messages in MB")
+        ("log.drop_policy",   bpo::value<string>(&args->log.drop_policy)->default_value("newest"), "Messages to drop when the log queue is full (newest/oldest)")
+        ("log.max_file_mb",   bpo::value<int>(&args->log.max_file_mb)->default_value(0), "Rotate the log file at this size in MB (0 to disable)")
+        ("log.nof_files",     bpo::value<int>(&args->log.nof_files)->default_value(4), "Number of rotated log files to keep")
 
         ("usim.algo",         bpo::value<string>(&args->usim.algo),        "USIM authentication algorithm")
         ("usim.op",           bpo::value<string>(&args->usim.op),          "USIM operator variant")
@@ -120,6 +154,10 @@ void parse_args(all_args_t *args, int argc, char* argv[]) {
             bpo::value<bool>(&args->expert.pregenerate_signals)->default_value(false), 
             "Pregenerate uplink signals after attach. Improves CPU performance.")
 
+        ("expert.buffer_pool_max_mb",
+            bpo::value<int>(&args->expert.buffer_pool_max_mb)->default_value(64),
+            "Maximum memory used by the packet buffer pool in MB")
+
         
         ("expert.prach_gain", 
             bpo::value<float>(&args->expert.phy.prach_gain)->default_value(-1.0),  
@@ -145,6 +183,22 @@ void parse_args(all_args_t *args, int argc, char* argv[]) {
             bpo::value<int>(&args->expert.phy.pdsch_max_its)->default_value(4), 
             "Maximum number of turbo decoder iterations")
 
+        ("expert.pdsch_its_adaptive",         
+            bpo::value<bool>(&args->expert.phy.pdsch_its_adaptive)->default_value(false), 
+            "Adapt the turbo decoder iterations of each TB to SNR, HARQ transmission and time budget")
+
+        ("expert.pdsch_min_its",         
+            bpo::value<int>(&args->expert.phy.pdsch_min_its)->default_value(2), 
+            "Minimum number of turbo decoder iterations with pdsch_its_adaptive")
+
+        ("expert.pdsch_boost_its",         
+            bpo::value<int>(&args->expert.phy.pdsch_boost_its)->default_value(8), 
+            "Turbo decoder iterations on the last HARQ transmission with pdsch_its_adaptive")
+
+        ("expert.pdsch_last_tx",         
+            bpo::value<int>(&args->expert.phy.pdsch_last_tx)->default_value(4), 
+            "DL HARQ transmission treated as the last chance with pdsch_its_adaptive")
+
         ("expert.attach_enable_64qam",      
             bpo::value<bool>(&args->expert.phy.attach_enable_64qam)->default_value(false), 
             "PUSCH 64QAM modulation before attachment")
@@ -180,6 +234,34 @@ void parse_args(all_args_t *args, int argc, char* argv[]) {
         ("expert.estimator_fil_w",    
             bpo::value<float>(&args->expert.phy.estimator_fil_w)->default_value(0.1), 
             "Chooses the coefficients for the 3-tap channel estimator centered filter.")
+
+        ("expert.atomic_handoff",    
+            bpo::value<bool>(&args->expert.phy.atomic_handoff)->default_value(false), 
+            "Hand subframes to PHY workers with atomic states and spin-then-block waiting.")
+
+        ("expert.handoff_spin_us",    
+            bpo::value<int>(&args->expert.phy.handoff_spin_us)->default_value(50), 
+            "Time to spin before blocking with atomic_handoff (us).")
+
+        ("expert.worker_cpus",    
+            bpo::value<string>(&args->expert.phy.worker_cpus)->default_value(""), 
+            "Comma-separated list of CPUs to pin PHY workers to.")
+
+        ("expert.sync_cpu",    
+            bpo::value<int>(&args->expert.phy.sync_cpu)->default_value(-1), 
+            "CPU to pin the PHY sync thread to (-1 to disable).")
+
+        ("expert.pipelined",    
+            bpo::value<bool>(&args->expert.phy.pipelined)->default_value(false), 
+            "Run the UL stage of each PHY worker on a separate thread.")
+
+        ("expert.pipeline_ack_deadline_us",    
+            bpo::value<int>(&args->expert.phy.pipeline_ack_deadline_us)->default_value(2000), 
+            "Time from the start of a subframe after which a PDSCH still being decoded is NACKed (us).")
+
+        ("expert.pdsch_dec_helpers",    
+            bpo::value<int>(&args->expert.phy.pdsch_dec_helpers)->default_value(0), 
+            "Number of helper threads per PHY worker that decode PDSCH code blocks in parallel.")
         
         
         ("rf_calibration.tx_corr_dc_gain",  bpo::value<float>(&args->rf_cal.tx_corr_dc_gain)->default_value(0.0),  "TX DC offset gain correction")
@@ -188,6 +270,16 @@ void parse_args(all_args_t *args, int argc, char* argv[]) {
         ("rf_calibration.tx_corr_iq_q",     bpo::value<float>(&args->rf_cal.tx_corr_iq_q)->default_value(0.0),     "TX IQ imbalance quadrature correction")
         
     ;
+
+    for (int i=0;i<nof_thread_names;i++) {
+      thread_args_t *t    = &args->expert.threads[thread_names[i]];
+      string         name = string("expert.threads.") + thread_names[i];
+      common.add_options()
+        ((name + "_cpus").c_str(),   bpo::value<string>(&t->cpus)->default_value(""),   "CPU list, e.g. 2,4-5")
+        ((name + "_policy").c_str(), bpo::value<string>(&t->policy)->default_value(""), "Scheduling policy (other, fifo, rr, batch, idle)")
+        ((name + "_prio").c_str(),   bpo::value<int>(&t->prio)->default_value(-1),      "Scheduling priority")
+      ;
+    }
     
     // Positional options - config file location
     bpo::options_description position("Positional options");
@@ -327,11 +419,20 @@ int main(int argc, char *argv[])
   signal(SIGINT, sig_int_handler);
   all_args_t     args;
   metrics_stdout metrics;
-  ue            *ue = ue::get_instance();
 
   cout << "---  Software Radio Systems LTE UE  ---" << endl << endl;
 
   parse_args(&args, argc, argv);
+
+  // Some threads start when the UE is created, so configure them first
+  std::map<std::string, thread_args_t>::iterator it;
+  for (it=args.expert.threads.begin();it!=args.expert.threads.end();it++) {
+    if (!threads_set_config(it->first.c_str(), it->second.cpus.c_str(), it->second.policy.c_str(), it->second.prio)) {
+      exit(1);
+    }
+  }
+
+  ue *ue = ue::get_instance();
   if(!ue->init(&args)) {
     exit(1);
   }
@@ -343,6 +444,9 @@ int main(int argc, char *argv[])
   bool plot_started         = false; 
   bool signals_pregenerated = false; 
   while(running) {
+    if (args.offline.enable && ue->is_finished()) {
+      break;
+    }
     if (ue->is_attached()) {
       if (!signals_pregenerated && args.expert.pregenerate_signals) {
         ue->pregenerate_signals(true);
@@ -26,6 +26,7 @@
  */
 
 #include "metrics_stdout.h"
+#include "common/threads.h"
 
 #include <unistd.h>
 #include <sstream>
@@ -58,7 +59,7 @@ bool metrics_stdout::init(ue_metrics_interface *u, float report_period_secs)
   metrics_report_period = report_period_secs;
 
   started = true;
-  pthread_create(&metrics_thread, NULL, &metrics_thread_start, this);
+  threads_new_rt_named(&metrics_thread, &metrics_thread_start, this, -1, -1, "metrics");
   return true;
 }
 
@@ -105,8 +106,8 @@ void metrics_stdout::print_metrics()
   {
     n_reports = 0;
     cout << endl;
-    cout << "--Signal--------------DL------------------------------UL----------------------" << endl;
-    cout << "  rsrp    pl    cfo   mcs   snr turbo  brate   bler   mcs   buff  brate   bler" << endl;
+    cout << "--Signal--------------DL-------------------------------------UL----------------------" << endl;
+    cout << "  rsrp    pl    cfo   mcs   snr turbo    dec  brate   bler   mcs   buff  brate   bler" << endl;
   }
   cout << float_to_string(metrics.phy.dl.rsrp, 2);
   cout << float_to_string(metrics.phy.dl.pathloss, 2);
@@ -114,6 +115,7 @@ void metrics_stdout::print_metrics()
   cout << float_to_string(metrics.phy.dl.mcs, 2);
   cout << float_to_string(metrics.phy.dl.sinr, 2);
   cout << float_to_string(metrics.phy.dl.turbo_iters, 2);
+  cout << float_to_eng_string(metrics.phy.dl.pdsch_dec_time.mean_us/1e6, 2);
   cout << float_to_eng_string((float) metrics.mac.rx_brate/metrics_report_period, 2);
   if (metrics.mac.rx_pkts > 0) {
     cout << float_to_string((float) 100*metrics.mac.rx_errors/metrics.mac.rx_pkts, 1) << "%";
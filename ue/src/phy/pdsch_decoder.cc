@@ -0,0 +1,467 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+
+#include "phy/pdsch_decoder.h"
+
+#define Error(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, ERROR, error_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...) if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, WARNING, warning_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, DEBUG, debug_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+
+namespace srsue {
+
+class pdsch_decoder::helper : public thread
+{
+public:
+  helper(pdsch_decoder *d, uint32_t idx) : dec(d), decoder_idx(idx), tb_id(d->tb_id) {
+    set_name("phy_dec");
+  }
+protected:
+  void run_thread() {
+    while (true) {
+      pthread_mutex_lock(&dec->mutex);
+      while (dec->running && dec->tb_id == tb_id) {
+        pthread_cond_wait(&dec->cvar, &dec->mutex);
+      }
+      bool run = dec->running;
+      tb_id    = dec->tb_id;
+      pthread_mutex_unlock(&dec->mutex);
+      if (!run) {
+        break;
+      }
+      dec->decode_cbs(decoder_idx);
+      pthread_mutex_lock(&dec->mutex);
+      dec->nof_helpers_done++;
+      pthread_cond_broadcast(&dec->cvar);
+      pthread_mutex_unlock(&dec->mutex);
+    }
+  }
+private:
+  pdsch_decoder *dec;
+  uint32_t       decoder_idx;
+  uint32_t       tb_id;
+};
+
+pdsch_decoder::pdsch_decoder() : next_cb(0), nof_iterations(0), cancel(false)
+{
+  log_h          = NULL;
+  cell_initiated = false;
+  max_re         = 0;
+  rnti           = 0;
+  rnti_is_set    = false;
+  max_noi        = 4;
+  nof_helpers    = 0;
+  running        = false;
+  avg_noi        = 0;
+  tb_id          = 0;
+  symbols        = NULL;
+  d              = NULL;
+  e              = NULL;
+  cb_segm        = NULL;
+  softbuffer     = NULL;
+  data           = NULL;
+  rv             = 0;
+  nof_helpers_done = 0;
+  bzero(&cell, sizeof(srslte_cell_t));
+  bzero(seq, sizeof(seq));
+  bzero(ce_re, sizeof(ce_re));
+  bzero(x, sizeof(x));
+  bzero(helpers, sizeof(helpers));
+  bzero(decoders, sizeof(decoders));
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cvar, NULL);
+}
+
+pdsch_decoder::~pdsch_decoder()
+{
+  stop_helpers();
+  free_cell();
+  pthread_cond_destroy(&cvar);
+  pthread_mutex_destroy(&mutex);
+}
+
+void pdsch_decoder::init(srslte::log *log_h_)
+{
+  log_h = log_h_;
+}
+
+bool pdsch_decoder::init_cell(srslte_cell_t cell_)
+{
+  cell   = cell_;
+  max_re = cell.nof_prb * 2 * SRSLTE_CP_NSYMB(cell.cp) * SRSLTE_NRE;
+
+  symbols = (cf_t*) srslte_vec_malloc(sizeof(cf_t) * max_re);
+  d       = (cf_t*) srslte_vec_malloc(sizeof(cf_t) * max_re);
+  e       = (int16_t*) srslte_vec_malloc(sizeof(int16_t) * max_re * srslte_mod_bits_x_symbol(SRSLTE_MOD_64QAM));
+  if (!symbols || !d || !e) {
+    Error("Allocating memory\n");
+    return false;
+  }
+  for (uint32_t i=0;i<cell.nof_ports;i++) {
+    ce_re[i] = (cf_t*) srslte_vec_malloc(sizeof(cf_t) * max_re);
+    x[i]     = (cf_t*) srslte_vec_malloc(sizeof(cf_t) * max_re);
+    if (!ce_re[i] || !x[i]) {
+      Error("Allocating memory\n");
+      return false;
+    }
+  }
+  if (srslte_crc_init(&crc_tb, SRSLTE_LTE_CRC24A, 24)) {
+    Error("Initiating TB CRC\n");
+    return false;
+  }
+  rnti_is_set    = false;
+  cell_initiated = true;
+  return true;
+}
+
+void pdsch_decoder::free_cell()
+{
+  if (symbols) {
+    free(symbols);
+  }
+  if (d) {
+    free(d);
+  }
+  if (e) {
+    free(e);
+  }
+  for (uint32_t i=0;i<SRSLTE_MAX_PORTS;i++) {
+    if (ce_re[i]) {
+      free(ce_re[i]);
+    }
+    if (x[i]) {
+      free(x[i]);
+    }
+    ce_re[i] = NULL;
+    x[i]     = NULL;
+  }
+  symbols = NULL;
+  d       = NULL;
+  e       = NULL;
+  if (rnti_is_set) {
+    for (uint32_t i=0;i<SRSLTE_NSUBFRAMES_X_FRAME;i++) {
+      srslte_sequence_free(&seq[i]);
+    }
+  }
+  rnti_is_set    = false;
+  cell_initiated = false;
+}
+
+bool pdsch_decoder::start_helpers(uint32_t nof_helpers_, int prio, int cpu)
+{
+  if (nof_helpers_ > MAX_HELPERS) {
+    nof_helpers_ = MAX_HELPERS;
+  }
+  running = true;
+  for (uint32_t i=0;i<=nof_helpers_;i++) {
+    if (srslte_tdec_init(&decoders[i].tdec, SRSLTE_TCOD_MAX_LEN_CB) ||
+        srslte_crc_init(&decoders[i].crc_cb, SRSLTE_LTE_CRC24B, 24))
+    {
+      Error("Initiating turbo decoder\n");
+      stop_helpers();
+      return false;
+    }
+    decoders[i].cb_in = (uint8_t*) srslte_vec_malloc(SRSLTE_TCOD_MAX_LEN_CB/8 + 1);
+    if (!decoders[i].cb_in) {
+      Error("Allocating memory\n");
+      srslte_tdec_free(&decoders[i].tdec);
+      stop_helpers();
+      return false;
+    }
+  }
+
+  for (uint32_t i=0;i<nof_helpers_;i++) {
+    helpers[i] = new helper(this, i+1);
+    if (!helpers[i]->start_cpu(prio, cpu)) {
+      delete helpers[i];
+      helpers[i] = NULL;
+      stop_helpers();
+      return false;
+    }
+  }
+  nof_helpers = nof_helpers_;
+  return true;
+}
+
+void pdsch_decoder::stop_helpers()
+{
+  if (!running) {
+    return;
+  }
+  pthread_mutex_lock(&mutex);
+  running = false;
+  pthread_cond_broadcast(&cvar);
+  pthread_mutex_unlock(&mutex);
+  for (uint32_t i=0;i<MAX_HELPERS;i++) {
+    if (helpers[i]) {
+      helpers[i]->wait_thread_finish();
+      delete helpers[i];
+      helpers[i] = NULL;
+    }
+  }
+  for (uint32_t i=0;i<=MAX_HELPERS;i++) {
+    if (decoders[i].cb_in) {
+      srslte_tdec_free(&decoders[i].tdec);
+      free(decoders[i].cb_in);
+      decoders[i].cb_in = NULL;
+    }
+  }
+  nof_helpers = 0;
+}
+
+bool pdsch_decoder::is_enabled()
+{
+  return nof_helpers > 0;
+}
+
+void pdsch_decoder::set_rnti(uint16_t rnti_)
+{
+  if (!cell_initiated) {
+    return;
+  }
+  for (uint32_t i=0;i<SRSLTE_NSUBFRAMES_X_FRAME;i++) {
+    if (rnti_is_set) {
+      srslte_sequence_free(&seq[i]);
+    }
+    if (srslte_sequence_pdsch(&seq[i], rnti_, 0, 2*i, cell.id, max_re * srslte_mod_bits_x_symbol(SRSLTE_MOD_64QAM))) {
+      Error("Generating scrambling sequence\n");
+      rnti_is_set = false;
+      return;
+    }
+  }
+  rnti        = rnti_;
+  rnti_is_set = true;
+}
+
+void pdsch_decoder::set_max_noi(uint32_t max_noi_)
+{
+  max_noi = max_noi_;
+}
+
+float pdsch_decoder::last_noi()
+{
+  return avg_noi;
+}
+
+bool pdsch_decoder::can_decode(srslte_pdsch_cfg_t *cfg, uint16_t rnti_)
+{
+  return nof_helpers > 0 && cell_initiated && rnti_is_set && rnti_ == rnti &&
+         cfg->cb_segm.C >= 2 && cfg->cb_segm.C <= MAX_CB;
+}
+
+uint32_t pdsch_decoder::get_nof_decoders(srslte_pdsch_cfg_t *cfg, uint16_t rnti_)
+{
+  return can_decode(cfg, rnti_) ? nof_helpers + 1 : 1;
+}
+
+int pdsch_decoder::decode(srslte_pdsch_cfg_t *cfg, srslte_softbuffer_rx_t *softbuffer_, cf_t *sf_symbols,
+                          cf_t *ce[SRSLTE_MAX_PORTS], float noise_estimate, uint16_t rnti_, uint8_t *data_)
+{
+  if (!can_decode(cfg, rnti_)) {
+    return SRSLTE_ERROR_INVALID_INPUTS;
+  }
+  if (!demodulate(cfg, sf_symbols, ce, noise_estimate)) {
+    return SRSLTE_ERROR_INVALID_INPUTS;
+  }
+
+  segment(cfg);
+  softbuffer     = softbuffer_;
+  data           = data_;
+  next_cb        = 0;
+  nof_iterations = 0;
+  cancel         = false;
+
+  pthread_mutex_lock(&mutex);
+  tb_id++;
+  nof_helpers_done = 0;
+  pthread_cond_broadcast(&cvar);
+  pthread_mutex_unlock(&mutex);
+
+  decode_cbs(0);
+
+  // Helpers may still be working on their last code block
+  pthread_mutex_lock(&mutex);
+  while (nof_helpers_done < nof_helpers) {
+    pthread_cond_wait(&cvar, &mutex);
+  }
+  pthread_mutex_unlock(&mutex);
+
+  avg_noi = (float) nof_iterations/cb_segm->C;
+  if (cancel) {
+    return SRSLTE_ERROR;
+  }
+
+  uint32_t par_rx = srslte_crc_checksum_byte(&crc_tb, data, cb_segm->tbs);
+  uint32_t par_tx = ((uint32_t) tb_parity[0])<<16 | ((uint32_t) tb_parity[1])<<8 | ((uint32_t) tb_parity[2]);
+  return (par_rx == par_tx) ? SRSLTE_SUCCESS : SRSLTE_ERROR;
+}
+
+/* Copies the PDSCH resource elements of the grant from a subframe grid,
+ * frequency first, skipping the control region, the cell-specific reference
+ * signals and the central 72 subcarriers where the PSS/SSS and PBCH are sent.
+ * Returns the number of REs.
+ */
+uint32_t pdsch_decoder::get_re(cf_t *grid, cf_t *re, srslte_ra_dl_grant_t *grant, uint32_t lstart, uint32_t sf_idx)
+{
+  uint32_t nsymb   = SRSLTE_CP_NSYMB(cell.cp);
+  uint32_t nof_sc  = cell.nof_prb * SRSLTE_NRE;
+  uint32_t sync_lo = nof_sc/2 - 36;
+  uint32_t sync_hi = nof_sc/2 + 36;
+  uint32_t v_shift = cell.id % 6;
+  uint32_t n       = 0;
+
+  for (uint32_t s=0;s<2;s++) {
+    for (uint32_t l=(s == 0)?lstart:0;l<nsymb;l++) {
+      bool     has_ref = SRSLTE_SYMBOL_HAS_REF(l, cell.cp, cell.nof_ports);
+      uint32_t ref_mod = (cell.nof_ports == 1) ? 6 : 3;
+      uint32_t ref_k   = (cell.nof_ports == 1) ? (v_shift + ((l == 0) ? 0 : 3)) % 6 : v_shift % 3;
+      bool     is_sync = (s == 0 && (sf_idx == 0 || sf_idx == 5) && l >= nsymb - 2);
+      bool     is_pbch = (s == 1 && sf_idx == 0 && l < 4);
+      cf_t    *in      = &grid[(s*nsymb + l) * nof_sc];
+      for (uint32_t p=0;p<cell.nof_prb;p++) {
+        if (!grant->prb_idx[s][p]) {
+          continue;
+        }
+        for (uint32_t k=p*SRSLTE_NRE;k<(p+1)*SRSLTE_NRE;k++) {
+          if (has_ref && (k % ref_mod) == ref_k) {
+            continue;
+          }
+          if ((is_sync || is_pbch) && k >= sync_lo && k < sync_hi) {
+            continue;
+          }
+          re[n++] = in[k];
+        }
+      }
+    }
+  }
+  return n;
+}
+
+bool pdsch_decoder::demodulate(srslte_pdsch_cfg_t *cfg, cf_t *sf_symbols, cf_t *ce[SRSLTE_MAX_PORTS], float noise_estimate)
+{
+  uint32_t nof_re = get_re(sf_symbols, symbols, &cfg->grant, cfg->nbits.lstart, cfg->sf_idx);
+  if (nof_re != cfg->nbits.nof_re) {
+    Warning("PDSCH grant has %d REs, expected %d. Decoding with srslte_pdsch\n", nof_re, cfg->nbits.nof_re);
+    return false;
+  }
+  for (uint32_t i=0;i<cell.nof_ports;i++) {
+    get_re(ce[i], ce_re[i], &cfg->grant, cfg->nbits.lstart, cfg->sf_idx);
+  }
+
+  if (cell.nof_ports == 1) {
+    srslte_predecoding_single(symbols, ce_re[0], d, nof_re, noise_estimate);
+  } else {
+    srslte_predecoding_diversity(symbols, ce_re, x, cell.nof_ports, nof_re/cell.nof_ports);
+    srslte_layerdemap_diversity(x, d, cell.nof_ports, nof_re/cell.nof_ports);
+  }
+  srslte_demod_soft_demodulate_s(cfg->grant.mcs.mod, d, e, nof_re);
+  srslte_scrambling_s_offset(&seq[cfg->sf_idx], e, 0, cfg->nbits.nof_bits);
+  return true;
+}
+
+/* Rate matching output length (E) and read/write offsets of each code block */
+void pdsch_decoder::segment(srslte_pdsch_cfg_t *cfg)
+{
+  cb_segm = &cfg->cb_segm;
+  rv      = cfg->rv;
+
+  uint32_t C     = cb_segm->C;
+  uint32_t Qm    = srslte_mod_bits_x_symbol(cfg->grant.mcs.mod);
+  uint32_t N_L   = (cell.nof_ports > 1) ? 2 : 1;
+  uint32_t Gp    = cfg->nbits.nof_bits / (N_L * Qm);
+  uint32_t gamma = Gp % C;
+  uint32_t rp    = 0;
+  uint32_t wp    = 0;
+
+  for (uint32_t i=0;i<C;i++) {
+    uint32_t cb_len = (i < cb_segm->C2) ? cb_segm->K2 : cb_segm->K1;
+    if (i < C - gamma) {
+      cb_ne[i] = N_L * Qm * (Gp / C);
+    } else {
+      cb_ne[i] = N_L * Qm * ((Gp + C - 1) / C);
+    }
+    cb_rp[i] = rp;
+    cb_wp[i] = wp;
+    rp += cb_ne[i];
+    wp += cb_len - 24 - ((i == 0) ? cb_segm->F : 0);
+  }
+}
+
+void pdsch_decoder::decode_cbs(uint32_t decoder_idx)
+{
+  uint32_t i;
+  while ((i = next_cb.fetch_add(1)) < cb_segm->C) {
+    if (!decode_cb(&decoders[decoder_idx], i)) {
+      cancel = true;
+    }
+  }
+}
+
+bool pdsch_decoder::decode_cb(cb_decoder_t *dec, uint32_t i)
+{
+  uint32_t cb_len = (i < cb_segm->C2) ? cb_segm->K2 : cb_segm->K1;
+  uint32_t cb_idx = (i < cb_segm->C2) ? cb_segm->K2_idx : cb_segm->K1_idx;
+
+  // Soft-combine even if the TB has already failed so that the retransmission can use it
+  if (srslte_rm_turbo_rx_lut(&e[cb_rp[i]], softbuffer->buffer_f[i], cb_ne[i], cb_idx, rv)) {
+    Error("Rate matching code block %d\n", i);
+    return false;
+  }
+  if (cancel) {
+    return false;
+  }
+
+  uint32_t noi    = 0;
+  bool     crc_ok = false;
+  srslte_tdec_reset(&dec->tdec, cb_len);
+  do {
+    srslte_tdec_iteration(&dec->tdec, softbuffer->buffer_f[i], cb_len);
+    srslte_tdec_decision_byte(&dec->tdec, dec->cb_in, cb_len);
+    crc_ok = srslte_crc_checksum_byte(&dec->crc_cb, dec->cb_in, cb_len) == 0;
+    noi++;
+  } while (!crc_ok && noi < max_noi && !cancel);
+  nof_iterations += noi;
+
+  if (!crc_ok) {
+    Debug("Code block %d of %d failed after %d iterations\n", i, cb_segm->C, noi);
+    return false;
+  }
+
+  // Drop the filler bits and the code block CRC. The last block ends with the TB CRC.
+  uint32_t skip = (i == 0) ? cb_segm->F : 0;
+  uint32_t len  = cb_len - 24 - skip;
+  if (i == cb_segm->C - 1) {
+    len -= 24;
+    memcpy(tb_parity, &dec->cb_in[(skip + len)/8], 3);
+  }
+  memcpy(&data[cb_wp[i]/8], &dec->cb_in[skip/8], len/8);
+  return true;
+}
+
+} // namespace srsue
@@ -28,12 +28,12 @@
 #include <string.h>
 #include "srslte/srslte.h"
 #include "phy/phch_common.h"
+#include "liblte_rrc.h"
 
-#define Error(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) log_h->error_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Warning(fmt, ...) if (SRSLTE_DEBUG_ENABLED) log_h->warning_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Info(fmt, ...)    if (SRSLTE_DEBUG_ENABLED) log_h->info_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Debug(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) log_h->debug_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-
+#define Error(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, ERROR, error_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...) if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, WARNING, warning_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)    if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, INFO, info_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, DEBUG, debug_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #define TX_MODE_CONTINUOUS 0 
 
 namespace srsue {
@@ -62,6 +62,11 @@ phch_common::phch_common(uint32_t max_mutex_) : tx_mutex(max_mutex_)
   sr_last_tx_tti = -1;
   cur_pusch_power = 0;
   bzero(zeros, 50000*sizeof(cf_t));
+  noise_alg       = SRSLTE_NOISE_ALG_REFS; 
+  equalizer_zf    = false; 
+  dl_rnti_skip_sf5 = false; 
+  bzero(ul_plan_buf, sizeof(ul_plan_buf));
+  ul_plan = ul_plan_buf[0]; 
 
   bzero(&dl_metrics, sizeof(dl_metrics_t));
   dl_metrics_read = true;
@@ -72,6 +77,8 @@ phch_common::phch_common(uint32_t max_mutex_) : tx_mutex(max_mutex_)
   bzero(&sync_metrics, sizeof(sync_metrics_t));
   sync_metrics_read = true;
   sync_metrics_count = 0;
+  tti_metrics_file = NULL;
+  tti_metrics_cnt  = 0;
 }
   
 void phch_common::init(phy_interface_rrc::phy_cfg_t *_config, phy_args_t *_args, srslte::log *_log, srslte::radio *_radio, mac_interface_phy *_mac)
@@ -84,6 +91,15 @@ void phch_common::init(phy_interface_rrc::phy_cfg_t *_config, phy_args_t *_args,
   is_first_tx = true; 
   sr_last_tx_tti = -1;
   
+  if (!args->snr_estim_alg.compare("refs")) {
+    noise_alg = SRSLTE_NOISE_ALG_REFS; 
+  } else if (!args->snr_estim_alg.compare("empty")) {
+    noise_alg = SRSLTE_NOISE_ALG_EMPTY; 
+  } else {
+    noise_alg = SRSLTE_NOISE_ALG_PSS; 
+  }
+  equalizer_zf = !args->equalizer_mode.compare("zf"); 
+  
   for (int i=0;i<nof_mutex;i++) {
     pthread_mutex_init(&tx_mutex[i], NULL);
   }
@@ -105,20 +121,11 @@ bool phch_common::ul_rnti_active(uint32_t tti) {
 }
 
 bool phch_common::dl_rnti_active(uint32_t tti) {
-  Debug("tti=%d, dl_rnti_start=%d, dl_rnti_end=%d, dl_rnti=%d\n", tti, dl_rnti_start, dl_rnti_end, dl_rnti);
   if (((tti >= dl_rnti_start && dl_rnti_start >= 0)  || dl_rnti_start < 0) && 
       ((tti <  dl_rnti_end   && dl_rnti_end   >= 0)  || dl_rnti_end   < 0))
   {
-    bool ret = true; 
-    // FIXME: This scheduling decision belongs to RRC
-    if (dl_rnti_type == SRSLTE_RNTI_SI) {
-      if (dl_rnti_end - dl_rnti_start > 1) { // This is not a SIB1        
-        if ((tti/10)%2 == 0 && (tti%10) == 5) { // Skip subframe #5 for which SFN mod 2 = 0
-          ret = false; 
-        }
-      }
-    }
-    return ret; 
+    // Skip subframe #5 for which SFN mod 2 = 0
+    return !(dl_rnti_skip_sf5 && (tti%20) == 5); 
   } else {
     return false; 
   }
@@ -186,6 +193,8 @@ void phch_common::set_dl_rnti(srslte_rnti_type_t type, uint16_t rnti_value, int
   dl_rnti_type  = type;
   dl_rnti_start = tti_start;
   dl_rnti_end   = tti_end;
+  // FIXME: This scheduling decision belongs to RRC
+  dl_rnti_skip_sf5 = type == SRSLTE_RNTI_SI && tti_end - tti_start > 1; // This is not a SIB1
   Debug("Set DL rnti: start=%d, end=%d, value=0x%x\n", tti_start, tti_end, rnti_value);  
 }
 
@@ -220,13 +229,15 @@ bool phch_common::get_pending_ack(uint32_t tti, uint32_t *I_lowest, uint32_t *n_
  */
 void phch_common::worker_end(uint32_t tti, bool tx_enable, 
                                    cf_t *buffer, uint32_t nof_samples, 
-                                   srslte_timestamp_t tx_time) 
+                                   srslte_timestamp_t tx_time, 
+                                   tti_metrics_t *metrics) 
 {
 
   // Wait previous TTIs to be transmitted 
   if (is_first_tx) {
     is_first_tx = false; 
   } else {
+    srslte::tti_span trace("tx_wait", tti);
     pthread_mutex_lock(&tx_mutex[tti%nof_mutex]);
   }
 
@@ -245,6 +256,14 @@ void phch_common::worker_end(uint32_t tti, bool tx_enable,
         is_first_of_burst = true;   
       }
     }
+    if (is_first_of_burst) {
+      radio_h->tx_idle(tx_time, nof_samples);
+    }
+  }
+  if (metrics && tti_metrics_file) {
+    fprintf(tti_metrics_file, "%lu,%d,%.2f,%.2f,%.2f,0x%x,%d,%d,%d,%.1f,%d\n", 
+            (unsigned long) tti_metrics_cnt++, metrics->tti, metrics->rsrp, metrics->rsrq, metrics->snr, 
+            metrics->rnti, metrics->mcs, metrics->tbs, metrics->crc, metrics->turbo_iters, metrics->proc_us);
   }
   // Trigger next transmission 
   pthread_mutex_unlock(&tx_mutex[(tti+1)%nof_mutex]);
@@ -255,6 +274,26 @@ void phch_common::worker_end(uint32_t tti, bool tx_enable,
 }    
 
 
+bool phch_common::open_tti_metrics(std::string filename)
+{
+  tti_metrics_file = fopen(filename.c_str(), "w");
+  if (!tti_metrics_file) {
+    fprintf(stderr, "Error opening TTI metrics file %s\n", filename.c_str());
+    return false; 
+  }
+  tti_metrics_cnt = 0; 
+  fprintf(tti_metrics_file, "subframe,tti,rsrp_dbm,rsrq_db,snr_db,rnti,mcs,tbs,crc,turbo_iters,proc_us\n");
+  return true; 
+}
+
+void phch_common::close_tti_metrics()
+{
+  if (tti_metrics_file) {
+    fclose(tti_metrics_file);
+    tti_metrics_file = NULL; 
+  }
+}
+
 void phch_common::set_cell(const srslte_cell_t &c) {
   cell = c;
 }
@@ -321,6 +360,40 @@ void phch_common::get_sync_metrics(sync_metrics_t &m) {
   sync_metrics_read = true;
 }
 
+/* Tabulates the SR, periodic CQI and SRS opportunities of the current
+ * configuration for every TTI. All their periods divide 10240. */
+void phch_common::build_ul_plan()
+{
+  LIBLTE_RRC_PHYSICAL_CONFIG_DEDICATED_STRUCT *dedicated = &config->dedicated;
+  
+  uint32_t I_sr        = dedicated->sched_request_cnfg.sr_cnfg_idx;
+  bool     cqi_enabled = dedicated->cqi_report_cnfg.report_periodic_setup_present; 
+  uint32_t pmi_idx     = dedicated->cqi_report_cnfg.report_periodic.pmi_cnfg_idx; 
+  bool     srs_enabled = dedicated->srs_ul_cnfg_ded.setup_present; 
+  uint32_t srs_sf_cfg  = liblte_rrc_srs_subfr_config_num[config->common.srs_ul_cnfg.subfr_cnfg%LIBLTE_RRC_SRS_SUBFR_CONFIG_N_ITEMS];
+  uint32_t I_srs       = dedicated->srs_ul_cnfg_ded.srs_cnfg_idx;
+  
+  uint8_t *cur  = ul_plan.load(boost::memory_order_relaxed); 
+  uint8_t *plan = (cur == ul_plan_buf[0]) ? ul_plan_buf[1] : ul_plan_buf[0]; 
+  for (uint32_t tti=0;tti<10240;tti++) {
+    uint8_t v = 0; 
+    if (srslte_ue_ul_sr_send_tti(I_sr, tti)) {
+      v |= UL_PLAN_SR; 
+    }
+    if (cqi_enabled && srslte_cqi_send(pmi_idx, tti)) {
+      v |= UL_PLAN_CQI; 
+    }
+    if (srs_enabled && 
+        srslte_refsignal_srs_send_cs(srs_sf_cfg, tti%10) == 1 && 
+        srslte_refsignal_srs_send_ue(I_srs, tti)         == 1) 
+    {
+      v |= UL_PLAN_SRS; 
+    }
+    plan[tti] = v; 
+  }
+  ul_plan.store(plan, boost::memory_order_release); 
+}
+
 void phch_common::reset_ul()
 {
   is_first_tx = true; 
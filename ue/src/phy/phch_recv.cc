@@ -26,26 +26,28 @@
 
 #include <unistd.h>
 #include "srslte/srslte.h"
+#include "common/common.h"
 #include "common/log.h"
+#include "common/tti_tracer.h"
 #include "phy/phch_worker.h"
 #include "phy/phch_common.h"
 #include "phy/phch_recv.h"
 
-#define Error(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) log_h->error_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Warning(fmt, ...) if (SRSLTE_DEBUG_ENABLED) log_h->warning_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Info(fmt, ...)    if (SRSLTE_DEBUG_ENABLED) log_h->info_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Debug(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) log_h->debug_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-
+#define Error(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, ERROR, error_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...) if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, WARNING, warning_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)    if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, INFO, info_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, DEBUG, debug_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 namespace srsue {
  
 
 phch_recv::phch_recv() { 
-  running = false; 
+  running  = false; 
+  finished = false; 
 }
 
 void phch_recv::init(srslte::radio* _radio_handler, mac_interface_phy *_mac, rrc_interface_phy *_rrc,
                      prach* _prach_buffer, srslte::thread_pool* _workers_pool,
-                     phch_common* _worker_com, srslte::log* _log_h, uint32_t prio)
+                     phch_common* _worker_com, srslte::log* _log_h, uint32_t prio, int cpu)
 {
   radio_h      = _radio_handler;
   log_h        = _log_h;     
@@ -60,11 +62,19 @@ void phch_recv::init(srslte::radio* _radio_handler, mac_interface_phy *_mac, rrc
   time_adv_sec = 0; 
   cell_is_set  = false; 
   sync_sfn_cnt = 0; 
+  finished     = false; 
+  nof_sf       = 0; 
+  start_ns     = srslte::get_time_ns(); 
   
   nof_tx_mutex = MUTEX_X_WORKER*workers_pool->get_nof_workers();
   worker_com->set_nof_mutex(nof_tx_mutex);
     
-  start(prio);
+  set_name("phy_sync");
+  if (cpu < 0) {
+    start(prio);
+  } else {
+    start_cpu(prio, cpu);
+  }
 }
 
 void phch_recv::stop() {
@@ -145,6 +155,9 @@ bool phch_recv::init_cell() {
           Error("Error setting cell: initiating PHCH worker\n");
           return false; 
         }
+        if (worker_com->args->offline) {
+          ((phch_worker*) workers_pool->get_worker(i))->set_crnti(worker_com->args->offline_rnti);
+        }
       }
       radio_h->set_tti_len(SRSLTE_SF_LEN_PRB(cell.nof_prb));
       if (do_agc) {
@@ -351,6 +364,8 @@ void phch_recv::run_thread()
           phy_state = SYNCING;
           sync_sfn_cnt = 0; 
           srslte_ue_mib_reset(&ue_mib);
+        } else if (radio_h->is_rx_finished()) {
+          end_of_capture();
         }
         break;
       case SYNCING:
@@ -365,6 +380,10 @@ void phch_recv::run_thread()
           
         switch(sync_sfn()) {
           default:
+            if (radio_h->is_rx_finished()) {
+              end_of_capture();
+              break; 
+            }
             log_h->console("Going IDLE\n");
             phy_state = IDLE; 
             break; 
@@ -393,7 +412,10 @@ void phch_recv::run_thread()
         sync_res = 0; 
         if (worker) {          
           buffer = worker->get_buffer();
-          sync_res = srslte_ue_sync_zerocopy(&ue_sync, buffer); 
+          {
+            srslte::tti_span trace("sync", tti);
+            sync_res = srslte_ue_sync_zerocopy(&ue_sync, buffer); 
+          }
           if (sync_res == 1) {
             
             log_h->step(tti);
@@ -422,7 +444,7 @@ void phch_recv::run_thread()
             tx_mutex_cnt = (tx_mutex_cnt+1)%nof_tx_mutex;
 
             // Check if we need to TX a PRACH 
-            if (prach_buffer->is_ready_to_send(tti)) {
+            if (!worker_com->args->offline && prach_buffer->is_ready_to_send(tti)) {
               srslte_timestamp_t cur_time; 
               radio_h->get_time(&cur_time);
               prach_buffer->send(radio_h, ul_dl_factor*metrics.cfo/15000, worker_com->pathloss, tx_time_prach);
@@ -431,11 +453,15 @@ void phch_recv::run_thread()
               worker_com->cur_radio_power = SRSLTE_MIN(SRSLTE_PC_MAX, worker_com->pathloss + worker_com->p0_preamble);
             }            
             workers_pool->start_worker(worker);             
+            nof_sf++; 
             // Notify RRC in-sync every 1 frame
             if ((tti%10) == 0) {
               rrc->in_sync();
               log_h->debug("Sending in-sync to RRC\n");
             }
+          } else if (radio_h->is_rx_finished()) {
+            worker->release();
+            end_of_capture();
           } else {
             log_h->console("Sync error.\n");
             log_h->error("Sync error. Sending out-of-sync to RRC\n");
@@ -457,6 +483,34 @@ void phch_recv::run_thread()
   }
 }
 
+/* Waits for the workers to finish the last subframes of the capture */
+void phch_recv::end_of_capture()
+{
+  std::vector<srslte::thread_pool::worker*> idle; 
+  for (uint32_t i=0;i<workers_pool->get_nof_workers();i++) {
+    srslte::thread_pool::worker *w = workers_pool->wait_worker(tti);
+    if (w) {
+      idle.push_back(w);
+    }
+  }
+  for (uint32_t i=0;i<idle.size();i++) {
+    idle[i]->release();
+  }
+  radio_h->stop_rx();
+  radio_is_streaming = false; 
+  phy_state = IDLE; 
+  finished  = true; 
+  
+  double secs = (double) (srslte::get_time_ns() - start_ns)/1e9;
+  log_h->console("End of IQ capture. Decoded %lu subframes in %.1f s, %.1f times real time\n", 
+                 (unsigned long) nof_sf, secs, secs>0?nof_sf/(1000*secs):0);
+}
+
+bool phch_recv::status_is_finished()
+{
+  return finished; 
+}
+
 uint32_t phch_recv::get_current_tti()
 {
   return tti; 
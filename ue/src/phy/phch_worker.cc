@@ -26,17 +26,17 @@
 
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 #include "phy/phch_worker.h"
 #include "common/mac_interface.h"
 #include "common/phy_interface.h"
+#include "common/tti_tracer.h"
 #include "liblte_rrc.h"
 
-#define Error(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) phy->log_h->error_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Warning(fmt, ...) if (SRSLTE_DEBUG_ENABLED) phy->log_h->warning_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Info(fmt, ...)    if (SRSLTE_DEBUG_ENABLED) phy->log_h->info_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Debug(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) phy->log_h->debug_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-
-
+#define Error(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(phy->log_h, PHY, ERROR, error_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...) if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(phy->log_h, PHY, WARNING, warning_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)    if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(phy->log_h, PHY, INFO, info_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(phy->log_h, PHY, DEBUG, debug_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 /* This is to visualize the channel response */
 #ifdef ENABLE_GUI
 #include "srsgui/srsgui.h"
@@ -58,10 +58,12 @@ phch_worker::phch_worker() : tr_exec(10240)
 {
   phy = NULL; 
   signal_buffer = NULL; 
+  tx_buffer     = NULL; 
   
   cell_initiated  = false; 
   pregen_enabled  = false; 
   trace_enabled   = false; 
+  ul_stage_thread = NULL; 
   
   reset();  
 }
@@ -70,6 +72,8 @@ void phch_worker::reset()
 {
   bzero(&dl_metrics, sizeof(dl_metrics_t));
   bzero(&ul_metrics, sizeof(ul_metrics_t));
+  last_turbo_iters = 0; 
+  nof_late_nacks   = 0; 
   bzero(&dmrs_cfg, sizeof(srslte_refsignal_dmrs_pusch_cfg_t));    
   bzero(&pusch_hopping, sizeof(srslte_pusch_hopping_cfg_t));
   bzero(&uci_cfg, sizeof(srslte_uci_cfg_t));
@@ -98,18 +102,53 @@ bool phch_worker::init_cell(srslte_cell_t cell_)
     Error("Allocating memory\n");
     return false; 
   }
+  
+  // The UL stage may still be encoding while the next subframe is received 
+  tx_buffer = (cf_t*) srslte_vec_malloc(sizeof(cf_t) * SRSLTE_SF_LEN_PRB(cell.nof_prb));
+  if (!tx_buffer) {
+    Error("Allocating memory\n");
+    free(signal_buffer);
+    signal_buffer = NULL; 
+    return false; 
+  }
 
   if (srslte_ue_dl_init(&ue_dl, cell)) {    
     Error("Initiating UE DL\n");
+    free(signal_buffer);
+    free(tx_buffer);
+    signal_buffer = NULL; 
+    tx_buffer     = NULL; 
     return false; 
   }
   
   if (srslte_ue_ul_init(&ue_ul, cell)) {  
     Error("Initiating UE UL\n");
+    srslte_ue_dl_free(&ue_dl);
+    free(signal_buffer);
+    free(tx_buffer);
+    signal_buffer = NULL; 
+    tx_buffer     = NULL; 
     return false; 
   }
   srslte_ue_ul_set_normalization(&ue_ul, true);
   srslte_ue_ul_set_cfo_enable(&ue_ul, true);
+  
+  pdsch_dec.init(phy->log_h);
+  its_policy.init(phy->args->pdsch_its_adaptive, phy->args->pdsch_max_its, phy->args->pdsch_min_its, 
+                  phy->args->pdsch_boost_its, phy->args->pdsch_last_tx);
+  if (!pdsch_dec.init_cell(cell)) {
+    Error("Initiating PDSCH decoder\n");
+    pdsch_dec.free_cell();
+    srslte_ue_ul_free(&ue_ul);
+    srslte_ue_dl_free(&ue_dl);
+    free(signal_buffer);
+    free(tx_buffer);
+    signal_buffer = NULL; 
+    tx_buffer     = NULL; 
+    return false; 
+  }
+  
+  set_chest_params();
     
   cell_initiated = true; 
   
@@ -119,11 +158,16 @@ bool phch_worker::init_cell(srslte_cell_t cell_)
 void phch_worker::free_cell()
 {
   if (cell_initiated) {
+    wait_ul_stage();
     if (signal_buffer) {
       free(signal_buffer);
     }
+    if (tx_buffer) {
+      free(tx_buffer);
+    }
     srslte_ue_dl_free(&ue_dl);
     srslte_ue_ul_free(&ue_ul);
+    pdsch_dec.free_cell();
   }
 }
 
@@ -155,9 +199,185 @@ void phch_worker::set_crnti(uint16_t rnti)
 {
   srslte_ue_dl_set_rnti(&ue_dl, rnti);
   srslte_ue_ul_set_rnti(&ue_ul, rnti);
+  pdsch_dec.set_rnti(rnti);
   rnti_is_set = true; 
 }
 
+/* Runs the UL stage of a worker in pipelined mode. The DL stage hands
+ * over a copy of the per-TTI context after the control channels are decoded
+ * and the HARQ-ACK once the PDSCH is decoded. Only one subframe is handed
+ * over at a time, so the next one waits until the UL stage is idle */
+class phch_worker::ul_thread : public thread
+{
+public:
+  ul_thread(phch_worker *w) : worker(w), running(true), busy(false), ack_ready(false), ack_claimed(false), nack_sent(false), grant_done(true) {
+    pthread_condattr_t attr; 
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cvar, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&mutex, NULL);
+    set_name("phy_ul");
+  }
+  ~ul_thread() {
+    pthread_cond_destroy(&cvar);
+    pthread_mutex_destroy(&mutex);
+  }
+  void stop() {
+    pthread_mutex_lock(&mutex);
+    running = false; 
+    pthread_cond_broadcast(&cvar);
+    pthread_mutex_unlock(&mutex);
+    wait_thread_finish();
+  }
+  void start(ul_ctx_t *ctx) {
+    pthread_mutex_lock(&mutex);
+    while (busy && running) {
+      pthread_cond_wait(&cvar, &mutex);
+    }
+    memcpy(&worker->ul_ctx, ctx, sizeof(ul_ctx_t));
+    ack_ready   = false; 
+    ack_claimed = false; 
+    nack_sent   = false; 
+    grant_done  = false; 
+    busy        = true; 
+    pthread_cond_broadcast(&cvar);
+    pthread_mutex_unlock(&mutex);
+  }
+  void set_dl_ack(bool ack) {
+    pthread_mutex_lock(&mutex);
+    worker->ul_ctx.dl_ack = ack; 
+    ack_ready = true; 
+    pthread_cond_broadcast(&cvar);
+    pthread_mutex_unlock(&mutex);
+  }
+  // Called once the UL grant and PHICH of the subframe have been passed to MAC
+  void set_ul_grant_done() {
+    pthread_mutex_lock(&mutex);
+    grant_done = true; 
+    pthread_cond_broadcast(&cvar);
+    pthread_mutex_unlock(&mutex);
+  }
+  void wait_ul_grant() {
+    pthread_mutex_lock(&mutex);
+    while (!grant_done && running) {
+      pthread_cond_wait(&cvar, &mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+  }
+  // Called once the PDSCH is decoded. Returns false if the UL stage has already
+  // sent a NACK, otherwise the UL stage waits for set_dl_ack() past the deadline
+  bool claim_dl_ack() {
+    pthread_mutex_lock(&mutex);
+    bool ret = !nack_sent; 
+    ack_claimed = ret; 
+    pthread_mutex_unlock(&mutex);
+    return ret; 
+  }
+  // Returns false, and latches the NACK, if the deadline (CLOCK_MONOTONIC, ns)
+  // expires before the PDSCH decoding has finished
+  bool wait_dl_ack(uint64_t deadline_ns) {
+    struct timespec ts; 
+    ts.tv_sec  = deadline_ns/1000000000; 
+    ts.tv_nsec = deadline_ns%1000000000; 
+    pthread_mutex_lock(&mutex);
+    while (!ack_ready && !nack_sent) {
+      if (ack_claimed) {
+        pthread_cond_wait(&cvar, &mutex);
+      } else if (pthread_cond_timedwait(&cvar, &mutex, &ts) == ETIMEDOUT && !ack_ready && !ack_claimed) {
+        nack_sent = true; 
+      }
+    }
+    bool ret = !nack_sent; 
+    pthread_mutex_unlock(&mutex);
+    return ret; 
+  }
+  void wait_idle() {
+    pthread_mutex_lock(&mutex);
+    while (busy && running) {
+      pthread_cond_wait(&cvar, &mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+  }
+protected:
+  void run_thread() {
+    while (true) {
+      pthread_mutex_lock(&mutex);
+      while (!busy && running) {
+        pthread_cond_wait(&cvar, &mutex);
+      }
+      bool run = running; 
+      pthread_mutex_unlock(&mutex);
+      if (!run) {
+        break; 
+      }
+      worker->ul_stage();
+      pthread_mutex_lock(&mutex);
+      busy = false; 
+      pthread_cond_broadcast(&cvar);
+      pthread_mutex_unlock(&mutex);
+    }
+  }
+private:
+  phch_worker     *worker; 
+  pthread_mutex_t  mutex; 
+  pthread_cond_t   cvar; 
+  bool             running; 
+  bool             busy; 
+  bool             ack_ready; 
+  bool             ack_claimed; 
+  bool             nack_sent; 
+  bool             grant_done; 
+};
+
+bool phch_worker::start_ul_thread(int prio, int cpu)
+{
+  ul_stage_thread = new ul_thread(this);
+  if (!ul_stage_thread->start_cpu(prio, cpu)) {
+    delete ul_stage_thread; 
+    ul_stage_thread = NULL; 
+    return false; 
+  }
+  return true; 
+}
+
+/* Returns once the UL stage, if any, has sent its last subframe */
+void phch_worker::wait_ul_stage()
+{
+  if (ul_stage_thread) {
+    ul_stage_thread->wait_idle();
+  }
+}
+
+void phch_worker::stop_ul_thread()
+{
+  if (ul_stage_thread) {
+    ul_stage_thread->stop();
+    delete ul_stage_thread; 
+    ul_stage_thread = NULL; 
+  }
+}
+
+bool phch_worker::start_dec_helpers(uint32_t nof_helpers, int prio, int cpu)
+{
+  return pdsch_dec.start_helpers(nof_helpers, prio, cpu);
+}
+
+void phch_worker::stop_dec_helpers()
+{
+  pdsch_dec.stop_helpers();
+}
+
+void phch_worker::get_turbo_its_metrics(turbo_its_metrics_t &m)
+{
+  its_policy.get_metrics(m);
+}
+
+uint32_t phch_worker::get_nof_late_nacks()
+{
+  return nof_late_nacks; 
+}
+
 void phch_worker::work_imp()
 {
   if (!cell_initiated) {
@@ -166,155 +386,242 @@ void phch_worker::work_imp()
   
   Debug("TTI %d running\n", tti);
 
+  srslte::tti_span trace_worker("worker", tti);
+  tti_start_ns = srslte::get_time_ns();
+
 #ifdef LOG_EXECTIME
   gettimeofday(&logtime_start[1], NULL);
 #endif
 
   tr_log_start();
   
-  reset_uci();
+  dl_ack             = false; 
+  dl_nack_sent       = false; 
+  ul_ack             = false; 
+  ul_ack_available   = false; 
+  ul_grant_available = false; 
+  drx_sleep          = !phy->mac->is_active_time(tti);
+  bzero(&dl_action, sizeof(mac_interface_phy::tb_action_dl_t));
+  bzero(&tti_metrics, sizeof(tti_metrics_t));
+  tti_metrics.tti = tti; 
 
-  bool dl_grant_available = false; 
-  bool ul_grant_available = false; 
-  bool dl_ack = false;
+  dl_control_stage();
+  
+  if (phy->args->offline) {
+    /* Offline decoding does not transmit */
+    dl_data_stage();
+  } else if (ul_stage_thread) {
+    /* UL grant processing and encoding overlap with the PDSCH decoding. The
+     * worker is released once the PDSCH is decoded, without waiting for the 
+     * UL stage to send its signal */
+    ul_ctx_t ctx; 
+    get_ul_ctx(&ctx);
+    ul_stage_thread->start(&ctx);
+    dl_data_stage();
+    ul_stage_thread->set_dl_ack(dl_ack);
+  } else {
+    dl_data_stage();
+    get_ul_ctx(&ul_ctx);
+    ul_ctx.dl_ack = dl_ack; 
+    ul_stage();
+  }
+  
+  if (dl_action.decode_enabled && (!dl_action.generate_ack_callback || dl_nack_sent)) {
+    if (dl_mac_grant.rnti_type == SRSLTE_RNTI_PCH) {
+      phy->mac->pch_decoded_ok(dl_mac_grant.n_bytes);
+    } else {
+      phy->mac->tb_decoded(dl_ack, dl_mac_grant.rnti_type, dl_mac_grant.pid);
+    }
+  }
+  
+  /* MAC keeps the next TTIs in Active Time until it has all the grants of this one */
+  if (ul_stage_thread) {
+    ul_stage_thread->wait_ul_grant();
+  }
+  phy->mac->pdcch_done(tti);
 
-  mac_interface_phy::mac_grant_t    dl_mac_grant;
-  mac_interface_phy::tb_action_dl_t dl_action; 
-  bzero(&dl_action, sizeof(mac_interface_phy::tb_action_dl_t));
+  update_measurements();
+  
+  tr_log_end();
+  
+  if (phy->args->offline) {
+    tti_metrics.proc_us = (srslte::get_time_ns() - tti_start_ns)/1000;
+    srslte::tti_span trace("worker_end", tti);
+    phy->worker_end(tx_tti, false, signal_buffer, SRSLTE_SF_LEN_PRB(cell.nof_prb), tx_time, &tti_metrics);
+  }
+  
+  /* Tell the plotting thread to draw the plots */
+#ifdef ENABLE_GUI
+  if (get_id() == plot_worker_id) {
+    sem_post(&plot_sem);    
+  }
+#endif
+}
 
-  mac_interface_phy::mac_grant_t    ul_mac_grant;
-  mac_interface_phy::tb_action_ul_t ul_action; 
-  bzero(&ul_action, sizeof(mac_interface_phy::tb_action_ul_t));
+/* FFT, channel estimation and all control channels. Leaves the UL stage
+ * everything it needs except the HARQ-ACK of the PDSCH */
+void phch_worker::dl_control_stage()
+{
+  bool dl_grant_available = false; 
 
   /* Do FFT and extract PDCCH LLR, or quit if no actions are required in this subframe */
   if (extract_fft_and_pdcch_llr()) {
     
-    
-    /***** Downlink Processing *******/
-    
-    /* PDCCH DL + PDSCH */
-    dl_grant_available = decode_pdcch_dl(&dl_mac_grant); 
+    /* PDCCH DL */
+    {
+      srslte::tti_span trace("pdcch_dl", tti);
+      dl_grant_available = decode_pdcch_dl(&dl_mac_grant); 
+    }
     if(dl_grant_available) {
       /* Send grant to MAC and get action for this TB */
+      srslte::tti_span trace("mac_grant_dl", tti);
       phy->mac->new_grant_dl(dl_mac_grant, &dl_action);
-      
-      /* Decode PDSCH if instructed to do so */
-      dl_ack = dl_action.default_ack; 
-      if (dl_action.decode_enabled) {
-        dl_ack = decode_pdsch(&dl_action.phy_grant.dl, dl_action.payload_ptr, 
-                              dl_action.softbuffer, dl_action.rv, dl_action.rnti, 
-                              dl_mac_grant.pid);              
-      }
-      if (dl_action.generate_ack_callback && dl_action.decode_enabled) {
-        phy->mac->tb_decoded(dl_ack, dl_mac_grant.rnti_type, dl_mac_grant.pid);
-        dl_ack = dl_action.generate_ack_callback(dl_action.generate_ack_callback_arg);
-        Debug("Calling generate ACK callback returned=%d\n", dl_ack);
-      }
-      Debug("dl_ack=%d, generate_ack=%d\n", dl_ack, dl_action.generate_ack);
-      if (dl_action.generate_ack) {
-        set_uci_ack(dl_ack);
-      }
     }
   }
   
+  // Offline decoding has no UL 
+  if (phy->args->offline) {
+    return; 
+  }
+  
   // Decode PHICH 
-  bool ul_ack; 
-  bool ul_ack_available = decode_phich(&ul_ack); 
+  ul_ack_available = decode_phich(&ul_ack); 
+
+  /* Check if we have UL grant. ul_phy_grant will be overwritten by new grant */
+  {
+    srslte::tti_span trace("pdcch_ul", tti);
+    ul_grant_available = decode_pdcch_ul(&ul_mac_grant);
+  }
+}
+
+/* Copies what the UL stage needs from the DL stages and from the main PHY thread */
+void phch_worker::get_ul_ctx(ul_ctx_t *ctx)
+{
+  ctx->tti                = tti; 
+  ctx->tx_tti             = tx_tti; 
+  ctx->tx_time            = tx_time; 
+  ctx->cfo                = cfo; 
+  ctx->start_ns           = tti_start_ns; 
+  ctx->last_dl_pdcch_ncce = last_dl_pdcch_ncce; 
+  ctx->ul_mac_grant       = ul_mac_grant; 
+  ctx->ul_ack             = ul_ack; 
+  ctx->ul_ack_available   = ul_ack_available; 
+  ctx->ul_grant_available = ul_grant_available; 
+  ctx->generate_ack       = dl_action.generate_ack; 
+  ctx->dl_ack             = false; 
+  ctx->drx_sleep          = drx_sleep; 
+}
 
-  /***** Uplink Processing + Transmission *******/
+/* PDSCH decoding. Sets dl_ack, and dl_nack_sent if the UL stage NACKed it already */
+void phch_worker::dl_data_stage()
+{
+  /* Decode PDSCH if instructed to do so */
+  dl_ack = dl_action.default_ack; 
+  if (dl_action.decode_enabled) {
+    srslte::tti_span trace("pdsch", tti);
+    dl_ack = decode_pdsch(&dl_action.phy_grant.dl, dl_action.payload_ptr, 
+                          dl_action.softbuffer, dl_action.rv, dl_action.rnti, 
+                          dl_mac_grant.pid, dl_action.current_tx_nb);              
+  }
+  /* If the UL stage gave up waiting and sent a NACK, MAC gets the same NACK so that 
+   * the HARQ process keeps the softbuffer for the retransmission */
+  if (ul_stage_thread && dl_action.generate_ack && !ul_stage_thread->claim_dl_ack()) {
+    dl_ack       = false; 
+    dl_nack_sent = true; 
+    nof_late_nacks++; 
+  }
+  if (dl_action.generate_ack_callback && dl_action.decode_enabled && !dl_nack_sent) {
+    phy->mac->tb_decoded(dl_ack, dl_mac_grant.rnti_type, dl_mac_grant.pid);
+    dl_ack = dl_action.generate_ack_callback(dl_action.generate_ack_callback_arg);
+    Debug("Calling generate ACK callback returned=%d\n", dl_ack);
+  }
+  Debug("dl_ack=%d, generate_ack=%d\n", dl_ack, dl_action.generate_ack);
+}
+
+/* UCI assembly, UL grant processing, encoding and transmission. Only uses ul_ctx 
+ * out of the per-TTI context */
+void phch_worker::ul_stage()
+{
+  reset_uci();
   
   /* Generate SR if required*/
   set_uci_sr();
 
-  /* Check if we have UL grant. ul_phy_grant will be overwritten by new grant */
-  ul_grant_available = decode_pdcch_ul(&ul_mac_grant);
-
   /* Generate CQI reports if required, note that in case both aperiodic
-      and periodic ones present, only aperiodic is sent (36.213 section 7.2) */
-  if (ul_grant_available && ul_mac_grant.has_cqi_request) {
+      and periodic ones present, only aperiodic is sent (36.213 section 7.2).
+      Periodic CQI is not reported outside the Active Time (36.321 section 5.7) */
+  if (ul_ctx.ul_grant_available && ul_ctx.ul_mac_grant.has_cqi_request) {
     set_uci_aperiodic_cqi();
-  } else {
+  } else if (!ul_ctx.drx_sleep) {
     set_uci_periodic_cqi();
   }
 
   /* Send UL grant or HARQ information (from PHICH) to MAC */
-  if (ul_grant_available         && ul_ack_available)  {    
-    phy->mac->new_grant_ul_ack(ul_mac_grant, ul_ack, &ul_action);      
-  } else if (ul_grant_available  && !ul_ack_available) {
-    phy->mac->new_grant_ul(ul_mac_grant, &ul_action);
-  } else if (!ul_grant_available && ul_ack_available)  {    
-    phy->mac->harq_recv(tti, ul_ack, &ul_action);        
+  bzero(&ul_action, sizeof(mac_interface_phy::tb_action_ul_t));
+  if (ul_ctx.ul_grant_available || ul_ctx.ul_ack_available) {
+    srslte::tti_span trace("mac_grant_ul", ul_ctx.tti);
+    if (ul_ctx.ul_grant_available         && ul_ctx.ul_ack_available)  {    
+      phy->mac->new_grant_ul_ack(ul_ctx.ul_mac_grant, ul_ctx.ul_ack, &ul_action);      
+    } else if (ul_ctx.ul_grant_available  && !ul_ctx.ul_ack_available) {
+      phy->mac->new_grant_ul(ul_ctx.ul_mac_grant, &ul_action);
+    } else if (!ul_ctx.ul_grant_available && ul_ctx.ul_ack_available)  {    
+      phy->mac->harq_recv(ul_ctx.tti, ul_ctx.ul_ack, &ul_action);        
+    }
+  }
+  if (ul_stage_thread) {
+    ul_stage_thread->set_ul_grant_done();
+  }
+
+  if (ul_ctx.generate_ack) {
+    /* A PDSCH still being decoded when the deadline expires is NACKed */
+    if (ul_stage_thread && !ul_stage_thread->wait_dl_ack(ul_ctx.start_ns + 1000*phy->args->pipeline_ack_deadline_us)) {
+      Warning("PDSCH decoding missed the UL deadline, sending NACK\n");
+      set_uci_ack(false);
+    } else {
+      set_uci_ack(ul_ctx.dl_ack);
+    }
   }
 
   /* Set UL CFO before transmission */  
-  srslte_ue_ul_set_cfo(&ue_ul, cfo);
+  srslte_ue_ul_set_cfo(&ue_ul, ul_ctx.cfo);
 
   /* Transmit PUSCH, PUCCH or SRS */
   bool signal_ready = false; 
   if (ul_action.tx_enabled) {
+    srslte::tti_span trace("pusch_encode", ul_ctx.tti);
     encode_pusch(&ul_action.phy_grant.ul, ul_action.payload_ptr, ul_action.current_tx_nb, 
-                 ul_action.softbuffer, ul_action.rv, ul_action.rnti, ul_mac_grant.is_from_rar);          
+                 ul_action.softbuffer, ul_action.rv, ul_action.rnti, ul_ctx.ul_mac_grant.is_from_rar);          
     signal_ready = true; 
     if (ul_action.expect_ack) {
-      phy->set_pending_ack(tti + 8, ue_ul.pusch_cfg.grant.n_prb_tilde[0], ul_action.phy_grant.ul.ncs_dmrs);
+      phy->set_pending_ack(ul_ctx.tti + 8, ue_ul.pusch_cfg.grant.n_prb_tilde[0], ul_action.phy_grant.ul.ncs_dmrs);
     }
 
-  } else if (dl_action.generate_ack || uci_data.scheduling_request || uci_data.uci_cqi_len > 0) {
+  } else if (ul_ctx.generate_ack || uci_data.scheduling_request || uci_data.uci_cqi_len > 0) {
+    srslte::tti_span trace("pucch_encode", ul_ctx.tti);
     encode_pucch();
     signal_ready = true; 
-  } else if (srs_is_ready_to_send()) {
+  } else if (!ul_ctx.drx_sleep && srs_is_ready_to_send()) {
+    srslte::tti_span trace("srs_encode", ul_ctx.tti);
     encode_srs();
     signal_ready = true; 
   } 
 
-  tr_log_end();
-  
-  phy->worker_end(tx_tti, signal_ready, signal_buffer, SRSLTE_SF_LEN_PRB(cell.nof_prb), tx_time);
-  
-  if (dl_action.decode_enabled && !dl_action.generate_ack_callback) {
-    if (dl_mac_grant.rnti_type == SRSLTE_RNTI_PCH) {
-      phy->mac->pch_decoded_ok(dl_mac_grant.n_bytes);
-    } else {
-      phy->mac->tb_decoded(dl_ack, dl_mac_grant.rnti_type, dl_mac_grant.pid);
-    }
-  }
-
-  update_measurements();
-  
-  /* Tell the plotting thread to draw the plots */
-#ifdef ENABLE_GUI
-  if (get_id() == plot_worker_id) {
-    sem_post(&plot_sem);    
+  {
+    srslte::tti_span trace("worker_end", ul_ctx.tti);
+    phy->worker_end(ul_ctx.tx_tti, signal_ready, tx_buffer, SRSLTE_SF_LEN_PRB(cell.nof_prb), ul_ctx.tx_time);
   }
-#endif
 }
 
 
 bool phch_worker::extract_fft_and_pdcch_llr() {
   bool decode_pdcch = false; 
-  if (phy->get_ul_rnti(tti) || phy->get_dl_rnti(tti) || phy->get_pending_rar(tti)) {
+  if (get_ul_rnti() || get_dl_rnti() || phy->get_pending_rar(tti)) {
     decode_pdcch = true; 
   } 
   
   /* Without a grant, we might need to do fft processing if need to decode PHICH */
   if (phy->get_pending_ack(tti) || decode_pdcch) {
-    
-    // Setup estimator filter 
-    float w_coeff = phy->args->estimator_fil_w; 
-    if (w_coeff > 0.0) {
-      srslte_chest_dl_set_smooth_filter3_coeff(&ue_dl.chest, w_coeff); 
-    } else if (w_coeff == 0.0) {
-      srslte_chest_dl_set_smooth_filter(&ue_dl.chest, NULL, 0); 
-    }
-    
-    if (!phy->args->snr_estim_alg.compare("refs")) {
-      srslte_chest_dl_set_noise_alg(&ue_dl.chest, SRSLTE_NOISE_ALG_REFS);
-    } else if (!phy->args->snr_estim_alg.compare("empty")) {
-      srslte_chest_dl_set_noise_alg(&ue_dl.chest, SRSLTE_NOISE_ALG_EMPTY);
-    } else {
-      srslte_chest_dl_set_noise_alg(&ue_dl.chest, SRSLTE_NOISE_ALG_PSS);      
-    }
-  
+    srslte::tti_span trace("fft_chest", tti);
     if (srslte_ue_dl_decode_fft_estimate(&ue_dl, signal_buffer, tti%10, &cfi) < 0) {
       Error("Getting PDCCH FFT estimate\n");
       return false; 
@@ -323,11 +630,11 @@ bool phch_worker::extract_fft_and_pdcch_llr() {
   } else {
     chest_done = false; 
   }
-  if (chest_done && decode_pdcch) { /* and not in DRX mode */
+  if (chest_done && decode_pdcch) {
     
     float noise_estimate = phy->avg_noise;
     
-    if (!phy->args->equalizer_mode.compare("zf")) {
+    if (phy->equalizer_zf) {
       noise_estimate = 0; 
     }
 
@@ -338,6 +645,28 @@ bool phch_worker::extract_fft_and_pdcch_llr() {
   }
   return (decode_pdcch || phy->get_pending_ack(tti));
 }
+
+/* The C-RNTI is not searched while the MAC is in DRX sleep */
+uint16_t phch_worker::get_dl_rnti()
+{
+  if (drx_sleep && phy->get_dl_rnti_type() == SRSLTE_RNTI_USER) {
+    return 0; 
+  }
+  uint16_t rnti = phy->get_dl_rnti(tti);
+  /* Offline decoding searches its C-RNTI whenever no other RNTI is searched */
+  if (!rnti && phy->args->offline) {
+    rnti = phy->args->offline_rnti; 
+  }
+  return rnti; 
+}
+
+uint16_t phch_worker::get_ul_rnti()
+{
+  if (drx_sleep && phy->get_ul_rnti_type() == SRSLTE_RNTI_USER) {
+    return 0; 
+  }
+  return phy->get_ul_rnti(tti);
+}
   
 
 
@@ -354,10 +683,10 @@ bool phch_worker::decode_pdcch_dl(srsue::mac_interface_phy::mac_grant_t* grant)
   char timestr[64];
   timestr[0]='\0';
 
-  dl_rnti = phy->get_dl_rnti(tti); 
+  dl_rnti = get_dl_rnti(); 
   if (dl_rnti) {
     
-    srslte_rnti_type_t type = phy->get_dl_rnti_type();
+    srslte_rnti_type_t type = phy->get_dl_rnti(tti) ? phy->get_dl_rnti_type() : SRSLTE_RNTI_USER;
 
     srslte_dci_msg_t dci_msg; 
     srslte_ra_dl_dci_t dci_unpacked;
@@ -384,6 +713,7 @@ bool phch_worker::decode_pdcch_dl(srsue::mac_interface_phy::mac_grant_t* grant)
     grant->last_tti = 0;
     
     last_dl_pdcch_ncce = srslte_ue_dl_get_ncce(&ue_dl);
+    tti_metrics.rnti   = dl_rnti; 
 
     char hexstr[16];
     hexstr[0]='\0';
@@ -400,7 +730,7 @@ bool phch_worker::decode_pdcch_dl(srsue::mac_interface_phy::mac_grant_t* grant)
 }
 
 bool phch_worker::decode_pdsch(srslte_ra_dl_grant_t *grant, uint8_t *payload, 
-                               srslte_softbuffer_rx_t* softbuffer, int rv, uint16_t rnti, uint32_t harq_pid)
+                               srslte_softbuffer_rx_t* softbuffer, int rv, uint16_t rnti, uint32_t harq_pid, uint32_t tx_nb)
 {
   char timestr[64];
   timestr[0]='\0';
@@ -414,35 +744,55 @@ bool phch_worker::decode_pdsch(srslte_ra_dl_grant_t *grant, uint8_t *payload,
         
         float noise_estimate = srslte_chest_dl_get_noise_estimate(&ue_dl.chest);
         
-        if (!phy->args->equalizer_mode.compare("zf")) {
+        if (phy->equalizer_zf) {
           noise_estimate = 0; 
         }
         
-        /* Set decoder iterations */
+        uint64_t t_start      = srslte::get_time_ns();
+        uint32_t nof_decoders = pdsch_dec.get_nof_decoders(&ue_dl.pdsch_cfg, rnti);
+        
+        /* Set decoder iterations for this TB and, in pipelined mode, the time left to decode it */
+        uint32_t max_its = 0; 
         if (phy->args->pdsch_max_its > 0) {
-          srslte_sch_set_max_noi(&ue_dl.pdsch.dl_sch, phy->args->pdsch_max_its);
+          int32_t budget_us = turbo_its_policy::NO_DEADLINE; 
+          if (ul_stage_thread) {
+            budget_us = phy->args->pipeline_ack_deadline_us - (int32_t) ((t_start - tti_start_ns)/1000);
+          }
+          max_its = its_policy.get_max_its(phy->avg_snr_db, ue_dl.pdsch_cfg.grant.mcs.tbs, ue_dl.pdsch_cfg.nbits.nof_re, 
+                                           tx_nb, ue_dl.pdsch_cfg.cb_segm.C, nof_decoders, budget_us);
+          srslte_sch_set_max_noi(&ue_dl.pdsch.dl_sch, max_its);
+          pdsch_dec.set_max_noi(max_its);
         }
-
         
-  #ifdef LOG_EXECTIME
-        struct timeval t[3];
-        gettimeofday(&t[1], NULL);
-  #endif
         
-        bool ack = srslte_pdsch_decode_rnti(&ue_dl.pdsch, &ue_dl.pdsch_cfg, softbuffer, ue_dl.sf_symbols, 
-                                      ue_dl.ce, noise_estimate, rnti, payload) == 0;
+        /* Transport blocks with several code blocks are shared with the helpers, if any */
+        float n_iter; 
+        int   ret = pdsch_dec.decode(&ue_dl.pdsch_cfg, softbuffer, ue_dl.sf_symbols, 
+                                     ue_dl.ce, noise_estimate, rnti, payload);
+        if (ret == SRSLTE_ERROR_INVALID_INPUTS) {
+          ret    = srslte_pdsch_decode_rnti(&ue_dl.pdsch, &ue_dl.pdsch_cfg, softbuffer, ue_dl.sf_symbols, 
+                                            ue_dl.ce, noise_estimate, rnti, payload);
+          n_iter = srslte_pdsch_last_noi(&ue_dl.pdsch);
+        } else {
+          n_iter = pdsch_dec.last_noi();
+        }
+        bool ack = ret == SRSLTE_SUCCESS;
+        
+        uint32_t dec_time_us = (srslte::get_time_ns() - t_start)/1000;
+        phy->pdsch_dec_time.add(dec_time_us);
+        if (max_its > 0) {
+          its_policy.tb_decoded(ack, max_its, n_iter, ue_dl.pdsch_cfg.cb_segm.C, nof_decoders, dec_time_us);
+        }
   #ifdef LOG_EXECTIME
-        gettimeofday(&t[2], NULL);
-        get_time_interval(t);
-        snprintf(timestr, 64, ", dec_time=%4d us", (int) t[0].tv_usec);
+        snprintf(timestr, 64, ", dec_time=%4d us", dec_time_us);
   #endif
         
-        Info("PDSCH: l_crb=%2d, harq=%d, tbs=%d, mcs=%d, rv=%d, crc=%s, snr=%.1f dB, n_iter=%d%s\n", 
+        Info("PDSCH: l_crb=%2d, harq=%d, tbs=%d, mcs=%d, rv=%d, tx=%d, crc=%s, snr=%.1f dB, n_iter=%.1f/%d%s\n", 
               grant->nof_prb, harq_pid, 
-              grant->mcs.tbs/8, grant->mcs.idx, rv, 
+              grant->mcs.tbs/8, grant->mcs.idx, rv, tx_nb, 
               ack?"OK":"KO", 
               10*log10(srslte_chest_dl_get_snr(&ue_dl.chest)), 
-              srslte_pdsch_last_noi(&ue_dl.pdsch),
+              n_iter, max_its,
               timestr);
 
         //printf("tti=%d, cfo=%f\n", tti, cfo*15000);
@@ -450,6 +800,11 @@ bool phch_worker::decode_pdsch(srslte_ra_dl_grant_t *grant, uint8_t *payload,
         
         // Store metrics
         dl_metrics.mcs    = grant->mcs.idx;
+        last_turbo_iters  = n_iter;
+        tti_metrics.mcs   = grant->mcs.idx;
+        tti_metrics.tbs   = grant->mcs.tbs;
+        tti_metrics.crc   = ack;
+        tti_metrics.turbo_iters = n_iter;
         
         return ack; 
       } else {
@@ -511,7 +866,7 @@ bool phch_worker::decode_pdcch_ul(mac_interface_phy::mac_grant_t* grant)
     Debug("RAR grant found for TTI=%d\n", tti);
     ret = true;  
   } else {
-    ul_rnti = phy->get_ul_rnti(tti);
+    ul_rnti = get_ul_rnti();
     if (ul_rnti) {
       if (srslte_ue_dl_find_ul_dci(&ue_dl, cfi, tti%10, ul_rnti, &dci_msg) != 1) {
         return false; 
@@ -589,9 +944,8 @@ void phch_worker::set_uci_sr()
 {
   uci_data.scheduling_request = false; 
   if (phy->sr_enabled) {
-    uint32_t sr_tx_tti = (tti+4)%10240;
-    // Get I_sr parameter   
-    if (srslte_ue_ul_sr_send_tti(I_sr, sr_tx_tti)) {
+    uint32_t sr_tx_tti = (ul_ctx.tti+4)%10240;
+    if (phy->get_ul_plan(sr_tx_tti) & phch_common::UL_PLAN_SR) {
       Info("PUCCH: SR transmission at TTI=%d, I_sr=%d\n", sr_tx_tti, I_sr);
       uci_data.scheduling_request = true; 
       phy->sr_last_tx_tti = sr_tx_tti; 
@@ -605,8 +959,8 @@ void phch_worker::set_uci_periodic_cqi()
   int cqi_fixed     = phy->args->cqi_fixed;
   int cqi_max       = phy->args->cqi_max;
   
-  if (period_cqi.configured && rnti_is_set) {
-    if (srslte_cqi_send(period_cqi.pmi_idx, (tti+4)%10240)) {
+  if (rnti_is_set) {
+    if (phy->get_ul_plan((ul_ctx.tti+4)%10240) & phch_common::UL_PLAN_CQI) {
       srslte_cqi_value_t cqi_report;
       if (period_cqi.format_is_subband) {
         // TODO: Implement subband periodic reports
@@ -671,14 +1025,19 @@ void phch_worker::set_uci_aperiodic_cqi()
 }
 
 bool phch_worker::srs_is_ready_to_send() {
-  if (srs_cfg.configured) {
-    if (srslte_refsignal_srs_send_cs(srs_cfg.subframe_config, (tti+4)%10) == 1 && 
-        srslte_refsignal_srs_send_ue(srs_cfg.I_srs, (tti+4)%10240)        == 1)
-    {
-      return true; 
-    }
+  return phy->get_ul_plan((ul_ctx.tti+4)%10240) & phch_common::UL_PLAN_SRS; 
+}
+
+/* Estimator settings only change with the args, apply them once per UE DL object */
+void phch_worker::set_chest_params()
+{
+  float w_coeff = phy->args->estimator_fil_w; 
+  if (w_coeff > 0.0) {
+    srslte_chest_dl_set_smooth_filter3_coeff(&ue_dl.chest, w_coeff); 
+  } else if (w_coeff == 0.0) {
+    srslte_chest_dl_set_smooth_filter(&ue_dl.chest, NULL, 0); 
   }
-  return false; 
+  srslte_chest_dl_set_noise_alg(&ue_dl.chest, phy->noise_alg);
 }
 
 void phch_worker::set_tx_time(srslte_timestamp_t _tx_time)
@@ -692,7 +1051,7 @@ void phch_worker::encode_pusch(srslte_ra_ul_grant_t *grant, uint8_t *payload, ui
   char timestr[64];
   timestr[0]='\0';
   
-  if (srslte_ue_ul_cfg_grant(&ue_ul, grant, (tti+4)%10240, rv, current_tx_nb)) {
+  if (srslte_ue_ul_cfg_grant(&ue_ul, grant, (ul_ctx.tti+4)%10240, rv, current_tx_nb)) {
     Error("Configuring UL grant\n");
   }
   
@@ -700,7 +1059,7 @@ void phch_worker::encode_pusch(srslte_ra_ul_grant_t *grant, uint8_t *payload, ui
                                                 payload, uci_data, 
                                                 softbuffer,
                                                 rnti, 
-                                                signal_buffer)) 
+                                                tx_buffer)) 
   {
     Error("Encoding PUSCH\n");
   }
@@ -722,11 +1081,11 @@ void phch_worker::encode_pusch(srslte_ra_ul_grant_t *grant, uint8_t *payload, ui
 #endif
 
   Info("PUSCH: tti_tx=%d, n_prb=%d, rb_start=%d, tbs=%d, mod=%d, mcs=%d, rv_idx=%d, ack=%s, cfo=%.1f Hz%s\n", 
-         (tti+4)%10240,
+         (ul_ctx.tti+4)%10240,
          grant->L_prb, grant->n_prb[0], 
          grant->mcs.tbs/8, grant->mcs.mod, grant->mcs.idx, rv,
          uci_data.uci_ack_len>0?(uci_data.uci_ack?"1":"0"):"no",
-         cfo*15000, timestr);
+         ul_ctx.cfo*15000, timestr);
 
   // Store metrics
   ul_metrics.mcs   = grant->mcs.idx;
@@ -752,7 +1111,7 @@ void phch_worker::encode_pucch()
     gettimeofday(&t[1], NULL);
 #endif
 
-    if (srslte_ue_ul_pucch_encode(&ue_ul, uci_data, last_dl_pdcch_ncce, (tti+4)%10240, signal_buffer)) {
+    if (srslte_ue_ul_pucch_encode(&ue_ul, uci_data, ul_ctx.last_dl_pdcch_ncce, (ul_ctx.tti+4)%10240, tx_buffer)) {
       Error("Encoding PUCCH\n");
     }
 
@@ -768,9 +1127,9 @@ void phch_worker::encode_pucch()
   float gain = set_power(tx_power);  
   
   Info("PUCCH: power=%.2f dBm, tti_tx=%d, n_cce=%3d, ack=%s, sr=%s, cfo=%.1f Hz%s\n", 
-         tx_power, (tti+4)%10240, 
-         last_dl_pdcch_ncce, uci_data.uci_ack_len>0?(uci_data.uci_ack?"1":"0"):"no",uci_data.scheduling_request?"yes":"no", 
-         cfo*15000, timestr);        
+         tx_power, (ul_ctx.tti+4)%10240, 
+         ul_ctx.last_dl_pdcch_ncce, uci_data.uci_ack_len>0?(uci_data.uci_ack?"1":"0"):"no",uci_data.scheduling_request?"yes":"no", 
+         ul_ctx.cfo*15000, timestr);        
   }   
   
   if (uci_data.scheduling_request) {
@@ -783,7 +1142,7 @@ void phch_worker::encode_srs()
   char timestr[64];
   timestr[0]='\0';
   
-  if (srslte_ue_ul_srs_encode(&ue_ul, (tti+4)%10240, signal_buffer)) 
+  if (srslte_ue_ul_srs_encode(&ue_ul, (ul_ctx.tti+4)%10240, tx_buffer)) 
   {
     Error("Encoding SRS\n");
   }
@@ -796,9 +1155,9 @@ void phch_worker::encode_srs()
   
   float tx_power = srslte_ue_ul_srs_power(&ue_ul, phy->pathloss);  
   float gain = set_power(tx_power);
-  uint32_t fi = srslte_vec_max_fi((float*) signal_buffer, SRSLTE_SF_LEN_PRB(cell.nof_prb));
-  float *f = (float*) signal_buffer;
-  Info("SRS:   power=%.2f dBm, tti_tx=%d%s\n", tx_power, (tti+4)%10240, timestr);
+  uint32_t fi = srslte_vec_max_fi((float*) tx_buffer, SRSLTE_SF_LEN_PRB(cell.nof_prb));
+  float *f = (float*) tx_buffer;
+  Info("SRS:   power=%.2f dBm, tti_tx=%d%s\n", tx_power, (ul_ctx.tti+4)%10240, timestr);
   
 }
 
@@ -1042,9 +1401,13 @@ void phch_worker::update_measurements()
     dl_metrics.rssi   = rssi;
     dl_metrics.pathloss = phy->pathloss;
     dl_metrics.sinr   = phy->avg_snr_db;
-    dl_metrics.turbo_iters = srslte_pdsch_last_noi(&ue_dl.pdsch);
+    dl_metrics.turbo_iters = last_turbo_iters;
     phy->set_dl_metrics(dl_metrics);
     
+    tti_metrics.rsrp  = rsrp; 
+    tti_metrics.rsrq  = cur_rsrq; 
+    tti_metrics.snr   = 10*log10(srslte_chest_dl_get_snr(&ue_dl.chest));
+    
   }
 }
 
@@ -26,6 +26,7 @@
 
 #include <string>
 #include <sstream>
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 #include <pthread.h>
@@ -39,13 +40,10 @@
 #include "phy/phy.h"
 #include "phy/phch_worker.h"
 
-#define Error(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) log_h->error_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Warning(fmt, ...) if (SRSLTE_DEBUG_ENABLED) log_h->warning_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Info(fmt, ...)    if (SRSLTE_DEBUG_ENABLED) log_h->info_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define Debug(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) log_h->debug_line(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-
-
-
+#define Error(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, ERROR, error_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...) if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, WARNING, warning_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)    if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, INFO, info_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)   if (SRSLTE_DEBUG_ENABLED) SRSLTE_LOG(log_h, PHY, DEBUG, debug_line, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 using namespace std; 
 
 
@@ -66,6 +64,10 @@ void phy::set_default_args(phy_args_t *args)
   args->snr_ema_coeff       = 0.1; 
   args->snr_estim_alg       = "refs";
   args->pdsch_max_its       = 4; 
+  args->pdsch_its_adaptive  = false; 
+  args->pdsch_min_its       = 2; 
+  args->pdsch_boost_its     = 8; 
+  args->pdsch_last_tx       = 4; 
   args->attach_enable_64qam = false; 
   args->nof_phy_threads     = DEFAULT_WORKERS;
   args->equalizer_mode      = "mmse"; 
@@ -75,12 +77,46 @@ void phy::set_default_args(phy_args_t *args)
   args->sfo_correct_disable = false; 
   args->sss_algorithm       = "full"; 
   args->estimator_fil_w     = 0.1; 
+  args->atomic_handoff      = false; 
+  args->handoff_spin_us     = 50; 
+  args->worker_cpus         = ""; 
+  args->sync_cpu            = -1; 
+  args->pipelined           = false; 
+  args->pipeline_ack_deadline_us = 2000; 
+  args->pdsch_dec_helpers   = 0; 
+  args->offline             = false; 
+  args->offline_rnti        = 0; 
+  args->tti_metrics_filename = ""; 
 }
 
 bool phy::check_args(phy_args_t *args) 
 {
-  if (args->nof_phy_threads > 3) {
-    log_h->console("Error in PHY args: nof_phy_threads must be 1, 2 or 3\n");
+  // Zero means one worker per CPU 
+  if (args->nof_phy_threads == 0) {
+    args->nof_phy_threads = SRSLTE_MIN(SRSLTE_MAX(sysconf(_SC_NPROCESSORS_ONLN), 1), MAX_WORKERS);
+  }
+  if (args->nof_phy_threads < 1 || args->nof_phy_threads > MAX_WORKERS) {
+    log_h->console("Error in PHY args: nof_phy_threads must be between 1 and %d\n", MAX_WORKERS);
+    return false; 
+  }
+  if (args->offline && (args->offline_rnti < 1 || args->offline_rnti > 0xfff3)) {
+    log_h->console("Error in PHY args: offline decoding needs a C-RNTI between 0x1 and 0xfff3\n");
+    return false; 
+  }
+  if (args->pipeline_ack_deadline_us < 0) {
+    log_h->console("Error in PHY args: pipeline_ack_deadline_us must be non-negative\n");
+    return false; 
+  }
+  if (args->pdsch_its_adaptive && (args->pdsch_min_its < 1 || 
+                                   args->pdsch_min_its > args->pdsch_max_its || 
+                                   args->pdsch_boost_its < args->pdsch_max_its ||
+                                   args->pdsch_last_tx < 1)) 
+  {
+    log_h->console("Error in PHY args: adaptive turbo iterations need 1<=pdsch_min_its<=pdsch_max_its<=pdsch_boost_its and pdsch_last_tx>=1\n");
+    return false; 
+  }
+  if (args->pdsch_dec_helpers < 0 || args->pdsch_dec_helpers > (int) pdsch_decoder::MAX_HELPERS) {
+    log_h->console("Error in PHY args: pdsch_dec_helpers must be between 0 and %d\n", pdsch_decoder::MAX_HELPERS);
     return false; 
   }
   if (args->estimator_fil_w > 1.0) {
@@ -117,16 +153,59 @@ bool phy::init(srslte::radio* radio_handler_, mac_interface_phy *mac, rrc_interf
   
   nof_workers = args->nof_phy_threads; 
   
+  if (args->atomic_handoff) {
+    workers_pool.set_atomic_handoff(args->handoff_spin_us);
+  }
+  
+  // Workers are pinned round-robin to the CPUs in worker_cpus, if any
+  std::vector<int> cpus; 
+  std::istringstream cpu_list(args->worker_cpus);
+  std::string cpu; 
+  while (std::getline(cpu_list, cpu, ',')) {
+    if (!cpu.empty()) {
+      cpus.push_back(atoi(cpu.c_str()));
+    }
+  }
+  
   // Add workers to workers pool and start threads
   for (int i=0;i<nof_workers;i++) {
     workers[i].set_common(&workers_common);
-    workers_pool.init_worker(i, &workers[i], WORKERS_THREAD_PRIO);    
+    workers[i].set_name("phy_worker");
+    workers_pool.init_worker(i, &workers[i], WORKERS_THREAD_PRIO, cpus.empty() ? -1 : cpus[i%cpus.size()]);    
   }
   prach_buffer.init(&config.common.prach_cnfg, args, log_h);
   workers_common.init(&config, args, log_h, radio_handler, mac);
+  if (args->offline && args->tti_metrics_filename.length() > 0) {
+    if (!workers_common.open_tti_metrics(args->tti_metrics_filename)) {
+      stop_workers();
+      return false; 
+    }
+  }
+  
+  // UL stage threads take the CPUs in worker_cpus after the workers
+  if (args->pipelined) {
+    for (int i=0;i<nof_workers;i++) {
+      if (!workers[i].start_ul_thread(WORKERS_THREAD_PRIO, cpus.empty() ? -1 : cpus[(nof_workers+i)%cpus.size()])) {
+        log_h->console("Error starting PHY UL stage thread\n");
+        stop_workers();
+        return false; 
+      }
+    }
+  }
+  
+  // Decoder helpers are not pinned unless configured in [expert.threads]
+  if (args->pdsch_dec_helpers > 0) {
+    for (int i=0;i<nof_workers;i++) {
+      if (!workers[i].start_dec_helpers(args->pdsch_dec_helpers, WORKERS_THREAD_PRIO, -1)) {
+        log_h->console("Error starting PDSCH decoder helper threads\n");
+        stop_workers();
+        return false; 
+      }
+    }
+  }
   
   // Warning this must be initialized after all workers have been added to the pool
-  sf_recv.init(radio_handler, mac, rrc, &prach_buffer, &workers_pool, &workers_common, log_h, SF_RECV_THREAD_PRIO);
+  sf_recv.init(radio_handler, mac, rrc, &prach_buffer, &workers_pool, &workers_common, log_h, SF_RECV_THREAD_PRIO, args->sync_cpu);
 
   // Disable UL signal pregeneration until the attachment 
   enable_pregen_signals(false);
@@ -144,6 +223,7 @@ void phy::start_trace()
   for (int i=0;i<nof_workers;i++) {
     workers[i].start_trace();
   }
+  workers_pool.start_trace();
 }
 
 void phy::write_trace(std::string filename)
@@ -152,23 +232,46 @@ void phy::write_trace(std::string filename)
     string i_str = static_cast<ostringstream*>( &(ostringstream() << i) )->str();
     workers[i].write_trace(filename + "_" + i_str);
   }
+  workers_pool.write_trace(filename);
 }
 
 void phy::stop()
 {  
   sf_recv.stop();
+  stop_workers();
+}
+
+/* Stops the workers and whatever UL stage and decoder helper threads have been started */
+void phy::stop_workers()
+{
   workers_pool.stop();
+  for (int i=0;i<nof_workers;i++) {
+    workers[i].stop_ul_thread();
+    workers[i].stop_dec_helpers();
+  }
+  workers_common.close_tti_metrics();
 }
 
 void phy::get_metrics(phy_metrics_t &m) {
   workers_common.get_dl_metrics(m.dl);
   workers_common.get_ul_metrics(m.ul);
   workers_common.get_sync_metrics(m.sync);
+  workers_common.pdsch_dec_time.get_metrics(m.dl.pdsch_dec_time);
+  bzero(&m.dl.turbo_its, sizeof(turbo_its_metrics_t));
+  for (int i=0;i<nof_workers;i++) {
+    workers[i].get_turbo_its_metrics(m.dl.turbo_its);
+  }
   int dl_tbs = srslte_ra_tbs_from_idx(srslte_ra_tbs_idx_from_mcs(m.dl.mcs), workers_common.get_nof_prb());
   int ul_tbs = srslte_ra_tbs_from_idx(srslte_ra_tbs_idx_from_mcs(m.ul.mcs), workers_common.get_nof_prb());
   m.dl.mabr_mbps = dl_tbs/1000.0; // TBS is bits/ms - convert to mbps
   m.ul.mabr_mbps = ul_tbs/1000.0; // TBS is bits/ms - convert to mbps
   Info("PHY:   MABR estimates. DL: %4.6f Mbps. UL: %4.6f Mbps.\n", m.dl.mabr_mbps, m.ul.mabr_mbps);
+  Info("PHY:   PDSCH decoding time: mean %.0f us, p50 %.0f us, p99 %.0f us, max %.0f us.\n",
+       m.dl.pdsch_dec_time.mean_us, m.dl.pdsch_dec_time.p50_us,
+       m.dl.pdsch_dec_time.p99_us, m.dl.pdsch_dec_time.max_us);
+  Info("PHY:   Turbo iteration cap: %d hits (%d with reduced cap), %d reduced, %d raised, %d deadline limited.\n",
+       m.dl.turbo_its.cap_hits, m.dl.turbo_its.cap_hits_reduced, m.dl.turbo_its.reduced, 
+       m.dl.turbo_its.raised, m.dl.turbo_its.deadline_limited);
 }
 
 void phy::set_timeadv_rar(uint32_t ta_cmd) {
@@ -200,6 +303,7 @@ void phy::configure_prach_params()
 void phy::configure_ul_params(bool pregen_disabled)
 {
   Info("PHY:   Configuring UL parameters\n");
+  workers_common.build_ul_plan();
   for (int i=0;i<nof_workers;i++) {
     workers[i].set_ul_params(pregen_disabled);
   }
@@ -285,6 +389,11 @@ bool phy::status_is_sync()
   return sf_recv.status_is_sync();
 }
 
+bool phy::status_is_finished()
+{
+  return sf_recv.status_is_finished();
+}
+
 void phy::resync_sfn() {
   sf_recv.resync_sfn();
 }
@@ -0,0 +1,138 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#include <math.h>
+#include "phy/turbo_its_policy.h"
+
+namespace srsue {
+
+// Margins over the SNR the grant needs, see get_max_its()
+const float turbo_its_policy::HIGH_MARGIN_DB = 6.0;
+const float turbo_its_policy::NEAR_MARGIN_DB = 2.0;
+const float turbo_its_policy::LOW_MARGIN_DB  = -3.0;
+const float turbo_its_policy::TIME_EMA_COEFF = 0.1;
+
+turbo_its_policy::turbo_its_policy() : cap_hits(0), cap_hits_reduced(0), reduced(0), raised(0), deadline_limited(0)
+{
+  adaptive  = false;
+  max_its   = 4;
+  min_its   = 2;
+  boost_its = 8;
+  last_tx   = 4;
+  us_per_it = 0;
+}
+
+void turbo_its_policy::init(bool adaptive_, uint32_t max_its_, uint32_t min_its_, uint32_t boost_its_, uint32_t last_tx_)
+{
+  adaptive  = adaptive_;
+  max_its   = max_its_;
+  min_its   = min_its_;
+  boost_its = boost_its_;
+  last_tx   = last_tx_;
+  us_per_it = 0;
+}
+
+/* SNR at which a grant with this spectral efficiency is expected to decode,
+ * taking the PDSCH to reach 75% of the Shannon capacity */
+float turbo_its_policy::required_snr_db(uint32_t tbs, uint32_t nof_re)
+{
+  if (nof_re == 0) {
+    return 0;
+  }
+  float eff = (float) tbs/nof_re;
+  return 10*log10f(powf(2, eff/0.75) - 1);
+}
+
+uint32_t turbo_its_policy::get_max_its(float snr_db, uint32_t tbs, uint32_t nof_re, uint32_t tx_nb,
+                                       uint32_t nof_cb, uint32_t nof_decoders, int32_t budget_us)
+{
+  if (!adaptive) {
+    return max_its;
+  }
+
+  // Chase combining adds up the energy of all transmissions
+  float    margin = snr_db + 10*log10f(tx_nb + 1) - required_snr_db(tbs, nof_re);
+  uint32_t its    = max_its;
+  if (tx_nb + 1 >= last_tx) {
+    its = boost_its;
+  } else if (margin >= HIGH_MARGIN_DB) {
+    its = (max_its/2 > min_its) ? max_its/2 : min_its;
+  } else if (margin < LOW_MARGIN_DB) {
+    its = min_its;
+  } else if (margin < NEAR_MARGIN_DB) {
+    its = (max_its + 1 < boost_its) ? max_its + 1 : boost_its;
+  }
+
+  // Code blocks of one decoder run one after the other
+  if (budget_us != NO_DEADLINE && us_per_it > 0 && nof_cb > 0 && nof_decoders > 0) {
+    uint32_t serial_cbs = (nof_cb + nof_decoders - 1)/nof_decoders;
+    int32_t  fit        = (int32_t) (budget_us/(serial_cbs*us_per_it));
+    if (fit < (int32_t) its) {
+      its = (fit > 1) ? fit : 1;
+      deadline_limited++;
+    }
+  }
+
+  if (its < max_its) {
+    reduced++;
+  } else if (its > max_its) {
+    raised++;
+  }
+  return its;
+}
+
+void turbo_its_policy::tb_decoded(bool crc_ok, uint32_t its, float avg_its,
+                                  uint32_t nof_cb, uint32_t nof_decoders, uint32_t dec_time_us)
+{
+  // A code block failed with all its iterations spent
+  if (!crc_ok) {
+    cap_hits++;
+    if (its < max_its) {
+      cap_hits_reduced++;
+    }
+    return;
+  }
+  if (avg_its > 0 && nof_cb > 0 && nof_decoders > 0) {
+    float serial_its = ((nof_cb + nof_decoders - 1)/nof_decoders) * avg_its;
+    float sample     = dec_time_us/serial_its;
+    if (us_per_it == 0) {
+      us_per_it = sample;
+    } else {
+      us_per_it = (1 - TIME_EMA_COEFF)*us_per_it + TIME_EMA_COEFF*sample;
+    }
+  }
+}
+
+void turbo_its_policy::get_metrics(turbo_its_metrics_t &m)
+{
+  m.cap_hits         += cap_hits.exchange(0);
+  m.cap_hits_reduced += cap_hits_reduced.exchange(0);
+  m.reduced          += reduced.exchange(0);
+  m.raised           += raised.exchange(0);
+  m.deadline_limited += deadline_limited.exchange(0);
+}
+
+} // namespace srsue
@@ -0,0 +1,355 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "radio/channel_emulator.h"
+
+namespace srslte {
+
+typedef struct {
+  const char *name;
+  uint32_t    nof_paths;
+  float       delay_ns[9];
+  float       power_db[9];
+} fading_profile_t;
+
+static const fading_profile_t fading_profiles[] = {
+  {"epa", 7, {0, 30, 70, 90, 110, 190, 410},
+             {0.0, -1.0, -2.0, -3.0, -8.0, -17.2, -20.8}},
+  {"eva", 9, {0, 30, 150, 310, 370, 710, 1090, 1730, 2510},
+             {0.0, -1.5, -1.4, -3.6, -0.6, -9.1, -7.0, -12.0, -16.9}},
+  {"etu", 9, {0, 50, 120, 200, 230, 500, 1600, 2300, 5000},
+             {-1.0, -1.0, -1.0, 0.0, 0.0, 0.0, -3.0, -5.0, -7.0}},
+};
+
+channel_emulator::channel_emulator()
+{
+  args.enable      = false;
+  args.seed        = 0;
+  args.awgn_enable = false;
+  args.snr_db      = 0;
+  args.cfo_hz      = 0;
+  args.drift_ppm   = 0;
+  args.doppler_hz  = 0;
+  args.drop_rate   = 0;
+  args.drop_len_us = 0;
+  enabled      = false;
+  srate        = 0;
+  fading_time  = 0;
+  phase        = 0;
+  fifo_started = false;
+  pos          = 0;
+  step         = 1;
+  last_drop    = 0;
+  out_count    = 0;
+  drop_len     = 0;
+  nof_dropped  = 0;
+  avg_power    = 0;
+  bzero(&fifo_time, sizeof(srslte_timestamp_t));
+  bzero(noise_rand, sizeof(noise_rand));
+  bzero(drop_rand, sizeof(drop_rand));
+}
+
+bool channel_emulator::init(channel_emulator_args_t *args_)
+{
+  args    = *args_;
+  enabled = false;
+  paths.clear();
+
+  // Independent streams so that enabling an impairment does not change the others
+  unsigned short fading_rand[3];
+  for (uint32_t i=0;i<3;i++) {
+    noise_rand[i]  = (unsigned short) (args.seed >> (16*(i%2))) ^ 0x330e;
+    drop_rand[i]   = noise_rand[i] ^ 0x5a5a;
+    fading_rand[i] = noise_rand[i] ^ 0xa5a5;
+  }
+  drop_rand[2]   += 1;
+  fading_rand[2] += 2;
+
+  if (args.fading_model.length() > 0 && args.fading_model.compare("none")) {
+    const fading_profile_t *profile = NULL;
+    for (uint32_t i=0;i<sizeof(fading_profiles)/sizeof(fading_profile_t);i++) {
+      if (!args.fading_model.compare(fading_profiles[i].name)) {
+        profile = &fading_profiles[i];
+      }
+    }
+    if (!profile) {
+      fprintf(stderr, "Error unknown fading model %s. Options are none, epa, eva or etu\n", args.fading_model.c_str());
+      return false;
+    }
+    float total = 0;
+    for (uint32_t i=0;i<profile->nof_paths;i++) {
+      total += pow(10, profile->power_db[i]/10);
+    }
+    paths.resize(profile->nof_paths);
+    for (uint32_t i=0;i<profile->nof_paths;i++) {
+      path_t *p    = &paths[i];
+      p->delay_ns  = profile->delay_ns[i];
+      p->delay     = 0;
+      p->amplitude = sqrt(pow(10, profile->power_db[i]/10)/total);
+      for (uint32_t n=0;n<FADING_NOF_SINUSOIDS;n++) {
+        p->theta[n] = 2*M_PI*uniform(fading_rand) - M_PI;
+        p->phi_i[n] = 2*M_PI*uniform(fading_rand) - M_PI;
+        p->phi_q[n] = 2*M_PI*uniform(fading_rand) - M_PI;
+      }
+    }
+  }
+
+  enabled = args.enable;
+  if (enabled) {
+    printf("Channel emulator: seed %d, SNR %s%.1f dB, CFO %.1f Hz, clock drift %.2f ppm, fading %s at %.1f Hz, "
+           "%.2f drops/s of %.0f us\n", args.seed, args.awgn_enable?"":"off ", args.snr_db, args.cfo_hz,
+           args.drift_ppm, paths.size()?args.fading_model.c_str():"none", args.doppler_hz,
+           args.drop_rate, args.drop_len_us);
+  }
+  if (srate > 0) {
+    set_srate(srate);
+  }
+  return true;
+}
+
+bool channel_emulator::is_enabled()
+{
+  return enabled;
+}
+
+void channel_emulator::set_srate(double srate_)
+{
+  srate = srate_;
+
+  uint32_t max_delay = 0;
+  for (uint32_t i=0;i<paths.size();i++) {
+    paths[i].delay = (uint32_t) round(paths[i].delay_ns*1e-9*srate);
+    if (paths[i].delay > max_delay) {
+      max_delay = paths[i].delay;
+    }
+  }
+  history.assign(max_delay, 0);
+
+  // A zero ahead of the first input gives the interpolator its first sample
+  fifo.assign(1, 0);
+  fifo_started = false;
+  pos          = 1;
+  step         = 1/(1+args.drift_ppm*1e-6);
+
+  drops.clear();
+  last_drop = 0;
+  out_count = 0;
+  drop_len  = (uint32_t) round(args.drop_len_us*1e-6*srate);
+}
+
+uint64_t channel_emulator::get_nof_dropped()
+{
+  return nof_dropped;
+}
+
+double channel_emulator::uniform(unsigned short *state)
+{
+  return erand48(state);
+}
+
+/* Output sample count of the i-th drop from now */
+uint64_t channel_emulator::drop_at(uint32_t i)
+{
+  if (args.drop_rate <= 0 || drop_len == 0) {
+    return (uint64_t) -1;
+  }
+  while (drops.size() <= i) {
+    double interval = -log(1-uniform(drop_rand))*srate/args.drop_rate;
+    last_drop += 1 + (uint64_t) interval;
+    drops.push_back(last_drop);
+  }
+  return drops[i];
+}
+
+uint32_t channel_emulator::get_nof_input(uint32_t nof_samples)
+{
+  if (nof_samples == 0) {
+    return 0;
+  }
+  uint32_t nof_drops = 0;
+  while (drop_at(nof_drops) < out_count + nof_samples) {
+    nof_drops++;
+  }
+  double   last   = pos + (nof_samples-1)*step + (double) nof_drops*drop_len;
+  uint32_t needed = (uint32_t) floor(last) + 3;
+  return needed > fifo.size() ? needed - fifo.size() : 0;
+}
+
+cf_t* channel_emulator::get_input_buffer(uint32_t nof_input)
+{
+  in_buffer.resize(nof_input);
+  return in_buffer.size() ? &in_buffer[0] : NULL;
+}
+
+void channel_emulator::run(srslte_timestamp_t *in_time, cf_t *out, uint32_t nof_samples, srslte_timestamp_t *out_time)
+{
+  uint32_t nof_input = in_buffer.size();
+  if (nof_input > 0) {
+    multipath(&in_buffer[0], nof_input);
+    rotate(&in_buffer[0], nof_input);
+    if (!fifo_started) {
+      srslte_timestamp_copy(&fifo_time, in_time);
+      srslte_timestamp_sub(&fifo_time, 0, 1/srate);
+      fifo_started = true;
+    }
+    fifo.insert(fifo.end(), in_buffer.begin(), in_buffer.end());
+    in_buffer.clear();
+  }
+
+  if (out_time) {
+    srslte_timestamp_copy(out_time, &fifo_time);
+    srslte_timestamp_add(out_time, 0, pos/srate);
+  }
+  resample(out, nof_samples);
+  if (args.awgn_enable) {
+    add_noise(out, nof_samples);
+  }
+}
+
+/* Zheng and Xiao sum of sinusoids, E{|h|^2} is the path power */
+cf_t channel_emulator::fading_coeff(path_t *p, double t)
+{
+  double w  = 2*M_PI*args.doppler_hz*t;
+  double re = 0, im = 0;
+  for (uint32_t n=0;n<FADING_NOF_SINUSOIDS;n++) {
+    double alpha = (2*M_PI*(n+1) - M_PI + p->theta[n])/(4*FADING_NOF_SINUSOIDS);
+    re += cos(w*cos(alpha) + p->phi_i[n]);
+    im += sin(w*sin(alpha) + p->phi_q[n]);
+  }
+  float a = p->amplitude/sqrt(FADING_NOF_SINUSOIDS);
+  return a*re + _Complex_I*a*im;
+}
+
+void channel_emulator::multipath(cf_t *x, uint32_t n)
+{
+  if (paths.size() == 0) {
+    return;
+  }
+  uint32_t max_delay = history.size();
+  history.insert(history.end(), x, x+n);
+
+  cf_t h[9];
+  for (uint32_t i=0;i<n;i++) {
+    if (i%FADING_UPDATE_LEN == 0) {
+      for (uint32_t j=0;j<paths.size();j++) {
+        h[j] = fading_coeff(&paths[j], fading_time + i/srate);
+      }
+    }
+    cf_t y = 0;
+    for (uint32_t j=0;j<paths.size();j++) {
+      y += h[j]*history[max_delay + i - paths[j].delay];
+    }
+    x[i] = y;
+  }
+  fading_time += n/srate;
+
+  history.erase(history.begin(), history.end()-max_delay);
+}
+
+void channel_emulator::rotate(cf_t *x, uint32_t n)
+{
+  if (args.cfo_hz == 0) {
+    return;
+  }
+  double dphase = 2*M_PI*args.cfo_hz/srate;
+  cf_t   rot    = cexpf(_Complex_I*dphase);
+  // The phase is recomputed every block to avoid the accumulation of errors
+  for (uint32_t i=0;i<n;i+=FADING_UPDATE_LEN) {
+    uint32_t len = n-i < FADING_UPDATE_LEN ? n-i : FADING_UPDATE_LEN;
+    cf_t     c   = cexpf(_Complex_I*phase);
+    for (uint32_t j=i;j<i+len;j++) {
+      x[j] *= c;
+      c    *= rot;
+    }
+    phase = fmod(phase + len*dphase, 2*M_PI);
+  }
+}
+
+/* Cubic Lagrange interpolation at the output positions. Drops skip drop_len
+ * input samples before the output sample they are scheduled at */
+void channel_emulator::resample(cf_t *out, uint32_t n)
+{
+  double   pos0      = pos;
+  uint32_t nof_drops = 0;
+  for (uint32_t k=0;k<n;k++) {
+    while (drops.size() && drops.front() == out_count) {
+      drops.pop_front();
+      nof_drops++;
+      nof_dropped += drop_len;
+    }
+    double   p = pos0 + k*step + (double) nof_drops*drop_len;
+    uint32_t i = (uint32_t) floor(p);
+    if (i + 2 >= fifo.size()) {
+      out[k] = 0;
+    } else {
+      float x  = p - i;
+      float c0 = -x*(x-1)*(x-2)/6;
+      float c1 = (x+1)*(x-1)*(x-2)/2;
+      float c2 = -(x+1)*x*(x-2)/2;
+      float c3 = (x+1)*x*(x-1)/6;
+      out[k] = c0*fifo[i-1] + c1*fifo[i] + c2*fifo[i+1] + c3*fifo[i+2];
+    }
+    out_count++;
+  }
+  pos = pos0 + n*step + (double) nof_drops*drop_len;
+
+  // Keep one sample before the next position
+  uint32_t consumed = (uint32_t) floor(pos) - 1;
+  if (consumed > fifo.size()) {
+    consumed = fifo.size();
+  }
+  fifo.erase(fifo.begin(), fifo.begin()+consumed);
+  pos -= consumed;
+  srslte_timestamp_add(&fifo_time, 0, consumed/srate);
+}
+
+void channel_emulator::add_noise(cf_t *x, uint32_t n)
+{
+  if (n == 0) {
+    return;
+  }
+  double power = 0;
+  for (uint32_t i=0;i<n;i++) {
+    power += crealf(x[i])*crealf(x[i]) + cimagf(x[i])*cimagf(x[i]);
+  }
+  power /= n;
+  avg_power = avg_power == 0 ? power : 0.99*avg_power + 0.01*power;
+
+  // Box-Muller, one complex sample per pair of uniforms
+  float std_dev = sqrt(avg_power/pow(10, args.snr_db/10)/2);
+  for (uint32_t i=0;i<n;i++) {
+    double r = std_dev*sqrt(-2*log(1-uniform(noise_rand)));
+    double a = 2*M_PI*uniform(noise_rand);
+    x[i] += r*cos(a) + _Complex_I*r*sin(a);
+  }
+}
+
+} // namespace srslte
@@ -0,0 +1,414 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "radio/iq_file.h"
+
+namespace srslte {
+
+/*******************************************************************************
+  Recorder
+*******************************************************************************/
+
+iq_recorder::iq_recorder()
+{
+  f           = NULL;
+  running     = false;
+  ring        = NULL;
+  ring_size   = 0;
+  wpos        = 0;
+  rpos        = 0;
+  nof_dropped = 0;
+  rx_srate    = 0;
+  bzero(&next_rx_time, sizeof(srslte_timestamp_t));
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cvar, NULL);
+}
+
+bool iq_recorder::open(std::string filename, uint32_t ring_size_)
+{
+  if (f) {
+    close();
+  }
+  f = fopen(filename.c_str(), "w");
+  if (!f) {
+    fprintf(stderr, "Error opening IQ capture file %s\n", filename.c_str());
+    return false;
+  }
+  iq_file_header_t header;
+  bzero(&header, sizeof(iq_file_header_t));
+  memcpy(header.magic, IQ_FILE_MAGIC, sizeof(header.magic));
+  header.version       = IQ_FILE_VERSION;
+  header.sizeof_sample = sizeof(cf_t);
+  ring = (uint8_t*) malloc(ring_size_);
+  if (!ring || fwrite(&header, sizeof(iq_file_header_t), 1, f) != 1) {
+    fprintf(stderr, "Error initiating IQ capture file %s\n", filename.c_str());
+    free(ring);
+    ring = NULL;
+    fclose(f);
+    f = NULL;
+    return false;
+  }
+  ring_size   = ring_size_;
+  wpos        = 0;
+  rpos        = 0;
+  nof_dropped = 0;
+  rx_srate    = 0;
+  bzero(&next_rx_time, sizeof(srslte_timestamp_t));
+  running     = true;
+
+  set_name("iq_recorder");
+  start();
+  return true;
+}
+
+void iq_recorder::close()
+{
+  if (!f) {
+    return;
+  }
+  pthread_mutex_lock(&mutex);
+  running = false;
+  pthread_cond_signal(&cvar);
+  pthread_mutex_unlock(&mutex);
+  wait_thread_finish();
+
+  fclose(f);
+  f = NULL;
+  free(ring);
+  ring = NULL;
+  if (nof_dropped) {
+    printf("Warning: %d records did not fit the IQ capture ring and were dropped\n", nof_dropped);
+  }
+}
+
+bool iq_recorder::is_open()
+{
+  return f != NULL;
+}
+
+uint32_t iq_recorder::get_nof_dropped()
+{
+  return nof_dropped;
+}
+
+void iq_recorder::rx(cf_t* buffer, uint32_t nof_samples, srslte_timestamp_t* rx_time)
+{
+  push(IQ_FILE_RX, rx_time, 0, buffer, nof_samples);
+}
+
+void iq_recorder::tx(cf_t* buffer, uint32_t nof_samples, srslte_timestamp_t* tx_time, bool is_start_of_burst)
+{
+  push(IQ_FILE_TX, tx_time, is_start_of_burst?1:0, buffer, nof_samples);
+}
+
+void iq_recorder::tx_end(srslte_timestamp_t* end_time)
+{
+  push(IQ_FILE_TX_END, end_time, 0, NULL, 0);
+}
+
+void iq_recorder::set(iq_file_type_t type, double value)
+{
+  push(type, NULL, value, NULL, 0);
+}
+
+void iq_recorder::copy_to_ring(uint64_t pos, void* data, uint32_t len)
+{
+  uint32_t offset = pos%ring_size;
+  uint32_t first  = len < ring_size-offset ? len : ring_size-offset;
+  memcpy(&ring[offset], data, first);
+  memcpy(ring, &((uint8_t*) data)[first], len-first);
+}
+
+/* Records without a timestamp get the time of the next RX sample */
+void iq_recorder::push(iq_file_type_t type, srslte_timestamp_t* t, double value, cf_t* samples, uint32_t nof_samples)
+{
+  iq_file_record_t record;
+  uint32_t len = sizeof(iq_file_record_t) + nof_samples*sizeof(cf_t);
+
+  pthread_mutex_lock(&mutex);
+  if (!running) {
+    pthread_mutex_unlock(&mutex);
+    return;
+  }
+  if (!t) {
+    t = &next_rx_time;
+  }
+  record.type        = type;
+  record.nof_samples = nof_samples;
+  record.full_secs   = t->full_secs;
+  record.frac_secs   = t->frac_secs;
+  record.value       = value;
+
+  if (type == IQ_FILE_RX) {
+    srslte_timestamp_copy(&next_rx_time, t);
+    if (rx_srate > 0) {
+      srslte_timestamp_add(&next_rx_time, 0, nof_samples/rx_srate);
+    }
+  } else if (type == IQ_FILE_RX_SRATE) {
+    rx_srate = value;
+  }
+
+  if (wpos - rpos + len > ring_size) {
+    nof_dropped++;
+  } else {
+    copy_to_ring(wpos, &record, sizeof(iq_file_record_t));
+    if (nof_samples) {
+      copy_to_ring(wpos + sizeof(iq_file_record_t), samples, nof_samples*sizeof(cf_t));
+    }
+    wpos += len;
+    pthread_cond_signal(&cvar);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+/* Producers only write past wpos, so the pending part of the ring can be
+ * written to disk without holding the mutex */
+void iq_recorder::run_thread()
+{
+  pthread_mutex_lock(&mutex);
+  while (running || rpos < wpos) {
+    if (rpos == wpos) {
+      pthread_cond_wait(&cvar, &mutex);
+      continue;
+    }
+    uint32_t offset  = rpos%ring_size;
+    uint64_t pending = wpos - rpos;
+    uint32_t len     = pending < ring_size-offset ? pending : ring_size-offset;
+    pthread_mutex_unlock(&mutex);
+
+    if (fwrite(&ring[offset], 1, len, f) != len) {
+      fprintf(stderr, "Error writing IQ capture file\n");
+    }
+
+    pthread_mutex_lock(&mutex);
+    rpos += len;
+  }
+  pthread_mutex_unlock(&mutex);
+  fflush(f);
+}
+
+/*******************************************************************************
+  Player
+*******************************************************************************/
+
+iq_player::iq_player()
+{
+  f = NULL;
+  close();
+}
+
+bool iq_player::open(std::string filename_, bool realtime_)
+{
+  close();
+  f = fopen(filename_.c_str(), "r");
+  if (!f) {
+    fprintf(stderr, "Error opening IQ capture file %s\n", filename_.c_str());
+    return false;
+  }
+  iq_file_header_t header;
+  if (fread(&header, sizeof(iq_file_header_t), 1, f) != 1         ||
+      memcmp(header.magic, IQ_FILE_MAGIC, sizeof(header.magic))  ||
+      header.version != IQ_FILE_VERSION                           ||
+      header.sizeof_sample != sizeof(cf_t))
+  {
+    fprintf(stderr, "Error %s is not a version %d IQ capture\n", filename_.c_str(), IQ_FILE_VERSION);
+    fclose(f);
+    f = NULL;
+    return false;
+  }
+  filename = filename_;
+  realtime = realtime_;
+  return true;
+}
+
+void iq_player::close()
+{
+  if (f) {
+    fclose(f);
+  }
+  f           = NULL;
+  realtime    = false;
+  finished    = false;
+  rec_srate   = 0;
+  rec_pos     = 0;
+  rec_len     = 0;
+  nof_samples = 0;
+  nof_tx      = 0;
+  started     = false;
+  bzero(&rec_time, sizeof(srslte_timestamp_t));
+  bzero(values, sizeof(values));
+  bzero(mismatch_warned, sizeof(mismatch_warned));
+}
+
+bool iq_player::is_open()
+{
+  return f != NULL;
+}
+
+bool iq_player::is_finished()
+{
+  return finished;
+}
+
+uint64_t iq_player::get_nof_samples()
+{
+  return nof_samples;
+}
+
+/* Applies the settings that precede the next RX record and moves to it */
+bool iq_player::next_rx_record()
+{
+  iq_file_record_t record;
+  while (!finished && fread(&record, sizeof(iq_file_record_t), 1, f) == 1) {
+    if (record.type >= IQ_FILE_NOF_TYPES) {
+      fprintf(stderr, "Error invalid record type %d in IQ capture %s\n", record.type, filename.c_str());
+      break;
+    }
+    if (record.type == IQ_FILE_RX && record.nof_samples > 0) {
+      rec_time.full_secs = record.full_secs;
+      rec_time.frac_secs = record.frac_secs;
+      rec_srate          = values[IQ_FILE_RX_SRATE];
+      rec_pos            = 0;
+      rec_len            = record.nof_samples;
+      return true;
+    }
+    if (record.type >= IQ_FILE_RX_SRATE && record.type <= IQ_FILE_TX_GAIN) {
+      values[record.type] = record.value;
+    } else if (record.type == IQ_FILE_TX) {
+      nof_tx++;
+    }
+    if (record.nof_samples && fseek(f, (long) record.nof_samples*sizeof(cf_t), SEEK_CUR)) {
+      break;
+    }
+  }
+  if (!finished) {
+    finished = true;
+    printf("Replay of %s finished after %.1f Msamples and %d TX bursts\n",
+           filename.c_str(), (float) nof_samples/1e6, nof_tx);
+  }
+  return false;
+}
+
+void iq_player::time_at(uint32_t offset, srslte_timestamp_t* t)
+{
+  srslte_timestamp_copy(t, &rec_time);
+  if (rec_srate > 0) {
+    srslte_timestamp_add(t, 0, offset/rec_srate);
+  }
+}
+
+/* Waits until the wall clock time since the first rx_now() matches the capture */
+void iq_player::wait_realtime(srslte_timestamp_t* t)
+{
+  if (!started) {
+    srslte_timestamp_copy(&start_time, t);
+    clock_gettime(CLOCK_MONOTONIC, &start_wall);
+    started = true;
+    return;
+  }
+  double elapsed = (double) (t->full_secs - start_time.full_secs) + (t->frac_secs - start_time.frac_secs);
+  if (elapsed <= 0) {
+    return;
+  }
+  struct timespec deadline = start_wall;
+  deadline.tv_sec  += (time_t) elapsed;
+  deadline.tv_nsec += (long) ((elapsed - floor(elapsed))*1e9);
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)) {
+  }
+}
+
+bool iq_player::rx_now(cf_t* buffer, uint32_t nof_samples_, srslte_timestamp_t* rxd_time)
+{
+  if (!f) {
+    return false;
+  }
+  uint32_t n = 0;
+  while (n < nof_samples_) {
+    if (rec_pos == rec_len && !next_rx_record()) {
+      // Behave as a radio that stopped streaming
+      usleep(1000);
+      return false;
+    }
+    if (n == 0 && rxd_time) {
+      time_at(rec_pos, rxd_time);
+    }
+    uint32_t len = nof_samples_-n < rec_len-rec_pos ? nof_samples_-n : rec_len-rec_pos;
+    if (fread(&buffer[n], sizeof(cf_t), len, f) != len) {
+      rec_pos = rec_len;
+      next_rx_record();
+      return false;
+    }
+    rec_pos += len;
+    n       += len;
+  }
+  nof_samples += n;
+  // A radio returns once the last sample has been received
+  if (realtime) {
+    srslte_timestamp_t last;
+    time_at(rec_pos, &last);
+    wait_realtime(&last);
+  }
+  return true;
+}
+
+void iq_player::get_time(srslte_timestamp_t* now)
+{
+  time_at(rec_pos, now);
+}
+
+double iq_player::get(iq_file_type_t type)
+{
+  return values[type];
+}
+
+void iq_player::check(iq_file_type_t type, double value)
+{
+  if (!f) {
+    return;
+  }
+  // Settings made between two RX records are stored before the second one
+  if (rec_pos == rec_len) {
+    next_rx_record();
+  }
+  double recorded = values[type];
+  if (recorded != 0 && fabs(recorded - value) > 1 && !mismatch_warned[type]) {
+    printf("Warning: replaying with %s %.2f MHz but the capture used %.2f MHz\n",
+           iq_file_type_text[type], value/1e6, recorded/1e6);
+    mismatch_warned[type] = true;
+  }
+}
+
+} // namespace srslte
@@ -29,7 +29,9 @@ extern "C" {
 #include "srslte/rf/rf.h"
 }
 #include "radio/radio.h"
+#include "common/tti_tracer.h"
 #include <string.h>
+#include <sys/time.h>
 
 namespace srslte {
 
@@ -62,8 +64,94 @@ bool radio::init(char *args, char *devname)
   return true;    
 }
 
+bool radio::init_replay(std::string filename, bool realtime)
+{
+  if (!player.open(filename, realtime)) {
+    return false;
+  }
+  init_backend(RADIO_BACKEND_REPLAY);
+  printf("Replaying IQ capture %s%s\n", filename.c_str(), realtime?" in real time":"");
+  return true; 
+}
+
+bool radio::init_shm(std::string name, double srate, bool lockstep)
+{
+  if (!link.open(name, shm_link::ENDPOINT_UE, srate, lockstep)) {
+    return false;
+  }
+  init_backend(RADIO_BACKEND_SHM);
+  return true; 
+}
+
+void radio::init_null()
+{
+  init_backend(RADIO_BACKEND_NULL);
+}
+
+/* Backends without RF have no time advance nor burst preamble */
+void radio::init_backend(radio_backend_t backend_)
+{
+  backend = backend_; 
+  bzero(values, sizeof(values));
+  
+  tx_adv_negative = false; 
+  agc_enabled = false; 
+  burst_preamble_samples = 0; 
+  burst_preamble_time_rounded = 0; 
+  burst_preamble_sec = 0; 
+  cur_tx_srate = 0; 
+  is_start_of_burst = true; 
+  tx_adv_auto = false; 
+}
+
+bool radio::set_channel(channel_emulator_args_t *args)
+{
+  return channel.init(args);
+}
+
+bool radio::start_record(std::string filename)
+{
+  if (!recorder.open(filename)) {
+    return false;
+  }
+  printf("Recording IQ samples to %s\n", filename.c_str());
+  return true; 
+}
+
+void radio::stop_record()
+{
+  if (recorder.is_open()) {
+    recorder.close();
+    printf("Saved IQ capture\n");
+  }
+}
+
+const char* radio::device_name()
+{
+  switch(backend) {
+    case RADIO_BACKEND_REPLAY: return "file";
+    case RADIO_BACKEND_SHM:    return "shm";
+    case RADIO_BACKEND_NULL:   return "null";
+    default:                   return srslte_rf_name(&rf_device);
+  }
+}
+
+void radio::set_value(iq_file_type_t type, double value)
+{
+  if (recorder.is_open()) {
+    recorder.set(type, value);
+  }
+  values[type] = value; 
+  if (backend == RADIO_BACKEND_REPLAY && (type == IQ_FILE_RX_SRATE || type == IQ_FILE_RX_FREQ)) {
+    player.check(type, value);
+  }
+}
+
 void radio::set_manual_calibration(rf_cal_t* calibration)
 {
+  if (backend != RADIO_BACKEND_RF) {
+    return; 
+  }
   srslte_rf_cal_t tx_cal; 
   tx_cal.dc_gain  = calibration->tx_corr_dc_gain;
   tx_cal.dc_phase = calibration->tx_corr_dc_phase;
@@ -73,7 +161,9 @@ void radio::set_manual_calibration(rf_cal_t* calibration)
 }
 
 void radio::set_tx_rx_gain_offset(float offset) {
-  srslte_rf_set_tx_rx_gain_offset(&rf_device, offset);  
+  if (backend == RADIO_BACKEND_RF) {
+    srslte_rf_set_tx_rx_gain_offset(&rf_device, offset);  
+  }
 }
 
 void radio::set_burst_preamble(double preamble_us)
@@ -102,7 +192,7 @@ void radio::tx_offset(int offset_)
 
 bool radio::start_agc(bool tx_gain_same_rx)
 {
-  if (srslte_rf_start_gain_thread(&rf_device, tx_gain_same_rx)) {
+  if (backend == RADIO_BACKEND_RF && srslte_rf_start_gain_thread(&rf_device, tx_gain_same_rx)) {
     fprintf(stderr, "Error opening RF device\n");
     return false;
   }
@@ -119,16 +209,80 @@ bool radio::rx_at(void* buffer, uint32_t nof_samples, srslte_timestamp_t rx_time
 
 bool radio::rx_now(void* buffer, uint32_t nof_samples, srslte_timestamp_t* rxd_time)
 {
-  if (srslte_rf_recv_with_time(&rf_device, buffer, nof_samples, true, 
-    rxd_time?&rxd_time->full_secs:NULL, rxd_time?&rxd_time->frac_secs:NULL) > 0) {
-    return true; 
+  srslte_timestamp_t t; 
+  bool ret; 
+  if (channel.is_enabled()) {
+    // The device delivers more or less samples than the PHY reads when the clock drifts 
+    uint32_t n = channel.get_nof_input(nof_samples);
+    ret = n == 0 || rx_backend(channel.get_input_buffer(n), n, &t);
+    if (ret) {
+      channel.run(&t, (cf_t*) buffer, nof_samples, &t);
+    }
   } else {
-    return false; 
+    ret = rx_backend((cf_t*) buffer, nof_samples, &t);
+  }
+  if (ret && rxd_time) {
+    srslte_timestamp_copy(rxd_time, &t);
   }
+  return ret; 
+}
+
+/* Reads from the backend. Captures keep the samples before the channel emulator */
+bool radio::rx_backend(cf_t *buffer, uint32_t nof_samples, srslte_timestamp_t *rxd_time)
+{
+  srslte_timestamp_t t; 
+  bool ret; 
+  switch(backend) {
+    case RADIO_BACKEND_REPLAY:
+      ret = player.rx_now(buffer, nof_samples, &t);
+      break;
+    case RADIO_BACKEND_SHM:
+      ret = link.rx_now(buffer, nof_samples, &t);
+      break;
+    case RADIO_BACKEND_NULL:
+      bzero(buffer, nof_samples*sizeof(cf_t));
+      get_time(&t);
+      ret = true;
+      break;
+    default:
+      ret = srslte_rf_recv_with_time(&rf_device, buffer, nof_samples, true, &t.full_secs, &t.frac_secs) > 0;
+      break;
+  }
+  if (ret) {
+    if (recorder.is_open()) {
+      recorder.rx(buffer, nof_samples, &t);
+    }
+    if (rxd_time) {
+      srslte_timestamp_copy(rxd_time, &t);
+    }
+  }
+  return ret; 
+}
+
+bool radio::is_rx_finished()
+{
+  return backend == RADIO_BACKEND_REPLAY && player.is_finished();
 }
 
 void radio::get_time(srslte_timestamp_t *now) {
-  srslte_rf_get_time(&rf_device, &now->full_secs, &now->frac_secs);  
+  switch(backend) {
+    case RADIO_BACKEND_REPLAY:
+      player.get_time(now);
+      break;
+    case RADIO_BACKEND_SHM:
+      link.get_time(now);
+      break;
+    case RADIO_BACKEND_NULL: {
+      struct timeval tv;
+      gettimeofday(&tv, NULL);
+      now->full_secs = tv.tv_sec;
+      now->frac_secs = tv.tv_usec*1e-6;
+      break;
+    }
+    default:
+      srslte_rf_get_time(&rf_device, &now->full_secs, &now->frac_secs);  
+      break;
+  }
 }
 
 // TODO: Use Calibrated values for this 
@@ -141,7 +295,7 @@ float radio::set_tx_power(float power)
     power = -50; 
   }
   float gain = power + 74;
-  srslte_rf_set_tx_gain(&rf_device, gain);
+  set_tx_gain(gain);
   return gain; 
 }
 
@@ -152,16 +306,17 @@ float radio::get_max_tx_power()
 
 float radio::get_rssi()
 {
-  return srslte_rf_get_rssi(&rf_device);  
+  return backend != RADIO_BACKEND_RF?0:srslte_rf_get_rssi(&rf_device);  
 }
 
 bool radio::has_rssi()
 {
-  return srslte_rf_has_rssi(&rf_device);
+  return backend != RADIO_BACKEND_RF?false:srslte_rf_has_rssi(&rf_device);
 }
 
 bool radio::tx(void* buffer, uint32_t nof_samples, srslte_timestamp_t tx_time)
 {
+  srslte::tti_span trace("radio_tx", tti);
   if (!tx_adv_negative) {
     srslte_timestamp_sub(&tx_time, 0, tx_adv_sec);
   } else {
@@ -174,7 +329,12 @@ bool radio::tx(void* buffer, uint32_t nof_samples, srslte_timestamp_t tx_time)
       srslte_timestamp_copy(&tx_time_pad, &tx_time);
       srslte_timestamp_sub(&tx_time_pad, 0, burst_preamble_time_rounded); 
       save_trace(1, &tx_time_pad);
-      srslte_rf_send_timed2(&rf_device, zeros, burst_preamble_samples, tx_time_pad.full_secs, tx_time_pad.frac_secs, true, false);
+      if (recorder.is_open()) {
+        recorder.tx(zeros, burst_preamble_samples, &tx_time_pad, true);
+      }
+      if (backend == RADIO_BACKEND_RF) {
+        srslte_rf_send_timed2(&rf_device, zeros, burst_preamble_samples, tx_time_pad.full_secs, tx_time_pad.frac_secs, true, false);
+      }
       is_start_of_burst = false; 
     }        
   }
@@ -184,7 +344,15 @@ bool radio::tx(void* buffer, uint32_t nof_samples, srslte_timestamp_t tx_time)
   srslte_timestamp_add(&end_of_burst_time, 0, (double) nof_samples/cur_tx_srate); 
   
   save_trace(0, &tx_time);
-  int ret = srslte_rf_send_timed2(&rf_device, buffer, nof_samples+offset, tx_time.full_secs, tx_time.frac_secs, is_start_of_burst, false);
+  if (recorder.is_open()) {
+    recorder.tx((cf_t*) buffer, nof_samples+offset, &tx_time, is_start_of_burst);
+  }
+  int ret = nof_samples+offset; 
+  if (backend == RADIO_BACKEND_SHM) {
+    ret = link.tx((cf_t*) buffer, nof_samples+offset, &tx_time)?ret:0;
+  } else if (backend == RADIO_BACKEND_RF) {
+    ret = srslte_rf_send_timed2(&rf_device, buffer, nof_samples+offset, tx_time.full_secs, tx_time.frac_secs, is_start_of_burst, false);
+  }
   offset = 0; 
   is_start_of_burst = false; 
   if (ret > 0) {
@@ -208,11 +376,29 @@ void radio::tx_end()
 {
   if (!is_start_of_burst) {
     save_trace(2, &end_of_burst_time);
-    srslte_rf_send_timed2(&rf_device, zeros, 0, end_of_burst_time.full_secs, end_of_burst_time.frac_secs, false, true);
+    if (recorder.is_open()) {
+      recorder.tx_end(&end_of_burst_time);
+    }
+    if (backend == RADIO_BACKEND_RF) {
+      srslte_rf_send_timed2(&rf_device, zeros, 0, end_of_burst_time.full_secs, end_of_burst_time.frac_secs, false, true);
+    }
     is_start_of_burst = true; 
   }
 }
 
+void radio::tx_idle(srslte_timestamp_t tx_time, uint32_t nof_samples)
+{
+  if (backend == RADIO_BACKEND_SHM) {
+    // Same time advance than a transmission in this subframe 
+    if (!tx_adv_negative) {
+      srslte_timestamp_sub(&tx_time, 0, tx_adv_sec);
+    } else {
+      srslte_timestamp_add(&tx_time, 0, tx_adv_sec);
+    }
+    link.tx_idle(&tx_time, nof_samples);
+  }
+}
+
 void radio::start_trace() {
   trace_enabled = true; 
 }
@@ -233,7 +419,7 @@ void radio::save_trace(uint32_t is_eob, srslte_timestamp_t *tx_time) {
   if (trace_enabled) {
     tr_local_time.push_cur_time_us(tti);
     srslte_timestamp_t usrp_time; 
-    srslte_rf_get_time(&rf_device, &usrp_time.full_secs, &usrp_time.frac_secs);
+    get_time(&usrp_time);
     tr_usrp_time.push(tti, srslte_timestamp_uint32(&usrp_time));
     tr_tx_time.push(tti, srslte_timestamp_uint32(tx_time));
     tr_is_eob.push(tti, is_eob);
@@ -242,37 +428,54 @@ void radio::save_trace(uint32_t is_eob, srslte_timestamp_t *tx_time) {
 
 void radio::set_rx_freq(float freq)
 {
-  rx_freq = srslte_rf_set_rx_freq(&rf_device, freq);
+  rx_freq = backend != RADIO_BACKEND_RF?freq:srslte_rf_set_rx_freq(&rf_device, freq);
+  set_value(IQ_FILE_RX_FREQ, rx_freq);
 }
 
 void radio::set_rx_gain(float gain)
 {
-  srslte_rf_set_rx_gain(&rf_device, gain);
+  if (backend == RADIO_BACKEND_RF) {
+    srslte_rf_set_rx_gain(&rf_device, gain);
+  }
+  set_value(IQ_FILE_RX_GAIN, gain);
 }
 
 double radio::set_rx_gain_th(float gain)
 {
-  return srslte_rf_set_rx_gain_th(&rf_device, gain);
+  double ret = backend != RADIO_BACKEND_RF?gain:srslte_rf_set_rx_gain_th(&rf_device, gain);
+  set_value(IQ_FILE_RX_GAIN, ret);
+  return ret; 
 }
 
 void radio::set_master_clock_rate(float rate)
 {
-  srslte_rf_set_master_clock_rate(&rf_device, rate);
+  if (backend == RADIO_BACKEND_RF) {
+    srslte_rf_set_master_clock_rate(&rf_device, rate);
+  }
 }
 
 void radio::set_rx_srate(float srate)
 {
-  srslte_rf_set_rx_srate(&rf_device, srate);
+  double ret = backend != RADIO_BACKEND_RF?srate:srslte_rf_set_rx_srate(&rf_device, srate);
+  if (backend == RADIO_BACKEND_SHM) {
+    link.set_rx_srate(srate);
+  }
+  set_value(IQ_FILE_RX_SRATE, ret);
+  channel.set_srate(ret);
 }
 
 void radio::set_tx_freq(float freq)
 {
-  tx_freq = srslte_rf_set_tx_freq(&rf_device, freq);  
+  tx_freq = backend != RADIO_BACKEND_RF?freq:srslte_rf_set_tx_freq(&rf_device, freq);  
+  set_value(IQ_FILE_TX_FREQ, tx_freq);
 }
 
 void radio::set_tx_gain(float gain)
 {
-  srslte_rf_set_tx_gain(&rf_device, gain);
+  if (backend == RADIO_BACKEND_RF) {
+    srslte_rf_set_tx_gain(&rf_device, gain);
+  }
+  set_value(IQ_FILE_TX_GAIN, gain);
 }
 
 float radio::get_rx_freq()
@@ -287,17 +490,21 @@ float radio::get_tx_freq()
 
 float radio::get_tx_gain()
 {
-  return srslte_rf_get_tx_gain(&rf_device);
+  return backend != RADIO_BACKEND_RF?values[IQ_FILE_TX_GAIN]:srslte_rf_get_tx_gain(&rf_device);
 }
 
 float radio::get_rx_gain()
 {
-  return srslte_rf_get_rx_gain(&rf_device);
+  return backend != RADIO_BACKEND_RF?values[IQ_FILE_RX_GAIN]:srslte_rf_get_rx_gain(&rf_device);
 }
 
 void radio::set_tx_srate(float srate)
 {
-  cur_tx_srate = srslte_rf_set_tx_srate(&rf_device, srate);
+  cur_tx_srate = backend != RADIO_BACKEND_RF?srate:srslte_rf_set_tx_srate(&rf_device, srate);
+  if (backend == RADIO_BACKEND_SHM) {
+    link.set_tx_srate(srate);
+  }
+  set_value(IQ_FILE_TX_SRATE, cur_tx_srate);
   burst_preamble_samples = (uint32_t) (cur_tx_srate * burst_preamble_sec);
   if (burst_preamble_samples > burst_preamble_max_samples) {
     burst_preamble_samples = burst_preamble_max_samples;
@@ -312,7 +519,7 @@ void radio::set_tx_srate(float srate)
     
     /* This values have been calibrated using the prach_test_usrp tool in srsLTE */
   
-    if (!strcmp(srslte_rf_name(&rf_device), "uhd_b200")) {
+    if (!strcmp(device_name(), "uhd_b200")) {
       
       double srate_khz = round(cur_tx_srate/1e3);
       if (srate_khz == 1.92e3) {
@@ -332,7 +539,7 @@ void radio::set_tx_srate(float srate)
         printf("\nWarning TX/RX time offset for sampling rate %.0f KHz not calibrated. Using interpolated value\n\n", cur_tx_srate);
         nsamples = cur_tx_srate*(uhd_default_tx_adv_samples * (1/cur_tx_srate) + uhd_default_tx_adv_offset_sec);        
       }                
-    } else if (!strcmp(srslte_rf_name(&rf_device), "bladerf")) {
+    } else if (!strcmp(device_name(), "bladerf")) {
       
       double srate_khz = round(cur_tx_srate/1e3);
       if (srate_khz == 1.92e3) {
@@ -353,7 +560,7 @@ void radio::set_tx_srate(float srate)
         tx_adv_sec = blade_default_tx_adv_samples * (1/cur_tx_srate) + blade_default_tx_adv_offset_sec;        
       }
     } else {
-      printf("\nWarning TX/RX time offset has not been calibrated for device %s. Set a value manually\n\n", srslte_rf_name(&rf_device));
+      printf("\nWarning TX/RX time offset has not been calibrated for device %s. Set a value manually\n\n", device_name());
     }
   } else {
     nsamples = tx_adv_nsamples; 
@@ -368,17 +575,27 @@ void radio::set_tx_srate(float srate)
 
 void radio::start_rx()
 {
-  srslte_rf_start_rx_stream(&rf_device);
+  if (backend == RADIO_BACKEND_RF) {
+    srslte_rf_start_rx_stream(&rf_device);
+  }
+  set_value(IQ_FILE_START_RX, 0);
 }
 
 void radio::stop_rx()
 {
-  srslte_rf_stop_rx_stream(&rf_device);
+  if (backend == RADIO_BACKEND_RF) {
+    srslte_rf_stop_rx_stream(&rf_device);
+  } else if (backend == RADIO_BACKEND_SHM) {
+    link.stop_rx();
+  }
+  set_value(IQ_FILE_STOP_RX, 0);
 }
 
 void radio::register_error_handler(srslte_rf_error_handler_t h)
 {
-  srslte_rf_register_error_handler(&rf_device, h);
+  if (backend == RADIO_BACKEND_RF) {
+    srslte_rf_register_error_handler(&rf_device, h);
+  }
 }
 
   
@@ -0,0 +1,453 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "radio/shm_link.h"
+
+namespace srslte {
+
+static uint64_t mono_ns()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t) t.tv_sec*1000000000 + t.tv_nsec;
+}
+
+shm_link::shm_link()
+{
+  fd            = -1;
+  size          = 0;
+  hdr           = NULL;
+  rx_samples    = NULL;
+  tx_samples    = NULL;
+  rx_ring       = NULL;
+  tx_ring       = NULL;
+  endpoint      = ENDPOINT_UE;
+  streaming     = false;
+  rx_time       = 0;
+  last_tx       = 0;
+  tx_active     = false;
+  nof_overflows = 0;
+  tx_srate_ok   = true;
+  decim         = 1;
+  nof_history   = 0;
+}
+
+shm_link::~shm_link()
+{
+  close();
+}
+
+bool shm_link::open(std::string name_, endpoint_t endpoint_, double srate, bool lockstep)
+{
+  close();
+  name     = name_;
+  endpoint = endpoint_;
+
+  uint32_t ring_len = (uint32_t) (srate*RING_MS/1000);
+  bool     created  = false;
+  size = sizeof(shm_link_header_t) + 2*ring_len*sizeof(cf_t);
+
+  fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+  if (fd >= 0) {
+    created = true;
+    if (ftruncate(fd, size)) {
+      fprintf(stderr, "Error sizing shared memory link %s: %s\n", name.c_str(), strerror(errno));
+      ::close(fd);
+      shm_unlink(name.c_str());
+      fd = -1;
+      return false;
+    }
+  } else if (errno == EEXIST) {
+    fd = shm_open(name.c_str(), O_RDWR, 0);
+  }
+  if (fd < 0) {
+    fprintf(stderr, "Error opening shared memory link %s: %s\n", name.c_str(), strerror(errno));
+    return false;
+  }
+
+  // The creator may still be initialising the segment
+  struct stat st;
+  for (uint32_t i=0;i<1000 && (fstat(fd, &st) || (size_t) st.st_size < size);i++) {
+    usleep(1000);
+  }
+  if ((size_t) st.st_size != size) {
+    fprintf(stderr, "Error shared memory link %s has %ld bytes, expected %ld. Sampling rates differ?\n",
+            name.c_str(), (long) st.st_size, (long) size);
+    ::close(fd);
+    fd = -1;
+    return false;
+  }
+  hdr = (shm_link_header_t*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (hdr == MAP_FAILED) {
+    fprintf(stderr, "Error mapping shared memory link %s: %s\n", name.c_str(), strerror(errno));
+    hdr = NULL;
+    ::close(fd);
+    fd = -1;
+    return false;
+  }
+
+  if (created) {
+    pthread_mutexattr_t mattr;
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&hdr->mutex, &mattr);
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&hdr->cvar, &cattr);
+
+    hdr->version  = SHM_LINK_VERSION;
+    hdr->lockstep = lockstep?1:0;
+    hdr->srate    = srate;
+    hdr->ring_len = ring_len;
+    hdr->epoch_ns = mono_ns();
+    __sync_synchronize();
+    memcpy(hdr->magic, SHM_LINK_MAGIC, sizeof(hdr->magic));
+  } else {
+    for (uint32_t i=0;i<1000 && memcmp((void*) hdr->magic, SHM_LINK_MAGIC, sizeof(hdr->magic));i++) {
+      usleep(1000);
+    }
+    __sync_synchronize();
+    if (memcmp(hdr->magic, SHM_LINK_MAGIC, sizeof(hdr->magic)) || hdr->version != SHM_LINK_VERSION ||
+        hdr->srate != srate || hdr->lockstep != (lockstep?1:0))
+    {
+      fprintf(stderr, "Error shared memory link %s uses another version, sampling rate or clock\n", name.c_str());
+      munmap(hdr, size);
+      hdr = NULL;
+      ::close(fd);
+      fd = -1;
+      return false;
+    }
+  }
+
+  rx_samples = (cf_t*) &hdr[1] + endpoint*ring_len;
+  tx_samples = (cf_t*) &hdr[1] + (1-endpoint)*ring_len;
+  rx_ring    = &hdr->ring[endpoint];
+  tx_ring    = &hdr->ring[1-endpoint];
+
+  pthread_mutex_lock(&hdr->mutex);
+  if (hdr->attached[endpoint]) {
+    printf("Warning: shared memory link %s was not closed. Remove /dev/shm%s if the peer is not running\n",
+           name.c_str(), name.c_str());
+  }
+  hdr->attached[endpoint] = 1;
+  pthread_mutex_unlock(&hdr->mutex);
+
+  streaming   = false;
+  tx_active   = false;
+  tx_srate_ok = true;
+  set_rx_srate(srate);
+
+  printf("%s shared memory link %s as %s, %.2f MHz, %s clock\n", created?"Created":"Attached to",
+         name.c_str(), endpoint==ENDPOINT_UE?"UE":"eNB", srate/1e6, lockstep?"lockstep":"free running");
+  return true;
+}
+
+void shm_link::close()
+{
+  if (!hdr) {
+    return;
+  }
+  pthread_mutex_lock(&hdr->mutex);
+  hdr->attached[endpoint] = 0;
+  bool last = !hdr->attached[0] && !hdr->attached[1];
+  pthread_cond_broadcast(&hdr->cvar);
+  pthread_mutex_unlock(&hdr->mutex);
+
+  munmap(hdr, size);
+  ::close(fd);
+  if (last) {
+    shm_unlink(name.c_str());
+  }
+  hdr = NULL;
+  fd  = -1;
+}
+
+bool shm_link::is_open()
+{
+  return hdr != NULL;
+}
+
+bool shm_link::set_rx_srate(double srate)
+{
+  uint32_t d = (uint32_t) round(hdr->srate/srate);
+  if (d < 1 || fabs(d*srate - hdr->srate) > 1) {
+    fprintf(stderr, "Error RX sampling rate %.2f MHz is not a fraction of the link rate %.2f MHz\n",
+            srate/1e6, hdr->srate/1e6);
+    return false;
+  }
+  decim       = d;
+  nof_history = 0;
+  if (decim == 1) {
+    taps.clear();
+    return true;
+  }
+
+  // Windowed sinc low-pass with the cut-off at 90% of the output bandwidth
+  uint32_t ntaps = 16*decim+1;
+  float    fc    = 0.45/decim;
+  taps.resize(ntaps);
+  float sum = 0;
+  for (uint32_t i=0;i<ntaps;i++) {
+    float n = (float) i - (ntaps-1)/2;
+    taps[i] = (n == 0 ? 2*fc : sinf(2*M_PI*fc*n)/(M_PI*n)) * (0.54 - 0.46*cosf(2*M_PI*i/(ntaps-1)));
+    sum += taps[i];
+  }
+  for (uint32_t i=0;i<ntaps;i++) {
+    taps[i] /= sum;
+  }
+  return true;
+}
+
+bool shm_link::set_tx_srate(double srate)
+{
+  tx_srate_ok = fabs(srate - hdr->srate) < 1;
+  if (!tx_srate_ok) {
+    fprintf(stderr, "Error TX sampling rate %.2f MHz differs from the link rate %.2f MHz. Set the link rate to the cell one\n",
+            srate/1e6, hdr->srate/1e6);
+  }
+  return tx_srate_ok;
+}
+
+void shm_link::stop_rx()
+{
+  streaming = false;
+}
+
+uint64_t shm_link::now_samples()
+{
+  return (uint64_t) ((double) (mono_ns() - hdr->epoch_ns)*hdr->srate/1e9);
+}
+
+uint64_t shm_link::to_samples(srslte_timestamp_t* t)
+{
+  double s = round((double) t->full_secs*hdr->srate + t->frac_secs*hdr->srate);
+  return s > 0 ? (uint64_t) s : 0;
+}
+
+void shm_link::to_timestamp(uint64_t samples, srslte_timestamp_t* t)
+{
+  t->full_secs = (time_t) floor(samples/hdr->srate);
+  t->frac_secs = (samples - t->full_secs*hdr->srate)/hdr->srate;
+}
+
+void shm_link::declare(shm_link_ring_t* r, uint64_t end)
+{
+  if (end > r->write_time) {
+    r->write_time = end;
+    pthread_cond_broadcast(&hdr->cvar);
+  }
+}
+
+/* Called with the mutex locked. Returns with it locked */
+bool shm_link::wait_rx(uint64_t end)
+{
+  if (hdr->lockstep) {
+    uint64_t deadline = mono_ns() + (uint64_t) RX_TIMEOUT_MS*1000000;
+    struct timespec ts = {(time_t) (deadline/1000000000), (long) (deadline%1000000000)};
+    while (rx_ring->write_time < end) {
+      if (pthread_cond_timedwait(&hdr->cvar, &hdr->mutex, &ts) == ETIMEDOUT) {
+        return false;
+      }
+    }
+  } else {
+    uint64_t t = hdr->epoch_ns + (uint64_t) (end/hdr->srate*1e9);
+    struct timespec ts = {(time_t) (t/1000000000), (long) (t%1000000000)};
+    pthread_mutex_unlock(&hdr->mutex);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) {
+    }
+    pthread_mutex_lock(&hdr->mutex);
+  }
+  return true;
+}
+
+bool shm_link::rx_now(cf_t* buffer, uint32_t nof_samples, srslte_timestamp_t* rxd_time)
+{
+  if (!hdr) {
+    return false;
+  }
+  uint32_t ring_len = hdr->ring_len;
+  uint32_t ntaps    = taps.size();
+  uint64_t len      = (uint64_t) nof_samples*decim;
+  if (len > ring_len/2) {
+    fprintf(stderr, "Error receiving %d samples from shared memory link: ring too short\n", nof_samples);
+    return false;
+  }
+
+  pthread_mutex_lock(&hdr->mutex);
+  if (!streaming) {
+    uint64_t start = hdr->lockstep ? rx_ring->read_time : now_samples();
+    // Samples written while the stream was stopped are not received
+    for (uint64_t i=rx_ring->read_time;i<start && i<rx_ring->read_time+ring_len;i++) {
+      rx_samples[i%ring_len] = 0;
+    }
+    rx_ring->read_time = start;
+    rx_time            = start;
+    nof_history        = 0;
+    streaming          = true;
+  }
+
+  // An idle endpoint must not hold back the peer
+  if (hdr->lockstep && (!tx_active || rx_time >= last_tx + (uint64_t) hdr->srate*LOCKSTEP_IDLE_MS/1000)) {
+    declare(tx_ring, rx_time + len + (uint64_t) hdr->srate*LOCKSTEP_LEAD_MS/1000);
+  }
+
+  if (!wait_rx(rx_time + len)) {
+    pthread_mutex_unlock(&hdr->mutex);
+    return false;
+  }
+
+  if (!hdr->lockstep && now_samples() > rx_time + ring_len/2) {
+    // Too late to read the oldest samples. Skip to the newest ones
+    uint64_t start = now_samples() - len;
+    for (uint64_t i=rx_time;i<start && i<rx_time+ring_len;i++) {
+      rx_samples[i%ring_len] = 0;
+    }
+    rx_time = start;
+    nof_overflows++;
+  }
+
+  // Copy out and zero the consumed slots
+  if (decim > 1 && in_buffer.size() < ntaps-1+len) {
+    in_buffer.resize(ntaps-1+len);
+  }
+  cf_t    *out  = decim > 1 ? &in_buffer[ntaps-1] : buffer;
+  uint64_t done = 0;
+  while (done < len) {
+    uint32_t offset = (rx_time+done)%ring_len;
+    uint32_t n      = len-done < ring_len-offset ? len-done : ring_len-offset;
+    memcpy(&out[done], &rx_samples[offset], n*sizeof(cf_t));
+    bzero(&rx_samples[offset], n*sizeof(cf_t));
+    done += n;
+  }
+  uint64_t first = rx_time;
+  rx_time += len;
+  rx_ring->read_time = rx_time;
+  pthread_cond_broadcast(&hdr->cvar);
+  pthread_mutex_unlock(&hdr->mutex);
+
+  if (decim > 1) {
+    decimate(&in_buffer[0], len, buffer);
+    // Compensate the delay of the filter
+    first = first > (ntaps-1)/2 ? first - (ntaps-1)/2 : 0;
+  }
+  if (rxd_time) {
+    to_timestamp(first, rxd_time);
+  }
+  return true;
+}
+
+/* Filters nof_in new samples, which follow ntaps-1 samples of history in in */
+void shm_link::decimate(cf_t* in, uint32_t nof_in, cf_t* out)
+{
+  uint32_t ntaps = taps.size();
+  if (nof_history < ntaps-1) {
+    bzero(in, (ntaps-1)*sizeof(cf_t));
+  }
+  for (uint32_t j=0;j<nof_in/decim;j++) {
+    cf_t y = 0;
+    cf_t *x = &in[j*decim];
+    for (uint32_t k=0;k<ntaps;k++) {
+      y += taps[k]*x[k];
+    }
+    out[j] = y;
+  }
+  memmove(in, &in[nof_in], (ntaps-1)*sizeof(cf_t));
+  nof_history = ntaps-1;
+}
+
+bool shm_link::tx(cf_t* buffer, uint32_t nof_samples, srslte_timestamp_t* tx_time)
+{
+  if (!hdr || !tx_srate_ok) {
+    return false;
+  }
+  uint32_t ring_len = hdr->ring_len;
+  uint64_t start    = to_samples(tx_time);
+  uint64_t end      = start + nof_samples;
+
+  pthread_mutex_lock(&hdr->mutex);
+  uint64_t lo = start > tx_ring->read_time ? start : tx_ring->read_time;
+  uint64_t hi = end < tx_ring->read_time + ring_len ? end : tx_ring->read_time + ring_len;
+  for (uint64_t t=lo;t<hi;) {
+    uint32_t offset = t%ring_len;
+    uint32_t n      = hi-t < ring_len-offset ? hi-t : ring_len-offset;
+    memcpy(&tx_samples[offset], &buffer[t-start], n*sizeof(cf_t));
+    t += n;
+  }
+  tx_ring->nof_late += nof_samples - (hi > lo ? hi-lo : 0);
+  declare(tx_ring, end);
+  tx_active = true;
+  last_tx   = rx_time;
+  pthread_mutex_unlock(&hdr->mutex);
+  return true;
+}
+
+void shm_link::tx_idle(srslte_timestamp_t* time, uint32_t nof_samples)
+{
+  if (!hdr) {
+    return;
+  }
+  pthread_mutex_lock(&hdr->mutex);
+  declare(tx_ring, to_samples(time) + nof_samples);
+  tx_active = true;
+  last_tx   = rx_time;
+  pthread_mutex_unlock(&hdr->mutex);
+}
+
+void shm_link::get_time(srslte_timestamp_t* now)
+{
+  if (!hdr) {
+    bzero(now, sizeof(srslte_timestamp_t));
+  } else if (hdr->lockstep) {
+    to_timestamp(streaming ? rx_time : rx_ring->read_time, now);
+  } else {
+    to_timestamp(now_samples(), now);
+  }
+}
+
+uint64_t shm_link::get_nof_late()
+{
+  return hdr ? tx_ring->nof_late : 0;
+}
+
+uint32_t shm_link::get_nof_overflows()
+{
+  return nof_overflows;
+}
+
+} // namespace srslte
@@ -28,6 +28,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/thread/mutex.hpp>
 #include "ue.h"
+#include "common/tti_tracer.h"
 #include "srslte_version_check.h"
 #include "srslte/srslte.h"
 
@@ -76,17 +77,24 @@ ue::ue()
 ue::~ue()
 {
   buffer_pool::cleanup();
+  tti_tracer::cleanup();
 }
 
 bool ue::init(all_args_t *args_)
 {
   args     = args_;
 
+  pool->set_max_memory((uint64_t) args->expert.buffer_pool_max_mb*1024*1024);
+
   if (!check_srslte_version()) {
     return false; 
   }
   
-  logger.init(args->log.filename);
+  logger.set_max_queue_bytes(args->log.max_queue_mb*1024*1024,
+                             boost::iequals(args->log.drop_policy, "oldest") ? srslte::LOGGER_DROP_OLDEST
+                                                                             : srslte::LOGGER_DROP_NEWEST);
+  logger.set_rotation((uint64_t) args->log.max_file_mb*1024*1024, args->log.nof_files);
+  logger.init(args->log.filename, args->log.binary);
   rf_log.init("RF  ", &logger);
   phy_log.init("PHY ", &logger, true);
   mac_log.init("MAC ", &logger, true);
@@ -118,6 +126,19 @@ bool ue::init(all_args_t *args_)
   gw_log.set_hex_limit(args->log.gw_hex_limit);
   usim_log.set_hex_limit(args->log.usim_hex_limit);
 
+  // Offline decoding reads a capture and writes the decoded PDUs to the pcap
+  if (args->offline.enable) {
+    if (args->rf.replay_file.length() == 0) {
+      printf("Offline decoding needs an IQ capture in rf.replay_file\n");
+      return false;
+    }
+    args->pcap.enable = true;
+    args->expert.phy.offline              = true;
+    args->expert.phy.offline_rnti         = strtol(args->offline.rnti.c_str(), NULL, 0);
+    args->expert.phy.tti_metrics_filename = args->offline.metrics_file;
+    args->expert.phy.nof_phy_threads      = args->offline.nof_workers;
+  }
+
   // Set up pcap and trace
   if(args->pcap.enable)
   {
@@ -128,6 +149,7 @@ bool ue::init(all_args_t *args_)
   {
     phy.start_trace();
     radio.start_trace();
+    tti_tracer::get_instance()->start();
   }
   
   // Init layers
@@ -143,12 +165,27 @@ bool ue::init(all_args_t *args_)
     dev_args = (char*) args->rf.device_args.c_str();
   }
   
-  if(!radio.init(dev_args, dev_name))
+  if (args->rf.replay_file.length() > 0) {
+    if (!radio.init_replay(args->rf.replay_file, args->rf.replay_realtime && !args->offline.enable)) {
+      printf("Failed to open IQ capture %s\n", args->rf.replay_file.c_str());
+      return false;
+    }
+  } else if (args->rf.shm_name.length() > 0) {
+    if (!radio.init_shm(args->rf.shm_name, args->rf.shm_srate, args->rf.shm_lockstep)) {
+      printf("Failed to open shared memory link %s\n", args->rf.shm_name.c_str());
+      return false;
+    }
+  } else if(!radio.init(dev_args, dev_name))
   {
     printf("Failed to find device %s with args %s\n",
            args->rf.device_name.c_str(), args->rf.device_args.c_str());
     return false;
   }    
+  if (args->rf.record_file.length() > 0) {
+    if (!radio.start_record(args->rf.record_file)) {
+      return false;
+    }
+  }
   
   // Set RF options
   if (args->rf.time_adv_nsamples.compare("auto")) {
@@ -159,13 +196,18 @@ bool ue::init(all_args_t *args_)
   }
   
   radio.set_manual_calibration(&args->rf_cal);
+  if (!radio.set_channel(&args->channel)) {
+    return false;
+  }
 
   if (args->rf.tx_gain > 0) {
     args->expert.phy.ul_pwr_ctrl_en = false; 
   } else {
     args->expert.phy.ul_pwr_ctrl_en = true; 
   }
-  phy.init(&radio, &mac, &rrc, &phy_log, &args->expert.phy);
+  if (!phy.init(&radio, &mac, &rrc, &phy_log, &args->expert.phy)) {
+    return false;
+  }
   
   if (args->rf.rx_gain < 0) {
     radio.start_agc(false);    
@@ -197,6 +239,12 @@ bool ue::init(all_args_t *args_)
   nas.init(&usim, &rrc, &gw, &nas_log);
   gw.init(&pdcp, &rrc, this, &gw_log);
   usim.init(&args->usim, &usim_log);
+  
+  // Offline decoding neither attaches nor runs the random access procedure
+  if (args->offline.enable) {
+    mac.set_offline(true);
+    rrc.set_offline(true);
+  }
 
   started = true;
   return true;
@@ -223,6 +271,7 @@ void ue::stop()
     rlc.stop();
     mac.stop();
     phy.stop();
+    radio.stop_record();
  
     usleep(1e5);
     if(args->pcap.enable)
@@ -233,6 +282,8 @@ void ue::stop()
     {
       phy.write_trace(args->trace.phy_filename);
       radio.write_trace(args->trace.radio_filename);
+      tti_tracer::get_instance()->stop();
+      tti_tracer::get_instance()->write_json(args->trace.timeline_filename);
     }
     started = false;
   }
@@ -243,6 +294,11 @@ bool ue::is_attached()
   return (EMM_STATE_REGISTERED == nas.get_state());
 }
 
+bool ue::is_finished()
+{
+  return phy.status_is_finished();
+}
+
 void ue::start_plot() {
   phy.start_plot();
 }
@@ -290,7 +346,7 @@ void ue::handle_rf_msg(srslte_rf_error_t error)
     str.erase(std::remove(str.begin(), str.end(), '\n'), str.end());
     str.erase(std::remove(str.begin(), str.end(), '\r'), str.end());
     str.push_back('\n');
-    rf_log.info(str);
+    rf_log.info("%s", str.c_str());
   }
 }
 
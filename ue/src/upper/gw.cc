@@ -34,6 +34,13 @@
 #include <linux/if_tun.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+
+#define Error(fmt, ...)               SRSLTE_LOG(gw_log, GW, ERROR, error, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...)             SRSLTE_LOG(gw_log, GW, WARNING, warning, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)                SRSLTE_LOG(gw_log, GW, INFO, info, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)               SRSLTE_LOG(gw_log, GW, DEBUG, debug, fmt, ##__VA_ARGS__)
+#define Info_hex(hex, size, fmt, ...) SRSLTE_LOG(gw_log, GW, INFO, info_hex, hex, size, fmt, ##__VA_ARGS__)
 
 
 using namespace srslte;
@@ -80,8 +87,12 @@ void gw::get_metrics(gw_metrics_t &m)
   double secs = td.total_microseconds()/(double)1e6;
   m.dl_tput_mbps = (dl_tput_bytes*8/(double)1e6)/secs;
   m.ul_tput_mbps = (ul_tput_bytes*8/(double)1e6)/secs;
-  gw_log->info("RX throughput: %4.6f Mbps. TX throughput: %4.6f Mbps.\n",
-               m.dl_tput_mbps, m.ul_tput_mbps);
+  dl_mac_gw_latency.get_metrics(m.dl_mac_gw_latency);
+  Info("RX throughput: %4.6f Mbps. TX throughput: %4.6f Mbps.\n",
+       m.dl_tput_mbps, m.ul_tput_mbps);
+  Info("DL latency MAC-GW: mean %.0f us, p50 %.0f us, p99 %.0f us, max %.0f us.\n",
+       m.dl_mac_gw_latency.mean_us, m.dl_mac_gw_latency.p50_us,
+       m.dl_mac_gw_latency.p99_us, m.dl_mac_gw_latency.max_us);
   metrics_time = now;
   dl_tput_bytes = 0;
   ul_tput_bytes = 0;
@@ -92,17 +103,40 @@ void gw::get_metrics(gw_metrics_t &m)
 *******************************************************************************/
 void gw::write_pdu(uint32_t lcid, srslte::byte_buffer_t *pdu)
 {
-  gw_log->info_hex(pdu->msg, pdu->N_bytes, "RX PDU");
-  gw_log->info("RX PDU. Stack latency: %ld us\n", pdu->get_latency_us());
-  dl_tput_bytes += pdu->N_bytes;
+  uint32_t len = pdu->get_chain_bytes();
+  Info_hex(pdu->msg, pdu->N_bytes, "RX PDU (%d bytes)", len);
+  long latency_us = pdu->get_latency_us();
+  dl_mac_gw_latency.add(latency_us);
+  Info("RX PDU. Stack latency: %ld us\n", latency_us);
+  dl_tput_bytes += len;
   if(!if_up)
   {
-    gw_log->warning("TUN/TAP not up - dropping gw RX message\n");
+    Warning("TUN/TAP not up - dropping gw RX message\n");
   }else{
-    int n = write(tun_fd, pdu->msg, pdu->N_bytes); 
-    if(pdu->N_bytes != n)
+    // Gather the segments so each packet is a single TUN write
+    if(pdu->get_nof_segments() > GW_MAX_IOV)
+    {
+      byte_buffer_t *flat = pool->flatten(pdu);
+      if(!flat)
+      {
+        Warning("Dropping gw RX message: can't flatten %d bytes\n", len);
+        pool->deallocate(pdu);
+        return;
+      }
+      pdu = flat;
+    }
+    struct iovec iov[GW_MAX_IOV];
+    int nof_iov = 0;
+    for(byte_buffer_t *seg = pdu; seg; seg = seg->get_next())
+    {
+      iov[nof_iov].iov_base = seg->msg;
+      iov[nof_iov].iov_len  = seg->N_bytes;
+      nof_iov++;
+    }
+    int n = writev(tun_fd, iov, nof_iov);
+    if(len != n)
     {
-      gw_log->warning("DL TUN/TAP write failure\n");
+      Warning("DL TUN/TAP write failure\n");
     } 
   }
   pool->deallocate(pdu);
@@ -117,7 +151,7 @@ srslte::error_t gw::setup_if_addr(uint32_t ip_addr, char *err_str)
   {
       if(init_if(err_str))
       {
-        gw_log->error("init_if failed\n");
+        Error("init_if failed\n");
         return(ERROR_CANT_START);
       }
   }
@@ -129,7 +163,7 @@ srslte::error_t gw::setup_if_addr(uint32_t ip_addr, char *err_str)
   if(0 > ioctl(sock, SIOCSIFADDR, &ifr))
   {
       err_str = strerror(errno);
-      gw_log->debug("Failed to set socket address: %s\n", err_str);
+      Debug("Failed to set socket address: %s\n", err_str);
       close(tun_fd);
       return(ERROR_CANT_START);
   }
@@ -138,12 +172,13 @@ srslte::error_t gw::setup_if_addr(uint32_t ip_addr, char *err_str)
   if(0 > ioctl(sock, SIOCSIFNETMASK, &ifr))
   {
       err_str = strerror(errno);
-      gw_log->debug("Failed to set socket netmask: %s\n", err_str);
+      Debug("Failed to set socket netmask: %s\n", err_str);
       close(tun_fd);
       return(ERROR_CANT_START);
   }
 
   // Setup a thread to receive packets from the TUN device
+  set_name("gw");
   start(GW_THREAD_PRIO);
 
   return(ERROR_NONE);
@@ -160,11 +195,11 @@ srslte::error_t gw::init_if(char *err_str)
 
     // Construct the TUN device
     tun_fd = open("/dev/net/tun", O_RDWR);
-    gw_log->info("TUN file descriptor = %d\n", tun_fd);
+    Info("TUN file descriptor = %d\n", tun_fd);
     if(0 > tun_fd)
     {
         err_str = strerror(errno);
-        gw_log->debug("Failed to open TUN device: %s\n", err_str);
+        Debug("Failed to open TUN device: %s\n", err_str);
         return(ERROR_CANT_START);
     }
     memset(&ifr, 0, sizeof(ifr));
@@ -173,7 +208,7 @@ srslte::error_t gw::init_if(char *err_str)
     if(0 > ioctl(tun_fd, TUNSETIFF, &ifr))
     {
         err_str = strerror(errno);
-        gw_log->debug("Failed to set TUN device name: %s\n", err_str);
+        Debug("Failed to set TUN device name: %s\n", err_str);
         close(tun_fd);
         return(ERROR_CANT_START);
     }
@@ -183,7 +218,7 @@ srslte::error_t gw::init_if(char *err_str)
     if(0 > ioctl(sock, SIOCGIFFLAGS, &ifr))
     {
         err_str = strerror(errno);
-        gw_log->debug("Failed to bring up socket: %s\n", err_str);
+        Debug("Failed to bring up socket: %s\n", err_str);
         close(tun_fd);
         return(ERROR_CANT_START);
     }
@@ -191,7 +226,7 @@ srslte::error_t gw::init_if(char *err_str)
     if(0 > ioctl(sock, SIOCSIFFLAGS, &ifr))
     {
         err_str = strerror(errno);
-        gw_log->debug("Failed to set socket flags: %s\n", err_str);
+        Debug("Failed to set socket flags: %s\n", err_str);
         close(tun_fd);
         return(ERROR_CANT_START);
     }
@@ -209,21 +244,21 @@ void gw::run_thread()
     struct iphdr   *ip_pkt;
     uint32          idx = 0;
     int32           N_bytes;
-    byte_buffer_t  *pdu = pool->allocate();
+    byte_buffer_t  *pdu = pool->allocate(SRSUE_MTU_BUFFER_SIZE_BYTES);
 
-    gw_log->info("GW IP packet receiver thread running\n");
+    Info("GW IP packet receiver thread running\n");
 
     while(running)
     {
       if (pdu) {
-        if (SRSUE_MAX_BUFFER_SIZE_BYTES-SRSUE_BUFFER_HEADER_OFFSET > idx) {
-          N_bytes = read(tun_fd, &pdu->msg[idx], SRSUE_MAX_BUFFER_SIZE_BYTES-SRSUE_BUFFER_HEADER_OFFSET - idx);
+        if (pdu->get_tailroom() > 0) {
+          N_bytes = read(tun_fd, &pdu->msg[idx], pdu->get_tailroom());
         } else {
-          gw_log->error("GW pdu buffer full - gw receive thread exiting.\n");
+          Error("GW pdu buffer full - gw receive thread exiting.\n");
           gw_log->console("GW pdu buffer full - gw receive thread exiting.\n");
           break; 
         }
-        gw_log->debug("Read %d bytes from TUN fd=%d, idx=%d\n", N_bytes, tun_fd, idx);
+        Debug("Read %d bytes from TUN fd=%d, idx=%d\n", N_bytes, tun_fd, idx);
         if(N_bytes > 0)
         {
           pdu->N_bytes = idx + N_bytes;
@@ -234,7 +269,7 @@ void gw::run_thread()
             // Check if entire packet was received
             if(ntohs(ip_pkt->tot_len) == pdu->N_bytes)
             {
-              gw_log->info_hex(pdu->msg, pdu->N_bytes, "TX PDU");
+              Info_hex(pdu->msg, pdu->N_bytes, "TX PDU");
 
               while(running && (!rrc->rrc_connected() || !rrc->have_drb())) {
                 rrc->rrc_connect();
@@ -246,29 +281,36 @@ void gw::run_thread()
               }
               
               // Send PDU directly to PDCP
-              pdu->timestamp = bpt::microsec_clock::local_time();
+              pdu->set_timestamp();
               ul_tput_bytes += pdu->N_bytes;
               pdcp->write_sdu(RB_ID_DRB1, pdu);
               
-              pdu = pool->allocate();
+              pdu = pool->allocate(SRSUE_MTU_BUFFER_SIZE_BYTES);
               idx = 0;
             }else{
+              // Packets larger than the MTU class are read into a larger buffer
               idx += N_bytes;
+              if (ntohs(ip_pkt->tot_len) > pdu->N_bytes + pdu->get_tailroom()) {
+                byte_buffer_t *tmp = pool->resize(pdu, ntohs(ip_pkt->tot_len));
+                if (tmp) {
+                  pdu = tmp;
+                }
+              }
             }            
           } 
         }else{
-          gw_log->error("Failed to read from TUN interface - gw receive thread exiting.\n");
+          Error("Failed to read from TUN interface - gw receive thread exiting.\n");
           gw_log->console("Failed to read from TUN interface - gw receive thread exiting.\n");
           break;
         }
       } else {
-        gw_log->error("Could not allocate a PDU\n");
+        Error("Could not allocate a PDU\n");
         gw_log->console("GW could not allocate a PDU\n");
         break;        
       }
     }
 
-    gw_log->info("GW IP receiver thread exiting.\n");
+    Info("GW IP receiver thread exiting.\n");
 }
 
 } // namespace srsue
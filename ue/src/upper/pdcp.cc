@@ -27,6 +27,10 @@
 
 #include "upper/pdcp.h"
 
+#define Error(fmt, ...)   SRSLTE_LOG(pdcp_log, PDCP, ERROR, error, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...) SRSLTE_LOG(pdcp_log, PDCP, WARNING, warning, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)    SRSLTE_LOG(pdcp_log, PDCP, INFO, info, fmt, ##__VA_ARGS__)
+
 using namespace srslte;
 
 namespace srsue{
@@ -68,14 +72,14 @@ void pdcp::write_sdu(uint32_t lcid, byte_buffer_t *sdu)
 void pdcp::add_bearer(uint32_t lcid, LIBLTE_RRC_PDCP_CONFIG_STRUCT *cnfg)
 {
   if(lcid < 0 || lcid >= SRSUE_N_RADIO_BEARERS) {
-    pdcp_log->error("Radio bearer id must be in [0:%d] - %d\n", SRSUE_N_RADIO_BEARERS, lcid);
+    Error("Radio bearer id must be in [0:%d] - %d\n", SRSUE_N_RADIO_BEARERS, lcid);
     return;
   }
   if (!pdcp_array[lcid].is_active()) {
     pdcp_array[lcid].init(rlc, rrc, gw, pdcp_log, lcid, cnfg);
-    pdcp_log->info("Added bearer %s\n", rb_id_text[lcid]);
+    Info("Added bearer %s\n", rb_id_text[lcid]);
   } else {
-    pdcp_log->warning("Bearer %s already configured. Reconfiguration not supported\n", rb_id_text[lcid]);
+    Warning("Bearer %s already configured. Reconfiguration not supported\n", rb_id_text[lcid]);
   }
 }
 
@@ -118,11 +122,11 @@ void pdcp::write_pdu_pcch(byte_buffer_t *sdu)
 bool pdcp::valid_lcid(uint32_t lcid)
 {
   if(lcid < 0 || lcid >= SRSUE_N_RADIO_BEARERS) {
-    pdcp_log->error("Radio bearer id must be in [0:%d] - %d", SRSUE_N_RADIO_BEARERS, lcid);
+    Error("Radio bearer id must be in [0:%d] - %d", SRSUE_N_RADIO_BEARERS, lcid);
     return false;
   }
   if(!pdcp_array[lcid].is_active()) {
-    pdcp_log->error("PDCP entity for logical channel %d has not been activated\n", lcid);
+    Error("PDCP entity for logical channel %d has not been activated\n", lcid);
     return false;
   }
   return true;
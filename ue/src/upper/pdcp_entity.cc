@@ -28,6 +28,10 @@
 #include "upper/pdcp_entity.h"
 #include "common/security.h"
 
+#define Error(fmt, ...)               SRSLTE_LOG(log, PDCP, ERROR, error, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)               SRSLTE_LOG(log, PDCP, DEBUG, debug, fmt, ##__VA_ARGS__)
+#define Info_hex(hex, size, fmt, ...) SRSLTE_LOG(log, PDCP, INFO, info_hex, hex, size, fmt, ##__VA_ARGS__)
+
 using namespace srslte;
 
 namespace srsue{
@@ -69,14 +73,14 @@ void pdcp_entity::init(rlc_interface_pdcp            *rlc_,
     }
     // TODO: handle remainder of cnfg
   }
-  log->debug("Init %s\n", rb_id_text[lcid]);
+  Debug("Init %s\n", rb_id_text[lcid]);
 }
 
 void pdcp_entity::reset()
 {
   active      = false;
   if(log)
-    log->debug("Reset %s\n", rb_id_text[lcid]);
+    Debug("Reset %s\n", rb_id_text[lcid]);
 }
 
 bool pdcp_entity::is_active()
@@ -87,7 +91,7 @@ bool pdcp_entity::is_active()
 // RRC interface
 void pdcp_entity::write_sdu(byte_buffer_t *sdu)
 {
-  log->info_hex(sdu->msg, sdu->N_bytes, "TX %s SDU, do_security = %s", rb_id_text[lcid], (do_security)?"true":"false");
+  Info_hex(sdu->msg, sdu->N_bytes, "TX %s SDU, do_security = %s", rb_id_text[lcid], (do_security)?"true":"false");
 
   // Handle SRB messages
   switch(lcid)
@@ -145,21 +149,37 @@ void pdcp_entity::config_security(uint8_t *k_rrc_enc_,
 // RLC interface
 void pdcp_entity::write_pdu(byte_buffer_t *pdu)
 {
+  // RLC delivers SDUs as segment chains. RRC needs contiguous messages and
+  // the DRB header must fit in the first segment, otherwise flatten.
+  uint32_t hdr_len = (12 == sn_len) ? 2 : 1;
+  if(lcid < RB_ID_DRB1 || pdu->N_bytes < hdr_len)
+  {
+    byte_buffer_t *flat = pool->flatten(pdu);
+    if(!flat)
+    {
+      Error("Dropping %s PDU: can't flatten %d bytes\n",
+            rb_id_text[lcid], pdu->get_chain_bytes());
+      pool->deallocate(pdu);
+      return;
+    }
+    pdu = flat;
+  }
+
   // Handle SRB messages
   switch(lcid)
   {
   case RB_ID_SRB0:
     // Simply pass on to RRC
-    log->info_hex(pdu->msg, pdu->N_bytes, "RX %s PDU", rb_id_text[lcid]);
+    Info_hex(pdu->msg, pdu->N_bytes, "RX %s PDU", rb_id_text[lcid]);
     rrc->write_pdu(RB_ID_SRB0, pdu);
     break;
   case RB_ID_SRB1: // Intentional fall-through
   case RB_ID_SRB2:
     uint32_t sn;
-    log->info_hex(pdu->msg, pdu->N_bytes, "RX %s PDU", rb_id_text[lcid]);
+    Info_hex(pdu->msg, pdu->N_bytes, "RX %s PDU", rb_id_text[lcid]);
     pdcp_unpack_control_pdu(pdu, &sn);
-    log->info_hex(pdu->msg, pdu->N_bytes, "RX %s SDU SN: %d",
-                  rb_id_text[lcid], sn);
+    Info_hex(pdu->msg, pdu->N_bytes, "RX %s SDU SN: %d",
+             rb_id_text[lcid], sn);
     rrc->write_pdu(lcid, pdu);
     break;
   }
@@ -174,7 +194,7 @@ void pdcp_entity::write_pdu(byte_buffer_t *pdu)
     } else {
       pdcp_unpack_data_pdu_short_sn(pdu, &sn);
     }
-    log->info_hex(pdu->msg, pdu->N_bytes, "RX %s PDU: %d", rb_id_text[lcid], sn);
+    Info_hex(pdu->msg, pdu->N_bytes, "RX %s PDU: %d", rb_id_text[lcid], sn);
     gw->write_pdu(lcid, pdu);
   }
 }
@@ -30,6 +30,11 @@
 #include "upper/rlc_um.h"
 #include "upper/rlc_am.h"
 
+#define Error(fmt, ...)               SRSLTE_LOG(rlc_log, RLC, ERROR, error, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...)             SRSLTE_LOG(rlc_log, RLC, WARNING, warning, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)                SRSLTE_LOG(rlc_log, RLC, INFO, info, fmt, ##__VA_ARGS__)
+#define Info_hex(hex, size, fmt, ...) SRSLTE_LOG(rlc_log, RLC, INFO, info_hex, hex, size, fmt, ##__VA_ARGS__)
+
 using namespace srslte;
 
 namespace srsue{
@@ -61,6 +66,8 @@ void rlc::reset_metrics()
 {
   bzero(dl_tput_bytes, sizeof(long)*SRSUE_N_RADIO_BEARERS);
   bzero(ul_tput_bytes, sizeof(long)*SRSUE_N_RADIO_BEARERS);
+  ul_gw_rlc_latency.reset();
+  ul_rlc_mac_latency.reset();
 }
 
 void rlc::stop()
@@ -80,13 +87,19 @@ void rlc::get_metrics(rlc_metrics_t &m)
     m.dl_tput_mbps += (dl_tput_bytes[i]*8/(double)1e6)/secs;
     m.ul_tput_mbps += (ul_tput_bytes[i]*8/(double)1e6)/secs;    
     if(rlc_array[i].active()) {
-      rlc_log->info("LCID=%d, TX throughput: %4.6f Mbps. RX throughput: %4.6f Mbps.\n",
-                    i,
-                    (dl_tput_bytes[i]*8/(double)1e6)/secs,
-                    (ul_tput_bytes[i]*8/(double)1e6)/secs);
+      Info("LCID=%d, TX throughput: %4.6f Mbps. RX throughput: %4.6f Mbps.\n",
+           i,
+           (dl_tput_bytes[i]*8/(double)1e6)/secs,
+           (ul_tput_bytes[i]*8/(double)1e6)/secs);
     }
   }
 
+  ul_gw_rlc_latency.get_metrics(m.ul_gw_rlc_latency);
+  ul_rlc_mac_latency.get_metrics(m.ul_rlc_mac_latency);
+  Info("UL latency GW-RLC: mean %.0f us, p99 %.0f us. RLC-MAC: mean %.0f us, p99 %.0f us.\n",
+       m.ul_gw_rlc_latency.mean_us, m.ul_gw_rlc_latency.p99_us,
+       m.ul_rlc_mac_latency.mean_us, m.ul_rlc_mac_latency.p99_us);
+
   metrics_time = now;
   reset_metrics();
 }
@@ -107,6 +120,11 @@ void rlc::reset()
 void rlc::write_sdu(uint32_t lcid, byte_buffer_t *sdu)
 {
   if(valid_lcid(lcid)) {
+    // Stamped by GW, restamped to measure the RLC queueing separately
+    if(lcid >= RB_ID_DRB1) {
+      ul_gw_rlc_latency.add(sdu->get_latency_us());
+      sdu->set_timestamp();
+    }
     rlc_array[lcid].write_sdu(sdu);
   }
 }
@@ -151,34 +169,34 @@ void rlc::write_pdu(uint32_t lcid, uint8_t *payload, uint32_t nof_bytes)
 
 void rlc::write_pdu_bcch_bch(uint8_t *payload, uint32_t nof_bytes)
 {
-  rlc_log->info_hex(payload, nof_bytes, "BCCH BCH message received.");
+  Info_hex(payload, nof_bytes, "BCCH BCH message received.");
   dl_tput_bytes[0] += nof_bytes;
-  byte_buffer_t *buf = pool->allocate();
+  byte_buffer_t *buf = pool->allocate(nof_bytes);
   memcpy(buf->msg, payload, nof_bytes);
   buf->N_bytes = nof_bytes;
-  buf->timestamp = bpt::microsec_clock::local_time();
+  buf->set_timestamp();
   pdcp->write_pdu_bcch_bch(buf);
 }
 
 void rlc::write_pdu_bcch_dlsch(uint8_t *payload, uint32_t nof_bytes)
 {
-  rlc_log->info_hex(payload, nof_bytes, "BCCH TXSCH message received.");
+  Info_hex(payload, nof_bytes, "BCCH TXSCH message received.");
   dl_tput_bytes[0] += nof_bytes;
-  byte_buffer_t *buf = pool->allocate();
+  byte_buffer_t *buf = pool->allocate(nof_bytes);
   memcpy(buf->msg, payload, nof_bytes);
   buf->N_bytes = nof_bytes;
-  buf->timestamp = bpt::microsec_clock::local_time();
+  buf->set_timestamp();
   pdcp->write_pdu_bcch_dlsch(buf);
 }
 
 void rlc::write_pdu_pcch(uint8_t *payload, uint32_t nof_bytes)
 {
-  rlc_log->info_hex(payload, nof_bytes, "PCCH message received.");
+  Info_hex(payload, nof_bytes, "PCCH message received.");
   dl_tput_bytes[0] += nof_bytes;
-  byte_buffer_t *buf = pool->allocate();
+  byte_buffer_t *buf = pool->allocate(nof_bytes);
   memcpy(buf->msg, payload, nof_bytes);
   buf->N_bytes = nof_bytes;
-  buf->timestamp = bpt::microsec_clock::local_time();
+  buf->set_timestamp();
   pdcp->write_pdu_pcch(buf);
 }
 
@@ -201,45 +219,46 @@ void rlc::add_bearer(uint32_t lcid)
       cnfg.dl_am_rlc.t_status_prohibit  = LIBLTE_RRC_T_STATUS_PROHIBIT_MS0;
       add_bearer(lcid, &cnfg);
     } else {
-      rlc_log->warning("Bearer %s already configured. Reconfiguration not supported\n", rb_id_text[lcid]);
+      Warning("Bearer %s already configured. Reconfiguration not supported\n", rb_id_text[lcid]);
     }
   }else{
-    rlc_log->error("Radio bearer %s does not support default RLC configuration.",
-                   rb_id_text[lcid]);
+    Error("Radio bearer %s does not support default RLC configuration.",
+          rb_id_text[lcid]);
   }
 }
 
 void rlc::add_bearer(uint32_t lcid, LIBLTE_RRC_RLC_CONFIG_STRUCT *cnfg)
 {
   if(lcid < 0 || lcid >= SRSUE_N_RADIO_BEARERS) {
-    rlc_log->error("Radio bearer id must be in [0:%d] - %d\n", SRSUE_N_RADIO_BEARERS, lcid);
+    Error("Radio bearer id must be in [0:%d] - %d\n", SRSUE_N_RADIO_BEARERS, lcid);
     return;
   }
   
   
   if (!rlc_array[lcid].active()) {
-    rlc_log->info("Adding radio bearer %s with mode %s\n",
-                    rb_id_text[lcid], liblte_rrc_rlc_mode_text[cnfg->rlc_mode]);  
+    Info("Adding radio bearer %s with mode %s\n",
+           rb_id_text[lcid], liblte_rrc_rlc_mode_text[cnfg->rlc_mode]);  
+    srslte::latency_hist *tx_latency = (lcid >= RB_ID_DRB1) ? &ul_rlc_mac_latency : NULL;
     switch(cnfg->rlc_mode)
     {
     case LIBLTE_RRC_RLC_MODE_AM:
-      rlc_array[lcid].init(RLC_MODE_AM, rlc_log, lcid, pdcp, rrc, mac_timers);
+      rlc_array[lcid].init(RLC_MODE_AM, rlc_log, lcid, pdcp, rrc, mac_timers, tx_latency);
       break;
     case LIBLTE_RRC_RLC_MODE_UM_BI:
-      rlc_array[lcid].init(RLC_MODE_UM, rlc_log, lcid, pdcp, rrc, mac_timers);
+      rlc_array[lcid].init(RLC_MODE_UM, rlc_log, lcid, pdcp, rrc, mac_timers, tx_latency);
       break;
     case LIBLTE_RRC_RLC_MODE_UM_UNI_DL:
-      rlc_array[lcid].init(RLC_MODE_UM, rlc_log, lcid, pdcp, rrc, mac_timers);
+      rlc_array[lcid].init(RLC_MODE_UM, rlc_log, lcid, pdcp, rrc, mac_timers, tx_latency);
       break;
     case LIBLTE_RRC_RLC_MODE_UM_UNI_UL:
-      rlc_array[lcid].init(RLC_MODE_UM, rlc_log, lcid, pdcp, rrc, mac_timers);
+      rlc_array[lcid].init(RLC_MODE_UM, rlc_log, lcid, pdcp, rrc, mac_timers, tx_latency);
       break;
     default:
-      rlc_log->error("Cannot add RLC entity - invalid mode\n");
+      Error("Cannot add RLC entity - invalid mode\n");
       return;
     }
   } else {
-    rlc_log->warning("Bearer %s already created.\n", rb_id_text[lcid]);
+    Warning("Bearer %s already created.\n", rb_id_text[lcid]);
   }
   rlc_array[lcid].configure(cnfg);    
 
@@ -27,6 +27,12 @@
 
 #include "upper/rlc_am.h"
 
+#define Error(fmt, ...)               SRSLTE_LOG(log, RLC, ERROR, error, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...)             SRSLTE_LOG(log, RLC, WARNING, warning, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)                SRSLTE_LOG(log, RLC, INFO, info, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)               SRSLTE_LOG(log, RLC, DEBUG, debug, fmt, ##__VA_ARGS__)
+#define Info_hex(hex, size, fmt, ...) SRSLTE_LOG(log, RLC, INFO, info_hex, hex, size, fmt, ##__VA_ARGS__)
+
 #define MOD 1024
 #define RX_MOD_BASE(x) (x-vr_r)%1024
 #define TX_MOD_BASE(x) (x-vt_a)%1024
@@ -57,18 +63,40 @@ rlc_am::rlc_am() : tx_sdu_queue(16)
 
   poll_received = false;
   do_status     = false;
+
+  mac_timers            = NULL;
+  poll_retx_timer       = NULL;
+  reordering_timer      = NULL;
+  status_prohibit_timer = NULL;
+  poll_retx_running     = false;
+  poll_retx_expired     = false;
+  reordering_running    = false;
 }
 
 void rlc_am::init(srslte::log          *log_,
                   uint32_t              lcid_,
                   pdcp_interface_rlc   *pdcp_,
                   rrc_interface_rlc    *rrc_,
-                  mac_interface_timers *mac_timers)
+                  mac_interface_timers *mac_timers_)
 {
   log  = log_;
   lcid = lcid_;
   pdcp = pdcp_;
   rrc  = rrc_;
+  if(mac_timers) {
+    mac_timers->release_id(poll_retx_timeout_id);
+    mac_timers->release_id(reordering_timeout_id);
+    mac_timers->release_id(status_prohibit_timeout_id);
+  }
+  mac_timers                 = mac_timers_;
+  poll_retx_timeout_id       = mac_timers->get_unique_id();
+  reordering_timeout_id      = mac_timers->get_unique_id();
+  status_prohibit_timeout_id = mac_timers->get_unique_id();
+
+  // Timers never move once created, resolve them once
+  poll_retx_timer            = mac_timers->get(poll_retx_timeout_id);
+  reordering_timer           = mac_timers->get(reordering_timeout_id);
+  status_prohibit_timer      = mac_timers->get(status_prohibit_timeout_id);
 }
 
 void rlc_am::configure(LIBLTE_RRC_RLC_CONFIG_STRUCT *cnfg)
@@ -81,30 +109,41 @@ void rlc_am::configure(LIBLTE_RRC_RLC_CONFIG_STRUCT *cnfg)
   t_reordering      = liblte_rrc_t_reordering_num[cnfg->dl_am_rlc.t_reordering];
   t_status_prohibit = liblte_rrc_t_status_prohibit_num[cnfg->dl_am_rlc.t_status_prohibit];
 
-  log->info("%s configured: t_poll_retx=%d, poll_pdu=%d, poll_byte=%d, max_retx_thresh=%d, "
-            "t_reordering=%d, t_status_prohibit=%d\n",
-            rb_id_text[lcid], t_poll_retx, poll_pdu, poll_byte, max_retx_thresh,
-            t_reordering, t_status_prohibit);
+  Info("%s configured: t_poll_retx=%d, poll_pdu=%d, poll_byte=%d, max_retx_thresh=%d, "
+       "t_reordering=%d, t_status_prohibit=%d\n",
+       rb_id_text[lcid], t_poll_retx, poll_pdu, poll_byte, max_retx_thresh,
+       t_reordering, t_status_prohibit);
 }
 
 
 void rlc_am::empty_queue() {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  drain_tx_sdu_queue();
+}
+
+// The queue has a single reader: the caller must hold mutex
+void rlc_am::drain_tx_sdu_queue() {
   // Drop all messages in TX SDU queue
-  byte_buffer_t *buf;
-  while(tx_sdu_queue.size() > 0) {
-    tx_sdu_queue.read(&buf);
-    pool->deallocate(buf);
+  byte_buffer_t *bufs[TX_SDU_BATCH];
+  uint32_t n;
+  while((n = tx_sdu_queue.read_batch(bufs, TX_SDU_BATCH)) > 0) {
+    for(uint32_t i=0;i<n;i++)
+      pool->deallocate(bufs[i]);
   }
-
 }
 
 void rlc_am::reset()
 {
-  reordering_timeout.reset();
+  boost::lock_guard<boost::mutex> lock(mutex);
+  if(mac_timers) {
+    stop_timer(poll_retx_timer);
+    stop_timer(reordering_timer);
+    stop_timer(status_prohibit_timer);
+  }
   if(tx_sdu)
     tx_sdu->reset();
-  if(rx_sdu)
-    rx_sdu->reset();
+  pool->deallocate(rx_sdu);
+  rx_sdu = NULL;
 
   vt_a    = 0;
   vt_ms   = RLC_AM_WINDOW_SIZE;
@@ -123,7 +162,7 @@ void rlc_am::reset()
   poll_received = false;
   do_status     = false;
 
-  empty_queue();
+  drain_tx_sdu_queue();
 
   // Drop all messages in RX segments
   std::map<uint32_t, rlc_amd_rx_pdu_segments_t>::iterator rxsegsit;
@@ -171,7 +210,8 @@ uint32_t rlc_am::get_bearer()
 
 void rlc_am::write_sdu(byte_buffer_t *sdu)
 {
-  log->info_hex(sdu->msg, sdu->N_bytes, "%s Tx SDU", rb_id_text[lcid]);
+  Info_hex(sdu->msg, sdu->N_bytes, "%s Tx SDU", rb_id_text[lcid]);
+  boost::lock_guard<boost::mutex> lock(tx_sdu_mutex);
   tx_sdu_queue.write(sdu);
 }
 
@@ -186,19 +226,18 @@ uint32_t rlc_am::get_total_buffer_state()
   uint32_t n_sdus  = 0;
 
   // Bytes needed for status report
-  check_reordering_timeout();
   if(do_status && !status_prohibited()) {
     n_bytes += prepare_status();
-    log->debug("Buffer state - status report: %d bytes\n", n_bytes);
+    Debug("Buffer state - status report: %d bytes\n", n_bytes);
   }
 
   // Bytes needed for retx
   if(retx_queue.size() > 0) {
     rlc_amd_retx_t retx = retx_queue.front();
-    log->debug("Buffer state - retx - SN: %d, Segment: %s, %d:%d\n", retx.sn, retx.is_segment ? "true" : "false", retx.so_start, retx.so_end);
+    Debug("Buffer state - retx - SN: %d, Segment: %s, %d:%d\n", retx.sn, retx.is_segment ? "true" : "false", retx.so_start, retx.so_end);
     if(tx_window.end() != tx_window.find(retx.sn)) {
         n_bytes += required_buffer_size(retx);
-        log->debug("Buffer state - retx: %d bytes\n", n_bytes);
+        Debug("Buffer state - retx: %d bytes\n", n_bytes);
     }
   }
 
@@ -218,7 +257,7 @@ uint32_t rlc_am::get_total_buffer_state()
   // Room needed for fixed header?
   if(n_bytes > 0) {
     n_bytes += 2;
-    log->debug("Buffer state - tx SDUs: %d bytes\n", n_bytes);
+    Debug("Buffer state - tx SDUs: %d bytes\n", n_bytes);
   }
 
   return n_bytes;
@@ -231,20 +270,19 @@ uint32_t rlc_am::get_buffer_state()
   uint32_t n_sdus  = 0;
 
   // Bytes needed for status report
-  check_reordering_timeout();
   if(do_status && !status_prohibited()) {
     n_bytes = prepare_status();
-    log->debug("Buffer state - status report: %d bytes\n", n_bytes);
+    Debug("Buffer state - status report: %d bytes\n", n_bytes);
     return n_bytes;
   }
 
   // Bytes needed for retx
   if(retx_queue.size() > 0) {
     rlc_amd_retx_t retx = retx_queue.front();
-    log->debug("Buffer state - retx - SN: %d, Segment: %s, %d:%d\n", retx.sn, retx.is_segment ? "true" : "false", retx.so_start, retx.so_end);
+    Debug("Buffer state - retx - SN: %d, Segment: %s, %d:%d\n", retx.sn, retx.is_segment ? "true" : "false", retx.so_start, retx.so_end);
     if(tx_window.end() != tx_window.find(retx.sn)) {
         n_bytes = required_buffer_size(retx);
-        log->debug("Buffer state - retx: %d bytes\n", n_bytes);
+        Debug("Buffer state - retx: %d bytes\n", n_bytes);
         return n_bytes;
     }
   }
@@ -265,7 +303,7 @@ uint32_t rlc_am::get_buffer_state()
   // Room needed for fixed header?
   if(n_bytes > 0) {
     n_bytes += 2;
-    log->debug("Buffer state - tx SDUs: %d bytes\n", n_bytes);
+    Debug("Buffer state - tx SDUs: %d bytes\n", n_bytes);
   }
 
   return n_bytes;
@@ -275,7 +313,7 @@ int rlc_am::read_pdu(uint8_t *payload, uint32_t nof_bytes)
 {
   boost::lock_guard<boost::mutex> lock(mutex);
 
-  log->debug("MAC opportunity - %d bytes\n", nof_bytes);
+  Debug("MAC opportunity - %d bytes\n", nof_bytes);
 
   // Tx STATUS if requested
   if(do_status && !status_prohibited())
@@ -309,25 +347,35 @@ void rlc_am::write_pdu(uint8_t *payload, uint32_t nof_bytes)
 }
 
 /****************************************************************************
- * Timer checks
+ * Timeout callback interface
  ***************************************************************************/
 
-bool rlc_am::status_prohibited()
+void rlc_am::timer_expired(uint32_t timeout_id)
 {
-  return (status_prohibit_timeout.is_running() && !status_prohibit_timeout.expired());
-}
+  boost::lock_guard<boost::mutex> lock(mutex);
 
-bool rlc_am::poll_retx()
-{
-  return (poll_retx_timeout.is_running() && poll_retx_timeout.expired());
-}
+  // Ignore expiries of timers restarted since
+  srslte::timers::timer *t = NULL;
+  if(timeout_id == poll_retx_timeout_id)
+    t = poll_retx_timer;
+  else if(timeout_id == reordering_timeout_id)
+    t = reordering_timer;
+  else if(timeout_id == status_prohibit_timeout_id)
+    t = status_prohibit_timer;
+  if(t == NULL || t->is_running())
+    return;
 
-void rlc_am::check_reordering_timeout()
-{
-  if(reordering_timeout.is_running() && reordering_timeout.expired())
+  if(poll_retx_timeout_id == timeout_id && poll_retx_running)
+  {
+    poll_retx_running = false;
+    poll_retx_expired = true;
+    Debug("%s poll retx timeout expiry\n", rb_id_text[lcid]);
+  }
+
+  if(reordering_timeout_id == timeout_id && reordering_running)
   {
-    reordering_timeout.reset();
-    log->debug("%s reordering timeout expiry - updating vr_ms\n", rb_id_text[lcid]);
+    reordering_running = false;
+    Debug("%s reordering timeout expiry - updating vr_ms\n", rb_id_text[lcid]);
 
     // 36.322 v10 Section 5.1.3.2.4
     vr_ms = vr_x;
@@ -342,7 +390,7 @@ void rlc_am::check_reordering_timeout()
 
     if(RX_MOD_BASE(vr_h) > RX_MOD_BASE(vr_ms))
     {
-      reordering_timeout.start(t_reordering);
+      start_timer(reordering_timer, t_reordering);
       vr_x = vr_h;
     }
 
@@ -350,6 +398,44 @@ void rlc_am::check_reordering_timeout()
   }
 }
 
+/****************************************************************************
+ * Timer checks
+ ***************************************************************************/
+
+bool rlc_am::status_prohibited()
+{
+  return status_prohibit_timer->is_running();
+}
+
+bool rlc_am::poll_retx()
+{
+  return poll_retx_expired;
+}
+
+// set() restarts a running timer, so no stop() is needed first
+void rlc_am::start_timer(srslte::timers::timer *t, int32_t duration)
+{
+  if(t == poll_retx_timer) {
+    poll_retx_running = true;
+    poll_retx_expired = false;
+  }
+  if(t == reordering_timer)
+    reordering_running = true;
+  t->set(this, duration);
+  t->run();
+}
+
+void rlc_am::stop_timer(srslte::timers::timer *t)
+{
+  if(t == poll_retx_timer) {
+    poll_retx_running = false;
+    poll_retx_expired = false;
+  }
+  if(t == reordering_timer)
+    reordering_running = false;
+  t->stop();
+}
+
 /****************************************************************************
  * Helpers
  ***************************************************************************/
@@ -388,19 +474,19 @@ int  rlc_am::build_status_pdu(uint8_t *payload, uint32_t nof_bytes)
   int pdu_len = rlc_am_packed_length(&status);
   if(nof_bytes >= pdu_len)
   {
-    log->info("%s Tx status PDU - %s\n",
-              rb_id_text[lcid], rlc_am_to_string(&status).c_str());
+    Info("%s Tx status PDU - %s\n",
+         rb_id_text[lcid], rlc_am_to_string(&status).c_str());
 
     do_status     = false;
     poll_received = false;
 
     if(t_status_prohibit > 0)
-      status_prohibit_timeout.start(t_status_prohibit);
+      start_timer(status_prohibit_timer, t_status_prohibit);
     debug_state();
     return rlc_am_write_status_pdu(&status, payload);
   }else{
-    log->warning("%s Cannot tx status PDU - %d bytes available, %d bytes required\n",
-                 rb_id_text[lcid], nof_bytes, pdu_len);
+    Warning("%s Cannot tx status PDU - %d bytes available, %d bytes required\n",
+            rb_id_text[lcid], nof_bytes, pdu_len);
     return 0;
   }
 }
@@ -417,7 +503,7 @@ int  rlc_am::build_retx_pdu(uint8_t *payload, uint32_t nof_bytes)
 
   // Is resegmentation needed?
   if(retx.is_segment || required_buffer_size(retx) > nof_bytes) {
-    log->debug("%s build_retx_pdu - resegmentation required\n", rb_id_text[lcid]);
+    Debug("%s build_retx_pdu - resegmentation required\n", rb_id_text[lcid]);
     return build_segment(payload, nof_bytes, retx);
   }
 
@@ -430,7 +516,7 @@ int  rlc_am::build_retx_pdu(uint8_t *payload, uint32_t nof_bytes)
     poll_sn           = vt_s;
     pdu_without_poll  = 0;
     byte_without_poll = 0;
-    poll_retx_timeout.start(t_poll_retx);
+    start_timer(poll_retx_timer, t_poll_retx);
   }
 
   uint8_t *ptr = payload;
@@ -441,8 +527,8 @@ int  rlc_am::build_retx_pdu(uint8_t *payload, uint32_t nof_bytes)
   tx_window[retx.sn].retx_count++;
   if(tx_window[retx.sn].retx_count >= max_retx_thresh)
     rrc->max_retx_attempted();
-  log->info("%s Retx PDU scheduled for tx. SN: %d, retx count: %d\n",
-            rb_id_text[lcid], retx.sn, tx_window[retx.sn].retx_count);
+  Info("%s Retx PDU scheduled for tx. SN: %d, retx count: %d\n",
+       rb_id_text[lcid], retx.sn, tx_window[retx.sn].retx_count);
 
   debug_state();
   return (ptr-payload) + tx_window[retx.sn].buf->N_bytes;
@@ -474,8 +560,8 @@ int rlc_am::build_segment(uint8_t *payload, uint32_t nof_bytes, rlc_amd_retx_t r
   head_len = rlc_am_packed_length(&new_header);
   if(nof_bytes <= head_len)
   {
-    log->warning("%s Cannot build a PDU segment - %d bytes available, %d bytes required for header\n",
-                 rb_id_text[lcid], nof_bytes, head_len);
+    Warning("%s Cannot build a PDU segment - %d bytes available, %d bytes required for header\n",
+            rb_id_text[lcid], nof_bytes, head_len);
     return 0;
   }
   pdu_space = nof_bytes-head_len;
@@ -540,16 +626,16 @@ int rlc_am::build_segment(uint8_t *payload, uint32_t nof_bytes, rlc_amd_retx_t r
   uint32_t len  = retx.so_end - retx.so_start;
   memcpy(ptr, data, len);
 
-  log->info("%s Retx PDU segment scheduled for tx. SN: %d, SO: %d\n",
-            rb_id_text[lcid], retx.sn, retx.so_start);
+  Info("%s Retx PDU segment scheduled for tx. SN: %d, SO: %d\n",
+       rb_id_text[lcid], retx.sn, retx.so_start);
 
   debug_state();
   int pdu_len = (ptr-payload) + len;
   if(pdu_len > nof_bytes) {
-    log->error("%s Retx PDU segment length error. Available: %d, Used: %d\n",
-               rb_id_text[lcid], nof_bytes, pdu_len);
-    log->debug("%s Retx PDU segment length error. Header len: %d, Payload len: %d, N_li: %d\n",
-               rb_id_text[lcid], (ptr-payload), len, new_header.N_li);
+    Error("%s Retx PDU segment length error. Available: %d, Used: %d\n",
+          rb_id_text[lcid], nof_bytes, pdu_len);
+    Debug("%s Retx PDU segment length error. Header len: %d, Payload len: %d, N_li: %d\n",
+          rb_id_text[lcid], (ptr-payload), len, new_header.N_li);
   }
   return pdu_len;
 
@@ -559,11 +645,11 @@ int  rlc_am::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
 {
   if(!tx_sdu && tx_sdu_queue.size() == 0)
   {
-    log->info("No data available to be sent\n");
+    Info("No data available to be sent\n");
     return 0;
   }
 
-  byte_buffer_t *pdu = pool->allocate();
+  byte_buffer_t *pdu = pool->allocate(nof_bytes);
   if (!pdu) {
     log->console("Fatal Error: Could not allocate PDU in build_data_pdu()\n");
     exit(-1);
@@ -586,13 +672,13 @@ int  rlc_am::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
 
   if(pdu_space <= head_len)
   {
-    log->warning("%s Cannot build a PDU - %d bytes available, %d bytes required for header\n",
-                 rb_id_text[lcid], nof_bytes, head_len);
+    Warning("%s Cannot build a PDU - %d bytes available, %d bytes required for header\n",
+            rb_id_text[lcid], nof_bytes, head_len);
     return 0;
   }
 
-  log->debug("%s Building PDU - pdu_space: %d, head_len: %d \n",
-            rb_id_text[lcid], pdu_space, head_len);
+  Debug("%s Building PDU - pdu_space: %d, head_len: %d \n",
+       rb_id_text[lcid], pdu_space, head_len);
 
   // Check for SDU segment
   if(tx_sdu)
@@ -606,8 +692,11 @@ int  rlc_am::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
     tx_sdu->msg     += to_move;
     if(tx_sdu->N_bytes == 0)
     {
-      log->info("%s Complete SDU scheduled for tx. Stack latency: %ld us\n",
-                rb_id_text[lcid], tx_sdu->get_latency_us());
+      long latency_us = tx_sdu->get_latency_us();
+      if(tx_latency)
+        tx_latency->add(latency_us);
+      Info("%s Complete SDU scheduled for tx. Stack latency: %ld us\n",
+           rb_id_text[lcid], latency_us);
       pool->deallocate(tx_sdu);
       tx_sdu = NULL;
     }
@@ -617,8 +706,8 @@ int  rlc_am::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
       pdu_space = 0;
     header.fi |= RLC_FI_FIELD_NOT_START_ALIGNED; // First byte does not correspond to first byte of SDU
 
-    log->debug("%s Building PDU - added SDU segment (len:%d) - pdu_space: %d, head_len: %d \n",
-              rb_id_text[lcid], to_move, pdu_space, head_len);
+    Debug("%s Building PDU - added SDU segment (len:%d) - pdu_space: %d, head_len: %d \n",
+         rb_id_text[lcid], to_move, pdu_space, head_len);
   }
 
   // Pull SDUs from queue
@@ -631,7 +720,7 @@ int  rlc_am::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
       header.N_li--;
       break;
     }
-    tx_sdu_queue.read(&tx_sdu);
+    tx_sdu_queue.try_read(&tx_sdu);
     to_move = ((pdu_space-head_len) >= tx_sdu->N_bytes) ? tx_sdu->N_bytes : pdu_space-head_len;
     memcpy(pdu_ptr, tx_sdu->msg, to_move);
     last_li          = to_move;
@@ -641,8 +730,11 @@ int  rlc_am::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
     tx_sdu->msg     += to_move;
     if(tx_sdu->N_bytes == 0)
     {
-      log->info("%s Complete SDU scheduled for tx. Stack latency: %ld us\n",
-                rb_id_text[lcid], tx_sdu->get_latency_us());
+      long latency_us = tx_sdu->get_latency_us();
+      if(tx_latency)
+        tx_latency->add(latency_us);
+      Info("%s Complete SDU scheduled for tx. Stack latency: %ld us\n",
+           rb_id_text[lcid], latency_us);
       pool->deallocate(tx_sdu);
       tx_sdu = NULL;
     }
@@ -651,8 +743,8 @@ int  rlc_am::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
     else
       pdu_space = 0;
 
-    log->debug("%s Building PDU - added SDU segment (len:%d) - pdu_space: %d, head_len: %d \n",
-              rb_id_text[lcid], to_move, pdu_space, head_len);
+    Debug("%s Building PDU - added SDU segment (len:%d) - pdu_space: %d, head_len: %d \n",
+         rb_id_text[lcid], to_move, pdu_space, head_len);
   }
 
   if(tx_sdu)
@@ -667,13 +759,13 @@ int  rlc_am::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
     poll_sn           = vt_s;
     pdu_without_poll  = 0;
     byte_without_poll = 0;
-    poll_retx_timeout.start(t_poll_retx);
+    start_timer(poll_retx_timer, t_poll_retx);
   }
 
   // Set SN
   header.sn = vt_s;
   vt_s = (vt_s + 1)%MOD;
-  log->info("%s PDU scheduled for tx. SN: %d\n", rb_id_text[lcid], header.sn);
+  Info("%s PDU scheduled for tx. SN: %d\n", rb_id_text[lcid], header.sn);
 
   // Place PDU in tx_window, write header and TX
   tx_window[header.sn].buf        = pdu;
@@ -693,33 +785,33 @@ void rlc_am::handle_data_pdu(uint8_t *payload, uint32_t nof_bytes, rlc_amd_pdu_h
 {
   std::map<uint32_t, rlc_amd_rx_pdu_t>::iterator it;
 
-  log->info_hex(payload, nof_bytes, "%s Rx data PDU SN: %d",
-                rb_id_text[lcid], header.sn);
+  Info_hex(payload, nof_bytes, "%s Rx data PDU SN: %d",
+           rb_id_text[lcid], header.sn);
 
   if(!inside_rx_window(header.sn)) {
     if(header.p) {
-      log->info("%s Status packet requested through polling bit\n", rb_id_text[lcid]);
+      Info("%s Status packet requested through polling bit\n", rb_id_text[lcid]);
       do_status = true;
     }
-    log->info("%s SN: %d outside rx window [%d:%d] - discarding\n",
-              rb_id_text[lcid], header.sn, vr_r, vr_mr);
+    Info("%s SN: %d outside rx window [%d:%d] - discarding\n",
+         rb_id_text[lcid], header.sn, vr_r, vr_mr);
     return;
   }
 
   it = rx_window.find(header.sn);
   if(rx_window.end() != it) {
     if(header.p) {
-      log->info("%s Status packet requested through polling bit\n", rb_id_text[lcid]);
+      Info("%s Status packet requested through polling bit\n", rb_id_text[lcid]);
       do_status = true;
     }
-    log->info("%s Discarding duplicate SN: %d\n",
-              rb_id_text[lcid], header.sn);
+    Info("%s Discarding duplicate SN: %d\n",
+         rb_id_text[lcid], header.sn);
     return;
   }
 
   // Write to rx window
   rlc_amd_rx_pdu_t pdu;
-  pdu.buf = pool->allocate();
+  pdu.buf = pool->allocate(nof_bytes);
   if (!pdu.buf) {
     log->console("Fatal Error: Could not allocate PDU in handle_data_pdu()\n");
     exit(-1);
@@ -727,6 +819,7 @@ void rlc_am::handle_data_pdu(uint8_t *payload, uint32_t nof_bytes, rlc_amd_pdu_h
 
   memcpy(pdu.buf->msg, payload, nof_bytes);
   pdu.buf->N_bytes  = nof_bytes;
+  pdu.buf->set_timestamp(); // Inherited by the SDU starting in this PDU
   pdu.header        = header;
 
   rx_window[header.sn] = pdu;
@@ -746,7 +839,7 @@ void rlc_am::handle_data_pdu(uint8_t *payload, uint32_t nof_bytes, rlc_amd_pdu_h
   // Check poll bit
   if(header.p)
   {
-    log->info("%s Status packet requested through polling bit\n", rb_id_text[lcid]);
+    Info("%s Status packet requested through polling bit\n", rb_id_text[lcid]);
     poll_received = true;
 
     // 36.322 v10 Section 5.2.3
@@ -762,7 +855,7 @@ void rlc_am::handle_data_pdu(uint8_t *payload, uint32_t nof_bytes, rlc_amd_pdu_h
   reassemble_rx_sdus();
 
   // Update reordering variables and timers (36.322 v10.0.0 Section 5.1.3.2.3)
-  if(reordering_timeout.is_running())
+  if(reordering_running)
   {
     if(
        vr_x == vr_r ||
@@ -771,14 +864,14 @@ void rlc_am::handle_data_pdu(uint8_t *payload, uint32_t nof_bytes, rlc_amd_pdu_h
         vr_x != vr_mr)
        )
     {
-      reordering_timeout.reset();
+      stop_timer(reordering_timer);
     }
   }
-  if(!reordering_timeout.is_running())
+  if(!reordering_running)
   {
     if(RX_MOD_BASE(vr_h) > RX_MOD_BASE(vr_r))
     {
-      reordering_timeout.start(t_reordering);
+      start_timer(reordering_timer, t_reordering);
       vr_x = vr_h;
     }
   }
@@ -790,22 +883,22 @@ void rlc_am::handle_data_pdu_segment(uint8_t *payload, uint32_t nof_bytes, rlc_a
 {
   std::map<uint32_t, rlc_amd_rx_pdu_segments_t>::iterator it;
 
-  log->info_hex(payload, nof_bytes, "%s Rx data PDU segment. SN: %d, SO: %d",
-                rb_id_text[lcid], header.sn, header.so);
+  Info_hex(payload, nof_bytes, "%s Rx data PDU segment. SN: %d, SO: %d",
+           rb_id_text[lcid], header.sn, header.so);
 
   // Check inside rx window
   if(!inside_rx_window(header.sn)) {
     if(header.p) {
-      log->info("%s Status packet requested through polling bit\n", rb_id_text[lcid]);
+      Info("%s Status packet requested through polling bit\n", rb_id_text[lcid]);
       do_status = true;
     }
-    log->info("%s SN: %d outside rx window [%d:%d] - discarding\n",
-              rb_id_text[lcid], header.sn, vr_r, vr_mr);
+    Info("%s SN: %d outside rx window [%d:%d] - discarding\n",
+         rb_id_text[lcid], header.sn, vr_r, vr_mr);
     return;
   }
 
   rlc_amd_rx_pdu_t segment;
-  segment.buf = pool->allocate();
+  segment.buf = pool->allocate(nof_bytes);
   memcpy(segment.buf->msg, payload, nof_bytes);
   segment.buf->N_bytes = nof_bytes;
   segment.header       = header;
@@ -815,7 +908,7 @@ void rlc_am::handle_data_pdu_segment(uint8_t *payload, uint32_t nof_bytes, rlc_a
   if(rx_segments.end() != it) {
 
     if(header.p) {
-      log->info("%s Status packet requested through polling bit\n", rb_id_text[lcid]);
+      Info("%s Status packet requested through polling bit\n", rb_id_text[lcid]);
       do_status = true;
     }
 
@@ -845,7 +938,7 @@ void rlc_am::handle_data_pdu_segment(uint8_t *payload, uint32_t nof_bytes, rlc_a
     // Check poll bit
     if(header.p)
     {
-      log->info("%s Status packet requested through polling bit\n", rb_id_text[lcid]);
+      Info("%s Status packet requested through polling bit\n", rb_id_text[lcid]);
       poll_received = true;
 
       // 36.322 v10 Section 5.2.3
@@ -863,14 +956,14 @@ void rlc_am::handle_data_pdu_segment(uint8_t *payload, uint32_t nof_bytes, rlc_a
 
 void rlc_am::handle_control_pdu(uint8_t *payload, uint32_t nof_bytes)
 {
-  log->info_hex(payload, nof_bytes, "%s Rx control PDU", rb_id_text[lcid]);
+  Info_hex(payload, nof_bytes, "%s Rx control PDU", rb_id_text[lcid]);
 
   rlc_status_pdu_t status;
   rlc_am_read_status_pdu(payload, nof_bytes, &status);
 
-  log->info("%s Rx Status PDU: %s\n", rb_id_text[lcid], rlc_am_to_string(&status).c_str());
+  Info("%s Rx Status PDU: %s\n", rb_id_text[lcid], rlc_am_to_string(&status).c_str());
 
-  poll_retx_timeout.reset();
+  stop_timer(poll_retx_timer);
 
   // Handle ACKs and NACKs
   bool update_vt_a = true;
@@ -931,47 +1024,22 @@ void rlc_am::handle_control_pdu(uint8_t *payload, uint32_t nof_bytes)
 
 void rlc_am::reassemble_rx_sdus()
 {
-  if(!rx_sdu) {
-    rx_sdu = pool->allocate();
-    if (!rx_sdu) {
-      log->console("Fatal Error: Could not allocate PDU in reassemble_rx_sdus() (1)\n");
-      exit(-1);
-    }
-  }
   // Iterate through rx_window, assembling and delivering SDUs
   while(rx_window.end() != rx_window.find(vr_r))
   {
     // Handle any SDU segments
     for(int i=0; i<rx_window[vr_r].header.N_li; i++)
     {
-      int len = rx_window[vr_r].header.li[i];
-      memcpy(&rx_sdu->msg[rx_sdu->N_bytes], rx_window[vr_r].buf->msg, len);
-      rx_sdu->N_bytes += len;
-      rx_window[vr_r].buf->msg += len;
-      rx_window[vr_r].buf->N_bytes -= len;
-      log->info_hex(rx_sdu->msg, rx_sdu->N_bytes, "%s Rx SDU", rb_id_text[lcid]);
-      rx_sdu->timestamp = bpt::microsec_clock::local_time();
-      pdcp->write_pdu(lcid, rx_sdu);
-      rx_sdu = pool->allocate();
-      if (!rx_sdu) {
-        log->console("Fatal Error: Could not allocate PDU in reassemble_rx_sdus() (2)\n");
-      exit(-1);
-      }
-
+      append_rx_sdu(rx_window[vr_r].buf, rx_window[vr_r].header.li[i]);
+      deliver_rx_sdu();
     }
 
     // Handle last segment
-    memcpy(&rx_sdu->msg[rx_sdu->N_bytes], rx_window[vr_r].buf->msg, rx_window[vr_r].buf->N_bytes);
-    rx_sdu->N_bytes += rx_window[vr_r].buf->N_bytes;
+    append_rx_sdu(rx_window[vr_r].buf, rx_window[vr_r].buf->N_bytes);
     if(rlc_am_end_aligned(rx_window[vr_r].header.fi))
-    {
-      log->info_hex(rx_sdu->msg, rx_sdu->N_bytes, "%s Rx SDU", rb_id_text[lcid]);
-      rx_sdu->timestamp = bpt::microsec_clock::local_time();
-      pdcp->write_pdu(lcid, rx_sdu);
-      rx_sdu = pool->allocate();
-    }
+      deliver_rx_sdu();
 
-    // Move the rx_window
+    // Move the rx_window. SDU segments keep referencing the PDU buffer.
     pool->deallocate(rx_window[vr_r].buf);
     rx_window.erase(vr_r);
     vr_r = (vr_r + 1)%MOD;
@@ -979,6 +1047,35 @@ void rlc_am::reassemble_rx_sdus()
   }
 }
 
+void rlc_am::append_rx_sdu(byte_buffer_t *pdu, uint32_t nof_bytes)
+{
+  // Reference the payload in place rather than copying it into the SDU
+  if(nof_bytes > 0)
+  {
+    byte_buffer_t *seg = pool->allocate_ref(pdu, 0, nof_bytes);
+    if (!seg) {
+      log->console("Fatal Error: Could not allocate SDU segment in append_rx_sdu()\n");
+      exit(-1);
+    }
+    if(rx_sdu)
+      rx_sdu->append_segment(seg);
+    else
+      rx_sdu = seg;
+  }
+  pdu->msg     += nof_bytes;
+  pdu->N_bytes -= nof_bytes;
+}
+
+void rlc_am::deliver_rx_sdu()
+{
+  if(!rx_sdu)
+    return;
+  Info_hex(rx_sdu->msg, rx_sdu->N_bytes, "%s Rx SDU (%d bytes in %d segments)",
+           rb_id_text[lcid], rx_sdu->get_chain_bytes(), rx_sdu->get_nof_segments());
+  pdcp->write_pdu(lcid, rx_sdu);
+  rx_sdu = NULL;
+}
+
 bool rlc_am::inside_tx_window(uint16_t sn)
 {
   if(RX_MOD_BASE(sn) >= RX_MOD_BASE(vt_a) &&
@@ -1003,10 +1100,10 @@ bool rlc_am::inside_rx_window(uint16_t sn)
 
 void rlc_am::debug_state()
 {
-  log->debug("%s vt_a = %d, vt_ms = %d, vt_s = %d, poll_sn = %d "
-             "vr_r = %d, vr_mr = %d, vr_x = %d, vr_ms = %d, vr_h = %d\n",
-             rb_id_text[lcid], vt_a, vt_ms, vt_s, poll_sn,
-             vr_r, vr_mr, vr_x, vr_ms, vr_h);
+  Debug("%s vt_a = %d, vt_ms = %d, vt_s = %d, poll_sn = %d "
+        "vr_r = %d, vr_mr = %d, vr_x = %d, vr_ms = %d, vr_h = %d\n",
+        rb_id_text[lcid], vt_a, vt_ms, vt_s, poll_sn,
+        vr_r, vr_mr, vr_x, vr_ms, vr_h);
 
 }
 
@@ -1066,13 +1163,18 @@ bool rlc_am::add_segment_and_check(rlc_amd_rx_pdu_segments_t *pdu, rlc_amd_rx_pd
   }
 
   // Copy data
-  byte_buffer_t *full_pdu = pool->allocate();
+  uint32_t full_len = 0;
+  for(it = pdu->segments.begin(); it != pdu->segments.end(); it++) {
+    full_len += it->buf->N_bytes;
+  }
+  byte_buffer_t *full_pdu = pool->allocate(full_len);
   for(it = pdu->segments.begin(); it != pdu->segments.end(); it++) {
     memcpy(&full_pdu->msg[full_pdu->N_bytes], it->buf->msg, it->buf->N_bytes);
     full_pdu->N_bytes += it->buf->N_bytes;
   }
 
   handle_data_pdu(full_pdu->msg, full_pdu->N_bytes, header);
+  pool->deallocate(full_pdu);
   return true;
 }
 
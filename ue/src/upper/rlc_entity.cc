@@ -38,7 +38,8 @@ void rlc_entity::init(rlc_mode_t            mode,
                       uint32_t              lcid_,
                       pdcp_interface_rlc   *pdcp_,
                       rrc_interface_rlc    *rrc_,
-                      srslte::mac_interface_timers *mac_timers_)
+                      srslte::mac_interface_timers *mac_timers_,
+                      srslte::latency_hist *tx_latency_)
 {
   tm.reset();
   um.reset();
@@ -62,6 +63,7 @@ void rlc_entity::init(rlc_mode_t            mode,
   }
 
   rlc->init(rlc_entity_log_, lcid_, pdcp_, rrc_, mac_timers_);
+  rlc->set_tx_latency(tx_latency_);
 }
 
 void rlc_entity::configure(LIBLTE_RRC_RLC_CONFIG_STRUCT *cnfg)
@@ -27,6 +27,10 @@
 
 #include "upper/rlc_tm.h"
 
+#define Error(fmt, ...)               SRSLTE_LOG(log, RLC, ERROR, error, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)                SRSLTE_LOG(log, RLC, INFO, info, fmt, ##__VA_ARGS__)
+#define Info_hex(hex, size, fmt, ...) SRSLTE_LOG(log, RLC, INFO, info_hex, hex, size, fmt, ##__VA_ARGS__)
+
 using namespace srslte;
 
 namespace srsue{
@@ -50,7 +54,7 @@ void rlc_tm::init(srslte::log        *log_,
 
 void rlc_tm::configure(LIBLTE_RRC_RLC_CONFIG_STRUCT *cnfg)
 {
-  log->error("Attempted to configure TM RLC entity");
+  Error("Attempted to configure TM RLC entity");
 }
 
 void rlc_tm::empty_queue()
@@ -81,7 +85,7 @@ uint32_t rlc_tm::get_bearer()
 // PDCP interface
 void rlc_tm::write_sdu(byte_buffer_t *sdu)
 {
-  log->info_hex(sdu->msg, sdu->N_bytes, "%s Tx SDU", rb_id_text[lcid]);
+  Info_hex(sdu->msg, sdu->N_bytes, "%s Tx SDU", rb_id_text[lcid]);
   ul_queue.write(sdu);
 }
 
@@ -101,26 +105,26 @@ int rlc_tm::read_pdu(uint8_t *payload, uint32_t nof_bytes)
   uint32_t pdu_size = ul_queue.size_tail_bytes();
   if(pdu_size > nof_bytes)
   {
-    log->error("TX %s PDU size larger than MAC opportunity\n", rb_id_text[lcid]);
+    Error("TX %s PDU size larger than MAC opportunity\n", rb_id_text[lcid]);
     return 0;
   }
   byte_buffer_t *buf;
   ul_queue.read(&buf);
   pdu_size = buf->N_bytes;
   memcpy(payload, buf->msg, buf->N_bytes);
-  log->info("%s Complete SDU scheduled for tx. Stack latency: %ld us\n",
-            rb_id_text[lcid], buf->get_latency_us());
+  Info("%s Complete SDU scheduled for tx. Stack latency: %ld us\n",
+       rb_id_text[lcid], buf->get_latency_us());
   pool->deallocate(buf);
-  log->info_hex(payload, pdu_size, "TX %s, %s PDU", rb_id_text[lcid], rlc_mode_text[RLC_MODE_TM]);
+  Info_hex(payload, pdu_size, "TX %s, %s PDU", rb_id_text[lcid], rlc_mode_text[RLC_MODE_TM]);
   return pdu_size;
 }
 
 void rlc_tm:: write_pdu(uint8_t *payload, uint32_t nof_bytes)
 {
-  byte_buffer_t *buf = pool->allocate();
+  byte_buffer_t *buf = pool->allocate(nof_bytes);
   memcpy(buf->msg, payload, nof_bytes);
   buf->N_bytes = nof_bytes;
-  buf->timestamp = bpt::microsec_clock::local_time();
+  buf->set_timestamp();
   pdcp->write_pdu(lcid, buf);  
 }
 
@@ -27,6 +27,12 @@
 
 #include "upper/rlc_um.h"
 
+#define Error(fmt, ...)               SRSLTE_LOG(log, RLC, ERROR, error, fmt, ##__VA_ARGS__)
+#define Warning(fmt, ...)             SRSLTE_LOG(log, RLC, WARNING, warning, fmt, ##__VA_ARGS__)
+#define Info(fmt, ...)                SRSLTE_LOG(log, RLC, INFO, info, fmt, ##__VA_ARGS__)
+#define Debug(fmt, ...)               SRSLTE_LOG(log, RLC, DEBUG, debug, fmt, ##__VA_ARGS__)
+#define Info_hex(hex, size, fmt, ...) SRSLTE_LOG(log, RLC, INFO, info_hex, hex, size, fmt, ##__VA_ARGS__)
+
 #define RX_MOD_BASE(x) (x-vr_uh-rx_window_size)%rx_mod
 
 using namespace srslte;
@@ -46,7 +52,8 @@ rlc_um::rlc_um() : tx_sdu_queue(16)
   
   vr_ur_in_rx_sdu = 0; 
   
-  mac_timers = NULL; 
+  mac_timers       = NULL; 
+  reordering_timer = NULL;
 
   pdu_lost = false;
 }
@@ -61,8 +68,11 @@ void rlc_um::init(srslte::log          *log_,
   lcid                  = lcid_;
   pdcp                  = pdcp_;
   rrc                   = rrc_;
+  if(mac_timers)
+    mac_timers->release_id(reordering_timeout_id);
   mac_timers            = mac_timers_;
   reordering_timeout_id = mac_timers->get_unique_id();
+  reordering_timer      = mac_timers->get(reordering_timeout_id);
 }
 
 void rlc_um::configure(LIBLTE_RRC_RLC_CONFIG_STRUCT *cnfg)
@@ -76,60 +86,68 @@ void rlc_um::configure(LIBLTE_RRC_RLC_CONFIG_STRUCT *cnfg)
     rx_mod              = (RLC_UMD_SN_SIZE_5_BITS == rx_sn_field_length) ? 32 : 1024;
     tx_sn_field_length  = (rlc_umd_sn_size_t)cnfg->ul_um_bi_rlc.sn_field_len;
     tx_mod              = (RLC_UMD_SN_SIZE_5_BITS == tx_sn_field_length) ? 32 : 1024;
-    log->info("%s configured in %s mode: "
-              "t_reordering=%d ms, rx_sn_field_length=%u bits, tx_sn_field_length=%u bits\n",
-              rb_id_text[lcid], liblte_rrc_rlc_mode_text[cnfg->rlc_mode],
-              t_reordering,
-              rlc_umd_sn_size_num[rx_sn_field_length],
-              rlc_umd_sn_size_num[tx_sn_field_length]);
+    Info("%s configured in %s mode: "
+         "t_reordering=%d ms, rx_sn_field_length=%u bits, tx_sn_field_length=%u bits\n",
+         rb_id_text[lcid], liblte_rrc_rlc_mode_text[cnfg->rlc_mode],
+         t_reordering,
+         rlc_umd_sn_size_num[rx_sn_field_length],
+         rlc_umd_sn_size_num[tx_sn_field_length]);
     break;
   case LIBLTE_RRC_RLC_MODE_UM_UNI_UL:
     tx_sn_field_length  = (rlc_umd_sn_size_t)cnfg->ul_um_uni_rlc.sn_field_len;
     tx_mod              = (RLC_UMD_SN_SIZE_5_BITS == tx_sn_field_length) ? 32 : 1024;
-    log->info("%s configured in %s mode: tx_sn_field_length=%u bits\n",
-              rb_id_text[lcid], liblte_rrc_rlc_mode_text[cnfg->rlc_mode],
-              rlc_umd_sn_size_num[tx_sn_field_length]);
+    Info("%s configured in %s mode: tx_sn_field_length=%u bits\n",
+         rb_id_text[lcid], liblte_rrc_rlc_mode_text[cnfg->rlc_mode],
+         rlc_umd_sn_size_num[tx_sn_field_length]);
     break;
   case LIBLTE_RRC_RLC_MODE_UM_UNI_DL:
     t_reordering        = liblte_rrc_t_reordering_num[cnfg->dl_um_uni_rlc.t_reordering];
     rx_sn_field_length  = (rlc_umd_sn_size_t)cnfg->dl_um_uni_rlc.sn_field_len;
     rx_window_size      = (RLC_UMD_SN_SIZE_5_BITS == rx_sn_field_length) ? 16 : 512;
     rx_mod              = (RLC_UMD_SN_SIZE_5_BITS == rx_sn_field_length) ? 32 : 1024;
-    log->info("%s configured in %s mode: "
-              "t_reordering=%d ms, rx_sn_field_length=%u bits\n",
-              rb_id_text[lcid], liblte_rrc_rlc_mode_text[cnfg->rlc_mode],
-              liblte_rrc_t_reordering_num[t_reordering],
-              rlc_umd_sn_size_num[rx_sn_field_length]);
+    Info("%s configured in %s mode: "
+         "t_reordering=%d ms, rx_sn_field_length=%u bits\n",
+         rb_id_text[lcid], liblte_rrc_rlc_mode_text[cnfg->rlc_mode],
+         liblte_rrc_t_reordering_num[t_reordering],
+         rlc_umd_sn_size_num[rx_sn_field_length]);
     break;
   default:
-    log->error("RLC configuration mode not recognized\n");
+    Error("RLC configuration mode not recognized\n");
   }
 }
 
 void rlc_um::empty_queue() {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  drain_tx_sdu_queue();
+}
+
+// The queue has a single reader: the caller must hold mutex
+void rlc_um::drain_tx_sdu_queue() {
   // Drop all messages in TX SDU queue
-  byte_buffer_t *buf;
-  while(tx_sdu_queue.size() > 0) {
-    tx_sdu_queue.read(&buf);
-    pool->deallocate(buf);
+  byte_buffer_t *bufs[TX_SDU_BATCH];
+  uint32_t n;
+  while((n = tx_sdu_queue.read_batch(bufs, TX_SDU_BATCH)) > 0) {
+    for(uint32_t i=0;i<n;i++)
+      pool->deallocate(bufs[i]);
   }
 }
 
 void rlc_um::reset()
 {
+  boost::lock_guard<boost::mutex> lock(mutex);
   vt_us    = 0;
   vr_ur    = 0;
   vr_ux    = 0;
   vr_uh    = 0;
   pdu_lost = false;
-  if(rx_sdu)
-    rx_sdu->reset();
+  pool->deallocate(rx_sdu);
+  rx_sdu = NULL;
   if(tx_sdu)
     tx_sdu->reset();
   if(mac_timers)
-    mac_timers->get(reordering_timeout_id)->stop();
+    reordering_timer->stop();
 
-  empty_queue();
+  drain_tx_sdu_queue();
   
   // Drop all messages in RX window
   std::map<uint32_t, rlc_umd_pdu_t>::iterator it;
@@ -155,7 +173,8 @@ uint32_t rlc_um::get_bearer()
 
 void rlc_um::write_sdu(byte_buffer_t *sdu)
 {
-  log->info_hex(sdu->msg, sdu->N_bytes, "%s Tx SDU", rb_id_text[lcid]);
+  Info_hex(sdu->msg, sdu->N_bytes, "%s Tx SDU", rb_id_text[lcid]);
+  boost::lock_guard<boost::mutex> lock(tx_sdu_mutex);
   tx_sdu_queue.write(sdu);
 }
 
@@ -192,7 +211,8 @@ uint32_t rlc_um::get_total_buffer_state()
 
 int rlc_um::read_pdu(uint8_t *payload, uint32_t nof_bytes)
 {
-  log->debug("MAC opportunity - %d bytes\n", nof_bytes);
+  boost::lock_guard<boost::mutex> lock(mutex);
+  Debug("MAC opportunity - %d bytes\n", nof_bytes);
   return build_data_pdu(payload, nof_bytes);
 }
 
@@ -213,24 +233,25 @@ void rlc_um::timer_expired(uint32_t timeout_id)
     boost::lock_guard<boost::mutex> lock(mutex);
 
     // 36.322 v10 Section 5.1.2.2.4
-    log->info("%s reordering timeout expiry - updating vr_ur and reassembling\n",
-               rb_id_text[lcid]);
+    Info("%s reordering timeout expiry - updating vr_ur and reassembling\n",
+          rb_id_text[lcid]);
 
-    log->warning("Lost PDU SN: %d\n", vr_ur);
+    Warning("Lost PDU SN: %d\n", vr_ur);
     pdu_lost = true;
-    rx_sdu->reset();
+    pool->deallocate(rx_sdu);
+    rx_sdu = NULL;
     while(RX_MOD_BASE(vr_ur) < RX_MOD_BASE(vr_ux))
     {
       vr_ur = (vr_ur + 1)%rx_mod;
-      log->debug("Entering Reassemble from timeout id=%d\n", timeout_id);
+      Debug("Entering Reassemble from timeout id=%d\n", timeout_id);
       reassemble_rx_sdus();
-      log->debug("Finished reassemble from timeout id=%d\n", timeout_id);
+      Debug("Finished reassemble from timeout id=%d\n", timeout_id);
     }
-    mac_timers->get(reordering_timeout_id)->stop();
+    reordering_timer->stop();
     if(RX_MOD_BASE(vr_uh) > RX_MOD_BASE(vr_ur))
     {
-      mac_timers->get(reordering_timeout_id)->set(this, t_reordering);
-      mac_timers->get(reordering_timeout_id)->run();
+      reordering_timer->set(this, t_reordering);
+      reordering_timer->run();
       vr_ux = vr_uh;
     }
 
@@ -240,7 +261,7 @@ void rlc_um::timer_expired(uint32_t timeout_id)
 
 bool rlc_um::reordering_timeout_running()
 {
-  return mac_timers->get(reordering_timeout_id)->is_running();
+  return reordering_timer->is_running();
 }
 
 /****************************************************************************
@@ -251,14 +272,15 @@ int  rlc_um::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
 {
   if(!tx_sdu && tx_sdu_queue.size() == 0)
   {
-    log->info("No data available to be sent\n");
+    Info("No data available to be sent\n");
     return 0;
   }
 
+  // The header is written into the headroom, which must hold up to one LI per SDU
   byte_buffer_t *pdu = pool->allocate();
   if(!pdu || pdu->N_bytes != 0)
   {
-    log->error("Failed to allocate PDU buffer\n");
+    Error("Failed to allocate PDU buffer\n");
     return 0;
   }
   rlc_umd_pdu_header_t header;
@@ -276,8 +298,8 @@ int  rlc_um::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
 
   if(pdu_space <= head_len)
   {
-    log->warning("%s Cannot build a PDU - %d bytes available, %d bytes required for header\n",
-                 rb_id_text[lcid], nof_bytes, head_len);
+    Warning("%s Cannot build a PDU - %d bytes available, %d bytes required for header\n",
+            rb_id_text[lcid], nof_bytes, head_len);
     return 0;
   }
 
@@ -285,8 +307,8 @@ int  rlc_um::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
   if(tx_sdu)
   {
     to_move = ((pdu_space-head_len) >= tx_sdu->N_bytes) ? tx_sdu->N_bytes : pdu_space-head_len;
-    log->debug("%s adding remainder of SDU segment - %d bytes of %d remaining\n",
-               rb_id_text[lcid], to_move, tx_sdu->N_bytes);
+    Debug("%s adding remainder of SDU segment - %d bytes of %d remaining\n",
+          rb_id_text[lcid], to_move, tx_sdu->N_bytes);
     memcpy(pdu_ptr, tx_sdu->msg, to_move);
     last_li          = to_move;
     pdu_ptr         += to_move;
@@ -295,8 +317,11 @@ int  rlc_um::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
     tx_sdu->msg     += to_move;
     if(tx_sdu->N_bytes == 0)
     {
-      log->info("%s Complete SDU scheduled for tx. Stack latency: %ld us\n",
-                rb_id_text[lcid], tx_sdu->get_latency_us());
+      long latency_us = tx_sdu->get_latency_us();
+      if(tx_latency)
+        tx_latency->add(latency_us);
+      Info("%s Complete SDU scheduled for tx. Stack latency: %ld us\n",
+           rb_id_text[lcid], latency_us);
       pool->deallocate(tx_sdu);
       tx_sdu = NULL;
     }
@@ -307,14 +332,14 @@ int  rlc_um::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
   // Pull SDUs from queue
   while(pdu_space > head_len && tx_sdu_queue.size() > 0)
   {
-    log->debug("pdu_space=%d, head_len=%d\n", pdu_space, head_len);
+    Debug("pdu_space=%d, head_len=%d\n", pdu_space, head_len);
     if(last_li > 0)
       header.li[header.N_li++] = last_li;
     head_len = rlc_um_packed_length(&header);
-    tx_sdu_queue.read(&tx_sdu);
+    tx_sdu_queue.try_read(&tx_sdu);
     to_move = ((pdu_space-head_len) >= tx_sdu->N_bytes) ? tx_sdu->N_bytes : pdu_space-head_len;
-    log->debug("%s adding new SDU segment - %d bytes of %d remaining\n",
-               rb_id_text[lcid], to_move, tx_sdu->N_bytes);
+    Debug("%s adding new SDU segment - %d bytes of %d remaining\n",
+          rb_id_text[lcid], to_move, tx_sdu->N_bytes);
     memcpy(pdu_ptr, tx_sdu->msg, to_move);
     last_li          = to_move;
     pdu_ptr         += to_move;
@@ -323,8 +348,11 @@ int  rlc_um::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
     tx_sdu->msg     += to_move;
     if(tx_sdu->N_bytes == 0)
     {
-      log->info("%s Complete SDU scheduled for tx. Stack latency: %ld us\n",
-                rb_id_text[lcid], tx_sdu->get_latency_us());
+      long latency_us = tx_sdu->get_latency_us();
+      if(tx_latency)
+        tx_latency->add(latency_us);
+      Info("%s Complete SDU scheduled for tx. Stack latency: %ld us\n",
+           rb_id_text[lcid], latency_us);
       pool->deallocate(tx_sdu);
       tx_sdu = NULL;
     }
@@ -339,11 +367,11 @@ int  rlc_um::build_data_pdu(uint8_t *payload, uint32_t nof_bytes)
   vt_us = (vt_us + 1)%tx_mod;
 
   // Add header and TX
-  log->debug("%s packing PDU with length %d\n", rb_id_text[lcid], pdu->N_bytes);
+  Debug("%s packing PDU with length %d\n", rb_id_text[lcid], pdu->N_bytes);
   rlc_um_write_data_pdu_header(&header, pdu);
   memcpy(payload, pdu->msg, pdu->N_bytes);
   uint32_t ret = pdu->N_bytes;
-  log->debug("%sreturning length %d\n", rb_id_text[lcid], pdu->N_bytes);
+  Debug("%sreturning length %d\n", rb_id_text[lcid], pdu->N_bytes);
   pool->deallocate(pdu);
 
   debug_state();
@@ -356,33 +384,34 @@ void rlc_um::handle_data_pdu(uint8_t *payload, uint32_t nof_bytes)
   rlc_umd_pdu_header_t header;
   rlc_um_read_data_pdu_header(payload, nof_bytes, rx_sn_field_length, &header);
 
-  log->info_hex(payload, nof_bytes, "RX %s Rx data PDU SN: %d",
-                rb_id_text[lcid], header.sn);
+  Info_hex(payload, nof_bytes, "RX %s Rx data PDU SN: %d",
+           rb_id_text[lcid], header.sn);
 
   if(RX_MOD_BASE(header.sn) >= RX_MOD_BASE(vr_uh-rx_window_size) &&
      RX_MOD_BASE(header.sn) <  RX_MOD_BASE(vr_ur))
   {
-    log->info("%s SN: %d outside rx window [%d:%d] - discarding\n",
-              rb_id_text[lcid], header.sn, vr_ur, vr_uh);
+    Info("%s SN: %d outside rx window [%d:%d] - discarding\n",
+         rb_id_text[lcid], header.sn, vr_ur, vr_uh);
     return;
   }
   it = rx_window.find(header.sn);
   if(rx_window.end() != it)
   {
-    log->info("%s Discarding duplicate SN: %d\n",
-              rb_id_text[lcid], header.sn);
+    Info("%s Discarding duplicate SN: %d\n",
+         rb_id_text[lcid], header.sn);
     return;
   }
 
   // Write to rx window
   rlc_umd_pdu_t pdu;
-  pdu.buf = pool->allocate();
+  pdu.buf = pool->allocate(nof_bytes);
   if (!pdu.buf) {
-    log->error("Discarting packet: no space in buffer pool\n");
+    Error("Discarting packet: no space in buffer pool\n");
     return;
   }
   memcpy(pdu.buf->msg, payload, nof_bytes);
   pdu.buf->N_bytes = nof_bytes;
+  pdu.buf->set_timestamp(); // Inherited by the SDU starting in this PDU
   //Strip header from PDU
   int header_len = rlc_um_packed_length(&header);
   pdu.buf->msg += header_len;
@@ -395,25 +424,25 @@ void rlc_um::handle_data_pdu(uint8_t *payload, uint32_t nof_bytes)
     vr_uh  = (header.sn + 1)%rx_mod;
 
   // Reassemble and deliver SDUs, while updating vr_ur
-  log->debug("Entering Reassemble from received PDU\n");
+  Debug("Entering Reassemble from received PDU\n");
   reassemble_rx_sdus();
-  log->debug("Finished reassemble from received PDU\n");
+  Debug("Finished reassemble from received PDU\n");
   
   // Update reordering variables and timers
-  if(mac_timers->get(reordering_timeout_id)->is_running())
+  if(reordering_timer->is_running())
   {
     if(RX_MOD_BASE(vr_ux) <= RX_MOD_BASE(vr_ur) ||
        (!inside_reordering_window(vr_ux) && vr_ux != vr_uh))
     {
-      mac_timers->get(reordering_timeout_id)->stop();
+      reordering_timer->stop();
     }
   }
-  if(!mac_timers->get(reordering_timeout_id)->is_running())
+  if(!reordering_timer->is_running())
   {
     if(RX_MOD_BASE(vr_uh) > RX_MOD_BASE(vr_ur))
     {
-      mac_timers->get(reordering_timeout_id)->set(this, t_reordering);
-      mac_timers->get(reordering_timeout_id)->run();
+      reordering_timer->set(this, t_reordering);
+      reordering_timer->run();
       vr_ux = vr_uh;
     }
   }
@@ -423,52 +452,44 @@ void rlc_um::handle_data_pdu(uint8_t *payload, uint32_t nof_bytes)
 
 void rlc_um::reassemble_rx_sdus()
 {
-  if(!rx_sdu)
-    rx_sdu = pool->allocate();
-
   // First catch up with lower edge of reordering window
   while(!inside_reordering_window(vr_ur))
   {
     if(rx_window.end() == rx_window.find(vr_ur))
     {
-      rx_sdu->reset();
+      pool->deallocate(rx_sdu);
+      rx_sdu = NULL;
     }else{
       // Handle any SDU segments
       for(int i=0; i<rx_window[vr_ur].header.N_li; i++)
       {
         int len = rx_window[vr_ur].header.li[i];
-        memcpy(&rx_sdu->msg[rx_sdu->N_bytes], rx_window[vr_ur].buf->msg, len);
-        rx_sdu->N_bytes += len;
-        rx_window[vr_ur].buf->msg += len;
-        rx_window[vr_ur].buf->N_bytes -= len;
+        append_rx_sdu(rx_window[vr_ur].buf, len);
         if(pdu_lost && !rlc_um_start_aligned(rx_window[vr_ur].header.fi) || vr_ur != ((vr_ur_in_rx_sdu+1)%rx_mod)) {
-          log->warning("Dropping remainder of lost PDU (lower edge middle segments, vr_ur=%d, vr_ur_in_rx_sdu=%d)\n", vr_ur, vr_ur_in_rx_sdu);
-          rx_sdu->reset();
+          Warning("Dropping remainder of lost PDU (lower edge middle segments, vr_ur=%d, vr_ur_in_rx_sdu=%d)\n", vr_ur, vr_ur_in_rx_sdu);
+          pool->deallocate(rx_sdu);
+          rx_sdu = NULL;
         } else {
-          log->info_hex(rx_sdu->msg, rx_sdu->N_bytes, "%s Rx SDU vr_ur=%d, i=%d (lower edge middle segments)", rb_id_text[lcid], vr_ur, i);
-          rx_sdu->timestamp = bpt::microsec_clock::local_time();
-          pdcp->write_pdu(lcid, rx_sdu);
-          rx_sdu = pool->allocate();
+          Info("%s Rx SDU vr_ur=%d, i=%d (lower edge middle segments)\n", rb_id_text[lcid], vr_ur, i);
+          deliver_rx_sdu();
         }
         pdu_lost = false;
       }
 
       // Handle last segment
-      memcpy(&rx_sdu->msg[rx_sdu->N_bytes], rx_window[vr_ur].buf->msg, rx_window[vr_ur].buf->N_bytes);
-      rx_sdu->N_bytes += rx_window[vr_ur].buf->N_bytes;
-      log->debug("Writting last segment in SDU buffer. Lower edge vr_ur=%d, Buffer size=%d, segment size=%d\n", 
-               vr_ur, rx_sdu->N_bytes, rx_window[vr_ur].buf->N_bytes);
+      append_rx_sdu(rx_window[vr_ur].buf, rx_window[vr_ur].buf->N_bytes);
+      Debug("Writting last segment in SDU buffer. Lower edge vr_ur=%d, Buffer size=%d, segment size=%d\n", 
+          vr_ur, rx_sdu_bytes(), rx_window[vr_ur].buf->N_bytes);
       vr_ur_in_rx_sdu = vr_ur; 
       if(rlc_um_end_aligned(rx_window[vr_ur].header.fi))
       {
         if(pdu_lost && !rlc_um_start_aligned(rx_window[vr_ur].header.fi)) {
-          log->warning("Dropping remainder of lost PDU (lower edge last segments)\n");
-          rx_sdu->reset();          
+          Warning("Dropping remainder of lost PDU (lower edge last segments)\n");
+          pool->deallocate(rx_sdu);
+          rx_sdu = NULL;
         } else {
-          log->info_hex(rx_sdu->msg, rx_sdu->N_bytes, "%s Rx SDU vr_ur=%d (lower edge last segments)", rb_id_text[lcid], vr_ur);
-          rx_sdu->timestamp = bpt::microsec_clock::local_time();
-          pdcp->write_pdu(lcid, rx_sdu);
-          rx_sdu = pool->allocate();
+          Info("%s Rx SDU vr_ur=%d (lower edge last segments)\n", rb_id_text[lcid], vr_ur);
+          deliver_rx_sdu();
         }
         pdu_lost = false;
       }
@@ -489,40 +510,34 @@ void rlc_um::reassemble_rx_sdus()
     for(int i=0; i<rx_window[vr_ur].header.N_li; i++)
     {
       int len = rx_window[vr_ur].header.li[i];
-      memcpy(&rx_sdu->msg[rx_sdu->N_bytes], rx_window[vr_ur].buf->msg, len);
-      log->debug("Concatenating %d bytes in to current length %d. rx_window remaining bytes=%d, vr_ur_in_rx_sdu=%d, vr_ur=%d, rx_mod=%d, last_mod=%d\n",
-        len, rx_sdu->N_bytes, rx_window[vr_ur].buf->N_bytes, vr_ur_in_rx_sdu, vr_ur, rx_mod, (vr_ur_in_rx_sdu+1)%rx_mod);
-      rx_sdu->N_bytes += len;      
-      rx_window[vr_ur].buf->msg += len;
-      rx_window[vr_ur].buf->N_bytes -= len;
+      Debug("Concatenating %d bytes in to current length %d. rx_window remaining bytes=%d, vr_ur_in_rx_sdu=%d, vr_ur=%d, rx_mod=%d, last_mod=%d\n",
+        len, rx_sdu_bytes(), rx_window[vr_ur].buf->N_bytes, vr_ur_in_rx_sdu, vr_ur, rx_mod, (vr_ur_in_rx_sdu+1)%rx_mod);
+      append_rx_sdu(rx_window[vr_ur].buf, len);
       if(pdu_lost && !rlc_um_start_aligned(rx_window[vr_ur].header.fi) || vr_ur != ((vr_ur_in_rx_sdu+1)%rx_mod)) {
-        log->warning("Dropping remainder of lost PDU (update vr_ur middle segments, vr_ur=%d, vr_ur_in_rx_sdu=%d)\n", vr_ur, vr_ur_in_rx_sdu);
-        rx_sdu->reset();
+        Warning("Dropping remainder of lost PDU (update vr_ur middle segments, vr_ur=%d, vr_ur_in_rx_sdu=%d)\n", vr_ur, vr_ur_in_rx_sdu);
+        pool->deallocate(rx_sdu);
+        rx_sdu = NULL;
       } else {
-        log->info_hex(rx_sdu->msg, rx_sdu->N_bytes, "%s Rx SDU vr_ur=%d, i=%d, (update vr_ur middle segments)", rb_id_text[lcid], vr_ur, i);
-        rx_sdu->timestamp = bpt::microsec_clock::local_time();
-        pdcp->write_pdu(lcid, rx_sdu);
-        rx_sdu = pool->allocate();
+        Info("%s Rx SDU vr_ur=%d, i=%d, (update vr_ur middle segments)\n", rb_id_text[lcid], vr_ur, i);
+        deliver_rx_sdu();
       }
       pdu_lost = false;
     }
     
     // Handle last segment
-    memcpy(&rx_sdu->msg[rx_sdu->N_bytes], rx_window[vr_ur].buf->msg, rx_window[vr_ur].buf->N_bytes);
-    rx_sdu->N_bytes += rx_window[vr_ur].buf->N_bytes;
-    log->debug("Writting last segment in SDU buffer. Updating vr_ur=%d, Buffer size=%d, segment size=%d\n", 
-               vr_ur, rx_sdu->N_bytes, rx_window[vr_ur].buf->N_bytes);
+    append_rx_sdu(rx_window[vr_ur].buf, rx_window[vr_ur].buf->N_bytes);
+    Debug("Writting last segment in SDU buffer. Updating vr_ur=%d, Buffer size=%d, segment size=%d\n", 
+          vr_ur, rx_sdu_bytes(), rx_window[vr_ur].buf->N_bytes);
     vr_ur_in_rx_sdu = vr_ur; 
     if(rlc_um_end_aligned(rx_window[vr_ur].header.fi))
     {
       if(pdu_lost && !rlc_um_start_aligned(rx_window[vr_ur].header.fi)) {
-        log->warning("Dropping remainder of lost PDU (update vr_ur last segments)\n");
-        rx_sdu->reset();
+        Warning("Dropping remainder of lost PDU (update vr_ur last segments)\n");
+        pool->deallocate(rx_sdu);
+        rx_sdu = NULL;
       } else {
-        log->info_hex(rx_sdu->msg, rx_sdu->N_bytes, "%s Rx SDU vr_ur=%d (update vr_ur last segments)", rb_id_text[lcid], vr_ur);
-        rx_sdu->timestamp = bpt::microsec_clock::local_time();
-        pdcp->write_pdu(lcid, rx_sdu);
-        rx_sdu = pool->allocate();
+        Info("%s Rx SDU vr_ur=%d (update vr_ur last segments)\n", rb_id_text[lcid], vr_ur);
+        deliver_rx_sdu();
       }
       pdu_lost = false;
     }
@@ -535,6 +550,40 @@ void rlc_um::reassemble_rx_sdus()
   }
 }
 
+void rlc_um::append_rx_sdu(byte_buffer_t *pdu, uint32_t nof_bytes)
+{
+  // Reference the payload in place rather than copying it into the SDU
+  if(nof_bytes > 0)
+  {
+    byte_buffer_t *seg = pool->allocate_ref(pdu, 0, nof_bytes);
+    if(!seg) {
+      Error("Failed to allocate SDU segment of %d bytes\n", nof_bytes);
+      pdu_lost = true;
+    } else if(rx_sdu) {
+      rx_sdu->append_segment(seg);
+    } else {
+      rx_sdu = seg;
+    }
+  }
+  pdu->msg     += nof_bytes;
+  pdu->N_bytes -= nof_bytes;
+}
+
+void rlc_um::deliver_rx_sdu()
+{
+  if(!rx_sdu)
+    return;
+  Info_hex(rx_sdu->msg, rx_sdu->N_bytes, "%s Rx SDU (%d bytes in %d segments)",
+           rb_id_text[lcid], rx_sdu->get_chain_bytes(), rx_sdu->get_nof_segments());
+  pdcp->write_pdu(lcid, rx_sdu);
+  rx_sdu = NULL;
+}
+
+uint32_t rlc_um::rx_sdu_bytes()
+{
+  return rx_sdu ? rx_sdu->get_chain_bytes() : 0;
+}
+
 bool rlc_um::inside_reordering_window(uint16_t sn)
 {
   if(RX_MOD_BASE(sn) >= RX_MOD_BASE(vr_uh-rx_window_size) &&
@@ -548,8 +597,8 @@ bool rlc_um::inside_reordering_window(uint16_t sn)
 
 void rlc_um::debug_state()
 {
-  log->debug("%s vt_us = %d, vr_ur = %d, vr_ux = %d, vr_uh = %d \n",
-             rb_id_text[lcid], vt_us, vr_ur, vr_ux, vr_uh);
+  Debug("%s vt_us = %d, vr_ur = %d, vr_ux = %d, vr_uh = %d \n",
+        rb_id_text[lcid], vt_us, vr_ur, vr_ux, vr_uh);
 
 }
 
@@ -31,6 +31,7 @@
 #include "upper/rrc.h"
 #include <srslte/utils/bit.h>
 #include "common/security.h"
+#include "common/threads.h"
 
 #define TIMEOUT_RESYNC_REESTABLISH 100
 
@@ -41,6 +42,7 @@ namespace srsue{
 rrc::rrc()
   :state(RRC_STATE_IDLE)
   ,drb_up(false)
+  ,offline(false)
 {}
 
 static void liblte_rrc_handler(void *ctx, char *str) {
@@ -95,6 +97,11 @@ rrc_state_t rrc::get_state()
   return state;
 }
 
+void rrc::set_offline(bool enable)
+{
+  offline = enable;
+}
+
 /*******************************************************************************
   NAS interface
 *******************************************************************************/
@@ -194,7 +201,7 @@ bool rrc::rrc_connected()
 
 void rrc::rrc_connect() {
   boost::mutex::scoped_lock lock(mutex);
-  if(RRC_STATE_IDLE == state) {
+  if(RRC_STATE_IDLE == state && !offline) {
     rrc_log->info("RRC in IDLE state - sending connection request.\n");
     state = RRC_STATE_WAIT_FOR_CON_SETUP;
     send_con_request();
@@ -246,7 +253,7 @@ void rrc::write_pdu_bcch_bch(byte_buffer_t *pdu)
 
   // Start the SIB search state machine
   state = RRC_STATE_SIB1_SEARCH;
-  pthread_create(&sib_search_thread, NULL, &rrc::start_sib_thread, this);
+  threads_new_rt_named(&sib_search_thread, &rrc::start_sib_thread, this, -1, -1, "rrc_sib");
 }
 
 void rrc::write_pdu_bcch_dlsch(byte_buffer_t *pdu)
@@ -290,10 +297,17 @@ void rrc::write_pdu_bcch_dlsch(byte_buffer_t *pdu)
       memcpy(&sib2, &dlsch_msg.sibs[0].sib.sib2, sizeof(LIBLTE_RRC_SYS_INFO_BLOCK_TYPE_2_STRUCT));
       rrc_log->console("SIB2 received\n");
       rrc_log->info("SIB2 received\n");
-      state = RRC_STATE_WAIT_FOR_CON_SETUP;
-      mac->bcch_stop_rx();
-      apply_sib2_configs();
-      send_con_request();
+      if (offline) {
+        // Offline decoding only receives: camp on the cell without connecting
+        state = RRC_STATE_IDLE;
+        mac->bcch_stop_rx();
+        apply_sib2_configs();
+      } else {
+        state = RRC_STATE_WAIT_FOR_CON_SETUP;
+        mac->bcch_stop_rx();
+        apply_sib2_configs();
+        send_con_request();
+      }
     }
   }
 }
@@ -382,10 +396,10 @@ void rrc::send_con_request()
       bit_buf.msg[bit_buf.N_bits + i] = 0;
     bit_buf.N_bits += 8 - (bit_buf.N_bits % 8);
   }
-  byte_buffer_t *pdcp_buf = pool->allocate();
+  byte_buffer_t *pdcp_buf = pool->allocate(bit_buf.N_bits/8);
   srslte_bit_pack_vector(bit_buf.msg, pdcp_buf->msg, bit_buf.N_bits);
   pdcp_buf->N_bytes = bit_buf.N_bits/8;
-  pdcp_buf->timestamp = bpt::microsec_clock::local_time();
+  pdcp_buf->set_timestamp();
 
   // Set UE contention resolution ID in MAC
   uint64_t uecri=0;
@@ -476,7 +490,7 @@ void rrc::send_con_restablish_request()
       bit_buf.msg[bit_buf.N_bits + i] = 0;
     bit_buf.N_bits += 8 - (bit_buf.N_bits % 8);
   }
-  byte_buffer_t *pdcp_buf = pool->allocate();
+  byte_buffer_t *pdcp_buf = pool->allocate(bit_buf.N_bits/8);
   srslte_bit_pack_vector(bit_buf.msg, pdcp_buf->msg, bit_buf.N_bits);
   pdcp_buf->N_bytes = bit_buf.N_bits/8;
 
@@ -513,7 +527,7 @@ void rrc::send_con_restablish_complete()
       bit_buf.msg[bit_buf.N_bits + i] = 0;
     bit_buf.N_bits += 8 - (bit_buf.N_bits % 8);
   }
-  byte_buffer_t *pdcp_buf = pool->allocate();
+  byte_buffer_t *pdcp_buf = pool->allocate(bit_buf.N_bits/8);
   srslte_bit_pack_vector(bit_buf.msg, pdcp_buf->msg, bit_buf.N_bits);
   pdcp_buf->N_bytes = bit_buf.N_bits/8;
 
@@ -544,10 +558,10 @@ void rrc::send_con_setup_complete(byte_buffer_t *nas_msg)
       bit_buf.msg[bit_buf.N_bits + i] = 0;
     bit_buf.N_bits += 8 - (bit_buf.N_bits % 8);
   }
-  byte_buffer_t *pdcp_buf = pool->allocate();
+  byte_buffer_t *pdcp_buf = pool->allocate(bit_buf.N_bits/8);
   srslte_bit_pack_vector(bit_buf.msg, pdcp_buf->msg, bit_buf.N_bits);
   pdcp_buf->N_bytes = bit_buf.N_bits/8;
-  pdcp_buf->timestamp = bpt::microsec_clock::local_time();
+  pdcp_buf->set_timestamp();
 
   state = RRC_STATE_RRC_CONNECTED;
   rrc_log->console("RRC Connected\n");
@@ -580,7 +594,7 @@ void rrc::send_ul_info_transfer(uint32_t lcid, byte_buffer_t *sdu)
   }
   srslte_bit_pack_vector(bit_buf.msg, pdu->msg, bit_buf.N_bits);
   pdu->N_bytes = bit_buf.N_bits/8;
-  pdu->timestamp = bpt::microsec_clock::local_time();
+  pdu->set_timestamp();
 
   rrc_log->info("Sending RX Info Transfer\n");
   pdcp->write_sdu(lcid, pdu);
@@ -603,7 +617,7 @@ void rrc::send_security_mode_complete(uint32_t lcid, byte_buffer_t *pdu)
   }
   srslte_bit_pack_vector(bit_buf.msg, pdu->msg, bit_buf.N_bits);
   pdu->N_bytes = bit_buf.N_bits/8;
-  pdu->timestamp = bpt::microsec_clock::local_time();
+  pdu->set_timestamp();
 
   rrc_log->info("Sending Security Mode Complete\n");
   pdcp->write_sdu(lcid, pdu);
@@ -627,7 +641,7 @@ void rrc::send_rrc_con_reconfig_complete(uint32_t lcid, byte_buffer_t *pdu)
   }
   srslte_bit_pack_vector(bit_buf.msg, pdu->msg, bit_buf.N_bits);
   pdu->N_bytes = bit_buf.N_bits/8;
-  pdu->timestamp = bpt::microsec_clock::local_time();
+  pdu->set_timestamp();
 
   rrc_log->info("Sending RRC Connection Reconfig Complete\n");
   pdcp->write_sdu(lcid, pdu);
@@ -713,7 +727,7 @@ void rrc::send_rrc_ue_cap_info(uint32_t lcid, byte_buffer_t *pdu)
   }
   srslte_bit_pack_vector(bit_buf.msg, pdu->msg, bit_buf.N_bits);
   pdu->N_bytes = bit_buf.N_bits/8;
-  pdu->timestamp = bpt::microsec_clock::local_time();
+  pdu->set_timestamp();
 
   rrc_log->info("Sending UE Capability Info\n");
   pdcp->write_sdu(lcid, pdu);
@@ -1277,7 +1291,7 @@ void rrc::handle_rrc_con_reconfig(uint32_t lcid, LIBLTE_RRC_CONNECTION_RECONFIGU
   byte_buffer_t *nas_sdu;
   for(i=0;i<reconfig->N_ded_info_nas;i++)
   {
-    nas_sdu = pool->allocate();
+    nas_sdu = pool->allocate(reconfig->ded_info_nas_list[i].N_bytes);
     memcpy(nas_sdu->msg, &reconfig->ded_info_nas_list[i].msg, reconfig->ded_info_nas_list[i].N_bytes);
     nas_sdu->N_bytes = reconfig->ded_info_nas_list[i].N_bytes;
     nas->write_pdu(lcid, nas_sdu);
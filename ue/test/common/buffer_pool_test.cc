@@ -0,0 +1,189 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#define NTHREADS 4
+#define NITERS   200000
+#define NHELD    64
+#define NGROW    1000
+
+#include <stdio.h>
+#include <pthread.h>
+#include "common/buffer_pool.h"
+
+using namespace srslte;
+
+typedef struct {
+  uint32_t  id;
+  bool      result;
+}args_t;
+
+// Each thread keeps a window of buffers tagged with its id and checks
+// that no other thread wrote to them while they were held.
+void* alloc_thread(void *a) {
+  args_t        *args = (args_t*)a;
+  buffer_pool   *pool = buffer_pool::get_instance();
+  byte_buffer_t *held[NHELD];
+
+  for(uint32_t i=0;i<NHELD;i++)
+    held[i] = NULL;
+
+  for(uint32_t i=0;i<NITERS;i++)
+  {
+    uint32_t k = i%NHELD;
+    if(held[k])
+    {
+      uint32_t tag;
+      memcpy(&tag, held[k]->msg, 4);
+      if(tag != args->id*NITERS+i-NHELD)
+        args->result = false;
+      pool->deallocate(held[k]);
+    }
+    held[k] = pool->allocate(1500);
+    if(!held[k])
+    {
+      args->result = false;
+      return NULL;
+    }
+    uint32_t tag = args->id*NITERS+i;
+    memcpy(held[k]->msg, &tag, 4);
+    held[k]->N_bytes = 4;
+  }
+  for(uint32_t i=0;i<NHELD;i++)
+    pool->deallocate(held[i]);
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  bool                  result = true;
+  pthread_t             threads[NTHREADS];
+  args_t                args[NTHREADS];
+  buffer_pool_metrics_t m;
+
+  for(uint32_t i=0;i<NTHREADS;i++)
+  {
+    args[i].id     = i;
+    args[i].result = true;
+    pthread_create(&threads[i], NULL, &alloc_thread, &args[i]);
+  }
+  for(uint32_t i=0;i<NTHREADS;i++)
+  {
+    pthread_join(threads[i], NULL);
+    result &= args[i].result;
+  }
+
+  // Exited threads must have returned their cached buffers
+  buffer_pool *pool = buffer_pool::get_instance();
+  pool->get_metrics(m);
+  printf("cache_hits=%lu, depot_refills=%lu, depot_drains=%lu, in_use=%d, high_water_mark=%d\n",
+         m.cache_hits, m.depot_refills, m.depot_drains,
+         m.in_use[BUFFER_CLASS_MTU], m.high_water_mark[BUFFER_CLASS_MTU]);
+  if(m.in_use[BUFFER_CLASS_MTU] != 0 || m.high_water_mark[BUFFER_CLASS_MTU] < NTHREADS*NHELD)
+    result = false;
+
+  // Smallest class that fits is used
+  byte_buffer_t *b1 = pool->allocate(40);
+  byte_buffer_t *b2 = pool->allocate(1500);
+  byte_buffer_t *b3 = pool->allocate(5000);
+  if(b1->get_size_class() != BUFFER_CLASS_SMALL ||
+     b2->get_size_class() != BUFFER_CLASS_MTU   ||
+     b3->get_size_class() != BUFFER_CLASS_MAX   ||
+     b1->get_tailroom() < 40 || b2->get_tailroom() < 1500 || b3->get_tailroom() < 5000)
+    result = false;
+
+  // Requests larger than the largest class are refused
+  if(pool->allocate(SRSUE_MAX_BUFFER_SIZE_BYTES) != NULL)
+    result = false;
+
+  // Resize keeps the contents
+  memcpy(b1->msg, "srsUE", 5);
+  b1->N_bytes = 5;
+  b1 = pool->resize(b1, 4000);
+  if(b1->get_size_class() != BUFFER_CLASS_MAX || b1->N_bytes != 5 || memcmp(b1->msg, "srsUE", 5))
+    result = false;
+
+  // Copies into a smaller class are refused if they do not fit
+  byte_buffer_t *small = pool->allocate(40);
+  b3->N_bytes = 4000;
+  if(small->copy_from(*b3) || small->N_bytes != 0 ||
+     !b3->copy_from(*b1) || b3->N_bytes != 5 || memcmp(b3->msg, "srsUE", 5))
+    result = false;
+  pool->deallocate(small);
+  pool->deallocate(b1);
+  pool->deallocate(b3);
+
+  // Segments reference the payload and keep it alive after the owner is freed
+  memcpy(b2->msg, "0123456789", 10);
+  b2->N_bytes = 10;
+  byte_buffer_t *s1 = pool->allocate_ref(b2, 0, 4);
+  byte_buffer_t *s2 = pool->allocate_ref(b2, 4, 6);
+  s1->append_segment(s2);
+  pool->deallocate(b2);
+  byte_buffer_t *b4 = pool->allocate(1500);
+  if(b4 == b2 || !s1->is_ref() || s1->get_tailroom() != 0 ||
+     s1->get_size_class() != BUFFER_CLASS_REF ||
+     s1->get_chain_bytes() != 10 || s1->get_nof_segments() != 2)
+    result = false;
+  pool->deallocate(b4);
+
+  // Flatten copies the chain into a single buffer and releases the payload
+  byte_buffer_t *flat = pool->flatten(s1);
+  if(flat->get_next() != NULL || flat->is_ref() ||
+     flat->N_bytes != 10 || memcmp(flat->msg, "0123456789", 10))
+    result = false;
+  b4 = pool->allocate(1500);
+  if(b4 != b2)
+    result = false;
+  pool->deallocate(b4);
+  pool->deallocate(flat);
+
+  // Pool grows in chunks, then stops at the memory limit
+  byte_buffer_t *grown[NGROW];
+  for(uint32_t i=0;i<NGROW;i++)
+    grown[i] = pool->allocate(100);
+  pool->get_metrics(m);
+  if(m.nof_buffers[BUFFER_CLASS_SMALL] < NGROW)
+    result = false;
+  pool->set_max_memory(m.memory_bytes);
+  while(pool->allocate(SRSUE_MTU_BUFFER_SIZE_BYTES+1));
+  pool->get_metrics(m);
+  if(m.grow_failures == 0)
+    result = false;
+  for(uint32_t i=0;i<NGROW;i++)
+    pool->deallocate(grown[i]);
+
+  // Foreign buffers are accepted but not recycled
+  byte_buffer_t b;
+  pool->deallocate(&b);
+  buffer_pool::cleanup();
+
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
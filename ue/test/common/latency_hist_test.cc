@@ -0,0 +1,100 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#define NTHREADS 4
+#define NSAMPLES 100000
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "common/latency_hist.h"
+
+using namespace srslte;
+
+latency_hist hist;
+
+// Uniform latencies in [1, NSAMPLES] us from each thread
+void* add_thread(void *a) {
+  for(uint32_t i=1;i<=NSAMPLES;i++)
+    hist.add(i);
+  return NULL;
+}
+
+bool within(float value, float expected, float tol) {
+  return value >= expected*(1-tol) && value <= expected*(1+tol);
+}
+
+int main(int argc, char **argv) {
+  bool              result = true;
+  pthread_t         threads[NTHREADS];
+  latency_metrics_t m;
+
+  // Buckets cover the range without gaps and each value falls in its bucket
+  for(uint32_t i=1;i<LATENCY_HIST_NOF_BUCKETS;i++) {
+    if(latency_hist::bucket_low(i) != latency_hist::bucket_low(i-1) + latency_hist::bucket_width(i-1))
+      result = false;
+  }
+  uint32_t values[] = {0, 1, 7, 8, 9, 15, 16, 17, 1000, 123456, 0xFFFFFFFF};
+  for(uint32_t i=0;i<sizeof(values)/sizeof(uint32_t);i++) {
+    uint32_t idx = latency_hist::bucket_idx(values[i]);
+    if(idx >= LATENCY_HIST_NOF_BUCKETS ||
+       values[i] < latency_hist::bucket_low(idx) ||
+       values[i] - latency_hist::bucket_low(idx) >= latency_hist::bucket_width(idx))
+      result = false;
+  }
+
+  for(uint32_t i=0;i<NTHREADS;i++)
+    pthread_create(&threads[i], NULL, &add_thread, NULL);
+  for(uint32_t i=0;i<NTHREADS;i++)
+    pthread_join(threads[i], NULL);
+
+  hist.get_metrics(m);
+  printf("count=%d, mean=%.1f, p50=%.1f, p90=%.1f, p99=%.1f, max=%.1f\n",
+         m.count, m.mean_us, m.p50_us, m.p90_us, m.p99_us, m.max_us);
+  if(m.count != NTHREADS*NSAMPLES || m.max_us != NSAMPLES ||
+     !within(m.mean_us, (NSAMPLES+1)/2.0, 0.001) ||
+     !within(m.p50_us, NSAMPLES*0.50, 0.125) ||
+     !within(m.p90_us, NSAMPLES*0.90, 0.125) ||
+     !within(m.p99_us, NSAMPLES*0.99, 0.125))
+    result = false;
+
+  // A new period starts after get_metrics()
+  hist.add(5);
+  hist.get_metrics(m);
+  if(m.count != 1 || m.p50_us != 5 || m.p99_us != 5 || m.max_us != 5)
+    result = false;
+  hist.get_metrics(m);
+  if(m.count != 0 || m.mean_us != 0 || m.max_us != 0)
+    result = false;
+
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
@@ -0,0 +1,188 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#define NTHREADS 16
+#define NMSGS    100
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include "common/log_filter.h"
+
+using namespace srslte;
+
+void log_all(log_filter *f)
+{
+  uint8_t hex[100];
+  for(int i=0;i<100;i++)
+    hex[i] = i & 0xFF;
+  const char *null_str = NULL;
+
+  f->set_level(LOG_LEVEL_DEBUG);
+  f->set_hex_limit(40);
+  f->step(1234);
+  f->error("Plain message\n");
+  f->warning("Ints %d %5d %-5d| %u %x %X %o %c\n", -1, 42, 7, 3000000000u, 0xbeef, 0xbeef, 8, 'a');
+  f->info("Longs %ld %lu %lld %llu %zu\n", -1L, 1UL<<40, -1LL, 1ULL<<63, sizeof(hex));
+  f->debug("Floats %f %.2f %e %g %8.3f\n", 1.5, 3.14159, 1e-7, 2.5f, -0.25);
+  f->info("Strings %s %10s %-10s| %.3s %s\n", "abc", "right", "left", "truncate", null_str);
+  f->info("Stars %*d %.*f %*.*s|\n", 6, 42, 3, 2.0, 8, 2, "xyz");
+  f->info("Percent 100%% done\n");
+  f->info_hex(hex, 100, "Hex dump %d bytes", 100);
+  f->debug_hex(hex, 10, "Short hex");
+  f->info_line("file.cc", 10, "Line %d\n", 10);
+  // Not supported by the binary encoder, logged as text
+  f->info("Long double %Lf\n", (long double) 1.5);
+}
+
+std::vector<std::string> read_lines(std::string filename)
+{
+  std::vector<std::string> lines;
+  char buf[1024];
+  FILE *f = fopen(filename.c_str(), "r");
+  if(f) {
+    while(fgets(buf, sizeof(buf), f)) {
+      // Skip the timestamp
+      std::string s(buf);
+      lines.push_back(s[2] == ':' ? s.substr(13) : s);
+    }
+    fclose(f);
+  }
+  return lines;
+}
+
+void* thread_loop(void *a) {
+  logger *l = (logger*)a;
+  char buf[100];
+  sprintf(buf, "T%d", (int) (long) pthread_self() % 1000);
+  log_filter filter(buf, l);
+  filter.set_level(LOG_LEVEL_INFO);
+  for(int i=0;i<NMSGS;i++)
+    filter.info("Thread %s: %d\n", buf, i);
+  return NULL;
+}
+
+// Logs one message and exits, so that thread ids get recycled
+void* short_thread(void *a) {
+  logger *l = (logger*)a;
+  log_filter filter("SHORT", l);
+  filter.set_level(LOG_LEVEL_INFO);
+  filter.info("Short thread\n");
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  bool result = true;
+
+  // Binary records are formatted exactly like text messages
+  {
+    logger     text_logger;
+    logger     bin_logger;
+    text_logger.init("log_text.txt");
+    bin_logger.init("log_binary.txt", true);
+    log_filter text_filter("TEXT", &text_logger, true);
+    log_filter bin_filter("TEXT", &bin_logger, true);
+    log_all(&text_filter);
+    log_all(&bin_filter);
+  }
+  std::vector<std::string> text = read_lines("log_text.txt");
+  std::vector<std::string> bin  = read_lines("log_binary.txt");
+  if(text.size() != bin.size() || text.size() < 10)
+    result = false;
+  for(uint32_t i=0;i<text.size() && i<bin.size();i++) {
+    if(text[i] != bin[i]) {
+      printf("Mismatch:\n  text:   %s  binary: %s", text[i].c_str(), bin[i].c_str());
+      result = false;
+    }
+  }
+
+  // Records from all threads are written
+  {
+    logger l;
+    l.init("log_threads.txt", true);
+    pthread_t threads[NTHREADS];
+    for(int i=0;i<NTHREADS;i++)
+      pthread_create(&threads[i], NULL, &thread_loop, &l);
+    for(int i=0;i<NTHREADS;i++)
+      pthread_join(threads[i], NULL);
+  }
+  std::vector<std::string> lines = read_lines("log_threads.txt");
+  uint32_t n = 0;
+  for(uint32_t i=0;i<lines.size();i++) {
+    if(lines[i].find("Thread") != std::string::npos)
+      n++;
+  }
+  if(n != NTHREADS*NMSGS)
+    result = false;
+
+  // Threads that exit have their ring released, new threads get their own
+  {
+    logger l;
+    l.init("log_exit.txt", true);
+    for(int i=0;i<NTHREADS;i++) {
+      pthread_t t;
+      pthread_create(&t, NULL, &short_thread, &l);
+      pthread_join(t, NULL);
+    }
+  }
+  lines = read_lines("log_exit.txt");
+  n = 0;
+  for(uint32_t i=0;i<lines.size();i++) {
+    if(lines[i].find("Short thread") != std::string::npos)
+      n++;
+  }
+  if(n != NTHREADS)
+    result = false;
+
+  // Long strings are cut and marked
+  {
+    logger l;
+    l.init("log_long.txt", true);
+    log_filter filter("LONG", &l);
+    filter.set_level(LOG_LEVEL_INFO);
+    std::string s(1000, 'a');
+    filter.info("Long %s\n", s.c_str());
+  }
+  lines = read_lines("log_long.txt");
+  if(lines.size() != 2 || lines[0].find("...(truncated)") == std::string::npos)
+    result = false;
+
+  remove("log_exit.txt");
+  remove("log_long.txt");
+  remove("log_text.txt");
+  remove("log_binary.txt");
+  remove("log_threads.txt");
+
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
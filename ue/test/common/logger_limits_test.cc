@@ -0,0 +1,159 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#define NTHREADS  8
+#define NMSGS     2000
+#define NLINES    5000
+#define FILE_SIZE (1024*64)
+#define NOF_FILES 2
+#define MAX_QUEUE (1024*16)
+
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include "common/logger.h"
+
+using namespace srslte;
+
+typedef struct {
+  logger *l;
+  int thread_id;
+}args_t;
+
+void* thread_loop(void *a) {
+  args_t *args = (args_t*)a;
+  char buf[100];
+  for(int i=0;i<NMSGS;i++)
+  {
+    sprintf(buf, "Thread %d: %d\n", args->thread_id, i);
+    args->l->log(buf);
+  }
+  return NULL;
+}
+
+// Rotated files keep the newest lines, in order and without gaps
+bool test_rotation(std::string filename) {
+  bool pass = true;
+  {
+    logger l;
+    l.set_rotation(FILE_SIZE, NOF_FILES);
+    l.init(filename);
+    char buf[100];
+    for(int i=0;i<NLINES;i++) {
+      sprintf(buf, "Line %d: 0123456789012345678901234567890123456789\n", i);
+      l.log(buf);
+      if(i%100 == 0)
+        sched_yield();
+    }
+  }
+
+  int expected = -1;
+  int n;
+  char name[256];
+  for(int k=NOF_FILES;k>=0;k--) {
+    if(k)
+      sprintf(name, "%s.%d", filename.c_str(), k);
+    else
+      sprintf(name, "%s", filename.c_str());
+    FILE *f = fopen(name, "r");
+    if(!f)
+      return false;
+    fseek(f, 0, SEEK_END);
+    if(ftell(f) > FILE_SIZE)
+      pass = false;
+    fseek(f, 0, SEEK_SET);
+    while(fscanf(f, "Line %d: %*s\n", &n) == 1) {
+      if(expected >= 0 && n != expected)
+        pass = false;
+      expected = n+1;
+    }
+    fclose(f);
+    remove(name);
+  }
+  sprintf(name, "%s.%d", filename.c_str(), NOF_FILES+1);
+  if(remove(name) == 0)
+    pass = false;
+  return pass && expected == NLINES;
+}
+
+// Queued memory stays below the limit and every message is either
+// written or counted as dropped
+bool test_limit(std::string filename, logger_drop_policy_t policy) {
+  logger_metrics_t m;
+  {
+    logger l;
+    l.set_max_queue_bytes(MAX_QUEUE, policy);
+    l.init(filename);
+    pthread_t threads[NTHREADS];
+    args_t    args[NTHREADS];
+    for(int i=0;i<NTHREADS;i++) {
+      args[i].l = &l;
+      args[i].thread_id = i;
+      pthread_create(&threads[i], NULL, &thread_loop, &args[i]);
+    }
+    for(int i=0;i<NTHREADS;i++) {
+      pthread_join(threads[i], NULL);
+    }
+    l.get_metrics(m);
+  }
+  printf("dropped=%lu, queue_bytes_max=%d, bytes_written=%lu\n",
+         m.dropped_msgs, m.queue_bytes_max, m.bytes_written);
+
+  uint64_t written  = 0;
+  uint64_t reported = 0;
+  char line[256];
+  FILE *f = fopen(filename.c_str(), "r");
+  if(!f)
+    return false;
+  while(fgets(line, sizeof(line), f)) {
+    int thread, msg, dropped;
+    if(sscanf(line, "Thread %d: %d", &thread, &msg) == 2)
+      written++;
+    else if(sscanf(line, "Log queue full, %d messages dropped", &dropped) == 1)
+      reported += dropped;
+  }
+  fclose(f);
+  remove(filename.c_str());
+
+  return m.queue_bytes_max <= MAX_QUEUE &&
+         written + m.dropped_msgs == NTHREADS*NMSGS &&
+         reported == m.dropped_msgs;
+}
+
+int main(int argc, char **argv) {
+  bool result = true;
+  std::string f("log_limits.txt");
+  result &= test_rotation(f);
+  result &= test_limit(f, LOGGER_DROP_NEWEST);
+  result &= test_limit(f, LOGGER_DROP_OLDEST);
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
@@ -0,0 +1,122 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#define NMSGS     1000000
+#define NOF_SLOTS 8
+#define MAX_LEN   64
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "common/qbuff.h"
+
+using namespace srslte;
+
+typedef struct {
+  qbuff *q;
+  bool   result;
+}args_t;
+
+// Message i holds len(i) bytes, all equal to (uint8_t) i
+static uint32_t msg_len(uint32_t i) { return 1 + (i*7)%MAX_LEN; }
+
+void* write_thread(void *a) {
+  args_t *args = (args_t*)a;
+  for(uint32_t i=0;i<NMSGS;i++)
+  {
+    uint8_t *ptr;
+    while((ptr = (uint8_t*) args->q->request()) == NULL)
+      sched_yield();
+    memset(ptr, (uint8_t) i, msg_len(i));
+    if(!args->q->push(msg_len(i)))
+      args->result = false;
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  bool      result = true;
+  qbuff     q;
+  pthread_t thread;
+  args_t    args;
+  uint32_t  len;
+  uint8_t   buf[MAX_LEN];
+
+  if(!q.init(NOF_SLOTS, MAX_LEN))
+    exit(1);
+
+  // Counters, peek and stream interface without a concurrent writer
+  for(uint32_t i=0;i<NOF_SLOTS;i++)
+    q.send(buf, i+1);
+  if(!q.isfull() || q.request() || q.push(1) ||
+     q.pending_msgs() != NOF_SLOTS || q.pending_data() != NOF_SLOTS*(NOF_SLOTS+1)/2)
+    result = false;
+  if(!q.pop(&len, NOF_SLOTS-1) || len != NOF_SLOTS || q.pop(&len, NOF_SLOTS))
+    result = false;
+  for(uint32_t i=0;i<NOF_SLOTS;i++)
+  {
+    if(q.recv(buf, MAX_LEN) != (int) i+1)
+      result = false;
+  }
+  if(!q.isempty() || q.pop() || q.pending_msgs() != 0 || q.pending_data() != 0)
+    result = false;
+
+  // One thread pushes while this one pops, checking order and contents
+  args.q      = &q;
+  args.result = true;
+  pthread_create(&thread, NULL, &write_thread, &args);
+
+  for(uint32_t i=0;i<NMSGS;i++)
+  {
+    uint8_t *ptr;
+    while((ptr = (uint8_t*) q.pop(&len)) == NULL)
+      sched_yield();
+    if(q.pending_msgs() > NOF_SLOTS || q.pending_data() > NOF_SLOTS*MAX_LEN)
+      result = false;
+    if(len != msg_len(i))
+      result = false;
+    for(uint32_t j=0;j<len;j++)
+    {
+      if(ptr[j] != (uint8_t) i)
+        result = false;
+    }
+    q.release();
+  }
+
+  pthread_join(thread, NULL);
+  result &= args.result;
+  if(!q.isempty() || q.pending_msgs() != 0 || q.pending_data() != 0)
+    result = false;
+
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
@@ -0,0 +1,111 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#define NMSGS    1000000
+#define CAPACITY 16
+#define BATCH    5
+
+#include <stdio.h>
+#include "common/sdu_queue.h"
+
+using namespace srslte;
+
+typedef struct {
+  sdu_queue     *q;
+  byte_buffer_t *bufs;
+}args_t;
+
+void* write_thread(void *a) {
+  args_t *args = (args_t*)a;
+  for(uint32_t i=0;i<NMSGS;i++)
+  {
+    byte_buffer_t *b = &args->bufs[i%(2*CAPACITY)];
+    memcpy(b->msg, &i, 4);
+    b->N_bytes = 4 + i%100;
+    args->q->write(b);
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  bool           result;
+  sdu_queue      q(CAPACITY);
+  byte_buffer_t *bufs = new byte_buffer_t[2*CAPACITY];
+  byte_buffer_t *b[BATCH];
+  pthread_t      thread;
+  args_t         args;
+  uint32_t       r;
+  uint32_t       n_read = 0;
+
+  result = true;
+  args.q    = &q;
+  args.bufs = bufs;
+
+  // Byte accounting and batch reads without a concurrent writer
+  for(uint32_t i=0;i<3;i++)
+  {
+    bufs[i].N_bytes = 10*(i+1);
+    q.write(&bufs[i]);
+  }
+  if(q.size() != 3 || q.size_bytes() != 60 || q.size_tail_bytes() != 10)
+    result = false;
+  if(q.read_batch(b, BATCH) != 3 || b[0] != &bufs[0] || b[2] != &bufs[2])
+    result = false;
+  if(q.size() != 0 || q.size_bytes() != 0 || q.size_tail_bytes() != 0 || q.try_read(b))
+    result = false;
+
+  // The writer blocks on the full queue while the reader drains it in
+  // batches. Buffers are recycled, so the reader copies out each value
+  // before the writer can reuse the slot CAPACITY messages later.
+  pthread_create(&thread, NULL, &write_thread, &args);
+
+  while(n_read < NMSGS)
+  {
+    if(q.size_bytes() > CAPACITY*103)
+      result = false;
+    uint32_t n = q.read_batch(b, BATCH);
+    for(uint32_t i=0;i<n;i++)
+    {
+      memcpy(&r, b[i]->msg, 4);
+      if(r != n_read || b[i]->N_bytes != 4 + n_read%100)
+        result = false;
+      n_read++;
+    }
+  }
+
+  pthread_join(thread, NULL);
+  if(q.size() != 0 || q.size_bytes() != 0)
+    result = false;
+  delete [] bufs;
+
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
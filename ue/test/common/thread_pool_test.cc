@@ -0,0 +1,138 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#define NWORKERS 3
+#define NTTI     20000
+#define SPIN_US  50
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common/thread_pool.h"
+
+using namespace srslte;
+
+class test_worker : public thread_pool::worker
+{
+public:
+  uint32_t  tti;
+  uint32_t *done;
+protected:
+  void work_imp() {
+    done[tti]++;
+  }
+};
+
+// Reads back a wake-up trace and returns the number of samples
+uint32_t read_trace(const char *filename, double *sum_us, uint32_t *max_us) {
+  uint32_t n = 0;
+  uint32_t v[2];
+  FILE *f = fopen(filename, "r");
+  if (!f) {
+    return 0;
+  }
+  while(fread(v, sizeof(uint32_t), 2, f) == 2) {
+    // Unused trace entries are zero
+    if (v[0] || v[1]) {
+      *sum_us += v[1];
+      if (v[1] > *max_us) {
+        *max_us = v[1];
+      }
+      n++;
+    }
+  }
+  fclose(f);
+  remove(filename);
+  return n;
+}
+
+bool run(bool atomic_handoff) {
+  thread_pool  pool(NWORKERS);
+  test_worker  workers[NWORKERS];
+  uint32_t    *done = (uint32_t*) calloc(NTTI, sizeof(uint32_t));
+
+  if (atomic_handoff) {
+    pool.set_atomic_handoff(SPIN_US);
+  }
+  pool.start_trace();
+  for (uint32_t i=0;i<NWORKERS;i++) {
+    workers[i].done = done;
+    pool.init_worker(i, &workers[i]);
+  }
+  for (uint32_t tti=0;tti<NTTI;tti++) {
+    test_worker *w = (test_worker*) pool.wait_worker(tti);
+    if (!w) {
+      return false;
+    }
+    w->tti = tti;
+    if (tti%100 == 99) {
+      // Release without running, like a sync error
+      w->release();
+      done[tti]++;
+    } else {
+      pool.start_worker(w);
+    }
+  }
+  // Wait for the last TTIs to finish
+  for (uint32_t i=0;i<NWORKERS;i++) {
+    pool.wait_worker(NTTI+i);
+  }
+  pool.write_trace("thread_pool_test");
+  pool.stop();
+
+  bool pass = true;
+  for (uint32_t tti=0;tti<NTTI;tti++) {
+    if (done[tti] != 1) {
+      pass = false;
+    }
+  }
+  free(done);
+
+  double   sum_us = 0;
+  uint32_t max_us = 0;
+  uint32_t n      = 0;
+  char     name[64];
+  for (uint32_t i=0;i<NWORKERS;i++) {
+    sprintf(name, "thread_pool_test_%d.wakeup", i);
+    n += read_trace(name, &sum_us, &max_us);
+  }
+  printf("%s hand-off: %d wake-ups, mean=%.1f us, max=%d us\n",
+         atomic_handoff?"atomic":"mutex", n, n?sum_us/n:0, max_us);
+  return pass && n > 0;
+}
+
+int main(int argc, char **argv) {
+  bool result = true;
+  result &= run(false);
+  result &= run(true);
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
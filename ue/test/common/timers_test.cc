@@ -0,0 +1,247 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#define NTIMERS   64
+#define NTICKS    200000
+#define LONG_TIMEOUT ((1<<26)+1000)
+#define NSTARTS   2000
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <boost/atomic.hpp>
+#include "common/timers.h"
+
+using namespace srslte;
+
+// Records the tick at which each timer expired
+class expiry_log
+    :public timer_callback
+{
+public:
+  expiry_log(){memset(fired, 0, sizeof(fired));}
+  void timer_expired(uint32_t timer_id)
+  {
+    fired[timer_id]++;
+  }
+  uint32_t fired[NTIMERS];
+};
+
+// Restarts itself from the callback
+class periodic
+    :public timer_callback
+{
+public:
+  periodic(timers *t_, uint32_t id_):t(t_),id(id_),n(0){}
+  void timer_expired(uint32_t timer_id)
+  {
+    n++;
+    t->get(id)->reset();
+    t->get(id)->run();
+  }
+  timers   *t;
+  uint32_t  id;
+  uint32_t  n;
+};
+
+// Counts expiries of timers started from another thread
+class concurrent_log
+    :public timer_callback
+{
+public:
+  concurrent_log(){n = 0;}
+  void timer_expired(uint32_t timer_id)
+  {
+    n++;
+  }
+  boost::atomic<uint32_t> n;
+};
+
+typedef struct {
+  timers           *t;
+  uint32_t          id;
+  concurrent_log   *log;
+  boost::atomic<bool> done;
+  bool              result;
+}starter_args_t;
+
+// Starts the timer again once the previous start has expired, while the
+// main thread keeps stepping
+void* starter_thread(void *a)
+{
+  starter_args_t *args = (starter_args_t*) a;
+  timers::timer  *t    = args->t->get(args->id);
+  for(uint32_t i=0;i<NSTARTS;i++)
+  {
+    t->set(args->log, 1 + i%5);
+    t->run();
+    while(args->log->n != i+1)
+      sched_yield();
+    if(t->is_running() || !t->is_expired())
+      args->result = false;
+  }
+  args->done = true;
+  return NULL;
+}
+
+static uint32_t random_timeout()
+{
+  uint32_t r = rand()%100;
+  if(r < 60)
+    return rand()%20;
+  if(r < 95)
+    return 200 + rand()%300;
+  return 1000 + rand()%20000;
+}
+
+int main(int argc, char **argv) {
+  bool result = true;
+
+  // Timers in the wheel behave exactly like manually stepped timers
+  timers        wheel(NTIMERS/2);
+  timers::timer ref[NTIMERS];
+  uint32_t      ids[NTIMERS];
+  expiry_log    wheel_log, ref_log;
+  for(uint32_t i=0;i<NTIMERS;i++)
+  {
+    ids[i] = (i < NTIMERS/2) ? i : wheel.get_unique_id();
+    if(ids[i] != i)
+      result = false;
+    ref[i].id = i;
+  }
+  srand(0);
+  for(uint32_t tti=0;tti<NTICKS && result;tti++)
+  {
+    uint32_t i = rand()%NTIMERS;
+    uint32_t timeout;
+    switch(rand()%8)
+    {
+    case 0:
+      timeout = random_timeout();
+      wheel.get(ids[i])->set(&wheel_log, timeout);
+      ref[i].set(&ref_log, timeout);
+      // Intentional fall-through
+    case 1:
+    case 2:
+      wheel.get(ids[i])->run();
+      ref[i].run();
+      break;
+    case 3:
+      wheel.get(ids[i])->stop();
+      ref[i].stop();
+      break;
+    case 4:
+      wheel.get(ids[i])->reset();
+      ref[i].reset();
+      break;
+    case 5:
+      // Released ids are handed out again
+      wheel.release_id(ids[i]);
+      ids[i] = wheel.get_unique_id();
+      if(ids[i] != i)
+        result = false;
+      ref[i] = timers::timer(i);
+      break;
+    default:
+      break;
+    }
+    wheel.step_all();
+    for(uint32_t j=0;j<NTIMERS;j++)
+      ref[j].step();
+    for(uint32_t j=0;j<NTIMERS;j++)
+    {
+      if(wheel_log.fired[j] != ref_log.fired[j]                    ||
+         wheel.get(j)->is_running() != ref[j].is_running()          ||
+         wheel.get(j)->is_expired() != ref[j].is_expired())
+      {
+        printf("Mismatch timer %d at tti %d\n", j, tti);
+        result = false;
+      }
+    }
+  }
+
+  // Invalid ids are rejected
+  if(wheel.get(NTIMERS) != NULL)
+    result = false;
+
+  // Timers can be restarted from their own callback
+  timers   t;
+  uint32_t id = t.get_unique_id();
+  periodic p(&t, id);
+  t.get(id)->set(&p, 10);
+  t.get(id)->run();
+  for(uint32_t tti=0;tti<1000;tti++)
+    t.step_all();
+  if(p.n != 100)
+    result = false;
+  t.release_id(id);
+  if(t.nof_running() != 0)
+    result = false;
+
+  // Timeouts beyond the wheel range expire on time
+  expiry_log l;
+  id = t.get_unique_id();
+  t.get(id)->set(&l, LONG_TIMEOUT);
+  t.get(id)->run();
+  for(uint32_t tti=1;tti<LONG_TIMEOUT;tti++)
+    t.step_all();
+  if(l.fired[id] != 0 || !t.get(id)->is_running())
+    result = false;
+  t.step_all();
+  if(l.fired[id] != 1 || !t.get(id)->is_expired())
+    result = false;
+
+  // Timers started from another thread while stepping expire once per start
+  concurrent_log cl;
+  starter_args_t sa;
+  pthread_t      starter;
+  sa.t      = &t;
+  sa.id     = t.get_unique_id();
+  sa.log    = &cl;
+  sa.done   = false;
+  sa.result = true;
+  pthread_create(&starter, NULL, &starter_thread, &sa);
+  while(!sa.done)
+  {
+    t.step_all();
+    sched_yield();
+  }
+  pthread_join(starter, NULL);
+  for(uint32_t tti=0;tti<10;tti++)
+    t.step_all();
+  if(!sa.result || cl.n != NSTARTS)
+    result = false;
+
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
@@ -0,0 +1,126 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#define NTTI      2000
+#define PERIOD_US 500
+#define SPIN_US   100
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include "common/tti_sync_cv.h"
+#include "common/tti_sync_futex.h"
+
+using namespace srslte;
+
+typedef struct {
+  tti_sync *s;
+  uint64_t  t_produce[NTTI];
+  uint64_t  t_consume[NTTI];
+  bool      in_order;
+}args_t;
+
+uint64_t now_ns() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t) t.tv_sec*1000000000 + t.tv_nsec;
+}
+
+void* consumer(void *a) {
+  args_t *args = (args_t*)a;
+  for(uint32_t i=0;i<NTTI;i++) {
+    uint32_t x = args->s->wait();
+    args->t_consume[i] = now_ns();
+    if(x != i) {
+      args->in_order = false;
+    }
+  }
+  return NULL;
+}
+
+// Ticks the producer every PERIOD_US and measures how long the consumer
+// takes to wake up
+bool run(const char *name, tti_sync *s) {
+  args_t   *args = new args_t;
+  pthread_t thread;
+  args->s        = s;
+  args->in_order = true;
+  s->set_producer_cntr(0);
+  pthread_create(&thread, NULL, &consumer, args);
+
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  for(uint32_t i=0;i<NTTI;i++) {
+    next.tv_nsec += PERIOD_US*1000;
+    if(next.tv_nsec >= 1000000000) {
+      next.tv_nsec -= 1000000000;
+      next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    args->t_produce[i] = now_ns();
+    s->increase();
+  }
+  pthread_join(thread, NULL);
+
+  std::vector<double> lat(NTTI);
+  double sum = 0;
+  for(uint32_t i=0;i<NTTI;i++) {
+    lat[i] = (args->t_consume[i] - args->t_produce[i])/1000.0;
+    sum   += lat[i];
+  }
+  double mean = sum/NTTI;
+  double var  = 0;
+  for(uint32_t i=0;i<NTTI;i++) {
+    var += (lat[i]-mean)*(lat[i]-mean);
+  }
+  std::sort(lat.begin(), lat.end());
+  printf("%-14s wake-up latency: mean=%.1f us, stddev=%.1f us, p99=%.1f us, max=%.1f us\n",
+         name, mean, sqrt(var/NTTI), lat[NTTI*99/100], lat[NTTI-1]);
+
+  bool pass = args->in_order;
+  delete args;
+  return pass;
+}
+
+int main(int argc, char **argv) {
+  bool result = true;
+  tti_sync_cv    cv;
+  tti_sync_futex futex;
+  tti_sync_futex futex_spin(10240, SPIN_US);
+  result &= run("tti_sync_cv", &cv);
+  result &= run("futex", &futex);
+  result &= run("futex+spin", &futex_spin);
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
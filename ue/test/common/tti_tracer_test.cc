@@ -0,0 +1,131 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#define NTHREADS 4
+#define NTTIS    1000
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "common/tti_tracer.h"
+
+using namespace srslte;
+
+void* worker_thread(void *a) {
+  char name[16];
+  snprintf(name, 16, "worker%lu", (unsigned long) a);
+  pthread_setname_np(pthread_self(), name);
+  for(uint32_t tti=0;tti<NTTIS;tti++)
+  {
+    tti_span s("worker", tti);
+    {
+      tti_span s2("pdsch", tti);
+    }
+  }
+  return NULL;
+}
+
+uint32_t count(const char *str, const char *pattern) {
+  uint32_t n = 0;
+  for(const char *p=strstr(str, pattern);p;p=strstr(p+1, pattern))
+    n++;
+  return n;
+}
+
+int main(int argc, char **argv) {
+  bool      result = true;
+  pthread_t threads[NTHREADS];
+  const char *filename = "/tmp/tti_tracer_test.json";
+
+  tti_tracer *tracer = tti_tracer::get_instance();
+
+  // Nothing is recorded while stopped
+  {
+    tti_span s("before_start", 0);
+  }
+
+  tracer->start();
+  for(unsigned long i=0;i<NTHREADS;i++)
+    pthread_create(&threads[i], NULL, &worker_thread, (void*) i);
+  for(uint32_t i=0;i<NTHREADS;i++)
+    pthread_join(threads[i], NULL);
+  tracer->stop();
+
+  {
+    tti_span s("after_stop", 0);
+  }
+
+  if(!tracer->write_json(filename))
+    result = false;
+
+  FILE *f = fopen(filename, "r");
+  char *buf = (char*) calloc(1, 16*1024*1024);
+  fread(buf, 1, 16*1024*1024-1, f);
+  fclose(f);
+
+  uint32_t nof_worker = count(buf, "\"name\":\"worker\"");
+  uint32_t nof_pdsch  = count(buf, "\"name\":\"pdsch\"");
+  uint32_t nof_x      = count(buf, "\"ph\":\"X\"");
+  printf("worker=%d, pdsch=%d, events=%d\n", nof_worker, nof_pdsch, nof_x);
+  if(nof_worker != NTHREADS*NTTIS || nof_pdsch != NTHREADS*NTTIS || nof_x != 2*NTHREADS*NTTIS)
+    result = false;
+  if(count(buf, "before_start") || count(buf, "after_stop"))
+    result = false;
+  if(!count(buf, "\"args\":{\"name\":\"worker3\"}") || strncmp(buf, "{\"displayTimeUnit\"", 18))
+    result = false;
+
+  free(buf);
+
+  std::map<std::string, std::vector<uint64_t> > durations;
+  tracer->get_durations(durations);
+  if(durations.size() != 2 || durations["worker"].size() != NTHREADS*NTTIS || durations["pdsch"].size() != NTHREADS*NTTIS)
+    result = false;
+
+  tti_tracer::cleanup();
+
+  // A span that ends after cleanup() neither creates a tracer nor is kept
+  uint64_t later = tti_tracer::now_ns() + 1000000000;
+  tti_tracer::record("after_cleanup", 0, later, later+1);
+  if(!tti_tracer::get_instance()->write_json(filename))
+    result = false;
+  f   = fopen(filename, "r");
+  buf = (char*) calloc(1, 16*1024*1024);
+  fread(buf, 1, 16*1024*1024-1, f);
+  fclose(f);
+  if(count(buf, "after_cleanup"))
+    result = false;
+  free(buf);
+  tti_tracer::cleanup();
+
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
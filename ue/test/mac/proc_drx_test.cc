@@ -0,0 +1,197 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common/log_stdout.h"
+#include "mac/proc_drx.h"
+
+using namespace srsue;
+using namespace srslte;
+
+log_stdout                   drx_log("MAC");
+mac_interface_rrc::mac_cfg_t cfg;
+drx_proc                     drx;
+
+// Checks the Active Time of TTIs [start, end) against the set of active TTIs
+bool check(uint32_t start, uint32_t end, const uint32_t *active, uint32_t nof_active) {
+  bool result = true;
+  for(uint32_t tti=start;tti!=end;tti=(tti+1)%10240) {
+    bool expected = false;
+    for(uint32_t i=0;i<nof_active;i++)
+      if(active[i] == tti)
+        expected = true;
+    if(drx.is_active_time(tti) != expected) {
+      printf("tti=%d: expected %s\n", tti, expected?"active":"sleep");
+      result = false;
+    }
+  }
+  return result;
+}
+
+int main(int argc, char **argv) {
+  bool result = true;
+
+  drx_log.set_level(LOG_LEVEL_INFO);
+  bzero(&cfg, sizeof(mac_interface_rrc::mac_cfg_t));
+  drx.init(&drx_log, &cfg);
+
+  // Not configured: always awake
+  drx.reconfigure();
+  for(uint32_t tti=0;tti<100;tti++)
+    if(!drx.is_active_time(tti))
+      result = false;
+
+  // onDuration 2, inactivity 4, retransmission 4, long cycle 40 starting at 5
+  cfg.main.drx_cnfg.setup_present                      = true;
+  cfg.main.drx_cnfg.on_duration_timer                  = LIBLTE_RRC_ON_DURATION_TIMER_PSF2;
+  cfg.main.drx_cnfg.drx_inactivity_timer               = LIBLTE_RRC_DRX_INACTIVITY_TIMER_PSF4;
+  cfg.main.drx_cnfg.drx_retx_timer                     = LIBLTE_RRC_DRX_RETRANSMISSION_TIMER_PSF4;
+  cfg.main.drx_cnfg.long_drx_cycle_start_offset_choice = LIBLTE_RRC_LONG_DRX_CYCLE_START_OFFSET_SF40;
+  cfg.main.drx_cnfg.long_drx_cycle_start_offset        = 5;
+  drx.reconfigure();
+  uint32_t on_duration[] = {5, 6, 45, 46};
+  result &= check(0, 80, on_duration, 4);
+
+  // A new DL transmission at 6 extends the Active Time to 10
+  drx.new_grant_dl(6, 0, true);
+  uint32_t inactivity[] = {5, 6, 7, 8, 9, 10, 45, 46};
+  result &= check(0, 80, inactivity, 8);
+
+  // A retransmission does not start drx-InactivityTimer. Its NACK wakes up
+  // the UE for drx-RetransmissionTimer after the HARQ RTT
+  drx.new_grant_dl(45, 3, false);
+  drx.tb_decoded(3, false);
+  uint32_t retx[] = {45, 46, 53, 54, 55, 56};
+  result &= check(41, 80, retx, 6);
+  drx.new_grant_dl(53, 3, false);
+  drx.tb_decoded(3, true);
+  uint32_t retx_acked[] = {45, 46};
+  result &= check(41, 80, retx_acked, 2);
+
+  // An UL transmission keeps the PHICH subframe awake for an adaptive retransmission
+  drx.new_grant_ul(60, false, true);
+  uint32_t ul_retx[] = {68};
+  result &= check(60, 80, ul_retx, 1);
+
+  // DRX Command stops the onDuration and inactivity timers
+  drx.reset();
+  drx.new_grant_dl(85, 0, true);
+  drx.drx_command(87);
+  uint32_t drx_cmd[] = {85, 86};
+  result &= check(80, 120, drx_cmd, 2);
+
+  // With a short cycle of 5 subframes during 2 cycles after the command
+  cfg.main.drx_cnfg.short_drx_present     = true;
+  cfg.main.drx_cnfg.short_drx_cycle       = LIBLTE_RRC_SHORT_DRX_CYCLE_SF5;
+  cfg.main.drx_cnfg.short_drx_cycle_timer = 2;
+  drx.reconfigure();
+  drx.new_grant_dl(85, 0, true);
+  drx.drx_command(87);
+  uint32_t short_cycle[] = {85, 86, 90, 91, 95, 96, 125, 126};
+  result &= check(80, 130, short_cycle, 8);
+
+  // The short cycle also follows the expiry of drx-InactivityTimer
+  drx.reset();
+  drx.new_grant_dl(125, 0, true);
+  uint32_t short_after_inactivity[] = {125, 126, 127, 128, 129, 130, 131, 135, 136, 165, 166};
+  result &= check(120, 170, short_after_inactivity, 11);
+
+  // Timers run across the TTI counter wrap around
+  cfg.main.drx_cnfg.short_drx_present = false;
+  drx.reconfigure();
+  drx.new_grant_ul(10238, true, false);
+  uint32_t wrap[] = {10238, 10239, 0, 1, 2, 5, 6};
+  result &= check(10230, 10, wrap, 7);
+
+  // Workers may report grants out of order
+  drx.reset();
+  drx.new_grant_dl(201, 0, true);
+  drx.new_grant_dl(200, 1, true);
+  uint32_t out_of_order[] = {201, 202, 203, 204, 205, 206};
+  result &= check(201, 240, out_of_order, 6);
+
+  // Events are forgotten before the TTI counter wraps around
+  for(uint32_t tti=202;tti<202+10240;tti++)
+    drx.step(tti%10240, false);
+  uint32_t forgotten[] = {205, 206};
+  result &= check(201, 240, forgotten, 2);
+
+  // A pending SR keeps the UE awake
+  drx.step(240, true);
+  for(uint32_t tti=240;tti<280;tti++)
+    if(!drx.is_active_time(tti))
+      result = false;
+  drx.step(280, false);
+  drx.get_sleep_count();
+  uint32_t sr_sent[] = {285, 286};
+  result &= check(280, 320, sr_sent, 2);
+
+  // Only the TTIs stepped by the MAC thread count as sleep, not the queries of the workers
+  if(drx.get_sleep_count() != 0)
+    result = false;
+  for(uint32_t tti=280;tti<320;tti++)
+    drx.step(tti, false);
+  if(drx.get_sleep_count() != 38)
+    result = false;
+
+  // Workers keep monitoring the PDCCH while an earlier monitored TTI is still being
+  // processed, since its grants may extend the Active Time
+  drx.reset();
+  if(!drx.monitor_pdcch(325) || !drx.monitor_pdcch(326) || !drx.monitor_pdcch(327))
+    result = false;
+  drx.new_grant_dl(326, 0, true);
+  drx.pdcch_done(325);
+  drx.pdcch_done(326);
+  drx.pdcch_done(327);
+  for(uint32_t tti=328;tti<=330;tti++) {
+    if(!drx.monitor_pdcch(tti))
+      result = false;
+    drx.pdcch_done(tti);
+  }
+  if(drx.monitor_pdcch(331) || drx.monitor_pdcch(332))
+    result = false;
+
+  // Only up to the maximum worker lag if pdcch_done() is never called
+  if(!drx.monitor_pdcch(366) || !drx.monitor_pdcch(380))
+    result = false;
+  drx.pdcch_done(380);
+  if(drx.monitor_pdcch(382))
+    result = false;
+  for(uint32_t tti=382;tti<382+10240;tti++)
+    drx.step(tti%10240, false);
+  if(drx.monitor_pdcch(367))
+    result = false;
+
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
@@ -0,0 +1,224 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/* Decodes PDSCH subframes generated with srslte_enb_dl through pdsch_decoder
+ * and through srslte_pdsch_decode_rnti, for each bandwidth, number of ports,
+ * CFI, subframe with and without synchronization signals, and MCS, and checks
+ * that both return the same CRC result and payload. Grants of a single code
+ * block must be left to srslte_pdsch, and so must a PDSCH configuration whose
+ * RE count does not match the grant */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "srslte/srslte.h"
+#include "phy/pdsch_decoder.h"
+#include "common/log_stdout.h"
+
+#define RNTI     0x46
+#define MAX_NOI  4
+
+using namespace srsue;
+
+static uint32_t nof_prbs[]   = {6, 15, 25, 50, 75, 100};
+static uint32_t nof_ports[]  = {1, 2};
+static uint32_t cfis[]       = {1, 2, 3};
+static uint32_t sf_idxs[]    = {0, 1, 5};
+static uint32_t mcss[]       = {0, 16, 28};
+
+#define NOF(x) (sizeof(x)/sizeof(x[0]))
+
+static uint8_t tx_data[SRSLTE_MAX_BUFFER_SIZE_BYTES];
+static uint8_t rx_data[SRSLTE_MAX_BUFFER_SIZE_BYTES];
+static uint8_t ref_data[SRSLTE_MAX_BUFFER_SIZE_BYTES];
+
+/* Encodes the PDSCH of one subframe with both ports added on the same
+ * channel. Returns false on error */
+bool generate_subframe(srslte_enb_dl_t *enb_dl, srslte_ra_dl_grant_t *grant, srslte_softbuffer_tx_t *softbuffer,
+                       uint32_t sf_idx, cf_t *signal)
+{
+  srslte_enb_dl_clear_sf(enb_dl);
+  srslte_enb_dl_put_base(enb_dl, sf_idx);
+  srslte_softbuffer_tx_reset(softbuffer);
+  if (srslte_enb_dl_put_pdsch(enb_dl, grant, softbuffer, RNTI, 0, sf_idx, tx_data)) {
+    return false;
+  }
+  uint32_t sf_len = SRSLTE_SF_LEN_RE(enb_dl->cell.nof_prb, enb_dl->cell.cp);
+  for (uint32_t p=1;p<enb_dl->cell.nof_ports;p++) {
+    srslte_vec_sum_ccc(enb_dl->sf_symbols[0], enb_dl->sf_symbols[p], enb_dl->sf_symbols[0], sf_len);
+  }
+  srslte_enb_dl_gen_signal(enb_dl, signal);
+  return true;
+}
+
+/* Runs all CFIs, subframes and MCS of one cell. Returns the number of errors */
+int run_cell(srslte_cell_t cell, srslte::log *log_h)
+{
+  srslte_enb_dl_t        enb_dl;
+  srslte_ue_dl_t         ue_dl;
+  srslte_softbuffer_tx_t softbuffer_tx;
+  srslte_softbuffer_rx_t softbuffer_dec;
+  srslte_softbuffer_rx_t softbuffer_ref;
+  pdsch_decoder          pdsch_dec;
+  int                    errors = 0;
+
+  cf_t *signal = (cf_t*) srslte_vec_malloc(sizeof(cf_t) * SRSLTE_SF_LEN_PRB(cell.nof_prb));
+  if (!signal || srslte_enb_dl_init(&enb_dl, cell) || srslte_ue_dl_init(&ue_dl, cell)) {
+    printf("Error initiating the eNodeB or UE DL\n");
+    exit(-1);
+  }
+  srslte_enb_dl_add_rnti(&enb_dl, RNTI);
+  srslte_ue_dl_set_rnti(&ue_dl, RNTI);
+  srslte_softbuffer_tx_init(&softbuffer_tx, cell.nof_prb);
+  srslte_softbuffer_rx_init(&softbuffer_dec, cell.nof_prb);
+  srslte_softbuffer_rx_init(&softbuffer_ref, cell.nof_prb);
+  srslte_sch_set_max_noi(&ue_dl.pdsch.dl_sch, MAX_NOI);
+
+  pdsch_dec.init(log_h);
+  if (!pdsch_dec.init_cell(cell) || !pdsch_dec.start_helpers(1, 0, -1)) {
+    printf("Error initiating the PDSCH decoder\n");
+    exit(-1);
+  }
+  pdsch_dec.set_rnti(RNTI);
+  pdsch_dec.set_max_noi(MAX_NOI);
+
+  for (uint32_t c=0;c<NOF(cfis);c++) {
+    srslte_enb_dl_set_cfi(&enb_dl, cfis[c]);
+    for (uint32_t s=0;s<NOF(sf_idxs);s++) {
+      for (uint32_t m=0;m<NOF(mcss);m++) {
+        uint32_t sf_idx = sf_idxs[s];
+
+        srslte_ra_dl_dci_t dci;
+        bzero(&dci, sizeof(srslte_ra_dl_dci_t));
+        uint32_t P                  = srslte_ra_type0_P(cell.nof_prb);
+        dci.alloc_type              = SRSLTE_RA_ALLOC_TYPE0;
+        dci.type0_alloc.rbg_bitmask = (1<<((cell.nof_prb+P-1)/P))-1;
+        dci.mcs_idx                 = mcss[m];
+        srslte_ra_dl_grant_t grant;
+        if (srslte_ra_dl_dci_to_grant(&dci, cell.nof_prb, RNTI, &grant)) {
+          printf("Error invalid DL grant for MCS %d\n", mcss[m]);
+          exit(-1);
+        }
+        if (!generate_subframe(&enb_dl, &grant, &softbuffer_tx, sf_idx, signal)) {
+          printf("Error encoding subframe %d\n", sf_idx);
+          exit(-1);
+        }
+
+        uint32_t cfi = 0;
+        if (srslte_ue_dl_decode_fft_estimate(&ue_dl, signal, sf_idx, &cfi) < 0 || cfi != cfis[c] ||
+            srslte_ue_dl_cfg_grant(&ue_dl, &grant, cfi, sf_idx, 0))
+        {
+          printf("Error configuring the UE DL for CFI %d\n", cfis[c]);
+          exit(-1);
+        }
+        srslte_pdsch_cfg_t *cfg    = &ue_dl.pdsch_cfg;
+        float               noise  = srslte_chest_dl_get_noise_estimate(&ue_dl.chest);
+        uint32_t            nbytes = grant.mcs.tbs/8;
+
+        srslte_softbuffer_rx_reset(&softbuffer_dec);
+        srslte_softbuffer_rx_reset(&softbuffer_ref);
+        bzero(rx_data, nbytes);
+        bzero(ref_data, nbytes);
+        int ret = pdsch_dec.decode(cfg, &softbuffer_dec, ue_dl.sf_symbols, ue_dl.ce, noise, RNTI, rx_data);
+        int ref = srslte_pdsch_decode_rnti(&ue_dl.pdsch, cfg, &softbuffer_ref, ue_dl.sf_symbols, ue_dl.ce,
+                                           noise, RNTI, ref_data);
+
+        char name[64];
+        snprintf(name, 64, "%d PRB, %d ports, CFI %d, SF %d, MCS %d, C=%d", cell.nof_prb, cell.nof_ports,
+                 cfis[c], sf_idx, mcss[m], cfg->cb_segm.C);
+        if (ref != SRSLTE_SUCCESS || memcmp(ref_data, tx_data, nbytes)) {
+          printf("%s: srslte_pdsch did not decode the TB\n", name);
+          errors++;
+        }
+        if (cfg->cb_segm.C < 2) {
+          if (ret != SRSLTE_ERROR_INVALID_INPUTS) {
+            printf("%s: single code block not left to srslte_pdsch\n", name);
+            errors++;
+          }
+          continue;
+        }
+        if (ret != ref || memcmp(rx_data, ref_data, nbytes)) {
+          printf("%s: CRC %s, payload %s\n", name, ret == ref ? "equal" : "differs",
+                 memcmp(rx_data, ref_data, nbytes) ? "differs" : "equal");
+          errors++;
+        }
+
+        // A configuration that disagrees with the grant goes back to srslte_pdsch
+        cfg->nbits.nof_re--;
+        if (pdsch_dec.decode(cfg, &softbuffer_dec, ue_dl.sf_symbols, ue_dl.ce, noise, RNTI, rx_data) != SRSLTE_ERROR_INVALID_INPUTS) {
+          printf("%s: RE count mismatch not left to srslte_pdsch\n", name);
+          errors++;
+        }
+        cfg->nbits.nof_re++;
+      }
+    }
+  }
+
+  pdsch_dec.stop_helpers();
+  pdsch_dec.free_cell();
+  srslte_softbuffer_tx_free(&softbuffer_tx);
+  srslte_softbuffer_rx_free(&softbuffer_dec);
+  srslte_softbuffer_rx_free(&softbuffer_ref);
+  srslte_ue_dl_free(&ue_dl);
+  srslte_enb_dl_free(&enb_dl);
+  free(signal);
+  return errors;
+}
+
+int main(int argc, char **argv)
+{
+  srslte::log_stdout log("PHY");
+  log.set_level(srslte::LOG_LEVEL_NONE);
+
+  srand(0);
+  for (uint32_t i=0;i<sizeof(tx_data);i++) {
+    tx_data[i] = rand()&0xff;
+  }
+
+  int errors = 0;
+  for (uint32_t i=0;i<NOF(nof_prbs);i++) {
+    for (uint32_t j=0;j<NOF(nof_ports);j++) {
+      srslte_cell_t cell;
+      bzero(&cell, sizeof(srslte_cell_t));
+      cell.nof_prb         = nof_prbs[i];
+      cell.nof_ports       = nof_ports[j];
+      cell.id              = 1;
+      cell.cp              = SRSLTE_CP_NORM;
+      cell.phich_length    = SRSLTE_PHICH_NORM;
+      cell.phich_resources = SRSLTE_PHICH_R_1;
+      errors += run_cell(cell, &log);
+    }
+  }
+
+  if (!errors) {
+    printf("Passed\n");
+    exit(0);
+  } else {
+    printf("Failed\n;");
+    exit(1);
+  }
+}
@@ -0,0 +1,510 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/* Runs a PHY worker on synthetic subframes that carry a PDSCH over the whole
+ * band and an UL grant, for each bandwidth and MCS. Reports the time of each
+ * processing stage, recorded with the TTI tracer spans, and of the cell and
+ * RNTI setup as JSON. Fails if any PDSCH is not decoded. In pipelined mode a 
+ * PDSCH may be NACKed on air when it misses the UL deadline, and then MAC must 
+ * be told the same NACK */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "srslte/srslte.h"
+#include "phy/phy.h"
+#include "phy/phch_common.h"
+#include "phy/phch_worker.h"
+#include "phy/prach.h"
+#include "radio/radio.h"
+#include "common/log_stdout.h"
+#include "common/tti_tracer.h"
+
+#define RNTI     0x46
+#define CFI      3
+
+using namespace srsue;
+using namespace srslte;
+
+/**********************************************************************
+ *  Program arguments processing
+ ***********************************************************************/
+
+typedef struct {
+  std::vector<uint32_t> nof_prb;
+  std::vector<uint32_t> mcs;
+  uint32_t              nof_subframes;
+  uint32_t              nof_reps;
+  bool                  pregen;
+  bool                  pipelined;
+  int                   deadline_us;
+  int                   cpu;
+  const char           *output;
+}prog_args_t;
+
+prog_args_t prog_args;
+
+void parse_list(char *str, std::vector<uint32_t> &list) {
+  list.clear();
+  for (char *tok=strtok(str, ",");tok;tok=strtok(NULL, ",")) {
+    list.push_back(atoi(tok));
+  }
+}
+
+void args_default(prog_args_t *args) {
+  char prb[] = "6,15,25,50,75,100";
+  char mcs[] = "0,9,16,28";
+  parse_list(prb, args->nof_prb);
+  parse_list(mcs, args->mcs);
+  args->nof_subframes = 1000;
+  args->nof_reps      = 10;
+  args->pregen        = false;
+  args->pipelined     = false;
+  args->deadline_us   = -1;
+  args->cpu           = -1;
+  args->output        = NULL;
+}
+
+void usage(prog_args_t *args, char *prog) {
+  printf("Usage: %s [pmnrgldco]\n", prog);
+  printf("\t-p PRB list [Default 6,15,25,50,75,100]\n");
+  printf("\t-m DL MCS list [Default 0,9,16,28]\n");
+  printf("\t-n subframes per bandwidth and MCS [Default %d]\n", args->nof_subframes);
+  printf("\t-r repetitions of the cell and RNTI setup [Default %d]\n", args->nof_reps);
+  printf("\t-g pre-generate UL signals\n");
+  printf("\t-l run the UL stage on its own thread (pipelined mode)\n");
+  printf("\t-d HARQ-ACK deadline in pipelined mode, in us [Default PHY default]\n");
+  printf("\t-c pin the worker to this CPU [Default none]\n");
+  printf("\t-o JSON output file [Default stdout]\n");
+}
+
+void parse_args(prog_args_t *args, int argc, char **argv) {
+  int opt;
+  args_default(args);
+  while ((opt = getopt(argc, argv, "pmnrgldco")) != -1) {
+    switch (opt) {
+    case 'p':
+      parse_list(argv[optind], args->nof_prb);
+      break;
+    case 'm':
+      parse_list(argv[optind], args->mcs);
+      break;
+    case 'n':
+      args->nof_subframes = atoi(argv[optind]);
+      break;
+    case 'r':
+      args->nof_reps = atoi(argv[optind]);
+      break;
+    case 'g':
+      args->pregen = true;
+      break;
+    case 'l':
+      args->pipelined = true;
+      break;
+    case 'd':
+      args->deadline_us = atoi(argv[optind]);
+      break;
+    case 'c':
+      args->cpu = atoi(argv[optind]);
+      break;
+    case 'o':
+      args->output = argv[optind];
+      break;
+    default:
+      usage(args, argv[0]);
+      exit(-1);
+    }
+  }
+  // Spans of a configuration must fit in the tracer ring of the worker
+  if (args->nof_subframes < 1 || args->nof_subframes*10 > TTI_TRACER_RING_SIZE) {
+    printf("Number of subframes must be between 1 and %d\n", TTI_TRACER_RING_SIZE/10);
+    exit(-1);
+  }
+}
+
+/******** MAC Interface implementation */
+class benchmac : public mac_interface_phy
+{
+public:
+  benchmac(uint32_t nof_prb) {
+    srslte_softbuffer_rx_init(&dl_softbuffer, nof_prb);
+    srslte_softbuffer_tx_init(&ul_softbuffer, nof_prb);
+    bzero(ul_payload, sizeof(ul_payload));
+    nof_dl_ok   = 0;
+    nof_dl_nack = 0;
+    ul_tbs    = 0;
+  }
+  ~benchmac() {
+    srslte_softbuffer_rx_free(&dl_softbuffer);
+    srslte_softbuffer_tx_free(&ul_softbuffer);
+  }
+  void new_grant_ul(mac_grant_t grant, tb_action_ul_t *action) {
+    // Every grant is a new transmission
+    srslte_softbuffer_tx_reset(&ul_softbuffer);
+    action->tx_enabled    = true;
+    action->expect_ack    = false;
+    action->rv            = 0;
+    action->rnti          = grant.rnti;
+    action->current_tx_nb = 0;
+    action->softbuffer    = &ul_softbuffer;
+    action->payload_ptr   = ul_payload;
+    memcpy(&action->phy_grant, &grant.phy_grant, sizeof(srslte_phy_grant_t));
+    ul_tbs = 8*grant.n_bytes;
+  }
+  void new_grant_ul_ack(mac_grant_t grant, bool ack, tb_action_ul_t *action) {
+    new_grant_ul(grant, action);
+  }
+  void harq_recv(uint32_t tti, bool ack, tb_action_ul_t *action) {
+    action->tx_enabled = false;
+  }
+  void new_grant_dl(mac_grant_t grant, tb_action_dl_t *action) {
+    srslte_softbuffer_rx_reset(&dl_softbuffer);
+    action->decode_enabled        = true;
+    action->default_ack           = false;
+    action->generate_ack          = true;
+    action->generate_ack_callback = NULL;
+    action->payload_ptr           = dl_payload;
+    action->softbuffer            = &dl_softbuffer;
+    action->rv                    = grant.rv;
+    action->rnti                  = grant.rnti;
+    action->current_tx_nb         = 0;
+    memcpy(&action->phy_grant, &grant.phy_grant, sizeof(srslte_phy_grant_t));
+  }
+  void tb_decoded(bool ack, srslte_rnti_type_t rnti, uint32_t harq_pid) {
+    if (ack) {
+      nof_dl_ok++;
+    } else {
+      nof_dl_nack++;
+    }
+  }
+  void bch_decoded_ok(uint8_t *payload, uint32_t len) {}
+  void pch_decoded_ok(uint32_t len) {}
+  bool is_active_time(uint32_t tti) {return true;}
+  void pdcch_done(uint32_t tti) {}
+  void tti_clock(uint32_t tti) {}
+
+  uint32_t nof_dl_ok;
+  uint32_t nof_dl_nack;
+  uint32_t ul_tbs;
+
+private:
+  srslte_softbuffer_rx_t dl_softbuffer;
+  srslte_softbuffer_tx_t ul_softbuffer;
+  uint8_t                dl_payload[SRSLTE_MAX_BUFFER_SIZE_BYTES];
+  uint8_t                ul_payload[SRSLTE_MAX_BUFFER_SIZE_BYTES];
+};
+
+/******** Synthetic eNodeB subframes */
+
+// Largest UL allocation that DFT precoding supports, leaving the PUCCH at the band edges
+uint32_t ul_nof_prb(uint32_t nof_prb) {
+  uint32_t L = nof_prb - 2;
+  while (!srslte_dft_precoding_valid_prb(L)) {
+    L--;
+  }
+  return L;
+}
+
+/* One subframe per subframe index, each with a DL grant of all RBGs and
+ * an UL grant on the same C-RNTI. Returns the DL TBS */
+int generate_subframes(srslte_cell_t cell, uint32_t mcs, std::vector<cf_t*> &subframes) {
+  srslte_enb_dl_t        enb_dl;
+  srslte_softbuffer_tx_t softbuffer;
+  static uint8_t         data[SRSLTE_MAX_BUFFER_SIZE_BYTES];
+
+  if (srslte_enb_dl_init(&enb_dl, cell)) {
+    fprintf(stderr, "Error initiating eNodeB DL\n");
+    return -1;
+  }
+  srslte_enb_dl_set_cfi(&enb_dl, CFI);
+  srslte_enb_dl_add_rnti(&enb_dl, RNTI);
+  srslte_softbuffer_tx_init(&softbuffer, cell.nof_prb);
+  for (uint32_t i=0;i<sizeof(data);i++) {
+    data[i] = rand()&0xff;
+  }
+
+  srslte_ra_dl_dci_t dl_dci;
+  bzero(&dl_dci, sizeof(srslte_ra_dl_dci_t));
+  uint32_t P                     = srslte_ra_type0_P(cell.nof_prb);
+  dl_dci.alloc_type              = SRSLTE_RA_ALLOC_TYPE0;
+  dl_dci.type0_alloc.rbg_bitmask = (1<<((cell.nof_prb+P-1)/P))-1;
+  dl_dci.mcs_idx                 = mcs;
+
+  srslte_ra_ul_dci_t ul_dci;
+  bzero(&ul_dci, sizeof(srslte_ra_ul_dci_t));
+  ul_dci.freq_hop_fl          = ul_dci.SRSLTE_RA_PUSCH_HOP_DISABLED;
+  ul_dci.type2_alloc.RB_start = 1;
+  ul_dci.type2_alloc.L_crb    = ul_nof_prb(cell.nof_prb);
+  ul_dci.mcs_idx              = SRSLTE_MIN(mcs, 20);   // No 64QAM in the UL
+
+  srslte_ra_dl_grant_t grant;
+  if (srslte_ra_dl_dci_to_grant(&dl_dci, cell.nof_prb, RNTI, &grant)) {
+    fprintf(stderr, "Error invalid DL grant for MCS %d\n", mcs);
+    return -1;
+  }
+
+  uint32_t sf_len = SRSLTE_SF_LEN_PRB(cell.nof_prb);
+  for (uint32_t sf_idx=0;sf_idx<10;sf_idx++) {
+    // First two UE specific candidates that do not overlap
+    srslte_dci_location_t locations[64];
+    uint32_t nof_locations = srslte_pdcch_ue_locations(&enb_dl.pdcch, locations, 64, sf_idx, CFI, RNTI);
+    uint32_t ul_loc        = 1;
+    while (ul_loc < nof_locations &&
+           locations[ul_loc].ncce < locations[0].ncce + (1<<locations[0].L) &&
+           locations[0].ncce < locations[ul_loc].ncce + (1<<locations[ul_loc].L)) {
+      ul_loc++;
+    }
+    if (ul_loc >= nof_locations) {
+      fprintf(stderr, "Error no PDCCH space for the DL and UL grants\n");
+      return -1;
+    }
+
+    srslte_enb_dl_clear_sf(&enb_dl);
+    srslte_enb_dl_put_base(&enb_dl, sf_idx);
+    srslte_softbuffer_tx_reset(&softbuffer);
+    if (srslte_enb_dl_put_pdcch_dl(&enb_dl, &dl_dci, SRSLTE_DCI_FORMAT1, locations[0], RNTI, sf_idx) ||
+        srslte_enb_dl_put_pdcch_ul(&enb_dl, &ul_dci, locations[ul_loc], RNTI, sf_idx) ||
+        srslte_enb_dl_put_pdsch(&enb_dl, &grant, &softbuffer, RNTI, 0, sf_idx, data))
+    {
+      fprintf(stderr, "Error encoding subframe %d\n", sf_idx);
+      return -1;
+    }
+    subframes[sf_idx] = (cf_t*) srslte_vec_malloc(sf_len*sizeof(cf_t));
+    srslte_enb_dl_gen_signal(&enb_dl, subframes[sf_idx]);
+  }
+
+  srslte_softbuffer_tx_free(&softbuffer);
+  srslte_enb_dl_free(&enb_dl);
+  return grant.mcs.tbs;
+}
+
+/******** Measurements */
+
+typedef std::map<std::string, std::vector<uint64_t> > durations_t;
+
+void write_stages(FILE *f, durations_t &durations) {
+  bool first = true;
+  fprintf(f, "\"stages\":{");
+  for (durations_t::iterator it=durations.begin();it!=durations.end();++it) {
+    std::vector<uint64_t> &d = it->second;
+    std::sort(d.begin(), d.end());
+    uint64_t sum = 0;
+    for (uint32_t i=0;i<d.size();i++) {
+      sum += d[i];
+    }
+    uint32_t n = d.size();
+    fprintf(f, "%s\n    \"%s\":{\"count\":%d,\"mean_us\":%.2f,\"median_us\":%.2f,\"p99_us\":%.2f,\"max_us\":%.2f}",
+            first?"":",", it->first.c_str(), n, (double) sum/n/1000, d[n/2]/1000.0, d[SRSLTE_MIN(n-1, n*99/100)]/1000.0,
+            d[n-1]/1000.0);
+    first = false;
+  }
+  fprintf(f, "}");
+}
+
+double total_us(std::vector<uint64_t> &d) {
+  uint64_t sum = 0;
+  for (uint32_t i=0;i<d.size();i++) {
+    sum += d[i];
+  }
+  return sum/1000.0;
+}
+
+/* Runs one bandwidth and MCS. Returns false if any PDSCH failed */
+bool run(uint32_t nof_prb, uint32_t mcs, phy_args_t *phy_args, srslte::log *log_h, FILE *f, bool first) {
+  srslte_cell_t cell;
+  bzero(&cell, sizeof(srslte_cell_t));
+  cell.nof_prb   = nof_prb;
+  cell.nof_ports = 1;
+  cell.id        = 1;
+  cell.cp        = SRSLTE_CP_NORM;
+  cell.phich_length     = SRSLTE_PHICH_NORM;
+  cell.phich_resources  = SRSLTE_PHICH_R_1;
+
+  std::vector<cf_t*> subframes(10);
+  int dl_tbs = generate_subframes(cell, mcs, subframes);
+  if (dl_tbs < 0) {
+    return false;
+  }
+
+  phy_interface_rrc::phy_cfg_t config;
+  bzero(&config, sizeof(phy_interface_rrc::phy_cfg_t));
+
+  srslte::radio radio;
+  radio.init_null();
+  radio.set_tx_srate(srslte_sampling_freq_hz(nof_prb));
+
+  benchmac     mac(nof_prb);
+  phch_common  common(phch_recv::MUTEX_X_WORKER);
+  phch_worker  worker;
+  thread_pool  pool(1);
+  durations_t  durations;
+
+  common.set_nof_mutex(phch_recv::MUTEX_X_WORKER);
+  common.init(&config, phy_args, log_h, &radio, &mac);
+  common.set_cell(cell);
+  common.set_dl_rnti(SRSLTE_RNTI_USER, RNTI);
+  common.set_ul_rnti(SRSLTE_RNTI_USER, RNTI);
+
+  worker.set_common(&common);
+  worker.set_name("phy_worker");
+
+  // Cell and RNTI setup, done once per cell in the UE
+  for (uint32_t r=0;r<prog_args.nof_reps;r++) {
+    uint64_t t0 = tti_tracer::now_ns();
+    if (r > 0) {
+      worker.free_cell();
+    }
+    if (!worker.init_cell(cell)) {
+      return false;
+    }
+    uint64_t t1 = tti_tracer::now_ns();
+    worker.set_crnti(RNTI);
+    uint64_t t2 = tti_tracer::now_ns();
+
+    prach prach_buffer;
+    prach_buffer.init(&config.common.prach_cnfg, phy_args, log_h);
+    uint64_t t3 = tti_tracer::now_ns();
+    prach_buffer.init_cell(cell);
+    uint64_t t4 = tti_tracer::now_ns();
+    prach_buffer.free_cell();
+
+    durations["init_cell"].push_back(t1-t0);
+    durations["set_crnti"].push_back(t2-t1);
+    durations["prach_init_cell"].push_back(t4-t3);
+  }
+  worker.set_ul_params();
+  if (prog_args.pregen) {
+    uint64_t t0 = tti_tracer::now_ns();
+    worker.enable_pregen_signals(true);
+    durations["pregen_signals"].push_back(tti_tracer::now_ns()-t0);
+  }
+  worker.set_cfo(0);
+  worker.set_sample_offset(0);
+  if (prog_args.pipelined && !worker.start_ul_thread(0, -1)) {
+    return false;
+  }
+  pool.init_worker(0, &worker, 0, prog_args.cpu);
+
+  tti_tracer *tracer = tti_tracer::get_instance();
+  tracer->start();
+  uint32_t sf_len = SRSLTE_SF_LEN_PRB(nof_prb);
+  srslte_timestamp_t tx_time = {0, 0};
+  for (uint32_t i=0;i<prog_args.nof_subframes;i++) {
+    uint32_t tti = i%10240;
+    phch_worker *w = (phch_worker*) pool.wait_worker(tti);
+    memcpy(w->get_buffer(), subframes[tti%10], sf_len*sizeof(cf_t));
+    srslte_timestamp_add(&tx_time, 0, 1e-3);
+    w->set_tx_time(tx_time);
+    w->set_tti(tti, i%phch_recv::MUTEX_X_WORKER);
+    pool.start_worker(w);
+  }
+  // Wait for the last subframe, whose UL stage may outlive the worker
+  pool.wait_worker(0)->release();
+  worker.wait_ul_stage();
+  tracer->stop();
+  tracer->get_durations(durations);
+  tti_tracer::cleanup();
+  pool.stop();
+  worker.stop_ul_thread();
+  worker.free_cell();
+
+  for (uint32_t i=0;i<10;i++) {
+    free(subframes[i]);
+  }
+
+  // Bits processed per microsecond of stage time
+  double dl_mbps = (double) dl_tbs*mac.nof_dl_ok/total_us(durations["pdsch"]);
+  double ul_mbps = (double) mac.ul_tbs*durations["pusch_encode"].size()/total_us(durations["pusch_encode"]);
+
+  uint32_t late_nacks = worker.get_nof_late_nacks();
+  fprintf(f, "%s\n  {\"nof_prb\":%d,\"mcs\":%d,\"dl_tbs\":%d,\"ul_tbs\":%d,\"subframes\":%d,\"dl_ok\":%d,"
+             "\"dl_late_nack\":%d,\"dl_mbps\":%.2f,\"ul_mbps\":%.2f,\n   ",
+          first?"":",", nof_prb, mcs, dl_tbs, mac.ul_tbs, prog_args.nof_subframes, mac.nof_dl_ok, late_nacks, 
+          dl_mbps, ul_mbps);
+  write_stages(f, durations);
+  fprintf(f, "}");
+  fflush(f);
+
+  fprintf(stderr, "%3d PRB MCS %2d: worker median %.1f us, PDSCH %d/%d, late NACK %d\n", nof_prb, mcs,
+          durations["worker"][durations["worker"].size()/2]/1000.0, mac.nof_dl_ok, prog_args.nof_subframes, late_nacks);
+  // Every PDSCH decodes, so the only NACKs MAC may see are the ones sent on air after the deadline
+  return mac.nof_dl_ok + mac.nof_dl_nack == prog_args.nof_subframes && mac.nof_dl_nack == late_nacks;
+}
+
+int main(int argc, char **argv)
+{
+  parse_args(&prog_args, argc, argv);
+
+  srslte::log_stdout log("PHY");
+  log.set_level(srslte::LOG_LEVEL_ERROR);
+
+  phy_args_t phy_args;
+  srsue::phy defaults;
+  defaults.set_default_args(&phy_args);
+  phy_args.pipelined = prog_args.pipelined;
+  if (prog_args.deadline_us >= 0) {
+    phy_args.pipeline_ack_deadline_us = prog_args.deadline_us;
+  }
+  srand(0);
+
+  FILE *f = stdout;
+  if (prog_args.output) {
+    f = fopen(prog_args.output, "w");
+    if (!f) {
+      perror("fopen");
+      exit(-1);
+    }
+  }
+
+  bool result = true;
+  bool first  = true;
+  fprintf(f, "{\"benchmark\":\"phy_worker\",\"results\":[");
+  for (uint32_t i=0;i<prog_args.nof_prb.size();i++) {
+    for (uint32_t j=0;j<prog_args.mcs.size();j++) {
+      if (!run(prog_args.nof_prb[i], prog_args.mcs[j], &phy_args, &log, f, first)) {
+        fprintf(stderr, "%d PRB MCS %d failed\n", prog_args.nof_prb[i], prog_args.mcs[j]);
+        result = false;
+      }
+      first = false;
+    }
+  }
+  fprintf(f, "\n]}\n");
+  if (f != stdout) {
+    fclose(f);
+  }
+
+  if(result) {
+    exit(0);
+  }else{
+    exit(1);
+  }
+}
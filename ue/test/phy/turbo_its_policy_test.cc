@@ -0,0 +1,160 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/* Checks the turbo iteration cap chosen by turbo_its_policy: the SNR margin
+ * table, the boost on the last HARQ transmission, the cap from the time
+ * left before the deadline, and the counters */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phy/turbo_its_policy.h"
+
+#define MAX_ITS    4
+#define MIN_ITS    2
+#define BOOST_ITS  8
+#define LAST_TX    4
+
+// A grant with 0.75 bits per RE needs 0 dB
+#define TBS        750
+#define NOF_RE     1000
+
+using namespace srsue;
+
+typedef struct {
+  float    snr_db;
+  uint32_t tx_nb;
+  uint32_t nof_cb;
+  uint32_t nof_decoders;
+  int32_t  budget_us;
+  uint32_t its;
+}its_case_t;
+
+static const int32_t NO_DEADLINE = turbo_its_policy::NO_DEADLINE;
+
+/* Without decoding time samples the deadline has no effect */
+static its_case_t margin_cases[] = {
+  { 10.0, 0, 1, 1, NO_DEADLINE, MAX_ITS/2},   // Far above the threshold
+  {  6.0, 0, 1, 1, NO_DEADLINE, MAX_ITS/2},
+  {  4.0, 0, 1, 1, NO_DEADLINE, MAX_ITS},
+  {  2.0, 0, 1, 1, NO_DEADLINE, MAX_ITS},
+  {  1.0, 0, 1, 1, NO_DEADLINE, MAX_ITS+1},   // Around the threshold
+  { -3.0, 0, 1, 1, NO_DEADLINE, MAX_ITS+1},
+  { -4.0, 0, 1, 1, NO_DEADLINE, MIN_ITS},     // Far below the threshold
+  { -4.0, 1, 1, 1, NO_DEADLINE, MAX_ITS+1},   // ... but a retransmission adds 3 dB
+  { 10.0, 3, 1, 1, NO_DEADLINE, BOOST_ITS},   // Last HARQ transmission
+  {-20.0, 5, 1, 1, NO_DEADLINE, BOOST_ITS},
+  {  1.0, 0, 8, 1, 10,          MAX_ITS+1},
+};
+
+/* With 50 us per iteration */
+static its_case_t deadline_cases[] = {
+  {  1.0, 0, 4, 2, NO_DEADLINE, MAX_ITS+1},
+  {  1.0, 0, 4, 2, 1000,        MAX_ITS+1},   // 2 serial code blocks of 5 iterations fit
+  {  1.0, 0, 4, 2, 300,         3},
+  {  1.0, 0, 4, 1, 300,         1},
+  {  1.0, 0, 4, 2, -10,         1},           // Already late, at least one iteration
+  { 10.0, 3, 4, 4, 200,         4},           // The boost is capped too
+  { 10.0, 0, 1, 1, 50,          1},
+};
+
+bool run_cases(turbo_its_policy *policy, its_case_t *cases, uint32_t nof_cases, const char *name)
+{
+  bool result = true;
+  for (uint32_t i=0;i<nof_cases;i++) {
+    its_case_t *c = &cases[i];
+    uint32_t its = policy->get_max_its(c->snr_db, TBS, NOF_RE, c->tx_nb, c->nof_cb, c->nof_decoders, c->budget_us);
+    if (its != c->its) {
+      printf("%s case %d: SNR %.1f dB, tx %d, %d CB, %d decoders, budget %d us: %d iterations, expected %d\n",
+             name, i, c->snr_db, c->tx_nb, c->nof_cb, c->nof_decoders, c->budget_us, its, c->its);
+      result = false;
+    }
+  }
+  return result;
+}
+
+int main(int argc, char **argv)
+{
+  bool result = true;
+  turbo_its_metrics_t m;
+
+  if (turbo_its_policy::required_snr_db(TBS, NOF_RE) != 0) {
+    printf("Required SNR %f dB, expected 0 dB\n", turbo_its_policy::required_snr_db(TBS, NOF_RE));
+    result = false;
+  }
+
+  // Fixed cap
+  turbo_its_policy fixed;
+  fixed.init(false, MAX_ITS, MIN_ITS, BOOST_ITS, LAST_TX);
+  if (fixed.get_max_its(-10.0, TBS, NOF_RE, 3, 4, 1, 10) != MAX_ITS) {
+    printf("Non adaptive policy did not return pdsch_max_its\n");
+    result = false;
+  }
+
+  turbo_its_policy policy;
+  policy.init(true, MAX_ITS, MIN_ITS, BOOST_ITS, LAST_TX);
+  result &= run_cases(&policy, margin_cases, sizeof(margin_cases)/sizeof(its_case_t), "Margin");
+
+  bzero(&m, sizeof(turbo_its_metrics_t));
+  policy.get_metrics(m);
+  if (m.reduced != 3 || m.raised != 6 || m.deadline_limited != 0) {
+    printf("Margin counters: reduced %d, raised %d, deadline %d\n", m.reduced, m.raised, m.deadline_limited);
+    result = false;
+  }
+
+  // 2 code blocks on 1 decoder, 2 iterations each, in 200 us
+  policy.tb_decoded(true, MAX_ITS, 2.0, 2, 1, 200);
+  result &= run_cases(&policy, deadline_cases, sizeof(deadline_cases)/sizeof(its_case_t), "Deadline");
+
+  // Failed TBs count as cap hits and do not update the time per iteration
+  policy.tb_decoded(false, MIN_ITS, MIN_ITS, 2, 1, 100000);
+  policy.tb_decoded(false, MAX_ITS, MAX_ITS, 2, 1, 100000);
+  bzero(&m, sizeof(turbo_its_metrics_t));
+  policy.get_metrics(m);
+  if (m.deadline_limited != 5 || m.cap_hits != 2 || m.cap_hits_reduced != 1) {
+    printf("Deadline counters: deadline %d, cap hits %d (%d reduced)\n", m.deadline_limited, m.cap_hits,
+           m.cap_hits_reduced);
+    result = false;
+  }
+  result &= run_cases(&policy, &deadline_cases[2], 1, "After failures");
+
+  // Counters restart once read
+  bzero(&m, sizeof(turbo_its_metrics_t));
+  policy.get_metrics(m);
+  if (m.deadline_limited != 1 || m.cap_hits != 0 || m.reduced != 1) {
+    printf("Counters not restarted: deadline %d, cap hits %d, reduced %d\n", m.deadline_limited, m.cap_hits, m.reduced);
+    result = false;
+  }
+
+  if (result) {
+    printf("Passed\n");
+    exit(0);
+  } else {
+    printf("Failed\n;");
+    exit(1);
+  }
+}
@@ -211,6 +211,8 @@ public:
   bool rar_rnti_set;
 
   void pch_decoded_ok(uint32_t len) {} 
+  bool is_active_time(uint32_t tti) {return true;}
+  void pdcch_done(uint32_t tti) {}
 
   
   void tti_clock(uint32_t tti) {
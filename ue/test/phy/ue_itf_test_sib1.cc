@@ -131,6 +131,8 @@ public:
   }
   
   void pch_decoded_ok(uint32_t len) {}
+  bool is_active_time(uint32_t tti) {return true;}
+  void pdcch_done(uint32_t tti) {}
 
   void bch_decoded_ok(uint8_t *payload, uint32_t len) {
     printf("BCH decoded\n");
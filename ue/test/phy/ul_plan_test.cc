@@ -0,0 +1,180 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+/* Checks the UL plan tabulated by phch_common against the SR, periodic CQI
+ * and SRS opportunity formulas evaluated for each TTI, and that workers
+ * reading the plan while it is rebuilt always see a complete plan */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <boost/atomic.hpp>
+
+#include "srslte/srslte.h"
+#include "phy/phch_common.h"
+
+#define NOF_REBUILDS 200
+
+using namespace srsue;
+
+typedef struct {
+  uint32_t I_sr;
+  bool     cqi_enabled;
+  uint32_t pmi_idx;
+  bool     srs_enabled;
+  uint32_t srs_sf_cfg;
+  uint32_t I_srs;
+}plan_cfg_t;
+
+static plan_cfg_t cfgs[] = {
+  {  0, false,   0, false,  0,   0},
+  {  5, true,    2, false,  0,   0},
+  { 17, true,   17, true,   0,   0},
+  { 40, true,   38, true,   3,  10},
+  { 80, false,   0, true,   7, 100},
+  {155, true,  160, true,  13, 400},
+  {156, true,  318, true,  15, 936},
+};
+#define NOF_CFGS (sizeof(cfgs)/sizeof(plan_cfg_t))
+
+static void set_config(phy_interface_rrc::phy_cfg_t *config, plan_cfg_t *c)
+{
+  bzero(config, sizeof(phy_interface_rrc::phy_cfg_t));
+  config->dedicated.sched_request_cnfg.sr_cnfg_idx             = c->I_sr;
+  config->dedicated.cqi_report_cnfg.report_periodic_setup_present = c->cqi_enabled;
+  config->dedicated.cqi_report_cnfg.report_periodic.pmi_cnfg_idx  = c->pmi_idx;
+  config->dedicated.srs_ul_cnfg_ded.setup_present              = c->srs_enabled;
+  config->dedicated.srs_ul_cnfg_ded.srs_cnfg_idx               = c->I_srs;
+  config->common.srs_ul_cnfg.subfr_cnfg                        = (LIBLTE_RRC_SRS_SUBFR_CONFIG_ENUM) c->srs_sf_cfg;
+}
+
+// Opportunities computed for a single TTI, as the workers used to do
+static uint32_t expected_plan(plan_cfg_t *c, uint32_t tti)
+{
+  uint32_t v = 0;
+  if (srslte_ue_ul_sr_send_tti(c->I_sr, tti)) {
+    v |= phch_common::UL_PLAN_SR;
+  }
+  if (c->cqi_enabled && srslte_cqi_send(c->pmi_idx, tti)) {
+    v |= phch_common::UL_PLAN_CQI;
+  }
+  if (c->srs_enabled &&
+      srslte_refsignal_srs_send_cs(c->srs_sf_cfg, tti%10) == 1 &&
+      srslte_refsignal_srs_send_ue(c->I_srs, tti)         == 1)
+  {
+    v |= phch_common::UL_PLAN_SRS;
+  }
+  return v;
+}
+
+typedef struct {
+  phch_common        *common;
+  uint8_t            *plan_a;
+  uint8_t            *plan_b;
+  boost::atomic<bool> done;
+  uint32_t            errors;
+}reader_args_t;
+
+void* reader_thread(void *a)
+{
+  reader_args_t *args = (reader_args_t*) a;
+  uint32_t tti = 0;
+  while (!args->done) {
+    uint32_t v = args->common->get_ul_plan(tti);
+    if (v != args->plan_a[tti] && v != args->plan_b[tti]) {
+      args->errors++;
+    }
+    tti = (tti+7)%10240;
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv)
+{
+  bool                          result = true;
+  phch_common                   common;
+  phy_interface_rrc::phy_cfg_t  config;
+
+  common.config = &config;
+
+  // Plan lookups match the per-TTI computation for every TTI
+  for (uint32_t i=0;i<NOF_CFGS;i++) {
+    set_config(&config, &cfgs[i]);
+    common.build_ul_plan();
+    uint32_t errors = 0;
+    for (uint32_t tti=0;tti<10240;tti++) {
+      if (common.get_ul_plan(tti) != expected_plan(&cfgs[i], tti)) {
+        errors++;
+      }
+    }
+    // Lookups use the TX TTI modulo 10240
+    if (common.get_ul_plan(10240+3) != expected_plan(&cfgs[i], 3)) {
+      errors++;
+    }
+    if (errors) {
+      printf("Config %d: %d TTIs differ\n", i, errors);
+      result = false;
+    }
+  }
+
+  // Readers see either the old or the new plan while it is rebuilt
+  static uint8_t plan_a[10240];
+  static uint8_t plan_b[10240];
+  for (uint32_t tti=0;tti<10240;tti++) {
+    plan_a[tti] = expected_plan(&cfgs[3], tti);
+    plan_b[tti] = expected_plan(&cfgs[5], tti);
+  }
+  set_config(&config, &cfgs[3]);
+  common.build_ul_plan();
+
+  reader_args_t args;
+  args.common = &common;
+  args.plan_a = plan_a;
+  args.plan_b = plan_b;
+  args.done   = false;
+  args.errors = 0;
+  pthread_t reader;
+  pthread_create(&reader, NULL, &reader_thread, &args);
+  for (uint32_t i=0;i<NOF_REBUILDS;i++) {
+    set_config(&config, &cfgs[(i%2) ? 3 : 5]);
+    common.build_ul_plan();
+  }
+  args.done = true;
+  pthread_join(reader, NULL);
+  if (args.errors) {
+    printf("%d lookups did not match any plan\n", args.errors);
+    result = false;
+  }
+
+  if (result) {
+    printf("Passed\n");
+    exit(0);
+  } else {
+    printf("Failed\n;");
+    exit(1);
+  }
+}
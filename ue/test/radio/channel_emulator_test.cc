@@ -0,0 +1,289 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "radio/channel_emulator.h"
+
+#define SRATE   1.92e6
+#define SF_LEN  1920
+
+using namespace srslte;
+
+typedef enum {
+  SOURCE_RAMP = 0,    // Sample n holds n
+  SOURCE_ONE,
+  SOURCE_NOISE
+} source_t;
+
+// Emulates the radio reading from a device whose sample n is at time n/SRATE
+class test_radio
+{
+public:
+  test_radio(channel_emulator_args_t *args, source_t source_) {
+    source = source_;
+    count  = 0;
+    seed   = 1;
+    if (!channel.init(args)) {
+      exit(1);
+    }
+    channel.set_srate(SRATE);
+  }
+  void rx(cf_t *out, uint32_t nof_samples, srslte_timestamp_t *t) {
+    uint32_t n  = channel.get_nof_input(nof_samples);
+    cf_t    *in = channel.get_input_buffer(n);
+    srslte_timestamp_t in_time = {0, 0};
+    srslte_timestamp_add(&in_time, 0, count/SRATE);
+    for (uint32_t i=0;i<n;i++) {
+      switch(source) {
+        case SOURCE_RAMP:
+          in[i] = count+i;
+          break;
+        case SOURCE_ONE:
+          in[i] = 1;
+          break;
+        case SOURCE_NOISE:
+          in[i] = (float) rand_r(&seed)/RAND_MAX-0.5 + _Complex_I*((float) rand_r(&seed)/RAND_MAX-0.5);
+          break;
+      }
+    }
+    count += n;
+    channel.run(&in_time, out, nof_samples, t);
+  }
+  channel_emulator channel;
+  source_t         source;
+  uint64_t         count;
+  unsigned int     seed;
+};
+
+void default_args(channel_emulator_args_t *args)
+{
+  args->enable       = true;
+  args->seed         = 1;
+  args->awgn_enable  = false;
+  args->snr_db       = 0;
+  args->cfo_hz       = 0;
+  args->drift_ppm    = 0;
+  args->fading_model = "none";
+  args->doppler_hz   = 0;
+  args->drop_rate    = 0;
+  args->drop_len_us  = 0;
+}
+
+double secs(srslte_timestamp_t *t)
+{
+  return t->full_secs + t->frac_secs;
+}
+
+// Without impairments the samples and timestamps are unchanged
+bool passthrough()
+{
+  channel_emulator_args_t args;
+  default_args(&args);
+  test_radio r(&args, SOURCE_RAMP);
+  cf_t out[SF_LEN];
+  srslte_timestamp_t t;
+  for (uint32_t sf=0;sf<10;sf++) {
+    r.rx(out, SF_LEN, &t);
+    if (fabs(secs(&t) - sf*SF_LEN/SRATE) > 1e-9) {
+      return false;
+    }
+    for (uint32_t i=0;i<SF_LEN;i++) {
+      if (out[i] != (float) (sf*SF_LEN+i)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// A UE clock 100 ppm fast takes output sample k at device time k/(1+100e-6)
+bool drift()
+{
+  channel_emulator_args_t args;
+  default_args(&args);
+  args.drift_ppm = 100;
+  test_radio r(&args, SOURCE_RAMP);
+  cf_t out[SF_LEN];
+  srslte_timestamp_t t;
+  for (uint32_t sf=0;sf<100;sf++) {
+    r.rx(out, SF_LEN, &t);
+    double first = sf*SF_LEN/(1+100e-6);
+    if (fabs(secs(&t) - first/SRATE) > 1e-9) {
+      printf("Subframe %d at %f, expected %f\n", sf, secs(&t), first/SRATE);
+      return false;
+    }
+    for (uint32_t i=sf?0:2;i<SF_LEN;i++) {
+      double expected = (sf*SF_LEN+i)/(1+100e-6);
+      if (fabs(crealf(out[i]) - expected) > 0.05) {
+        printf("Sample %d: %f, expected %f\n", sf*SF_LEN+i, crealf(out[i]), expected);
+        return false;
+      }
+    }
+  }
+  // The device delivered less samples than the UE read
+  return r.count < 100*SF_LEN && r.count > 100*SF_LEN*(1-110e-6);
+}
+
+// Drops skip whole bursts of the stream
+bool drops()
+{
+  channel_emulator_args_t args;
+  default_args(&args);
+  args.drop_rate   = 50;
+  args.drop_len_us = 100;
+  test_radio r(&args, SOURCE_RAMP);
+  cf_t out[SF_LEN];
+  float    last      = -1;
+  uint32_t nof_drops = 0;
+  for (uint32_t sf=0;sf<1000;sf++) {
+    r.rx(out, SF_LEN, NULL);
+    for (uint32_t i=0;i<SF_LEN;i++) {
+      float d = crealf(out[i]) - last;
+      if (d == 193) {
+        nof_drops++;
+      } else if (d != 1) {
+        printf("Sample %d: %f after %f\n", sf*SF_LEN+i, crealf(out[i]), last);
+        return false;
+      }
+      last = crealf(out[i]);
+    }
+  }
+  if (nof_drops < 25 || nof_drops > 75 || nof_drops*192 != r.channel.get_nof_dropped()) {
+    printf("%d drops, %d samples dropped\n", nof_drops, (int) r.channel.get_nof_dropped());
+    return false;
+  }
+  return true;
+}
+
+bool awgn()
+{
+  channel_emulator_args_t args;
+  default_args(&args);
+  args.awgn_enable = true;
+  args.snr_db      = 10;
+  test_radio r(&args, SOURCE_ONE);
+  cf_t   out[SF_LEN];
+  double noise = 0;
+  for (uint32_t sf=0;sf<100;sf++) {
+    r.rx(out, SF_LEN, NULL);
+    for (uint32_t i=0;i<SF_LEN;i++) {
+      noise += pow(cabsf(out[i]-1), 2);
+    }
+  }
+  noise /= 100*SF_LEN;
+  if (fabs(noise - 0.1) > 0.01) {
+    printf("Noise power %f, expected 0.1\n", noise);
+    return false;
+  }
+  return true;
+}
+
+bool cfo()
+{
+  channel_emulator_args_t args;
+  default_args(&args);
+  args.cfo_hz = -1000;
+  test_radio r(&args, SOURCE_ONE);
+  cf_t out[SF_LEN];
+  cf_t last = 1;
+  for (uint32_t sf=0;sf<100;sf++) {
+    r.rx(out, SF_LEN, NULL);
+    for (uint32_t i=sf?0:1;i<SF_LEN;i++) {
+      float dphase = cargf(out[i]*conjf(last));
+      if (fabs(cabsf(out[i]) - 1) > 1e-3 || fabs(dphase + 2*M_PI*1000/SRATE) > 1e-4) {
+        printf("Sample %d: %f %f\n", sf*SF_LEN+i, crealf(out[i]), cimagf(out[i]));
+        return false;
+      }
+      last = out[i];
+    }
+  }
+  return true;
+}
+
+// Fading keeps the average power and the output depends only on the seed
+bool fading()
+{
+  channel_emulator_args_t args;
+  default_args(&args);
+  args.fading_model = "eva";
+  args.doppler_hz   = 70;
+  args.cfo_hz       = 100;
+  args.drift_ppm    = -5;
+  args.awgn_enable  = true;
+  args.snr_db       = 20;
+  args.drop_rate    = 10;
+  args.drop_len_us  = 50;
+  test_radio r1(&args, SOURCE_NOISE), r2(&args, SOURCE_NOISE);
+  args.seed = 2;
+  test_radio r3(&args, SOURCE_NOISE);
+
+  cf_t   out1[SF_LEN], out2[SF_LEN], out3[SF_LEN];
+  double power = 0;
+  bool   same  = true, other = false;
+  for (uint32_t sf=0;sf<2000;sf++) {
+    r1.rx(out1, SF_LEN, NULL);
+    r2.rx(out2, SF_LEN, NULL);
+    r3.rx(out3, SF_LEN, NULL);
+    for (uint32_t i=0;i<SF_LEN;i++) {
+      power += pow(cabsf(out1[i]), 2);
+      same  &= out1[i] == out2[i];
+      other |= out1[i] != out3[i];
+    }
+  }
+  // Input power is 1/6, noise adds 1%
+  power /= 2000*SF_LEN;
+  if (fabs(power*6 - 1.01) > 0.25 || !same || !other) {
+    printf("Power %f, same %d, other %d\n", power*6, same, other);
+    return false;
+  }
+  // Unknown models are rejected
+  channel_emulator c;
+  args.fading_model = "foo";
+  return !c.init(&args);
+}
+
+int main(int argc, char **argv)
+{
+  bool result = true;
+  const char *names[] = {"Passthrough", "Drift", "Drops", "AWGN", "CFO", "Fading"};
+  bool (*tests[])()   = {passthrough, drift, drops, awgn, cfo, fading};
+  for (uint32_t i=0;i<6;i++) {
+    if (!tests[i]()) {
+      printf("%s failed\n", names[i]);
+      result = false;
+    }
+  }
+
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
@@ -0,0 +1,124 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include "radio/iq_file.h"
+
+#define FILENAME  "/tmp/iq_file_test.iq"
+#define CHUNK     1000
+#define NOF_CHUNK 5
+
+using namespace srslte;
+
+cf_t buffer[CHUNK];
+
+// Sample n of the capture holds the value n
+void fill(uint32_t first) {
+  for(uint32_t i=0;i<CHUNK;i++)
+    buffer[i] = first + i;
+}
+
+int main(int argc, char **argv)
+{
+  bool result = true;
+
+  // Chunk i is received at time[i] with srate[i]
+  double time[NOF_CHUNK]  = {10.0, 10.001, 10.002, 10.5, 10.5005};
+  double srate[NOF_CHUNK] = {1e6, 1e6, 1e6, 2e6, 2e6};
+
+  iq_recorder recorder;
+  if(!recorder.open(FILENAME)) {
+    exit(1);
+  }
+  recorder.set(IQ_FILE_RX_FREQ, 2680e6);
+  for(uint32_t i=0;i<NOF_CHUNK;i++) {
+    if(i == 0 || srate[i] != srate[i-1])
+      recorder.set(IQ_FILE_RX_SRATE, srate[i]);
+    srslte_timestamp_t t = {10, time[i]-10};
+    fill(i*CHUNK);
+    recorder.rx(buffer, CHUNK, &t);
+    if(i == 1) {
+      // TX bursts are skipped when replaying
+      srslte_timestamp_add(&t, 0, 4e-3);
+      recorder.tx(buffer, CHUNK, &t, true);
+      recorder.tx_end(&t);
+    }
+  }
+  recorder.close();
+
+  iq_player player;
+  if(!player.open(FILENAME, false)) {
+    exit(1);
+  }
+  player.check(IQ_FILE_RX_SRATE, 1e6);
+  if(player.get(IQ_FILE_RX_FREQ) != 2680e6)
+    result = false;
+
+  // Read in chunks that do not match the recorded ones
+  uint32_t n = 0;
+  cf_t     data[700];
+  srslte_timestamp_t t;
+  while(player.rx_now(data, 700, &t)) {
+    if(player.is_finished())
+      result = false;
+    double expected = time[n/CHUNK] + (double) (n%CHUNK)/srate[n/CHUNK];
+    if(fabs(t.full_secs + t.frac_secs - expected) > 1e-9) {
+      printf("Sample %d: timestamp %f, expected %f\n", n, t.full_secs + t.frac_secs, expected);
+      result = false;
+    }
+    for(uint32_t i=0;i<700;i++) {
+      if(crealf(data[i]) != n+i) {
+        printf("Sample %d: value %f\n", n+i, crealf(data[i]));
+        result = false;
+        break;
+      }
+    }
+    n += 700;
+  }
+  // The last incomplete read is dropped
+  if(n != (NOF_CHUNK*CHUNK/700)*700 || player.get(IQ_FILE_RX_SRATE) != 2e6 || !player.is_finished())
+    result = false;
+  player.close();
+
+  // Files that are not captures are rejected
+  FILE *f = fopen(FILENAME, "w");
+  fprintf(f, "Not a capture\n");
+  fclose(f);
+  if(player.open(FILENAME, false))
+    result = false;
+  unlink(FILENAME);
+
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
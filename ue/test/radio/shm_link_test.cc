@@ -0,0 +1,186 @@
+/**
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2013-2015 Software Radio Systems Limited
+ *
+ * \section LICENSE
+ *
+ * This file is part of the srsUE library.
+ *
+ * srsUE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * srsUE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * A copy of the GNU Affero General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "radio/shm_link.h"
+
+#define SRATE     1.92e6
+#define SF_LEN    1920
+#define NOF_SF    300
+#define TX_DELAY  (4*SF_LEN)
+
+using namespace srslte;
+
+/* Each endpoint receives a subframe and transmits one 4 subframes later in
+ * which the sample at time t holds t, negated in the UL. Checks that the
+ * peer samples arrive at their time and that silence reads as zeros. Free
+ * running endpoints may be descheduled for longer than the TX delay: the
+ * samples they send late are dropped and read as zeros */
+typedef struct endpoint_args_s {
+  shm_link                link;
+  float                   sign;
+  volatile int64_t        first_rx;   // Time of the first sample received or -1
+  struct endpoint_args_s *peer;
+  uint32_t                nof_missing;
+  bool                    result;
+} endpoint_args_t;
+
+void* endpoint_thread(void *arg)
+{
+  endpoint_args_t *a = (endpoint_args_t*) arg;
+  cf_t rx_buffer[SF_LEN], tx_buffer[SF_LEN];
+  a->result      = true;
+  a->nof_missing = 0;
+  for(uint32_t sf=0;sf<NOF_SF;sf++) {
+    srslte_timestamp_t t;
+    if(!a->link.rx_now(rx_buffer, SF_LEN, &t)) {
+      printf("Error receiving subframe %d\n", sf);
+      a->result = false;
+      break;
+    }
+    uint64_t rx_time = (uint64_t) round((t.full_secs + t.frac_secs)*SRATE);
+    if(sf == 0)
+      a->first_rx = rx_time;
+    // The peer transmits NOF_SF subframes from TX_DELAY after its first one
+    while(a->peer->first_rx < 0)
+      usleep(100);
+    int64_t tx_start = a->peer->first_rx + TX_DELAY;
+    int64_t tx_end   = tx_start + NOF_SF*SF_LEN;
+    for(uint32_t i=0;i<SF_LEN;i++) {
+      int64_t n        = rx_time+i;
+      float   expected = n >= tx_start && n < tx_end ? -a->sign*n : 0;
+      if(crealf(rx_buffer[i]) == 0 && expected != 0) {
+        a->nof_missing++;
+      } else if(crealf(rx_buffer[i]) != expected) {
+        printf("Sample %d: received %f, expected %f\n", (int) n, crealf(rx_buffer[i]), expected);
+        a->result = false;
+      }
+    }
+    for(uint32_t i=0;i<SF_LEN;i++)
+      tx_buffer[i] = a->sign*(rx_time+TX_DELAY+i);
+    srslte_timestamp_add(&t, 0, (double) TX_DELAY/SRATE);
+    a->link.tx(tx_buffer, SF_LEN, &t);
+  }
+  return NULL;
+}
+
+bool run(bool lockstep)
+{
+  endpoint_args_t ue, enb;
+  const char *name = "/srsue_shm_link_test";
+  shm_unlink(name);
+  if(!ue.link.open(name, shm_link::ENDPOINT_UE, SRATE, lockstep) ||
+     !enb.link.open(name, shm_link::ENDPOINT_ENB, SRATE, lockstep))
+    return false;
+  ue.sign  = -1;
+  enb.sign = 1;
+  ue.first_rx  = -1;
+  enb.first_rx = -1;
+  ue.peer      = &enb;
+  enb.peer     = &ue;
+
+  pthread_t t1, t2;
+  pthread_create(&t1, NULL, endpoint_thread, &ue);
+  pthread_create(&t2, NULL, endpoint_thread, &enb);
+  pthread_join(t1, NULL);
+  pthread_join(t2, NULL);
+  bool result = ue.result && enb.result;
+  if(ue.nof_missing != enb.link.get_nof_late() || enb.nof_missing != ue.link.get_nof_late()) {
+    printf("Missing %d/%d samples, %d/%d sent late\n", ue.nof_missing, enb.nof_missing,
+           (int) enb.link.get_nof_late(), (int) ue.link.get_nof_late());
+    result = false;
+  }
+  if(lockstep && (ue.nof_missing || enb.nof_missing))
+    result = false;
+  ue.link.close();
+  enb.link.close();
+  return result;
+}
+
+// A reader at a quarter of the link rate gets the low-pass filtered signal
+bool decimation()
+{
+  shm_link ue, enb;
+  const char *name = "/srsue_shm_link_test";
+  shm_unlink(name);
+  if(!ue.open(name, shm_link::ENDPOINT_UE, 4*SRATE, true) ||
+     !enb.open(name, shm_link::ENDPOINT_ENB, 4*SRATE, true))
+    return false;
+  ue.set_rx_srate(SRATE);
+
+  static cf_t tx_buffer[40*SF_LEN];
+  for(uint32_t i=0;i<40*SF_LEN;i++)
+    tx_buffer[i] = 1 + cexpf(_Complex_I*2*M_PI*0.3*i);   // DC plus a tone outside the output band
+  srslte_timestamp_t t = {0, 0};
+  enb.tx(tx_buffer, 40*SF_LEN, &t);
+
+  bool result = true;
+  cf_t rx_buffer[SF_LEN];
+  for(uint32_t sf=0;sf<5;sf++) {
+    if(!ue.rx_now(rx_buffer, SF_LEN, &t))
+      result = false;
+    for(uint32_t i=sf?0:100;i<SF_LEN;i++) {
+      if(cabsf(rx_buffer[i] - 1) > 0.01) {
+        printf("Decimated sample %d: %f %f\n", sf*SF_LEN+i, crealf(rx_buffer[i]), cimagf(rx_buffer[i]));
+        result = false;
+        break;
+      }
+    }
+  }
+  ue.close();
+  enb.close();
+  return result;
+}
+
+int main(int argc, char **argv)
+{
+  bool result = true;
+  if(!run(true)) {
+    printf("Lockstep link failed\n");
+    result = false;
+  }
+  if(!run(false)) {
+    printf("Free running link failed\n");
+    result = false;
+  }
+  if(!decimation()) {
+    printf("Decimation failed\n");
+    result = false;
+  }
+
+  if(result) {
+    printf("Passed\n");
+    exit(0);
+  }else{
+    printf("Failed\n;");
+    exit(1);
+  }
+}
@@ -39,12 +39,18 @@ class mac_dummy_timers
 public:
   srslte::timers::timer* get(uint32_t timer_id)
   {
-    return &t;
+    return t.get(timer_id);
+  }
+  uint32_t get_unique_id(){return t.get_unique_id();}
+  void release_id(uint32_t timer_id){t.release_id(timer_id);}
+  void step(uint32_t nof_ttis)
+  {
+    for(uint32_t i=0;i<nof_ttis;i++)
+      t.step_all();
   }
-  uint32_t get_unique_id(){return 0;}
 
 private:
-  srslte::timers::timer t;
+  srslte::timers t;
 };
 
 class rlc_am_tester
@@ -58,7 +64,8 @@ public:
   void write_pdu(uint32_t lcid, byte_buffer_t *sdu)
   {
     assert(lcid == 1);
-    sdus[n_sdus++] = sdu;
+    // SDUs arrive as segment chains
+    sdus[n_sdus++] = buffer_pool::get_instance()->flatten(sdu);
   }
   void write_pdu_bcch_bch(byte_buffer_t *sdu) {}
   void write_pdu_bcch_dlsch(byte_buffer_t *sdu) {}
@@ -100,6 +107,7 @@ void basic_test()
   cnfg.ul_am_rlc.max_retx_thresh = LIBLTE_RRC_MAX_RETX_THRESHOLD_T4;
   cnfg.ul_am_rlc.poll_byte = LIBLTE_RRC_POLL_BYTE_KB25;
   cnfg.ul_am_rlc.poll_pdu = LIBLTE_RRC_POLL_PDU_P4;
+  cnfg.ul_am_rlc.t_poll_retx = LIBLTE_RRC_T_POLL_RETRANSMIT_MS5;
 
   rlc1.configure(&cnfg);
   rlc2.configure(&cnfg);
@@ -179,6 +187,7 @@ void concat_test()
   cnfg.ul_am_rlc.max_retx_thresh = LIBLTE_RRC_MAX_RETX_THRESHOLD_T4;
   cnfg.ul_am_rlc.poll_byte = LIBLTE_RRC_POLL_BYTE_KB25;
   cnfg.ul_am_rlc.poll_pdu = LIBLTE_RRC_POLL_PDU_P4;
+  cnfg.ul_am_rlc.t_poll_retx = LIBLTE_RRC_T_POLL_RETRANSMIT_MS5;
 
   rlc1.configure(&cnfg);
   rlc2.configure(&cnfg);
@@ -243,6 +252,7 @@ void segment_test()
   cnfg.ul_am_rlc.max_retx_thresh = LIBLTE_RRC_MAX_RETX_THRESHOLD_T4;
   cnfg.ul_am_rlc.poll_byte = LIBLTE_RRC_POLL_BYTE_KB25;
   cnfg.ul_am_rlc.poll_pdu = LIBLTE_RRC_POLL_PDU_P4;
+  cnfg.ul_am_rlc.t_poll_retx = LIBLTE_RRC_T_POLL_RETRANSMIT_MS5;
 
   rlc1.configure(&cnfg);
   rlc2.configure(&cnfg);
@@ -325,6 +335,7 @@ void retx_test()
   cnfg.ul_am_rlc.max_retx_thresh = LIBLTE_RRC_MAX_RETX_THRESHOLD_T4;
   cnfg.ul_am_rlc.poll_byte = LIBLTE_RRC_POLL_BYTE_KB25;
   cnfg.ul_am_rlc.poll_pdu = LIBLTE_RRC_POLL_PDU_P4;
+  cnfg.ul_am_rlc.t_poll_retx = LIBLTE_RRC_T_POLL_RETRANSMIT_MS5;
 
   rlc1.configure(&cnfg);
   rlc2.configure(&cnfg);
@@ -357,8 +368,8 @@ void retx_test()
       rlc2.write_pdu(pdu_bufs[i].msg, pdu_bufs[i].N_bytes);
   }
 
-  // Sleep to let reordering timeout expire
-  usleep(10000);
+  // Step timers to let reordering timeout expire
+  timers.step(10);
 
   assert(4 == rlc2.get_buffer_state());
 
@@ -421,6 +432,7 @@ void resegment_test_1()
   cnfg.ul_am_rlc.max_retx_thresh = LIBLTE_RRC_MAX_RETX_THRESHOLD_T4;
   cnfg.ul_am_rlc.poll_byte = LIBLTE_RRC_POLL_BYTE_KB25;
   cnfg.ul_am_rlc.poll_pdu = LIBLTE_RRC_POLL_PDU_P4;
+  cnfg.ul_am_rlc.t_poll_retx = LIBLTE_RRC_T_POLL_RETRANSMIT_MS5;
 
   rlc1.configure(&cnfg);
   rlc2.configure(&cnfg);
@@ -454,8 +466,8 @@ void resegment_test_1()
       rlc2.write_pdu(pdu_bufs[i].msg, pdu_bufs[i].N_bytes);
   }
 
-  // Sleep to let reordering timeout expire
-  usleep(10000);
+  // Step timers to let reordering timeout expire
+  timers.step(10);
 
   assert(4 == rlc2.get_buffer_state());
 
@@ -530,6 +542,7 @@ void resegment_test_2()
   cnfg.ul_am_rlc.max_retx_thresh = LIBLTE_RRC_MAX_RETX_THRESHOLD_T4;
   cnfg.ul_am_rlc.poll_byte = LIBLTE_RRC_POLL_BYTE_KB25;
   cnfg.ul_am_rlc.poll_pdu = LIBLTE_RRC_POLL_PDU_P4;
+  cnfg.ul_am_rlc.t_poll_retx = LIBLTE_RRC_T_POLL_RETRANSMIT_MS5;
 
   rlc1.configure(&cnfg);
   rlc2.configure(&cnfg);
@@ -563,8 +576,8 @@ void resegment_test_2()
       rlc2.write_pdu(pdu_bufs[i].msg, pdu_bufs[i].N_bytes);
   }
 
-  // Sleep to let reordering timeout expire
-  usleep(10000);
+  // Step timers to let reordering timeout expire
+  timers.step(10);
 
   assert(4 == rlc2.get_buffer_state());
 
@@ -636,6 +649,7 @@ void resegment_test_3()
   cnfg.ul_am_rlc.max_retx_thresh = LIBLTE_RRC_MAX_RETX_THRESHOLD_T4;
   cnfg.ul_am_rlc.poll_byte = LIBLTE_RRC_POLL_BYTE_KB25;
   cnfg.ul_am_rlc.poll_pdu = LIBLTE_RRC_POLL_PDU_P4;
+  cnfg.ul_am_rlc.t_poll_retx = LIBLTE_RRC_T_POLL_RETRANSMIT_MS5;
 
   rlc1.configure(&cnfg);
   rlc2.configure(&cnfg);
@@ -669,8 +683,8 @@ void resegment_test_3()
       rlc2.write_pdu(pdu_bufs[i].msg, pdu_bufs[i].N_bytes);
   }
 
-  // Sleep to let reordering timeout expire
-  usleep(10000);
+  // Step timers to let reordering timeout expire
+  timers.step(10);
 
   assert(4 == rlc2.get_buffer_state());
 
@@ -738,6 +752,7 @@ void resegment_test_4()
   cnfg.ul_am_rlc.max_retx_thresh = LIBLTE_RRC_MAX_RETX_THRESHOLD_T4;
   cnfg.ul_am_rlc.poll_byte = LIBLTE_RRC_POLL_BYTE_KB25;
   cnfg.ul_am_rlc.poll_pdu = LIBLTE_RRC_POLL_PDU_P4;
+  cnfg.ul_am_rlc.t_poll_retx = LIBLTE_RRC_T_POLL_RETRANSMIT_MS5;
 
   rlc1.configure(&cnfg);
   rlc2.configure(&cnfg);
@@ -771,8 +786,8 @@ void resegment_test_4()
       rlc2.write_pdu(pdu_bufs[i].msg, pdu_bufs[i].N_bytes);
   }
 
-  // Sleep to let reordering timeout expire
-  usleep(10000);
+  // Step timers to let reordering timeout expire
+  timers.step(10);
 
   assert(4 == rlc2.get_buffer_state());
 
@@ -840,6 +855,7 @@ void resegment_test_5()
   cnfg.ul_am_rlc.max_retx_thresh = LIBLTE_RRC_MAX_RETX_THRESHOLD_T4;
   cnfg.ul_am_rlc.poll_byte = LIBLTE_RRC_POLL_BYTE_KB25;
   cnfg.ul_am_rlc.poll_pdu = LIBLTE_RRC_POLL_PDU_P4;
+  cnfg.ul_am_rlc.t_poll_retx = LIBLTE_RRC_T_POLL_RETRANSMIT_MS5;
 
   rlc1.configure(&cnfg);
   rlc2.configure(&cnfg);
@@ -873,8 +889,8 @@ void resegment_test_5()
       rlc2.write_pdu(pdu_bufs[i].msg, pdu_bufs[i].N_bytes);
   }
 
-  // Sleep to let reordering timeout expire
-  usleep(10000);
+  // Step timers to let reordering timeout expire
+  timers.step(10);
 
   assert(4 == rlc2.get_buffer_state());
 
@@ -941,6 +957,7 @@ void resegment_test_6()
   cnfg.ul_am_rlc.max_retx_thresh = LIBLTE_RRC_MAX_RETX_THRESHOLD_T4;
   cnfg.ul_am_rlc.poll_byte = LIBLTE_RRC_POLL_BYTE_KB25;
   cnfg.ul_am_rlc.poll_pdu = LIBLTE_RRC_POLL_PDU_P4;
+  cnfg.ul_am_rlc.t_poll_retx = LIBLTE_RRC_T_POLL_RETRANSMIT_MS5;
 
   rlc1.configure(&cnfg);
   rlc2.configure(&cnfg);
@@ -984,8 +1001,8 @@ void resegment_test_6()
       rlc2.write_pdu(pdu_bufs[i].msg, pdu_bufs[i].N_bytes);
   }
 
-  // Sleep to let reordering timeout expire
-  usleep(10000);
+  // Step timers to let reordering timeout expire
+  timers.step(10);
 
   assert(4 == rlc2.get_buffer_state());
 
@@ -42,6 +42,7 @@ public:
     return &t;
   }
   uint32_t get_unique_id(){return 0;}
+  void release_id(uint32_t timer_id){}
   void step()
   {
     t.step();
@@ -62,7 +63,8 @@ public:
   void write_pdu(uint32_t lcid, byte_buffer_t *sdu)
   {
     assert(lcid == 3);
-    sdus[n_sdus++] = sdu;
+    // SDUs arrive as segment chains
+    sdus[n_sdus++] = buffer_pool::get_instance()->flatten(sdu);
   }
   void write_pdu_bcch_bch(byte_buffer_t *sdu) {}
   void write_pdu_bcch_dlsch(byte_buffer_t *sdu) {}